@@ -0,0 +1,81 @@
+#!/bin/sh
+# compares bench results against the baseline, exits 1 when a stage got slower than the tolerances allow
+# usage: compare.sh baseline.tsv results.tsv
+# environment:
+#   BENCH_TOLERANCE      allowed increase of avg and p50 in percent, default 10
+#   BENCH_P99_TOLERANCE  allowed increase of p99 in percent, default 25
+#   BENCH_NOISE_US       increases below this many microseconds are never regressions, default 20
+# stages missing from the baseline are reported and pass, baseline stages missing from the results fail
+# a missing baseline or one without data rows skips the comparison, record one with make bench_baseline on the reference ICD
+
+set -u
+
+if [ $# -ne 2 ]; then
+    echo "usage: $0 baseline.tsv results.tsv" >&2
+    exit 2
+fi
+
+if [ ! -f "$1" ] || ! grep -q '^[^#]' "$1"; then
+    echo "skipped: no baseline rows in $1, record them with make bench_baseline"
+    exit 0
+fi
+
+awk -F '\t' \
+    -v tolerance="${BENCH_TOLERANCE:-10}" \
+    -v p99Tolerance="${BENCH_P99_TOLERANCE:-25}" \
+    -v noise="${BENCH_NOISE_US:-20}" '
+    # slower by more than the tolerance and the noise floor
+    function regressed(base, current, percent) {
+        return current - base > noise && current > base * (1 + percent / 100)
+    }
+
+    function check(metric, base, current, percent) {
+        change = base > 0 ? (current - base) / base * 100 : 0
+        if (regressed(base, current, percent)) {
+            printf "REGRESSION %-16s %-20s %-4s %10.1f -> %10.1f us (%+.1f%%)\n", $1, $2, metric, base, current, change
+            failures++
+        }
+        else {
+            printf "ok         %-16s %-20s %-4s %10.1f -> %10.1f us (%+.1f%%)\n", $1, $2, metric, base, current, change
+        }
+    }
+
+    /^#/ { next }
+
+    FILENAME == ARGV[1] {
+        key = $1 FS $2
+        baseAvg[key] = $4
+        baseP50[key] = $5
+        baseP99[key] = $6
+        next
+    }
+
+    {
+        key = $1 FS $2
+        seen[key] = 1
+        if (!(key in baseAvg)) {
+            printf "new        %-16s %-20s no baseline\n", $1, $2
+            next
+        }
+
+        check("avg", baseAvg[key], $4, tolerance)
+        check("p50", baseP50[key], $5, tolerance)
+        check("p99", baseP99[key], $6, p99Tolerance)
+    }
+
+    END {
+        # renamed stages and scenarios that stopped emitting one would otherwise pass unnoticed
+        for (key in baseAvg) {
+            if (!(key in seen)) {
+                split(key, field, FS)
+                printf "MISSING    %-16s %-20s in baseline, not in results\n", field[1], field[2]
+                failures++
+            }
+        }
+
+        if (failures > 0) {
+            printf "%d failures\n", failures
+            exit 1
+        }
+    }
+' "$1" "$2"
@@ -0,0 +1,118 @@
+/**
+ * @file cull_bench.c
+ * @brief frustum culling throughput over object count and thread count
+ *
+ * prints one "name threads objects value unit" line per measurement
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "init.h"
+#include "job.h"
+#include "log.h"
+#include "simd.h"
+#include "trace.h"
+#include "visibility.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define BENCH_MIN_OBJECTS (1u << 14)
+#define BENCH_MAX_OBJECTS (1u << 22)
+#define BENCH_ROUNDS 20
+
+// full parallel cull must keep exactly what the scalar kernel keeps, in the same order
+static void checkAgainstScalar(Visibility* visibility, mat4 viewProjection)
+{
+    vec4 planes[6];
+    visibilityFrustumPlanes(viewProjection, planes);
+
+    uint32_t* reference = malloc(sizeof(uint32_t) * visibility->capacity);
+    uint32_t referenceCount = visibilityKernelCullScalar(visibility, planes, 0, visibility->count, reference);
+
+    visibilityCull(visibility, viewProjection);
+
+    int same = referenceCount == visibility->visibleCount;
+    for (uint32_t i = 0; same && i < referenceCount; i++)
+    {
+        same = reference[i] == visibility->visible[i];
+    }
+
+    free(reference);
+
+    if (!same) {
+        fprintf(stderr, "parallel culling differs from scalar reference\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    uint32_t maxThreads = argc > 1 ? (uint32_t) strtoul(argv[1], NULL, 10) : (uint32_t) (cores > 0 ? cores : 1);
+    if (maxThreads == 0 || maxThreads > JOB_MAX_THREADS) {
+        maxThreads = JOB_MAX_THREADS;
+    }
+
+    logLevel = LOG_LEVEL_WARN;
+
+    State state = {0};
+    createVisibility(&state, BENCH_MAX_OBJECTS);
+    Visibility* visibility = &state.visibility;
+
+    // objects scattered around the frustum, roughly a quarter survives
+    uint32_t seed = 0x9E3779B9u;
+    for (uint32_t i = 0; i < BENCH_MAX_OBJECTS; i++)
+    {
+        vec3 center = {simdRandomRange(&seed, -2.0f, 2.0f), simdRandomRange(&seed, -2.0f, 2.0f), simdRandomRange(&seed, 0.0f, 1.0f)};
+        vec3 extent = {simdRandomRange(&seed, 0.0f, 0.05f), simdRandomRange(&seed, 0.0f, 0.05f), 0.0f};
+        visibilityAdd(visibility, center, extent);
+    }
+
+    // identity -> objects are already in clip space
+    mat4 viewProjection = {
+        {1.0f, 0.0f, 0.0f, 0.0f},
+        {0.0f, 1.0f, 0.0f, 0.0f},
+        {0.0f, 0.0f, 1.0f, 0.0f},
+        {0.0f, 0.0f, 0.0f, 1.0f},
+    };
+
+    double singleThreadNs = 0.0;
+
+    for (uint32_t threads = 1; threads <= maxThreads; threads++)
+    {
+        jobSystemInit(threads);
+
+        checkAgainstScalar(visibility, viewProjection);
+
+        double ns = 0.0;
+        for (uint32_t objects = BENCH_MIN_OBJECTS; objects <= BENCH_MAX_OBJECTS; objects *= 4)
+        {
+            visibility->count = objects;
+
+            uint64_t start = traceNow();
+            for (uint32_t round = 0; round < BENCH_ROUNDS; round++)
+            {
+                visibilityCull(visibility, viewProjection);
+            }
+            ns = (double) (traceNow() - start) / BENCH_ROUNDS;
+
+            printf("cull %u %u %.2f ns/object\n", threads, objects, ns / objects);
+        }
+
+        // speedup measured on the largest object count
+        if (threads == 1) {
+            singleThreadNs = ns;
+        }
+        printf("speedup %u %u %.2f x\n", threads, BENCH_MAX_OBJECTS, singleThreadNs / ns);
+
+        visibility->count = BENCH_MAX_OBJECTS;
+        jobSystemShutdown();
+    }
+
+    destroyVisibility(&state);
+
+    return 0;
+}
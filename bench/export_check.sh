@@ -0,0 +1,50 @@
+#!/bin/sh
+# renders headless with --export and lets frame_consumer import, copy and check the frames on the same device
+# exercises the OPAQUE_FD memory import, the SYNC_FD semaphore export and the acquire from VK_QUEUE_FAMILY_EXTERNAL
+# usage: export_check.sh binary frame_consumer [frames]
+# exits 1 when either process fails or the consumer received a blank frame
+
+set -u
+
+if [ $# -lt 2 ] || [ $# -gt 3 ]; then
+    echo "usage: $0 binary frame_consumer [frames]" >&2
+    exit 2
+fi
+
+binary=$1
+consumer=$2
+frames=${3:-120}
+
+directory=$(mktemp -d)
+socket="$directory/export.sock"
+trap 'rm -rf "$directory"' EXIT
+
+# capped and long enough that the consumer connects and takes its frames while the renderer still runs
+"$binary" --headless 1 --log-level warn --export "$socket" --max-fps 120 --frames $((frames * 10)) &
+renderer=$!
+
+waited=0
+while [ ! -S "$socket" ]
+do
+    if ! kill -0 "$renderer" 2> /dev/null || [ $waited -ge 100 ]; then
+        echo "export: renderer did not create $socket" >&2
+        kill "$renderer" 2> /dev/null
+        exit 1
+    fi
+    sleep 0.1
+    waited=$((waited + 1))
+done
+
+failed=0
+
+if ! "$consumer" "$socket" --frames "$frames"; then
+    echo "export: frame_consumer failed" >&2
+    failed=1
+fi
+
+if ! wait "$renderer"; then
+    echo "export: renderer failed" >&2
+    failed=1
+fi
+
+exit $failed
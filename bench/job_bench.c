@@ -0,0 +1,165 @@
+/**
+ * @file job_bench.c
+ * @brief micro benchmarks of the job system: scheduling overhead and parallel-for scaling
+ *
+ * prints one "name threads value unit" line per measurement
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "job.h"
+#include "log.h"
+#include "trace.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define BENCH_EMPTY_JOBS 2000
+#define BENCH_EMPTY_ROUNDS 200
+#define BENCH_CHAIN_LENGTH 1000
+#define BENCH_SCALING_COUNT (1u << 22)
+#define BENCH_SCALING_ROUNDS 20
+
+static void emptyJob(void* data)
+{
+    (void) data;
+}
+
+typedef struct ChainLink
+{
+    JobCounter done;
+    uint32_t* visited;
+} ChainLink;
+
+static void chainJob(void* data)
+{
+    ChainLink* link = data;
+    (*link->visited)++;
+}
+
+// compute bound kernel, enough work per element that memory bandwidth does not hide scaling
+static void scalingRange(void* data, uint32_t begin, uint32_t end)
+{
+    float* values = data;
+
+    for (uint32_t i = begin; i < end; i++)
+    {
+        float x = values[i];
+        for (int k = 0; k < 32; k++)
+        {
+            x = x * 0.999f + 0.001f;
+        }
+        values[i] = x;
+    }
+}
+
+static double elapsedNs(uint64_t start)
+{
+    return (double) (traceNow() - start);
+}
+
+static void benchEmptyJobs(uint32_t threads)
+{
+    uint64_t start = traceNow();
+
+    for (uint32_t round = 0; round < BENCH_EMPTY_ROUNDS; round++)
+    {
+        JobCounter counter = {0};
+        for (uint32_t i = 0; i < BENCH_EMPTY_JOBS; i++)
+        {
+            jobRun(emptyJob, NULL, &counter);
+        }
+        jobWait(&counter);
+    }
+
+    printf("empty_job %u %.1f ns\n", threads, elapsedNs(start) / ((double) BENCH_EMPTY_JOBS * BENCH_EMPTY_ROUNDS));
+}
+
+static void benchDependencyChain(uint32_t threads)
+{
+    static ChainLink links[BENCH_CHAIN_LENGTH];
+    uint32_t visited = 0;
+
+    uint64_t start = traceNow();
+
+    // every job waits on the previous one, measures latency of handing work over
+    for (uint32_t i = 0; i < BENCH_CHAIN_LENGTH; i++)
+    {
+        links[i].done = (JobCounter) {0};
+        links[i].visited = &visited;
+
+        if (i == 0) {
+            jobRun(chainJob, &links[i], &links[i].done);
+        }
+        else
+        {
+            jobRunAfter(&links[i - 1].done, chainJob, &links[i], &links[i].done);
+        }
+    }
+
+    jobWait(&links[BENCH_CHAIN_LENGTH - 1].done);
+
+    if (visited != BENCH_CHAIN_LENGTH) {
+        fprintf(stderr, "dependency chain ran %u of %u jobs\n", visited, BENCH_CHAIN_LENGTH);
+        exit(EXIT_FAILURE);
+    }
+
+    printf("dependency_link %u %.1f ns\n", threads, elapsedNs(start) / BENCH_CHAIN_LENGTH);
+}
+
+static double benchParallelFor(uint32_t threads, float* values)
+{
+    uint64_t start = traceNow();
+
+    for (uint32_t round = 0; round < BENCH_SCALING_ROUNDS; round++)
+    {
+        jobParallelFor(BENCH_SCALING_COUNT, 16384, scalingRange, values);
+    }
+
+    double ms = elapsedNs(start) / 1e6 / BENCH_SCALING_ROUNDS;
+    printf("parallel_for %u %.3f ms\n", threads, ms);
+
+    return ms;
+}
+
+int main(int argc, char** argv)
+{
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    uint32_t maxThreads = argc > 1 ? (uint32_t) strtoul(argv[1], NULL, 10) : (uint32_t) (cores > 0 ? cores : 1);
+    if (maxThreads == 0 || maxThreads > JOB_MAX_THREADS) {
+        maxThreads = JOB_MAX_THREADS;
+    }
+
+    logLevel = LOG_LEVEL_WARN;
+
+    float* values = malloc(sizeof(float) * BENCH_SCALING_COUNT);
+    for (uint32_t i = 0; i < BENCH_SCALING_COUNT; i++)
+    {
+        values[i] = (float) i / BENCH_SCALING_COUNT;
+    }
+
+    double singleThreadMs = 0.0;
+
+    for (uint32_t threads = 1; threads <= maxThreads; threads++)
+    {
+        jobSystemInit(threads);
+
+        benchEmptyJobs(threads);
+        benchDependencyChain(threads);
+        double ms = benchParallelFor(threads, values);
+
+        if (threads == 1) {
+            singleThreadMs = ms;
+        }
+        printf("speedup %u %.2f x\n", threads, singleThreadMs / ms);
+
+        jobSystemShutdown();
+    }
+
+    free(values);
+
+    return 0;
+}
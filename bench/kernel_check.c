@@ -0,0 +1,37 @@
+/**
+ * @file kernel_check.c
+ * @brief compares the SIMD kernels selected for this CPU with their scalar references
+ *
+ * prints one "name kernel mismatches" line per kernel, exits with failure when any kernel differs
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "instance.h"
+#include "log.h"
+#include "visibility.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// odd counts leave a scalar tail behind every SIMD kernel
+#define CHECK_INSTANCES 1027
+#define CHECK_INSTANCE_STEPS 64
+#define CHECK_OBJECTS 1027
+#define CHECK_CULL_ROUNDS 16
+
+int main(void)
+{
+    logLevel = LOG_LEVEL_WARN;
+
+    instanceKernelSelect();
+    uint32_t instanceMismatches = instanceKernelVerify(CHECK_INSTANCES, CHECK_INSTANCE_STEPS);
+    printf("instance %s %u\n", instanceKernelName(), instanceMismatches);
+
+    visibilityKernelSelect();
+    uint32_t cullMismatches = visibilityKernelVerify(CHECK_OBJECTS, CHECK_CULL_ROUNDS);
+    printf("cull %s %u\n", visibilityKernelName(), cullMismatches);
+
+    return instanceMismatches == 0 && cullMismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,44 @@
+#!/bin/sh
+# runs every scenario of the scenario file headless and collects per stage statistics
+# usage: run_bench.sh binary scenarios.tsv results.tsv
+# output columns: scenario, stage, count, avg_us, p50_us, p99_us, min_us, max_us
+
+set -u
+
+if [ $# -ne 3 ]; then
+    echo "usage: $0 binary scenarios.tsv results.tsv" >&2
+    exit 2
+fi
+
+binary=$1
+scenarios=$2
+results=$3
+
+summary=$(mktemp)
+trap 'rm -f "$summary"' EXIT
+
+printf '# scenario\tstage\tcount\tavg_us\tp50_us\tp99_us\tmin_us\tmax_us\n' > "$results"
+
+failed=0
+tab=$(printf '\t')
+
+while IFS="$tab" read -r name arguments
+do
+    case "$name" in
+        ''|'#'*) continue ;;
+    esac
+
+    echo "bench: $name ($arguments)"
+
+    # arguments are split on purpose
+    # shellcheck disable=SC2086
+    if ! "$binary" --headless 1 --log-level warn --summary "$summary" $arguments > /dev/null; then
+        echo "bench: $name failed" >&2
+        failed=1
+        continue
+    fi
+
+    grep -v '^#' "$summary" | sed "s/^/$name$tab/" >> "$results"
+done < "$scenarios"
+
+exit $failed
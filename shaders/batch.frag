@@ -0,0 +1,33 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(location = 0) in vec4 fragColor;
+layout(location = 1) in vec2 fragUV;
+
+layout(location = 0) out vec4 outColor;
+
+// bindless set, arrays are partially bound so only registered elements may be indexed
+layout(set = 1, binding = 0) uniform sampler2D textures[];
+
+// must match the vertex shader block, one texture per draw of the batcher
+layout(push_constant) uniform PushConstants {
+    vec4 offset;
+    uint textureIndex;
+    uint materialIndex;
+} push;
+
+// BINDLESS_INVALID_INDEX
+const uint invalidIndex = 0xFFFFFFFFu;
+
+// PIPELINE_SPECIALIZATION_TEXTURES, untextured runs compile the lookup out
+layout(constant_id = 0) const bool sampleTextures = true;
+
+void main() {
+    vec4 color = fragColor;
+
+    if (sampleTextures && push.textureIndex != invalidIndex) {
+        color *= texture(textures[push.textureIndex], fragUV);
+    }
+
+    outColor = color;
+}
@@ -0,0 +1,25 @@
+#version 450
+// Vertex shader of the 2D batcher
+// quad corners are given in pixels of the render target with origin top left
+
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec2 inUV;
+layout(location = 2) in vec4 inColor;
+
+layout(location = 0) out vec4 fragColor;
+layout(location = 1) out vec2 fragUV;
+
+// must match DrawPushConstants, offset holds pixel to clip space scale (xy) and bias (zw)
+layout(push_constant) uniform PushConstants {
+    vec4 offset;
+    uint textureIndex;
+    uint materialIndex;
+} push;
+
+void main() {
+
+    gl_Position = vec4(inPosition * push.offset.xy + push.offset.zw, 0.0, 1.0);
+    fragColor = inColor;
+    fragUV = inUV;
+
+}
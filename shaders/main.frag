@@ -1,9 +1,42 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
 
 layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec2 fragUV;
 
 layout(location = 0) out vec4 outColor;
 
+// bindless set, arrays are partially bound so only registered elements may be indexed
+layout(set = 1, binding = 0) uniform sampler2D textures[];
+
+layout(set = 1, binding = 1) readonly buffer MaterialBuffer {
+    vec4 color;
+} materials[];
+
+// must match the vertex shader block
+layout(push_constant) uniform PushConstants {
+    vec4 offset;
+    uint textureIndex;
+    uint materialIndex;
+} push;
+
+// BINDLESS_INVALID_INDEX
+const uint invalidIndex = 0xFFFFFFFFu;
+
+// PIPELINE_SPECIALIZATION_*, variants for draws without texture or material compile the lookups out
+layout(constant_id = 0) const bool sampleTextures = true;
+layout(constant_id = 1) const bool readMaterials = true;
+
 void main() {
-    outColor = vec4(fragColor, 1.0);
+    vec4 color = vec4(fragColor, 1.0);
+
+    if (sampleTextures && push.textureIndex != invalidIndex) {
+        color *= texture(textures[push.textureIndex], fragUV);
+    }
+
+    if (readMaterials && push.materialIndex != invalidIndex) {
+        color *= materials[push.materialIndex].color;
+    }
+
+    outColor = color;
 }
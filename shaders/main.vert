@@ -4,14 +4,39 @@
 
 // gl_Position - contains position of current vertex
 // some types like dvec3 takes multiple slots meaning that  
-layout(location = 0) in vec2 inPosition;
+layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inColor;
 
+// per instance stream written by the CPU instance kernels
+layout(location = 2) in vec4 instanceTransform; // x, y, rotation, scale
+layout(location = 3) in vec4 instanceColor;
+
 layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 fragUV;
+
+// block of the target from the uniform ring, selected by dynamic offset
+layout(set = 0, binding = 0) uniform DrawUniforms {
+    mat4 transform;
+    float time;
+} draw;
+
+layout(push_constant) uniform PushConstants {
+    vec4 offset;
+    // indices into bindless arrays of set 1, used by the fragment shader
+    uint textureIndex;
+    uint materialIndex;
+} push;
 
 void main() {
 
-    gl_Position = vec4(inPosition, 0.0, 1.0);
-    fragColor = inColor;
+    float c = cos(instanceTransform.z);
+    float s = sin(instanceTransform.z);
+    vec2 local = mat2(c, s, -s, c) * (inPosition.xy * instanceTransform.w);
+    vec3 position = vec3(local + instanceTransform.xy, inPosition.z);
+
+    gl_Position = draw.transform * vec4(position + push.offset.xyz, 1.0);
+    fragColor = inColor * instanceColor.rgb;
+    // quad spans -0.5..0.5, map it to 0..1 texture coordinates
+    fragUV = inPosition.xy + 0.5;
 
 }
@@ -0,0 +1,68 @@
+#version 450
+#extension GL_EXT_buffer_reference : require
+#extension GL_EXT_buffer_reference_uvec2 : require
+// Vertex shader of the pulled layout
+// fetches and decodes its vertex from the mesh pool, only the per instance streams are vertex input
+
+// per instance stream written by the CPU instance kernels
+layout(location = 2) in vec4 instanceTransform; // x, y, rotation, scale
+layout(location = 3) in vec4 instanceColor;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 fragUV;
+
+// block of the target from the uniform ring, selected by dynamic offset
+layout(set = 0, binding = 0) uniform DrawUniforms {
+    mat4 transform;
+    float time;
+} draw;
+
+// vertices of one mesh, read as words so every format shares the reference type
+layout(buffer_reference, std430, buffer_reference_align = 4) readonly buffer VertexWords {
+    uint words[];
+};
+
+// must match DrawPushConstants
+layout(push_constant) uniform PushConstants {
+    vec4 offset;
+    uint textureIndex;
+    uint materialIndex;
+    // buffer device address of the mesh's first vertex
+    uvec2 vertexAddress;
+    uint vertexFormat;
+} push;
+
+// VertexFormat
+const uint formatFloat = 0u;
+const uint formatPacked = 1u;
+
+void main() {
+
+    VertexWords vertices = VertexWords(push.vertexAddress);
+    vec3 inPosition;
+    vec3 inColor;
+
+    // draws of different formats share the pipeline, the branch is uniform for the whole draw
+    if (push.vertexFormat == formatPacked) {
+        uint base = uint(gl_VertexIndex) * 4u;
+        inPosition = uintBitsToFloat(uvec3(vertices.words[base], vertices.words[base + 1], vertices.words[base + 2]));
+        inColor = unpackUnorm4x8(vertices.words[base + 3]).rgb;
+    }
+    else
+    {
+        uint base = uint(gl_VertexIndex) * 6u;
+        inPosition = uintBitsToFloat(uvec3(vertices.words[base], vertices.words[base + 1], vertices.words[base + 2]));
+        inColor = uintBitsToFloat(uvec3(vertices.words[base + 3], vertices.words[base + 4], vertices.words[base + 5]));
+    }
+
+    float c = cos(instanceTransform.z);
+    float s = sin(instanceTransform.z);
+    vec2 local = mat2(c, s, -s, c) * (inPosition.xy * instanceTransform.w);
+    vec3 position = vec3(local + instanceTransform.xy, inPosition.z);
+
+    gl_Position = draw.transform * vec4(position + push.offset.xyz, 1.0);
+    fragColor = inColor * instanceColor.rgb;
+    // quad spans -0.5..0.5, map it to 0..1 texture coordinates
+    fragUV = inPosition.xy + 0.5;
+
+}
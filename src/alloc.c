@@ -0,0 +1,61 @@
+#include "alloc.h"
+
+#ifdef DEBUG_ALLOC
+
+#include "debug.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+
+void* __real_malloc(size_t size);
+void* __real_realloc(void* pointer, size_t size);
+
+// NULL outside a guarded scope
+static __thread const char* allocGuardScope = NULL;
+
+static void allocGuardCheck(const char* function, size_t size, void* caller)
+{
+    const char* scope = allocGuardScope;
+
+    if (scope != NULL) {
+        // logging must not come back here
+        allocGuardScope = NULL;
+        logFatal(__FILE__, __func__, __LINE__, "%s of %zu bytes during %s, called from %p", function, size, scope, caller);
+    }
+}
+
+void allocGuardBegin(const char* scope)
+{
+    allocGuardScope = scope;
+}
+
+void allocGuardEnd(void)
+{
+    allocGuardScope = NULL;
+}
+
+void* __wrap_malloc(size_t size)
+{
+    allocGuardCheck("malloc", size, __builtin_return_address(0));
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size)
+{
+    allocGuardCheck("calloc", count * size, __builtin_return_address(0));
+    return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* pointer, size_t size)
+{
+    allocGuardCheck("realloc", size, __builtin_return_address(0));
+    return __real_realloc(pointer, size);
+}
+
+int __wrap_posix_memalign(void** memptr, size_t alignment, size_t size)
+{
+    allocGuardCheck("posix_memalign", size, __builtin_return_address(0));
+    return __real_posix_memalign(memptr, alignment, size);
+}
+
+#endif
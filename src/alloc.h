@@ -0,0 +1,37 @@
+#ifndef __ALLOC_H__
+#define __ALLOC_H__
+
+#include <stddef.h>
+
+// DEBUG_ALLOC builds link with -Wl,--wrap for malloc, calloc, realloc and posix_memalign (make DEBUG_ALLOC=1),
+// a heap allocation of this program's code inside a guarded scope is fatal
+// libraries and the driver call the allocator directly and are not seen
+
+#ifdef DEBUG_ALLOC
+
+/**
+ * @brief every allocation of the calling thread until allocGuardEnd is fatal
+ * @details other threads are unaffected, scopes do not nest
+ * @param scope name printed when the guard fires
+ */
+void allocGuardBegin(const char* scope);
+
+void allocGuardEnd(void);
+
+void* __real_calloc(size_t count, size_t size);
+int __real_posix_memalign(void** memptr, size_t alignment, size_t size);
+
+#define ALLOC_GUARD_BEGIN(SCOPE) allocGuardBegin(SCOPE)
+#define ALLOC_GUARD_END() allocGuardEnd()
+// allocations standing in for the driver's, invisible to the guard like the real driver's
+#define ALLOC_UNGUARDED(FUNCTION) __real_##FUNCTION
+
+#else
+
+#define ALLOC_GUARD_BEGIN(SCOPE) ((void) 0)
+#define ALLOC_GUARD_END() ((void) 0)
+#define ALLOC_UNGUARDED(FUNCTION) FUNCTION
+
+#endif
+
+#endif // __ALLOC_H__
@@ -0,0 +1,225 @@
+#include "batch.h"
+
+#include "debug.h"
+#include "dynamic.h"
+#include "encoder.h"
+#include "init.h"
+#include "pipeline.h"
+#include "utils.h"
+
+#include <stdint.h>
+#include <vulkan/vulkan_core.h>
+
+// quads are overlays -> no culling, no depth, the rest of the scene's key is kept so formats match the pass
+static void batchKey(State* state, PipelineBlend blend, VkBool32 textured, PipelineKey* key)
+{
+    *key = state->pipelineKey;
+
+    key->shaders = state->batch.shaders;
+    key->vertexLayout = PIPELINE_VERTEX_BATCH;
+    key->specialization[PIPELINE_SPECIALIZATION_TEXTURES] = textured;
+    key->specialization[PIPELINE_SPECIALIZATION_MATERIALS] = VK_FALSE;
+
+    key->cullMode = VK_CULL_MODE_NONE;
+    key->depthTest = VK_FALSE;
+    key->depthWrite = VK_FALSE;
+    key->blend = blend;
+}
+
+static uint32_t batchVariant(State* state, PipelineBlend blend, VkBool32 textured)
+{
+    uint32_t* variant = &state->batch.variants[blend][textured];
+
+    if (*variant == PIPELINE_INVALID_VARIANT) {
+        PipelineKey key;
+        batchKey(state, blend, textured, &key);
+        *variant = pipelineCacheRequest(state, &key);
+    }
+
+    return *variant;
+}
+
+static void createQuadIndices(State* state, Batcher* batch)
+{
+    VkDeviceSize bufferSize = (VkDeviceSize) BATCH_MAX_QUADS * 6 * sizeof(uint32_t);
+    VkBuffer stagingBuffer;
+    VkDeviceMemory stagingBufferMemory;
+
+    createBuffer(state, bufferSize,
+    VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+    &stagingBuffer, &stagingBufferMemory);
+
+    void* data;
+    assertVk(vkMapMemory(state->device, stagingBufferMemory, 0, bufferSize, 0, &data), "failed to map batch index staging buffer", "");
+
+    // corners are written top left, top right, bottom right, bottom left
+    uint32_t* indices = data;
+    for (uint32_t q = 0; q < BATCH_MAX_QUADS; q++)
+    {
+        uint32_t corner = q * 4;
+        uint32_t* quad = indices + (size_t) q * 6;
+
+        quad[0] = corner;
+        quad[1] = corner + 1;
+        quad[2] = corner + 2;
+        quad[3] = corner + 2;
+        quad[4] = corner + 3;
+        quad[5] = corner;
+    }
+
+    vkUnmapMemory(state->device, stagingBufferMemory);
+
+    createBuffer(state, bufferSize,
+    VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &batch->indexBuffer, &batch->indexMemory);
+
+    copyBuffer(state, stagingBuffer, batch->indexBuffer, bufferSize);
+
+    vkDestroyBuffer(state->device, stagingBuffer, state->allocator);
+    vkFreeMemory(state->device, stagingBufferMemory, state->allocator);
+}
+
+void createBatcher(State* state)
+{
+    Batcher* batch = &state->batch;
+
+    createDynamicBuffer(state, &batch->vertices, (VkDeviceSize) BATCH_MAX_QUADS * 4 * sizeof(BatchVertex),
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, "batch vertices");
+    createQuadIndices(state, batch);
+
+    batch->shaders = pipelineCacheAddShaders(state, "shaders/batch.vert.spv", "shaders/batch.frag.spv");
+    for (uint32_t b = 0; b < PIPELINE_BLEND_COUNT; b++)
+    {
+        batch->variants[b][0] = PIPELINE_INVALID_VARIANT;
+        batch->variants[b][1] = PIPELINE_INVALID_VARIANT;
+    }
+
+    // state every batchBegin starts with is ready for the first frame, other variants compile when first used
+    pipelineCacheGetBlocking(state, batchVariant(state, PIPELINE_BLEND_ALPHA, VK_FALSE));
+
+    batch->mapped = NULL;
+    batch->quadCount = 0;
+    batch->runCount = 0;
+    batch->textureIndex = BINDLESS_INVALID_INDEX;
+    batch->blend = PIPELINE_BLEND_ALPHA;
+}
+
+void batchBegin(State* state, uint32_t frame)
+{
+    Batcher* batch = &state->batch;
+
+    batch->mapped = (BatchVertex*) dynamicBufferBeginFrame(&batch->vertices, frame);
+    batch->quadCount = 0;
+    batch->runCount = 0;
+    batch->textureIndex = BINDLESS_INVALID_INDEX;
+    batch->blend = PIPELINE_BLEND_ALPHA;
+}
+
+void batchSetTexture(State* state, uint32_t textureIndex)
+{
+    state->batch.textureIndex = textureIndex;
+}
+
+void batchSetBlend(State* state, PipelineBlend blend)
+{
+    state->batch.blend = blend;
+}
+
+VkBool32 batchQuadUV(State* state, float x, float y, float w, float h, float u0, float v0, float u1, float v1, uint32_t color)
+{
+    Batcher* batch = &state->batch;
+
+    if (batch->quadCount == BATCH_MAX_QUADS) {
+        return VK_FALSE;
+    }
+
+    BatchRun* run = batch->runCount > 0 ? &batch->runs[batch->runCount - 1] : NULL;
+
+    // only texture and blend split draws, everything else lives in the vertices
+    if (run == NULL || run->textureIndex != batch->textureIndex || run->blend != batch->blend) {
+        if (batch->runCount == BATCH_MAX_RUNS) {
+            return VK_FALSE;
+        }
+
+        run = &batch->runs[batch->runCount++];
+        run->firstQuad = batch->quadCount;
+        run->quadCount = 0;
+        run->textureIndex = batch->textureIndex;
+        run->blend = batch->blend;
+    }
+
+    // whole vertices are stored, the region may be uncached device memory which must not be read back
+    BatchVertex* corners = batch->mapped + (size_t) batch->quadCount * 4;
+    corners[0] = (BatchVertex) {x, y, u0, v0, color};
+    corners[1] = (BatchVertex) {x + w, y, u1, v0, color};
+    corners[2] = (BatchVertex) {x + w, y + h, u1, v1, color};
+    corners[3] = (BatchVertex) {x, y + h, u0, v1, color};
+
+    batch->quadCount++;
+    run->quadCount++;
+
+    return VK_TRUE;
+}
+
+VkBool32 batchQuad(State* state, float x, float y, float w, float h, uint32_t color)
+{
+    return batchQuadUV(state, x, y, w, h, 0.0f, 0.0f, 1.0f, 1.0f, color);
+}
+
+void batchEnd(State* state)
+{
+    Batcher* batch = &state->batch;
+
+    dynamicBufferWritten(&batch->vertices, 0, (VkDeviceSize) batch->quadCount * 4 * sizeof(BatchVertex));
+}
+
+void batchRecord(State* state, CommandEncoder* encoder, VkExtent2D extent)
+{
+    Batcher* batch = &state->batch;
+
+    if (batch->runCount == 0) {
+        return;
+    }
+
+    PipelineKey key;
+    batchKey(state, PIPELINE_BLEND_ALPHA, VK_FALSE, &key);
+    encoderSetDynamicState(encoder, state, &key);
+
+    VkDeviceSize offset = batch->vertices.frameOffset;
+    encoderBindVertexBuffers(encoder, 0, 1, &batch->vertices.buffer, &offset);
+    encoderBindIndexBuffer(encoder, batch->indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+
+    // pixels -> clip space, offset holds scale and bias for batch.vert
+    DrawPushConstants pushConstants = {
+        .offset = {2.0f / (float) extent.width, 2.0f / (float) extent.height, -1.0f, -1.0f},
+        .textureIndex = BINDLESS_INVALID_INDEX,
+        .materialIndex = BINDLESS_INVALID_INDEX,
+    };
+
+    for (uint32_t i = 0; i < batch->runCount; i++)
+    {
+        BatchRun* run = &batch->runs[i];
+
+        VkPipeline pipeline = pipelineCacheGet(state, batchVariant(state, run->blend, run->textureIndex != BINDLESS_INVALID_INDEX));
+        if (pipeline == VK_NULL_HANDLE) {
+            continue;
+        }
+
+        encoderBindPipeline(encoder, pipeline);
+
+        pushConstants.textureIndex = run->textureIndex;
+        encoderPushConstants(encoder, &pushConstants);
+
+        encoderDrawIndexed(encoder, run->quadCount * 6, 1, run->firstQuad * 6, 0, 0);
+    }
+}
+
+void destroyBatcher(State* state)
+{
+    Batcher* batch = &state->batch;
+
+    destroyDynamicBuffer(state, &batch->vertices);
+    vkDestroyBuffer(state->device, batch->indexBuffer, state->allocator);
+    vkFreeMemory(state->device, batch->indexMemory, state->allocator);
+}
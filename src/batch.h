@@ -0,0 +1,125 @@
+#ifndef __BATCH_H__
+#define __BATCH_H__
+
+#include "common.h"
+#include "dynamic.h"
+#include "encoder.h"
+#include "pipeline.h"
+
+#include <stdint.h>
+#include <vulkan/vulkan_core.h>
+
+// quads the batcher holds per frame, the shared index buffer covers all of them
+#define BATCH_MAX_QUADS 65536
+// texture or blend changes per frame, every run is one draw
+#define BATCH_MAX_RUNS 256
+
+// cells of the --hud workload in pixels
+#define HUD_CELL_SIZE 4.0f
+#define HUD_CELL_PITCH 5
+
+// corner of a batched quad, positions in pixels of the render target with origin top left
+typedef struct BatchVertex
+{
+    float x;
+    float y;
+    float u;
+    float v;
+    // packed R8G8B8A8
+    uint32_t color;
+} BatchVertex;
+
+// consecutive quads drawn with the same texture and blend
+typedef struct BatchRun
+{
+    uint32_t firstQuad;
+    uint32_t quadCount;
+    uint32_t textureIndex;
+    PipelineBlend blend;
+} BatchRun;
+
+// immediate mode 2D quads, appended into a per frame dynamic buffer and drawn over the scene
+// with one vkCmdDrawIndexed per run
+typedef struct Batcher
+{
+    DynamicBuffer vertices;
+    // 6 indices per quad for BATCH_MAX_QUADS, generated once
+    VkBuffer indexBuffer;
+    VkDeviceMemory indexMemory;
+
+    // index returned by pipelineCacheAddShaders
+    uint32_t shaders;
+    // variants per blend, without and with texture, PIPELINE_INVALID_VARIANT until first used
+    uint32_t variants[PIPELINE_BLEND_COUNT][2];
+
+    // region of the frame between batchBegin and batchEnd
+    BatchVertex* mapped;
+    uint32_t quadCount;
+
+    BatchRun runs[BATCH_MAX_RUNS];
+    uint32_t runCount;
+
+    // state of the next quad, BINDLESS_INVALID_INDEX draws untextured
+    uint32_t textureIndex;
+    PipelineBlend blend;
+} Batcher;
+
+/**
+ * @brief creates per frame vertex buffer, shared index buffer and default pipeline of the batcher
+ * Requires:
+    - state->pipelineLayout and pipeline cache created
+    - state->commandPool created
+ */
+void createBatcher(State* state);
+
+/**
+ * @brief starts collecting quads into region of given frame in flight, quads of the last frame are dropped
+ * @details texture and blend are reset to untextured alpha blending
+ * Requires:
+    - fence of the frame signaled, GPU no longer reads the region
+ */
+void batchBegin(State* state, uint32_t frame);
+
+/**
+ * @brief bindless texture of following quads, BINDLESS_INVALID_INDEX draws untextured
+ * @details a change starts a new draw once the next quad is added
+ */
+void batchSetTexture(State* state, uint32_t textureIndex);
+
+/**
+ * @brief blending of following quads, a change starts a new draw once the next quad is added
+ */
+void batchSetBlend(State* state, PipelineBlend blend);
+
+/**
+ * @brief appends axis aligned quad covering the whole texture
+ * @param x, y top left corner in pixels of the render target
+ * @param color packed R8G8B8A8, multiplied with the texture
+ * @return VK_FALSE when BATCH_MAX_QUADS or BATCH_MAX_RUNS are exhausted and the quad was dropped
+ */
+VkBool32 batchQuad(State* state, float x, float y, float w, float h, uint32_t color);
+
+/**
+ * @brief appends axis aligned quad showing texture coordinates (u0, v0) to (u1, v1)
+ * @return VK_FALSE when BATCH_MAX_QUADS or BATCH_MAX_RUNS are exhausted and the quad was dropped
+ */
+VkBool32 batchQuadUV(State* state, float x, float y, float w, float h, float u0, float v0, float u1, float v1, uint32_t color);
+
+/**
+ * @brief marks the written vertices for upload, quads are drawn by every following batchRecord
+ */
+void batchEnd(State* state);
+
+/**
+ * @brief draws every run over what was recorded before, one vkCmdDrawIndexed per run
+ * @details runs whose pipeline variant is still compiling are skipped, binds already made by the encoder are elided
+ * Requires:
+    - render pass or rendering of a target begun on the encoder's command buffer, bindless set bound
+    - batch vertices uploaded by dynamicBufferRecordUpload before the pass
+ * @param extent size of the target, positions are pixels of it
+ */
+void batchRecord(State* state, CommandEncoder* encoder, VkExtent2D extent);
+
+void destroyBatcher(State* state);
+
+#endif // __BATCH_H__
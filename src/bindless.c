@@ -0,0 +1,253 @@
+#include "bindless.h"
+
+#include "debug.h"
+#include "init.h"
+
+#include <stdint.h>
+#include <vulkan/vulkan_core.h>
+
+#define BINDLESS_TEXTURE_BINDING 0
+#define BINDLESS_BUFFER_BINDING 1
+
+static uint32_t minU32(uint32_t a, uint32_t b)
+{
+    return a < b ? a : b;
+}
+
+static void createDefaultSampler(State* state)
+{
+    VkSamplerCreateInfo samplerCrtInf = {
+        .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+
+        .magFilter = VK_FILTER_LINEAR,
+        .minFilter = VK_FILTER_LINEAR,
+        .mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR,
+
+        .addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+        .addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+        .addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+
+        .mipLodBias = 0.0f,
+        .anisotropyEnable = VK_FALSE,
+        .maxAnisotropy = 1.0f,
+        .compareEnable = VK_FALSE,
+        .compareOp = VK_COMPARE_OP_ALWAYS,
+        .minLod = 0.0f,
+        .maxLod = VK_LOD_CLAMP_NONE,
+        .borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK,
+        .unnormalizedCoordinates = VK_FALSE,
+    };
+
+    assertVk(vkCreateSampler(state->device, &samplerCrtInf, state->allocator, &state->bindless.defaultSampler),
+    "failed to create default sampler", "created default sampler");
+}
+
+void createBindlessTable(State* state)
+{
+    BindlessTable* table = &state->bindless;
+
+    // update after bind descriptors have their own, usually much higher, limits
+    VkPhysicalDeviceVulkan12Properties props12 = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES,
+        .pNext = NULL,
+    };
+
+    VkPhysicalDeviceProperties2 props = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+        .pNext = &props12,
+    };
+
+    vkGetPhysicalDeviceProperties2(state->physicalDevice, &props);
+
+    table->textureCapacity = minU32(BINDLESS_MAX_TEXTURES,
+        minU32(props12.maxPerStageDescriptorUpdateAfterBindSampledImages, props12.maxDescriptorSetUpdateAfterBindSampledImages));
+    table->bufferCapacity = minU32(BINDLESS_MAX_BUFFERS,
+        minU32(props12.maxPerStageDescriptorUpdateAfterBindStorageBuffers, props12.maxDescriptorSetUpdateAfterBindStorageBuffers));
+
+    assert_my(table->textureCapacity > 0 && table->bufferCapacity > 0, "device has no update after bind descriptors", "");
+    LOG("bindless capacity: %u textures, %u buffers", table->textureCapacity, table->bufferCapacity);
+
+    VkDescriptorSetLayoutBinding bindings[] = {
+        {
+            .binding = BINDLESS_TEXTURE_BINDING,
+            .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .descriptorCount = table->textureCapacity,
+            .stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+            .pImmutableSamplers = NULL,
+        },
+        {
+            .binding = BINDLESS_BUFFER_BINDING,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = table->bufferCapacity,
+            .stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+            .pImmutableSamplers = NULL,
+        },
+    };
+
+    // partially bound -> unused elements may stay unwritten
+    // update after bind + unused while pending -> new elements can be written while frames in flight use the set
+    VkDescriptorBindingFlags bindingFlags[] = {
+        VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT,
+        VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT,
+    };
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsCrtInf = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO,
+        .pNext = NULL,
+
+        .bindingCount = sizeof(bindingFlags) / sizeof(bindingFlags[0]),
+        .pBindingFlags = bindingFlags,
+    };
+
+    VkDescriptorSetLayoutCreateInfo layoutCrtInf = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .pNext = &bindingFlagsCrtInf,
+        .flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT,
+
+        .bindingCount = sizeof(bindings) / sizeof(bindings[0]),
+        .pBindings = bindings,
+    };
+
+    assertVk(vkCreateDescriptorSetLayout(state->device, &layoutCrtInf, state->allocator, &table->setLayout),
+    "failed to create bindless descriptor set layout", "created bindless descriptor set layout");
+
+    VkDescriptorPoolSize poolSizes[] = {
+        {.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .descriptorCount = table->textureCapacity},
+        {.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .descriptorCount = table->bufferCapacity},
+    };
+
+    VkDescriptorPoolCreateInfo poolCrtInf = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .pNext = NULL,
+        .flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT,
+
+        .maxSets = 1,
+        .poolSizeCount = sizeof(poolSizes) / sizeof(poolSizes[0]),
+        .pPoolSizes = poolSizes,
+    };
+
+    assertVk(vkCreateDescriptorPool(state->device, &poolCrtInf, state->allocator, &table->descriptorPool),
+    "failed to create bindless descriptor pool", "created bindless descriptor pool");
+
+    VkDescriptorSetAllocateInfo allocInf = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .pNext = NULL,
+
+        .descriptorPool = table->descriptorPool,
+        .descriptorSetCount = 1,
+        .pSetLayouts = &table->setLayout,
+    };
+
+    assertVk(vkAllocateDescriptorSets(state->device, &allocInf, &table->set), "failed to allocate bindless descriptor set", "allocated bindless descriptor set");
+
+    createDefaultSampler(state);
+
+    // push in reverse so lowest indices are handed out first
+    table->freeTextureCount = 0;
+    for (uint32_t i = table->textureCapacity; i > 0; i--)
+    {
+        table->freeTextures[table->freeTextureCount++] = i - 1;
+    }
+
+    table->freeBufferCount = 0;
+    for (uint32_t i = table->bufferCapacity; i > 0; i--)
+    {
+        table->freeBuffers[table->freeBufferCount++] = i - 1;
+    }
+}
+
+uint32_t bindlessRegisterTexture(State* state, VkImageView imageView, VkSampler sampler)
+{
+    BindlessTable* table = &state->bindless;
+
+    if (table->freeTextureCount == 0) {
+        LOG_WARN("bindless texture array full (%u)", table->textureCapacity);
+        return BINDLESS_INVALID_INDEX;
+    }
+
+    uint32_t index = table->freeTextures[--table->freeTextureCount];
+
+    VkDescriptorImageInfo imageInf = {
+        .sampler = sampler != VK_NULL_HANDLE ? sampler : table->defaultSampler,
+        .imageView = imageView,
+        .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+    };
+
+    VkWriteDescriptorSet write = {
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .pNext = NULL,
+
+        .dstSet = table->set,
+        .dstBinding = BINDLESS_TEXTURE_BINDING,
+        .dstArrayElement = index,
+        .descriptorCount = 1,
+        .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+        .pImageInfo = &imageInf,
+    };
+
+    vkUpdateDescriptorSets(state->device, 1, &write, 0, NULL);
+
+    return index;
+}
+
+uint32_t bindlessRegisterBuffer(State* state, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+    BindlessTable* table = &state->bindless;
+
+    if (table->freeBufferCount == 0) {
+        LOG_WARN("bindless buffer array full (%u)", table->bufferCapacity);
+        return BINDLESS_INVALID_INDEX;
+    }
+
+    uint32_t index = table->freeBuffers[--table->freeBufferCount];
+
+    VkDescriptorBufferInfo bufferInf = {
+        .buffer = buffer,
+        .offset = offset,
+        .range = range,
+    };
+
+    VkWriteDescriptorSet write = {
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .pNext = NULL,
+
+        .dstSet = table->set,
+        .dstBinding = BINDLESS_BUFFER_BINDING,
+        .dstArrayElement = index,
+        .descriptorCount = 1,
+        .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        .pBufferInfo = &bufferInf,
+    };
+
+    vkUpdateDescriptorSets(state->device, 1, &write, 0, NULL);
+
+    return index;
+}
+
+// stale descriptor stays in the set, partially bound makes that valid as long as shaders never index it
+void bindlessReleaseTexture(State* state, uint32_t index)
+{
+    BindlessTable* table = &state->bindless;
+
+    assert_my(index < table->textureCapacity && table->freeTextureCount < table->textureCapacity, "invalid bindless texture release", "");
+    table->freeTextures[table->freeTextureCount++] = index;
+}
+
+void bindlessReleaseBuffer(State* state, uint32_t index)
+{
+    BindlessTable* table = &state->bindless;
+
+    assert_my(index < table->bufferCapacity && table->freeBufferCount < table->bufferCapacity, "invalid bindless buffer release", "");
+    table->freeBuffers[table->freeBufferCount++] = index;
+}
+
+void destroyBindlessTable(State* state)
+{
+    BindlessTable* table = &state->bindless;
+
+    vkDestroySampler(state->device, table->defaultSampler, state->allocator);
+    vkDestroyDescriptorPool(state->device, table->descriptorPool, state->allocator);
+    vkDestroyDescriptorSetLayout(state->device, table->setLayout, state->allocator);
+}
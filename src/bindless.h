@@ -0,0 +1,70 @@
+#ifndef __BINDLESS_H__
+#define __BINDLESS_H__
+
+#include "common.h"
+
+#include <stdint.h>
+#include <vulkan/vulkan_core.h>
+
+// capacity of the bindless arrays, clamped to device limits at creation
+#define BINDLESS_MAX_TEXTURES 4096
+#define BINDLESS_MAX_BUFFERS 4096
+
+// one descriptor indexing set holding every sampled texture and storage buffer,
+// bound once per command buffer and indexed from shaders with push constants
+typedef struct BindlessTable
+{
+    VkDescriptorSetLayout setLayout;
+    VkDescriptorPool descriptorPool;
+    VkDescriptorSet set;
+
+    // used when texture is registered without its own sampler
+    VkSampler defaultSampler;
+
+    uint32_t textureCapacity;
+    uint32_t bufferCapacity;
+
+    // stacks of unused array elements
+    uint32_t freeTextures[BINDLESS_MAX_TEXTURES];
+    uint32_t freeTextureCount;
+    uint32_t freeBuffers[BINDLESS_MAX_BUFFERS];
+    uint32_t freeBufferCount;
+} BindlessTable;
+
+/**
+ * @brief creates bindless descriptor set (set 1) with partially bound, update after bind arrays
+ * @details binding 0 -> combined image samplers, binding 1 -> storage buffers,
+ * array sizes are BINDLESS_MAX_TEXTURES / BINDLESS_MAX_BUFFERS clamped to device limits
+ * Requires:
+    - Valid logical device created with descriptor indexing features
+ * @param state
+ */
+void createBindlessTable(State* state);
+
+/**
+ * @brief writes texture into free element of texture array
+ * @details descriptor is written directly into the bound set, frames in flight never read the element
+ * @param sampler sampler of the texture, NULL for default linear repeat sampler
+ * @return index to pass to shaders, BINDLESS_INVALID_INDEX when array is full
+ * Requires:
+    - imageView in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL when sampled
+ */
+uint32_t bindlessRegisterTexture(State* state, VkImageView imageView, VkSampler sampler);
+
+/**
+ * @brief writes storage buffer range into free element of buffer array
+ * @return index to pass to shaders, BINDLESS_INVALID_INDEX when array is full
+ */
+uint32_t bindlessRegisterBuffer(State* state, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range);
+
+/**
+ * @brief returns array element for reuse
+ * Requires:
+    - no frame in flight references the index
+ */
+void bindlessReleaseTexture(State* state, uint32_t index);
+void bindlessReleaseBuffer(State* state, uint32_t index);
+
+void destroyBindlessTable(State* state);
+
+#endif // __BINDLESS_H__
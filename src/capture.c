@@ -0,0 +1,546 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "capture.h"
+
+#include "debug.h"
+#include "init.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vulkan/vulkan_core.h>
+
+// biggest payload of an uncompressed deflate block
+#define CAPTURE_DEFLATE_BLOCK 65535u
+
+static uint32_t crcTable[256];
+
+static void initCrcTable(void)
+{
+    for (uint32_t n = 0; n < 256; n++)
+    {
+        uint32_t c = n;
+        for (int k = 0; k < 8; k++)
+        {
+            c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        }
+        crcTable[n] = c;
+    }
+}
+
+static uint32_t crc32Update(uint32_t crc, const uint8_t* data, size_t length)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        crc = crcTable[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+
+    return crc;
+}
+
+static void storeBigEndian(uint8_t* out, uint32_t value)
+{
+    out[0] = (uint8_t) (value >> 24);
+    out[1] = (uint8_t) (value >> 16);
+    out[2] = (uint8_t) (value >> 8);
+    out[3] = (uint8_t) value;
+}
+
+static int writeChunk(FILE* file, const char* type, const uint8_t* data, uint32_t length)
+{
+    uint8_t header[8];
+    storeBigEndian(header, length);
+    memcpy(header + 4, type, 4);
+
+    uint32_t crc = crc32Update(0xFFFFFFFFu, header + 4, 4);
+    crc = crc32Update(crc, data, length) ^ 0xFFFFFFFFu;
+
+    uint8_t footer[4];
+    storeBigEndian(footer, crc);
+
+    return fwrite(header, 1, 8, file) == 8 &&
+        (length == 0 || fwrite(data, 1, length, file) == length) &&
+        fwrite(footer, 1, 4, file) == 4;
+}
+
+// byte offsets of red, green and blue inside a pixel, 0 if the format is not 8 bit per channel
+static int channelOrder(VkFormat format, uint32_t order[3])
+{
+    switch (format)
+    {
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+        order[0] = 0;
+        order[1] = 1;
+        order[2] = 2;
+        return 1;
+    case VK_FORMAT_B8G8R8A8_UNORM:
+    case VK_FORMAT_B8G8R8A8_SRGB:
+        order[0] = 2;
+        order[1] = 1;
+        order[2] = 0;
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+// swapchain composites opaque, alpha of the image is meaningless so PNG is stored as RGB
+static int writePng(FILE* file, const CaptureFrame* frame, const uint32_t order[3])
+{
+    static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+
+    size_t rowSize = 1 + (size_t) frame->width * 3;
+    size_t rawSize = rowSize * frame->height;
+    size_t blocks = (rawSize + CAPTURE_DEFLATE_BLOCK - 1) / CAPTURE_DEFLATE_BLOCK;
+    size_t zlibSize = 2 + blocks * 5 + rawSize + 4;
+
+    uint8_t* raw = malloc(rawSize);
+    uint8_t* zlib = malloc(zlibSize);
+    if (raw == NULL || zlib == NULL || zlibSize > UINT32_MAX) {
+        free(raw);
+        free(zlib);
+        return 0;
+    }
+
+    // filter type 0 -> rows are stored as is
+    for (uint32_t y = 0; y < frame->height; y++)
+    {
+        uint8_t* row = raw + rowSize * y;
+        const uint8_t* src = frame->pixels + (size_t) frame->width * 4 * y;
+
+        row[0] = 0;
+        for (uint32_t x = 0; x < frame->width; x++)
+        {
+            row[1 + x * 3 + 0] = src[x * 4 + order[0]];
+            row[1 + x * 3 + 1] = src[x * 4 + order[1]];
+            row[1 + x * 3 + 2] = src[x * 4 + order[2]];
+        }
+    }
+
+    // zlib stream of stored deflate blocks, encoding cost is the copy and the checksums
+    uint8_t* out = zlib;
+    *out++ = 0x78;
+    *out++ = 0x01;
+
+    uint32_t adlerA = 1;
+    uint32_t adlerB = 0;
+
+    for (size_t offset = 0; offset < rawSize; offset += CAPTURE_DEFLATE_BLOCK)
+    {
+        uint32_t length = rawSize - offset > CAPTURE_DEFLATE_BLOCK ? CAPTURE_DEFLATE_BLOCK : (uint32_t) (rawSize - offset);
+
+        *out++ = offset + length == rawSize;
+        *out++ = (uint8_t) length;
+        *out++ = (uint8_t) (length >> 8);
+        *out++ = (uint8_t) ~length;
+        *out++ = (uint8_t) (~length >> 8);
+
+        memcpy(out, raw + offset, length);
+        out += length;
+
+        // 65535 bytes per block keep the sums below overflow before the modulo
+        for (uint32_t i = 0; i < length; i++)
+        {
+            adlerA += raw[offset + i];
+            adlerB += adlerA;
+            if (adlerA >= 65521) {
+                adlerA -= 65521;
+            }
+        }
+        adlerB %= 65521;
+    }
+
+    storeBigEndian(out, (adlerB << 16) | adlerA);
+
+    uint8_t header[13];
+    storeBigEndian(header, frame->width);
+    storeBigEndian(header + 4, frame->height);
+    header[8] = 8;
+    header[9] = 2;
+    header[10] = 0;
+    header[11] = 0;
+    header[12] = 0;
+
+    int written = fwrite(signature, 1, sizeof(signature), file) == sizeof(signature) &&
+        writeChunk(file, "IHDR", header, sizeof(header)) &&
+        writeChunk(file, "IDAT", zlib, (uint32_t) zlibSize) &&
+        writeChunk(file, "IEND", NULL, 0);
+
+    free(raw);
+    free(zlib);
+
+    return written;
+}
+
+static int writePam(FILE* file, const CaptureFrame* frame, const uint32_t order[3])
+{
+    if (fprintf(file, "P7\nWIDTH %u\nHEIGHT %u\nDEPTH 4\nMAXVAL 255\nTUPLTYPE RGB_ALPHA\nENDHDR\n", frame->width, frame->height) < 0) {
+        return 0;
+    }
+
+    uint8_t* row = malloc((size_t) frame->width * 4);
+    if (row == NULL) {
+        return 0;
+    }
+
+    int written = 1;
+    for (uint32_t y = 0; written && y < frame->height; y++)
+    {
+        const uint8_t* src = frame->pixels + (size_t) frame->width * 4 * y;
+
+        for (uint32_t x = 0; x < frame->width; x++)
+        {
+            row[x * 4 + 0] = src[x * 4 + order[0]];
+            row[x * 4 + 1] = src[x * 4 + order[1]];
+            row[x * 4 + 2] = src[x * 4 + order[2]];
+            row[x * 4 + 3] = 0xFF;
+        }
+
+        written = fwrite(row, 1, (size_t) frame->width * 4, file) == (size_t) frame->width * 4;
+    }
+
+    free(row);
+
+    return written;
+}
+
+void captureFileCallback(void* userData, const CaptureFrame* frame)
+{
+    CaptureFileWriter* writer = userData;
+
+    uint32_t order[3];
+    if (!channelOrder(frame->format, order)) {
+        LOG_WARN("capture: swapchain format %d can not be written", frame->format);
+        return;
+    }
+
+    char path[512];
+    snprintf(path, sizeof(path), "%s/frame_%06llu.%s", writer->directory, (unsigned long long) frame->frame,
+        writer->format == CAPTURE_FILE_PNG ? "png" : "pam");
+
+    FILE* file = fopen(path, "wb");
+    if (file == NULL) {
+        LOG_WARN("capture: failed to open %s", path);
+        return;
+    }
+
+    int written = writer->format == CAPTURE_FILE_PNG ? writePng(file, frame, order) : writePam(file, frame, order);
+
+    if (fclose(file) != 0 || !written) {
+        LOG_WARN("capture: failed to write %s", path);
+    }
+}
+
+static void* captureEncoderMain(void* arg)
+{
+    State* state = arg;
+    Capture* capture = &state->capture;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&capture->mutex);
+        while (capture->running && capture->queueHead == capture->queueTail)
+        {
+            pthread_cond_wait(&capture->queued, &capture->mutex);
+        }
+
+        // queue is drained before the encoders stop
+        if (capture->queueHead == capture->queueTail) {
+            pthread_mutex_unlock(&capture->mutex);
+            break;
+        }
+
+        uint32_t index = capture->queue[capture->queueTail % CAPTURE_SLOT_COUNT];
+        capture->queueTail++;
+        pthread_mutex_unlock(&capture->mutex);
+
+        CaptureSlot* slot = &capture->slots[index];
+        CaptureFrame frame = {
+            .frame = slot->frame,
+            .width = slot->width,
+            .height = slot->height,
+            .format = slot->format,
+            .pixels = slot->mapped,
+        };
+
+        capture->callback(capture->userData, &frame);
+
+        pthread_mutex_lock(&capture->mutex);
+        __atomic_store_n(&slot->status, CAPTURE_SLOT_FREE, __ATOMIC_RELEASE);
+        pthread_cond_signal(&capture->freed);
+        pthread_mutex_unlock(&capture->mutex);
+    }
+
+    return NULL;
+}
+
+static void destroySlotBuffer(State* state, CaptureSlot* slot)
+{
+    if (slot->buffer == VK_NULL_HANDLE) {
+        return;
+    }
+
+    vkUnmapMemory(state->device, slot->memory);
+    vkDestroyBuffer(state->device, slot->buffer, state->allocator);
+    vkFreeMemory(state->device, slot->memory, state->allocator);
+
+    slot->buffer = VK_NULL_HANDLE;
+    slot->memory = VK_NULL_HANDLE;
+    slot->mapped = NULL;
+    slot->size = 0;
+}
+
+// host cached memory makes the CPU reads fast, coherent uncached memory is the fallback
+static void createSlotBuffer(State* state, CaptureSlot* slot, VkDeviceSize size)
+{
+    Capture* capture = &state->capture;
+
+    VkBufferCreateInfo bufferCrtInf = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .size = size,
+        .usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+    };
+
+    assertVk(vkCreateBuffer(state->device, &bufferCrtInf, state->allocator, &slot->buffer), "failed to create capture buffer", "created capture buffer");
+
+    VkMemoryRequirements memReq;
+    vkGetBufferMemoryRequirements(state->device, slot->buffer, &memReq);
+
+    uint32_t memoryTypeIndex;
+    capture->coherent = !tryFindMemoryType(state, memReq.memoryTypeBits,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT, &memoryTypeIndex);
+    if (capture->coherent) {
+        memoryTypeIndex = findMemoryType(state, memReq.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    }
+
+    VkMemoryAllocateInfo allocInf = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+        .pNext = NULL,
+        .allocationSize = memReq.size,
+        .memoryTypeIndex = memoryTypeIndex,
+    };
+
+    assertVk(vkAllocateMemory(state->device, &allocInf, state->allocator, &slot->memory), "failed to allocate capture memory", "allocated capture memory");
+    vkBindBufferMemory(state->device, slot->buffer, slot->memory, 0);
+
+    void* mapped;
+    assertVk(vkMapMemory(state->device, slot->memory, 0, VK_WHOLE_SIZE, 0, &mapped), "failed to map capture buffer", "mapped capture buffer");
+    slot->mapped = mapped;
+    slot->size = size;
+}
+
+void createCapture(State* state, CaptureCallback callback, void* userData, uint32_t encoderCount)
+{
+    Capture* capture = &state->capture;
+
+    initCrcTable();
+
+    memset(capture->slots, 0, sizeof(capture->slots));
+    capture->nextSlot = 0;
+    capture->recordSlot = UINT32_MAX;
+    capture->callback = callback;
+    capture->userData = userData;
+    capture->queueHead = 0;
+    capture->queueTail = 0;
+    capture->stalls = 0;
+
+    encoderCount = encoderCount == 0 ? 1 : encoderCount;
+    capture->encoderCount = encoderCount > CAPTURE_MAX_ENCODERS ? CAPTURE_MAX_ENCODERS : encoderCount;
+
+    pthread_mutex_init(&capture->mutex, NULL);
+    pthread_cond_init(&capture->queued, NULL);
+    pthread_cond_init(&capture->freed, NULL);
+
+    capture->running = 1;
+    for (uint32_t i = 0; i < capture->encoderCount; i++)
+    {
+        assert_my(pthread_create(&capture->encoders[i], NULL, captureEncoderMain, state) == 0, "failed to start capture encoder", "started capture encoder");
+    }
+
+    LOG("capture: %u slots, %u encoder threads", CAPTURE_SLOT_COUNT, capture->encoderCount);
+}
+
+void captureCollect(State* state, uint32_t frameIndex)
+{
+    Capture* capture = &state->capture;
+
+    for (uint32_t i = 0; i < CAPTURE_SLOT_COUNT; i++)
+    {
+        CaptureSlot* slot = &capture->slots[i];
+
+        if (__atomic_load_n(&slot->status, __ATOMIC_ACQUIRE) != CAPTURE_SLOT_GPU || slot->frameIndex != frameIndex) {
+            continue;
+        }
+
+        if (!capture->coherent) {
+            VkMappedMemoryRange range = {
+                .sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
+                .pNext = NULL,
+                .memory = slot->memory,
+                .offset = 0,
+                .size = VK_WHOLE_SIZE,
+            };
+            assertVk(vkInvalidateMappedMemoryRanges(state->device, 1, &range), "failed to invalidate capture memory", "");
+        }
+
+        __atomic_store_n(&slot->status, CAPTURE_SLOT_ENCODING, __ATOMIC_RELAXED);
+
+        // at most CAPTURE_SLOT_COUNT slots are ever queued, the queue can not overflow
+        pthread_mutex_lock(&capture->mutex);
+        capture->queue[capture->queueHead % CAPTURE_SLOT_COUNT] = i;
+        capture->queueHead++;
+        pthread_cond_signal(&capture->queued);
+        pthread_mutex_unlock(&capture->mutex);
+    }
+}
+
+void captureBeginFrame(State* state, uint32_t frameIndex, uint64_t frame)
+{
+    Capture* capture = &state->capture;
+
+    // slots are reused round robin, with more slots than frames in flight the
+    // next one was collected already and can only be busy encoding
+    uint32_t index = capture->nextSlot;
+    CaptureSlot* slot = &capture->slots[index];
+
+    if (__atomic_load_n(&slot->status, __ATOMIC_ACQUIRE) != CAPTURE_SLOT_FREE) {
+        capture->stalls++;
+        LOG_DEBUG("capture: waiting for encoder, %llu stalls", (unsigned long long) capture->stalls);
+
+        pthread_mutex_lock(&capture->mutex);
+        while (__atomic_load_n(&slot->status, __ATOMIC_ACQUIRE) != CAPTURE_SLOT_FREE)
+        {
+            pthread_cond_wait(&capture->freed, &capture->mutex);
+        }
+        pthread_mutex_unlock(&capture->mutex);
+    }
+
+    // free slot is not used by the GPU, it grows when the swapchain did
+    VkDeviceSize size = (VkDeviceSize) state->targets[0].extent.width * state->targets[0].extent.height * 4;
+    if (slot->size < size) {
+        destroySlotBuffer(state, slot);
+        createSlotBuffer(state, slot, size);
+    }
+
+    slot->frame = frame;
+    slot->frameIndex = frameIndex;
+    slot->width = state->targets[0].extent.width;
+    slot->height = state->targets[0].extent.height;
+    slot->format = state->swapchainFormat.format;
+    __atomic_store_n(&slot->status, CAPTURE_SLOT_GPU, __ATOMIC_RELAXED);
+
+    capture->recordSlot = index;
+    capture->nextSlot = (index + 1) % CAPTURE_SLOT_COUNT;
+}
+
+// copy into the reserved slot, image is a transfer source already
+static void recordSlotCopy(State* state, VkCommandBuffer commandBuffer, VkImage image)
+{
+    CaptureSlot* slot = &state->capture.slots[state->capture.recordSlot];
+
+    // tightly packed rows, callbacks get the buffer as is
+    VkBufferImageCopy region = {
+        .bufferOffset = 0,
+        .bufferRowLength = 0,
+        .bufferImageHeight = 0,
+        .imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1},
+        .imageOffset = {0, 0, 0},
+        .imageExtent = {slot->width, slot->height, 1},
+    };
+
+    vkCmdCopyImageToBuffer(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, slot->buffer, 1, &region);
+
+    // copy must be visible to host reads once the frame's fence signaled
+    VkBufferMemoryBarrier toHost = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+        .pNext = NULL,
+        .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_HOST_READ_BIT,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .buffer = slot->buffer,
+        .offset = 0,
+        .size = VK_WHOLE_SIZE,
+    };
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+        0, 0, NULL, 1, &toHost, 0, NULL);
+
+    state->capture.recordSlot = UINT32_MAX;
+}
+
+void captureRecordCopy(State* state, VkCommandBuffer commandBuffer, VkImage image, VkImageLayout layout,
+    VkPipelineStageFlags srcStage, VkAccessFlags srcAccess)
+{
+    VkImageMemoryBarrier toTransfer = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .pNext = NULL,
+        .srcAccessMask = srcAccess,
+        .dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
+        .oldLayout = layout,
+        .newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = image,
+        .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1},
+    };
+
+    vkCmdPipelineBarrier(commandBuffer, srcStage, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 1, &toTransfer);
+
+    recordSlotCopy(state, commandBuffer, image);
+
+    // presentation waits on the render finished semaphore, the image only needs its layout back
+    VkImageMemoryBarrier toPresent = toTransfer;
+    toPresent.srcAccessMask = 0;
+    toPresent.dstAccessMask = 0;
+    toPresent.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    toPresent.newLayout = state->presentLayout;
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+        0, 0, NULL, 0, NULL, 1, &toPresent);
+}
+
+void captureRecordGraphCopy(State* state, VkCommandBuffer commandBuffer, VkImage image)
+{
+    recordSlotCopy(state, commandBuffer, image);
+}
+
+void destroyCapture(State* state)
+{
+    Capture* capture = &state->capture;
+
+    // device is idle, copies of every frame in flight are done
+    for (uint32_t frameIndex = 0; frameIndex < MAX_FRAMES_IN_FLIGHT; frameIndex++)
+    {
+        captureCollect(state, frameIndex);
+    }
+
+    pthread_mutex_lock(&capture->mutex);
+    capture->running = 0;
+    pthread_cond_broadcast(&capture->queued);
+    pthread_mutex_unlock(&capture->mutex);
+
+    for (uint32_t i = 0; i < capture->encoderCount; i++)
+    {
+        pthread_join(capture->encoders[i], NULL);
+    }
+
+    for (uint32_t i = 0; i < CAPTURE_SLOT_COUNT; i++)
+    {
+        destroySlotBuffer(state, &capture->slots[i]);
+    }
+
+    if (capture->stalls > 0) {
+        LOG_WARN("capture: render loop waited for encoders %llu times", (unsigned long long) capture->stalls);
+    }
+
+    pthread_cond_destroy(&capture->freed);
+    pthread_cond_destroy(&capture->queued);
+    pthread_mutex_destroy(&capture->mutex);
+}
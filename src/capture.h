@@ -0,0 +1,155 @@
+#ifndef __CAPTURE_H__
+#define __CAPTURE_H__
+
+#include "common.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <vulkan/vulkan_core.h>
+
+// readback buffers, more than frames in flight so encoders can work on older frames while the GPU copies new ones
+#define CAPTURE_SLOT_COUNT 4
+#define CAPTURE_MAX_ENCODERS 8
+
+typedef enum CaptureSlotStatus
+{
+    CAPTURE_SLOT_FREE,
+    // copy recorded, waiting for fence of its frame in flight
+    CAPTURE_SLOT_GPU,
+    // handed to encoder threads, slot is freed once the callback returned
+    CAPTURE_SLOT_ENCODING,
+} CaptureSlotStatus;
+
+// captured swapchain image as passed to the callback
+typedef struct CaptureFrame
+{
+    // number of the frame since start
+    uint64_t frame;
+    uint32_t width;
+    uint32_t height;
+    // swapchain format, 4 bytes per pixel
+    VkFormat format;
+    // rows of width * 4 bytes without padding, valid during the callback only
+    const uint8_t* pixels;
+} CaptureFrame;
+
+// called on an encoder thread, several frames may be encoded at the same time
+typedef void (*CaptureCallback)(void* userData, const CaptureFrame* frame);
+
+typedef struct CaptureSlot
+{
+    // CaptureSlotStatus, accessed atomically
+    int status;
+
+    // persistently mapped, host cached when the device has such memory
+    VkBuffer buffer;
+    VkDeviceMemory memory;
+    uint8_t* mapped;
+    VkDeviceSize size;
+
+    uint64_t frame;
+    // frame in flight whose fence guards the copy
+    uint32_t frameIndex;
+    uint32_t width;
+    uint32_t height;
+    VkFormat format;
+} CaptureSlot;
+
+// copies every rendered swapchain image into host memory and hands it to encoder threads
+typedef struct Capture
+{
+    CaptureSlot slots[CAPTURE_SLOT_COUNT];
+    uint32_t nextSlot;
+    // slot the current command buffer copies into, UINT32_MAX when frame is not captured
+    uint32_t recordSlot;
+    // host coherent fallback memory needs no invalidate
+    VkBool32 coherent;
+
+    CaptureCallback callback;
+    void* userData;
+
+    pthread_t encoders[CAPTURE_MAX_ENCODERS];
+    uint32_t encoderCount;
+    int running;
+
+    // slots waiting for an encoder, protected by mutex
+    pthread_mutex_t mutex;
+    pthread_cond_t queued;
+    pthread_cond_t freed;
+    uint32_t queue[CAPTURE_SLOT_COUNT];
+    uint32_t queueHead;
+    uint32_t queueTail;
+
+    // frames the render loop had to wait for a free slot
+    uint64_t stalls;
+} Capture;
+
+#define CAPTURE_DEFAULT_ENCODERS 2
+
+typedef enum CaptureFileFormat
+{
+    // 8 bit RGB PNG with uncompressed deflate blocks, cheap to encode
+    CAPTURE_FILE_PNG,
+    // PAM RGB_ALPHA, raw pixels with a short text header, loadable as --texture
+    CAPTURE_FILE_PAM,
+} CaptureFileFormat;
+
+// user data of captureFileCallback
+typedef struct CaptureFileWriter
+{
+    char directory[256];
+    CaptureFileFormat format;
+} CaptureFileWriter;
+
+/**
+ * @brief allocates readback slots and starts encoder threads
+ * Requires:
+    - state->captureFrames was set before swapchain creation
+ * @param callback receives every captured frame on an encoder thread
+ * @param encoderCount number of encoder threads, clamped to 1..CAPTURE_MAX_ENCODERS
+ */
+void createCapture(State* state, CaptureCallback callback, void* userData, uint32_t encoderCount);
+
+/**
+ * @brief hands slots copied by the given frame in flight to the encoders
+ * Requires:
+    - fence of the frame in flight signaled
+ */
+void captureCollect(State* state, uint32_t frameIndex);
+
+/**
+ * @brief reserves slot for the frame about to be recorded
+ * @details waits for an encoder only when every slot is still busy, never waits for the GPU
+ */
+void captureBeginFrame(State* state, uint32_t frameIndex, uint64_t frame);
+
+/**
+ * @brief records copy of the rendered image of the first target into the reserved slot and leaves image in state->presentLayout
+ * @param layout current layout of the image
+ * @param srcStage stage which last wrote the image or its layout
+ * @param srcAccess access of that write
+ */
+void captureRecordCopy(State* state, VkCommandBuffer commandBuffer, VkImage image, VkImageLayout layout,
+    VkPipelineStageFlags srcStage, VkAccessFlags srcAccess);
+
+/**
+ * @brief records copy of the rendered image of the first target into the reserved slot, for render graph passes
+ * Requires:
+    - image in VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL with color writes visible to transfer reads
+ */
+void captureRecordGraphCopy(State* state, VkCommandBuffer commandBuffer, VkImage image);
+
+/**
+ * @brief CaptureCallback writing every frame as file frame_<number>.png or .pam into writer's directory
+ * @param userData CaptureFileWriter
+ */
+void captureFileCallback(void* userData, const CaptureFrame* frame);
+
+/**
+ * @brief encodes all outstanding frames, stops encoders and frees slots
+ * Requires:
+    - device idle
+ */
+void destroyCapture(State* state);
+
+#endif // __CAPTURE_H__
@@ -0,0 +1,32 @@
+#ifndef __COMMON_H__
+#define __COMMON_H__
+
+#include <cglm/types.h>
+#include <stdint.h>
+#include <vulkan/vulkan_core.h>
+
+// completed in init.h, subsystem headers only take them by pointer
+typedef struct State State;
+typedef struct RenderTarget RenderTarget;
+
+#define MAX_FRAMES_IN_FLIGHT 2
+
+// windows and headless targets rendered by one device, all of them are recorded into one submission
+#define MAX_RENDER_TARGETS 8
+
+// smallest per draw data, pushed directly into the command buffer
+// layout must match PushConstants block in the shaders
+typedef struct DrawPushConstants
+{
+    vec4 offset;
+    // indices into bindless arrays of set 1
+    uint32_t textureIndex;
+    uint32_t materialIndex;
+    // vertices fetched by pulled.vert, unused with fixed vertex input
+    VkDeviceAddress vertexAddress;
+    // VertexFormat
+    uint32_t vertexFormat;
+    uint32_t padding[3];
+} DrawPushConstants;
+
+#endif // __COMMON_H__
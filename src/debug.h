@@ -6,24 +6,34 @@
 
 #include <vulkan/vulkan.h>
 
+#include "log.h"
+
 
 
 #define COLORRED    "\033[31m"
 #define COLORGREEN  "\033[32m"
+#define COLORYELLOW "\033[33m"
 
-#define COLOREND    "\033[m" 
+#define COLOREND    "\033[m"
 
 #define STARTBOLD   "\033[1m"
 #define ENDBOLD     "\033[0m"
 
-#define ERRMSG(MSG) STARTBOLD COLORRED MSG COLOREND 
+#define ERRMSG(MSG) STARTBOLD COLORRED MSG COLOREND
+#define WARNMSG(MSG) STARTBOLD COLORYELLOW MSG COLOREND
 #define SUCCESMSG(MSG) STARTBOLD COLORGREEN MSG COLOREND
 
 
-#define assertVk(EX, MSG, SCSMSG) if(EX != VK_SUCCESS){ fprintf(stderr, "%s in %s->%s on line %d\n", ERRMSG(MSG), __FILE__, __func__, __LINE__); exit(EXIT_FAILURE);} else {fprintf(stdout, "%s\n", SUCCESMSG(SCSMSG));};
-#define assert_my(EX, MSG, SCSMSG) if(!(EX)) { fprintf(stderr, " %s in %s->%s on line %d\n", ERRMSG(MSG), __FILE__, __func__, __LINE__); exit(EXIT_FAILURE);}else {fprintf(stdout, "%s\n", SUCCESMSG(SCSMSG));};
+// level check is a constant for the compiler and a single load at runtime, arguments are not evaluated when skipped
+// the format is part of __VA_ARGS__, format only calls stay valid ISO C99 without the GNU ## extension
+#define LOG_AT(LEVEL, ...) do { if ((LEVEL) <= LOG_COMPILE_LEVEL && (LEVEL) <= logLevel) { logWrite((LEVEL), __FILE__, __func__, __LINE__, __VA_ARGS__); } } while (0)
 
+#define LOG(...) LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_WARN(...) LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_DEBUG(...) LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
 
-#define LOG(format, ...) fprintf (stderr, SUCCESMSG(format)"\n", ##__VA_ARGS__)
+// success messages are debug level so they are off by default and cost nothing on hot paths
+#define assertVk(EX, MSG, SCSMSG) do { VkResult assertRslt = (EX); if (assertRslt != VK_SUCCESS) { logFatal(__FILE__, __func__, __LINE__, "%s (VkResult %d)", MSG, assertRslt); } else { LOG_DEBUG("%s", SCSMSG); } } while (0)
+#define assert_my(EX, MSG, SCSMSG) do { if (!(EX)) { logFatal(__FILE__, __func__, __LINE__, "%s", MSG); } else { LOG_DEBUG("%s", SCSMSG); } } while (0)
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,134 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "dispatch.h"
+
+#include "debug.h"
+
+#include <dlfcn.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <vulkan/vulkan_core.h>
+
+#define DISPATCH_DEFINE(NAME) PFN_##NAME NAME = NULL;
+DISPATCH_FUNCTIONS(DISPATCH_DEFINE)
+#undef DISPATCH_DEFINE
+
+PFN_vkGetInstanceProcAddr vkGetInstanceProcAddr = NULL;
+
+uint64_t dispatchCalls[DISPATCH_FUNCTION_COUNT];
+
+static const char* dispatchFunctionNames[DISPATCH_FUNCTION_COUNT] = {
+#define DISPATCH_NAME(NAME) [DISPATCH_FUNCTION_##NAME] = #NAME,
+    DISPATCH_FUNCTIONS(DISPATCH_NAME)
+#undef DISPATCH_NAME
+};
+
+static DispatchBackend dispatchSelected = DISPATCH_BACKEND_VULKAN;
+static void* dispatchLoader = NULL;
+
+int dispatchInit(DispatchBackend backend)
+{
+    dispatchSelected = backend;
+
+    if (backend == DISPATCH_BACKEND_NULL) {
+        dispatchUseNull();
+        LOG("dispatch: null backend, Vulkan calls are counted and not executed");
+        return 0;
+    }
+
+    dispatchLoader = dlopen("libvulkan.so.1", RTLD_NOW | RTLD_LOCAL);
+    if (dispatchLoader == NULL) {
+        dispatchLoader = dlopen("libvulkan.so", RTLD_NOW | RTLD_LOCAL);
+    }
+
+    if (dispatchLoader == NULL) {
+        LOG_WARN("dispatch: failed to open the Vulkan loader: %s", dlerror());
+        return -1;
+    }
+
+    // object to function pointer conversion the way POSIX documents for dlsym
+    *(void**) &vkGetInstanceProcAddr = dlsym(dispatchLoader, "vkGetInstanceProcAddr");
+    if (vkGetInstanceProcAddr == NULL) {
+        LOG_WARN("dispatch: loader has no vkGetInstanceProcAddr");
+        return -1;
+    }
+
+#define DISPATCH_LOAD_GLOBAL(NAME) NAME = (PFN_##NAME) vkGetInstanceProcAddr(NULL, #NAME);
+    DISPATCH_GLOBAL_FUNCTIONS(DISPATCH_LOAD_GLOBAL)
+#undef DISPATCH_LOAD_GLOBAL
+
+    return 0;
+}
+
+void dispatchLoadInstance(VkInstance instance)
+{
+    if (dispatchSelected == DISPATCH_BACKEND_NULL) {
+        return;
+    }
+
+#define DISPATCH_LOAD_INSTANCE(NAME) NAME = (PFN_##NAME) vkGetInstanceProcAddr(instance, #NAME);
+    DISPATCH_INSTANCE_FUNCTIONS(DISPATCH_LOAD_INSTANCE)
+    DISPATCH_DEVICE_FUNCTIONS(DISPATCH_LOAD_INSTANCE)
+#undef DISPATCH_LOAD_INSTANCE
+}
+
+void dispatchLoadDevice(VkDevice device)
+{
+    if (dispatchSelected == DISPATCH_BACKEND_NULL) {
+        return;
+    }
+
+#define DISPATCH_LOAD_DEVICE(NAME) \
+    { \
+        PFN_##NAME function = (PFN_##NAME) vkGetDeviceProcAddr(device, #NAME); \
+        NAME = function != NULL ? function : NAME; \
+    }
+    DISPATCH_DEVICE_FUNCTIONS(DISPATCH_LOAD_DEVICE)
+#undef DISPATCH_LOAD_DEVICE
+}
+
+void dispatchShutdown(void)
+{
+    if (dispatchLoader != NULL) {
+        dlclose(dispatchLoader);
+        dispatchLoader = NULL;
+    }
+}
+
+DispatchBackend dispatchBackend(void)
+{
+    return dispatchSelected;
+}
+
+const char* dispatchFunctionName(DispatchFunction function)
+{
+    return function < DISPATCH_FUNCTION_COUNT ? dispatchFunctionNames[function] : "unknown";
+}
+
+void dispatchResetCalls(void)
+{
+    for (uint32_t f = 0; f < DISPATCH_FUNCTION_COUNT; f++)
+    {
+        __atomic_store_n(&dispatchCalls[f], 0, __ATOMIC_RELAXED);
+    }
+}
+
+void dispatchPrintCalls(FILE* out, uint64_t frames)
+{
+    fprintf(out, "%-48s %12s %12s\n", "vulkan function", "calls", "per frame");
+
+    uint64_t total = 0;
+    for (uint32_t f = 0; f < DISPATCH_FUNCTION_COUNT; f++)
+    {
+        uint64_t calls = __atomic_load_n(&dispatchCalls[f], __ATOMIC_RELAXED);
+        if (calls == 0) {
+            continue;
+        }
+
+        total += calls;
+        fprintf(out, "%-48s %12llu %12.2f\n", dispatchFunctionName(f), (unsigned long long) calls,
+            frames > 0 ? (double) calls / (double) frames : 0.0);
+    }
+
+    fprintf(out, "%-48s %12llu %12.2f\n", "total", (unsigned long long) total, frames > 0 ? (double) total / (double) frames : 0.0);
+}
@@ -0,0 +1,199 @@
+#ifndef __DISPATCH_H__
+#define __DISPATCH_H__
+
+// every Vulkan call goes through the function pointers below, built with VK_NO_PROTOTYPES so nothing links the loader
+#include <stdint.h>
+#include <stdio.h>
+#include <vulkan/vulkan_core.h>
+
+// entry points queried without an instance
+#define DISPATCH_GLOBAL_FUNCTIONS(X) \
+    X(vkCreateInstance)
+
+// entry points of the instance and its physical devices
+#define DISPATCH_INSTANCE_FUNCTIONS(X) \
+    X(vkCreateDevice) \
+    X(vkDestroyInstance) \
+    X(vkDestroySurfaceKHR) \
+    X(vkEnumerateDeviceExtensionProperties) \
+    X(vkEnumeratePhysicalDevices) \
+    X(vkGetDeviceProcAddr) \
+    X(vkGetPhysicalDeviceExternalSemaphoreProperties) \
+    X(vkGetPhysicalDeviceFeatures2) \
+    X(vkGetPhysicalDeviceFormatProperties) \
+    X(vkGetPhysicalDeviceImageFormatProperties2) \
+    X(vkGetPhysicalDeviceMemoryProperties) \
+    X(vkGetPhysicalDeviceProperties) \
+    X(vkGetPhysicalDeviceProperties2) \
+    X(vkGetPhysicalDeviceQueueFamilyProperties) \
+    X(vkGetPhysicalDeviceSurfaceCapabilitiesKHR) \
+    X(vkGetPhysicalDeviceSurfaceFormatsKHR) \
+    X(vkGetPhysicalDeviceSurfaceSupportKHR)
+
+// entry points of the device and its child objects, loaded from the driver without the loader trampoline
+#define DISPATCH_DEVICE_FUNCTIONS(X) \
+    X(vkAcquireNextImageKHR) \
+    X(vkAllocateCommandBuffers) \
+    X(vkAllocateDescriptorSets) \
+    X(vkAllocateMemory) \
+    X(vkBeginCommandBuffer) \
+    X(vkBindBufferMemory) \
+    X(vkBindImageMemory) \
+    X(vkCmdBeginRenderPass) \
+    X(vkCmdBeginRendering) \
+    X(vkCmdBindDescriptorSets) \
+    X(vkCmdBindIndexBuffer) \
+    X(vkCmdBindPipeline) \
+    X(vkCmdBindVertexBuffers) \
+    X(vkCmdBlitImage) \
+    X(vkCmdClearColorImage) \
+    X(vkCmdCopyBuffer) \
+    X(vkCmdCopyBufferToImage) \
+    X(vkCmdCopyImage) \
+    X(vkCmdCopyImageToBuffer) \
+    X(vkCmdDispatch) \
+    X(vkCmdDrawIndexed) \
+    X(vkCmdEndRenderPass) \
+    X(vkCmdEndRendering) \
+    X(vkCmdPipelineBarrier) \
+    X(vkCmdPipelineBarrier2) \
+    X(vkCmdPushConstants) \
+    X(vkCmdSetCullMode) \
+    X(vkCmdSetDepthCompareOp) \
+    X(vkCmdSetDepthTestEnable) \
+    X(vkCmdSetDepthWriteEnable) \
+    X(vkCmdSetFrontFace) \
+    X(vkCmdSetPrimitiveTopology) \
+    X(vkCmdSetScissor) \
+    X(vkCmdSetViewport) \
+    X(vkCreateBuffer) \
+    X(vkCreateCommandPool) \
+    X(vkCreateComputePipelines) \
+    X(vkCreateDescriptorPool) \
+    X(vkCreateDescriptorSetLayout) \
+    X(vkCreateFence) \
+    X(vkCreateFramebuffer) \
+    X(vkCreateGraphicsPipelines) \
+    X(vkCreateImage) \
+    X(vkCreateImageView) \
+    X(vkCreatePipelineCache) \
+    X(vkCreatePipelineLayout) \
+    X(vkCreateRenderPass) \
+    X(vkCreateSampler) \
+    X(vkCreateSemaphore) \
+    X(vkCreateShaderModule) \
+    X(vkCreateSwapchainKHR) \
+    X(vkDestroyBuffer) \
+    X(vkDestroyCommandPool) \
+    X(vkDestroyDescriptorPool) \
+    X(vkDestroyDescriptorSetLayout) \
+    X(vkDestroyDevice) \
+    X(vkDestroyFence) \
+    X(vkDestroyFramebuffer) \
+    X(vkDestroyImage) \
+    X(vkDestroyImageView) \
+    X(vkDestroyPipeline) \
+    X(vkDestroyPipelineCache) \
+    X(vkDestroyPipelineLayout) \
+    X(vkDestroyRenderPass) \
+    X(vkDestroySampler) \
+    X(vkDestroySemaphore) \
+    X(vkDestroyShaderModule) \
+    X(vkDestroySwapchainKHR) \
+    X(vkDeviceWaitIdle) \
+    X(vkEndCommandBuffer) \
+    X(vkFlushMappedMemoryRanges) \
+    X(vkFreeCommandBuffers) \
+    X(vkFreeMemory) \
+    X(vkGetBufferDeviceAddress) \
+    X(vkGetBufferMemoryRequirements) \
+    X(vkGetDeviceQueue) \
+    X(vkGetFenceStatus) \
+    X(vkGetImageMemoryRequirements) \
+    X(vkGetPipelineCacheData) \
+    X(vkGetSwapchainImagesKHR) \
+    X(vkInvalidateMappedMemoryRanges) \
+    X(vkMapMemory) \
+    X(vkQueuePresentKHR) \
+    X(vkQueueSubmit) \
+    X(vkQueueWaitIdle) \
+    X(vkResetCommandBuffer) \
+    X(vkResetFences) \
+    X(vkUnmapMemory) \
+    X(vkUpdateDescriptorSets) \
+    X(vkWaitForFences) \
+    X(vkWaitSemaphores)
+
+#define DISPATCH_FUNCTIONS(X) DISPATCH_GLOBAL_FUNCTIONS(X) DISPATCH_INSTANCE_FUNCTIONS(X) DISPATCH_DEVICE_FUNCTIONS(X)
+
+// same names as the prototypes they replace, call sites stay plain Vulkan
+#define DISPATCH_DECLARE(NAME) extern PFN_##NAME NAME;
+DISPATCH_FUNCTIONS(DISPATCH_DECLARE)
+#undef DISPATCH_DECLARE
+
+extern PFN_vkGetInstanceProcAddr vkGetInstanceProcAddr;
+
+typedef enum DispatchFunction
+{
+#define DISPATCH_ENUM(NAME) DISPATCH_FUNCTION_##NAME,
+    DISPATCH_FUNCTIONS(DISPATCH_ENUM)
+#undef DISPATCH_ENUM
+
+    DISPATCH_FUNCTION_COUNT
+} DispatchFunction;
+
+typedef enum DispatchBackend
+{
+    // system Vulkan loader and the driver it picks
+    DISPATCH_BACKEND_VULKAN,
+    // accepts and counts every call without executing it, headless targets only
+    DISPATCH_BACKEND_NULL,
+} DispatchBackend;
+
+// calls per function made through the null backend, incremented atomically
+extern uint64_t dispatchCalls[DISPATCH_FUNCTION_COUNT];
+
+/**
+ * @brief selects the backend, the Vulkan backend opens the loader and loads the global entry points
+ * @return 0 on success, -1 when the loader could not be opened
+ */
+int dispatchInit(DispatchBackend backend);
+
+/**
+ * @brief loads instance entry points, device entry points are set to the loader trampolines until a device exists
+ */
+void dispatchLoadInstance(VkInstance instance);
+
+/**
+ * @brief loads device entry points directly from the driver of device
+ * @details only one device is used, entry points of extensions the device did not enable keep their trampolines
+ */
+void dispatchLoadDevice(VkDevice device);
+
+/**
+ * @brief closes the loader
+ * Requires:
+    - instance destroyed
+ */
+void dispatchShutdown(void);
+
+DispatchBackend dispatchBackend(void);
+
+const char* dispatchFunctionName(DispatchFunction function);
+
+/**
+ * @brief zeroes the call counters, counts after it cover only what follows, e.g. the frame loop
+ */
+void dispatchResetCalls(void);
+
+/**
+ * @brief prints calls of every function the null backend received, total and per frame
+ */
+void dispatchPrintCalls(FILE* out, uint64_t frames);
+
+/**
+ * @brief points every entry point at the null backend
+ */
+void dispatchUseNull(void);
+
+#endif // __DISPATCH_H__
@@ -0,0 +1,733 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "dispatch.h"
+
+#include "alloc.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vulkan/vulkan_core.h>
+
+// device of the null backend: one memory type which is everything, a graphics and a compute only family
+#define NULL_HEAP_SIZE (8ull << 30)
+#define NULL_MEMORY_ALIGNMENT 256
+// bytes reserved per texel of an image, enough for every format used
+#define NULL_TEXEL_SIZE 16
+
+#define NULL_CALL(NAME) __atomic_add_fetch(&dispatchCalls[DISPATCH_FUNCTION_##NAME], 1, __ATOMIC_RELAXED)
+
+// buffers, images and memory remember their size, memory holds host storage so mapping works
+// and bound buffers point into the storage of their memory
+typedef struct NullObject
+{
+    VkDeviceSize size;
+    void* data;
+} NullObject;
+
+static uint64_t nullHandleCounter = 0;
+
+// handles are never dereferenced, unique values keep hash maps and comparisons of the callers working
+static uintptr_t nullHandle(void)
+{
+    return (uintptr_t) __atomic_add_fetch(&nullHandleCounter, 1, __ATOMIC_RELAXED) << 4;
+}
+
+static NullObject* nullObject(VkDeviceSize size)
+{
+    // objects are the driver's memory, the allocation guard does not see them
+    NullObject* object = ALLOC_UNGUARDED(calloc)(1, sizeof(NullObject));
+    if (object != NULL) {
+        object->size = size;
+    }
+    return object;
+}
+
+// every feature struct is a header followed only by VkBool32 members
+static void nullEnableFeatures(VkBaseOutStructure* features, size_t size)
+{
+    VkBool32* flags = (VkBool32*) (features + 1);
+    size_t count = (size - sizeof(VkBaseOutStructure)) / sizeof(VkBool32);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        flags[i] = VK_TRUE;
+    }
+}
+
+static VkResult vkCreateInstanceNull(const VkInstanceCreateInfo* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkInstance* pInstance)
+{
+    NULL_CALL(vkCreateInstance);
+    *pInstance = (VkInstance) nullHandle();
+    return VK_SUCCESS;
+}
+
+static void vkDestroyInstanceNull(VkInstance instance, const VkAllocationCallbacks* pAllocator)
+{
+    NULL_CALL(vkDestroyInstance);
+}
+
+static void vkDestroySurfaceKHRNull(VkInstance instance, VkSurfaceKHR surface, const VkAllocationCallbacks* pAllocator)
+{
+    NULL_CALL(vkDestroySurfaceKHR);
+}
+
+static VkResult vkEnumeratePhysicalDevicesNull(VkInstance instance, uint32_t* pPhysicalDeviceCount, VkPhysicalDevice* pPhysicalDevices)
+{
+    NULL_CALL(vkEnumeratePhysicalDevices);
+
+    if (pPhysicalDevices != NULL && *pPhysicalDeviceCount > 0) {
+        pPhysicalDevices[0] = (VkPhysicalDevice) (uintptr_t) 0x10;
+    }
+    *pPhysicalDeviceCount = 1;
+    return VK_SUCCESS;
+}
+
+// no extensions, everything optional stays off
+static VkResult vkEnumerateDeviceExtensionPropertiesNull(VkPhysicalDevice physicalDevice, const char* pLayerName, uint32_t* pPropertyCount, VkExtensionProperties* pProperties)
+{
+    NULL_CALL(vkEnumerateDeviceExtensionProperties);
+    *pPropertyCount = 0;
+    return VK_SUCCESS;
+}
+
+static PFN_vkVoidFunction vkGetDeviceProcAddrNull(VkDevice device, const char* pName)
+{
+    NULL_CALL(vkGetDeviceProcAddr);
+    return NULL;
+}
+
+static PFN_vkVoidFunction vkGetInstanceProcAddrNull(VkInstance instance, const char* pName)
+{
+    return NULL;
+}
+
+static void vkGetPhysicalDeviceExternalSemaphorePropertiesNull(VkPhysicalDevice physicalDevice, const VkPhysicalDeviceExternalSemaphoreInfo* pExternalSemaphoreInfo, VkExternalSemaphoreProperties* pExternalSemaphoreProperties)
+{
+    NULL_CALL(vkGetPhysicalDeviceExternalSemaphoreProperties);
+    pExternalSemaphoreProperties->exportFromImportedHandleTypes = 0;
+    pExternalSemaphoreProperties->compatibleHandleTypes = 0;
+    pExternalSemaphoreProperties->externalSemaphoreFeatures = 0;
+}
+
+static void vkGetPhysicalDeviceFeatures2Null(VkPhysicalDevice physicalDevice, VkPhysicalDeviceFeatures2* pFeatures)
+{
+    NULL_CALL(vkGetPhysicalDeviceFeatures2);
+
+    for (VkBaseOutStructure* s = (VkBaseOutStructure*) pFeatures; s != NULL; s = s->pNext)
+    {
+        switch (s->sType)
+        {
+            case VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2:
+                nullEnableFeatures(s, sizeof(VkPhysicalDeviceFeatures2));
+                break;
+            case VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES:
+                nullEnableFeatures(s, sizeof(VkPhysicalDeviceVulkan12Features));
+                break;
+            case VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES:
+                nullEnableFeatures(s, sizeof(VkPhysicalDeviceVulkan13Features));
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+static void vkGetPhysicalDeviceFormatPropertiesNull(VkPhysicalDevice physicalDevice, VkFormat format, VkFormatProperties* pFormatProperties)
+{
+    NULL_CALL(vkGetPhysicalDeviceFormatProperties);
+    pFormatProperties->linearTilingFeatures = ~(VkFormatFeatureFlags) 0;
+    pFormatProperties->optimalTilingFeatures = ~(VkFormatFeatureFlags) 0;
+    pFormatProperties->bufferFeatures = ~(VkFormatFeatureFlags) 0;
+}
+
+static VkResult vkGetPhysicalDeviceImageFormatProperties2Null(VkPhysicalDevice physicalDevice, const VkPhysicalDeviceImageFormatInfo2* pImageFormatInfo, VkImageFormatProperties2* pImageFormatProperties)
+{
+    NULL_CALL(vkGetPhysicalDeviceImageFormatProperties2);
+    return VK_ERROR_FORMAT_NOT_SUPPORTED;
+}
+
+static void vkGetPhysicalDeviceMemoryPropertiesNull(VkPhysicalDevice physicalDevice, VkPhysicalDeviceMemoryProperties* pMemoryProperties)
+{
+    NULL_CALL(vkGetPhysicalDeviceMemoryProperties);
+
+    memset(pMemoryProperties, 0, sizeof(*pMemoryProperties));
+    pMemoryProperties->memoryTypeCount = 1;
+    pMemoryProperties->memoryTypes[0].propertyFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+        VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+    pMemoryProperties->memoryTypes[0].heapIndex = 0;
+    pMemoryProperties->memoryHeapCount = 1;
+    pMemoryProperties->memoryHeaps[0].size = NULL_HEAP_SIZE;
+    pMemoryProperties->memoryHeaps[0].flags = VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+}
+
+static void nullDeviceProperties(VkPhysicalDeviceProperties* properties)
+{
+    memset(properties, 0, sizeof(*properties));
+    properties->apiVersion = VK_API_VERSION_1_3;
+    properties->deviceType = VK_PHYSICAL_DEVICE_TYPE_CPU;
+    strcpy(properties->deviceName, "null device");
+
+    properties->limits.maxImageDimension2D = 16384;
+    properties->limits.maxUniformBufferRange = 65536;
+    properties->limits.maxStorageBufferRange = 1u << 30;
+    properties->limits.maxPushConstantsSize = 256;
+    properties->limits.maxBoundDescriptorSets = 8;
+    properties->limits.minUniformBufferOffsetAlignment = NULL_MEMORY_ALIGNMENT;
+    properties->limits.minStorageBufferOffsetAlignment = NULL_MEMORY_ALIGNMENT;
+    properties->limits.nonCoherentAtomSize = NULL_MEMORY_ALIGNMENT;
+    properties->limits.optimalBufferCopyOffsetAlignment = 16;
+    properties->limits.optimalBufferCopyRowPitchAlignment = 1;
+    properties->limits.timestampPeriod = 1.0f;
+}
+
+static void vkGetPhysicalDevicePropertiesNull(VkPhysicalDevice physicalDevice, VkPhysicalDeviceProperties* pProperties)
+{
+    NULL_CALL(vkGetPhysicalDeviceProperties);
+    nullDeviceProperties(pProperties);
+}
+
+static void vkGetPhysicalDeviceProperties2Null(VkPhysicalDevice physicalDevice, VkPhysicalDeviceProperties2* pProperties)
+{
+    NULL_CALL(vkGetPhysicalDeviceProperties2);
+    nullDeviceProperties(&pProperties->properties);
+
+    for (VkBaseOutStructure* s = pProperties->pNext; s != NULL; s = s->pNext)
+    {
+        if (s->sType == VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES) {
+            VkPhysicalDeviceVulkan12Properties* props12 = (VkPhysicalDeviceVulkan12Properties*) s;
+            props12->maxPerStageDescriptorUpdateAfterBindSampledImages = 1u << 20;
+            props12->maxDescriptorSetUpdateAfterBindSampledImages = 1u << 20;
+            props12->maxPerStageDescriptorUpdateAfterBindStorageBuffers = 1u << 20;
+            props12->maxDescriptorSetUpdateAfterBindStorageBuffers = 1u << 20;
+        }
+    }
+}
+
+static void vkGetPhysicalDeviceQueueFamilyPropertiesNull(VkPhysicalDevice physicalDevice, uint32_t* pQueueFamilyPropertyCount, VkQueueFamilyProperties* pQueueFamilyProperties)
+{
+    NULL_CALL(vkGetPhysicalDeviceQueueFamilyProperties);
+
+    VkQueueFamilyProperties families[2] = {
+        {.queueFlags = VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT, .queueCount = 1, .timestampValidBits = 64, .minImageTransferGranularity = {1, 1, 1}},
+        {.queueFlags = VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT, .queueCount = 1, .timestampValidBits = 64, .minImageTransferGranularity = {1, 1, 1}},
+    };
+
+    if (pQueueFamilyProperties == NULL) {
+        *pQueueFamilyPropertyCount = 2;
+        return;
+    }
+
+    *pQueueFamilyPropertyCount = *pQueueFamilyPropertyCount < 2 ? *pQueueFamilyPropertyCount : 2;
+    memcpy(pQueueFamilyProperties, families, sizeof(VkQueueFamilyProperties) * *pQueueFamilyPropertyCount);
+}
+
+// surfaces never exist, windows are rejected before the backend is selected
+static VkResult vkGetPhysicalDeviceSurfaceCapabilitiesKHRNull(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface, VkSurfaceCapabilitiesKHR* pSurfaceCapabilities)
+{
+    NULL_CALL(vkGetPhysicalDeviceSurfaceCapabilitiesKHR);
+    return VK_ERROR_SURFACE_LOST_KHR;
+}
+
+static VkResult vkGetPhysicalDeviceSurfaceFormatsKHRNull(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface, uint32_t* pSurfaceFormatCount, VkSurfaceFormatKHR* pSurfaceFormats)
+{
+    NULL_CALL(vkGetPhysicalDeviceSurfaceFormatsKHR);
+    *pSurfaceFormatCount = 0;
+    return VK_ERROR_SURFACE_LOST_KHR;
+}
+
+static VkResult vkGetPhysicalDeviceSurfaceSupportKHRNull(VkPhysicalDevice physicalDevice, uint32_t queueFamilyIndex, VkSurfaceKHR surface, VkBool32* pSupported)
+{
+    NULL_CALL(vkGetPhysicalDeviceSurfaceSupportKHR);
+    *pSupported = VK_FALSE;
+    return VK_SUCCESS;
+}
+
+static VkResult vkCreateDeviceNull(VkPhysicalDevice physicalDevice, const VkDeviceCreateInfo* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkDevice* pDevice)
+{
+    NULL_CALL(vkCreateDevice);
+    *pDevice = (VkDevice) nullHandle();
+    return VK_SUCCESS;
+}
+
+static void vkDestroyDeviceNull(VkDevice device, const VkAllocationCallbacks* pAllocator)
+{
+    NULL_CALL(vkDestroyDevice);
+}
+
+static void vkGetDeviceQueueNull(VkDevice device, uint32_t queueFamilyIndex, uint32_t queueIndex, VkQueue* pQueue)
+{
+    NULL_CALL(vkGetDeviceQueue);
+    *pQueue = (VkQueue) (uintptr_t) ((queueFamilyIndex + 1) << 8 | (queueIndex + 1) << 4);
+}
+
+static VkResult vkDeviceWaitIdleNull(VkDevice device)
+{
+    NULL_CALL(vkDeviceWaitIdle);
+    return VK_SUCCESS;
+}
+
+static VkResult vkQueueWaitIdleNull(VkQueue queue)
+{
+    NULL_CALL(vkQueueWaitIdle);
+    return VK_SUCCESS;
+}
+
+// memory and resources
+
+static VkResult vkAllocateMemoryNull(VkDevice device, const VkMemoryAllocateInfo* pAllocateInfo, const VkAllocationCallbacks* pAllocator, VkDeviceMemory* pMemory)
+{
+    NULL_CALL(vkAllocateMemory);
+
+    NullObject* memory = nullObject(pAllocateInfo->allocationSize);
+    if (memory == NULL) {
+        return VK_ERROR_OUT_OF_HOST_MEMORY;
+    }
+
+    // mappings of real devices are aligned at least to minMemoryMapAlignment, SIMD writers rely on it
+    if (ALLOC_UNGUARDED(posix_memalign)(&memory->data, NULL_MEMORY_ALIGNMENT, (size_t) pAllocateInfo->allocationSize) != 0) {
+        free(memory);
+        return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+    }
+
+    *pMemory = (VkDeviceMemory) (uintptr_t) memory;
+    return VK_SUCCESS;
+}
+
+static void vkFreeMemoryNull(VkDevice device, VkDeviceMemory memory, const VkAllocationCallbacks* pAllocator)
+{
+    NULL_CALL(vkFreeMemory);
+
+    NullObject* object = (NullObject*) (uintptr_t) memory;
+    if (object != NULL) {
+        free(object->data);
+        free(object);
+    }
+}
+
+static VkResult vkMapMemoryNull(VkDevice device, VkDeviceMemory memory, VkDeviceSize offset, VkDeviceSize size, VkMemoryMapFlags flags, void** ppData)
+{
+    NULL_CALL(vkMapMemory);
+    *ppData = (char*) ((NullObject*) (uintptr_t) memory)->data + offset;
+    return VK_SUCCESS;
+}
+
+static void vkUnmapMemoryNull(VkDevice device, VkDeviceMemory memory)
+{
+    NULL_CALL(vkUnmapMemory);
+}
+
+static VkResult vkFlushMappedMemoryRangesNull(VkDevice device, uint32_t memoryRangeCount, const VkMappedMemoryRange* pMemoryRanges)
+{
+    NULL_CALL(vkFlushMappedMemoryRanges);
+    return VK_SUCCESS;
+}
+
+static VkResult vkInvalidateMappedMemoryRangesNull(VkDevice device, uint32_t memoryRangeCount, const VkMappedMemoryRange* pMemoryRanges)
+{
+    NULL_CALL(vkInvalidateMappedMemoryRanges);
+    return VK_SUCCESS;
+}
+
+static VkResult vkCreateBufferNull(VkDevice device, const VkBufferCreateInfo* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkBuffer* pBuffer)
+{
+    NULL_CALL(vkCreateBuffer);
+
+    NullObject* buffer = nullObject(pCreateInfo->size);
+    if (buffer == NULL) {
+        return VK_ERROR_OUT_OF_HOST_MEMORY;
+    }
+
+    *pBuffer = (VkBuffer) (uintptr_t) buffer;
+    return VK_SUCCESS;
+}
+
+static void vkDestroyBufferNull(VkDevice device, VkBuffer buffer, const VkAllocationCallbacks* pAllocator)
+{
+    NULL_CALL(vkDestroyBuffer);
+    free((NullObject*) (uintptr_t) buffer);
+}
+
+// host pointer of the bound memory, never dereferenced since no shader runs
+static VkDeviceAddress vkGetBufferDeviceAddressNull(VkDevice device, const VkBufferDeviceAddressInfo* pInfo)
+{
+    NULL_CALL(vkGetBufferDeviceAddress);
+    return (VkDeviceAddress) (uintptr_t) ((NullObject*) (uintptr_t) pInfo->buffer)->data;
+}
+
+static void vkGetBufferMemoryRequirementsNull(VkDevice device, VkBuffer buffer, VkMemoryRequirements* pMemoryRequirements)
+{
+    NULL_CALL(vkGetBufferMemoryRequirements);
+    pMemoryRequirements->size = ((NullObject*) (uintptr_t) buffer)->size;
+    pMemoryRequirements->alignment = NULL_MEMORY_ALIGNMENT;
+    pMemoryRequirements->memoryTypeBits = 1;
+}
+
+static VkResult vkBindBufferMemoryNull(VkDevice device, VkBuffer buffer, VkDeviceMemory memory, VkDeviceSize memoryOffset)
+{
+    NULL_CALL(vkBindBufferMemory);
+
+    // buffers share the storage of their memory, device addresses point into it
+    ((NullObject*) (uintptr_t) buffer)->data = (char*) ((NullObject*) (uintptr_t) memory)->data + memoryOffset;
+    return VK_SUCCESS;
+}
+
+static VkResult vkCreateImageNull(VkDevice device, const VkImageCreateInfo* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkImage* pImage)
+{
+    NULL_CALL(vkCreateImage);
+
+    // full mip chains add a third at most
+    VkDeviceSize size = (VkDeviceSize) pCreateInfo->extent.width * pCreateInfo->extent.height * pCreateInfo->extent.depth *
+        pCreateInfo->arrayLayers * NULL_TEXEL_SIZE;
+    size += pCreateInfo->mipLevels > 1 ? size / 3 : 0;
+
+    NullObject* image = nullObject(size);
+    if (image == NULL) {
+        return VK_ERROR_OUT_OF_HOST_MEMORY;
+    }
+
+    *pImage = (VkImage) (uintptr_t) image;
+    return VK_SUCCESS;
+}
+
+static void vkDestroyImageNull(VkDevice device, VkImage image, const VkAllocationCallbacks* pAllocator)
+{
+    NULL_CALL(vkDestroyImage);
+    free((NullObject*) (uintptr_t) image);
+}
+
+static void vkGetImageMemoryRequirementsNull(VkDevice device, VkImage image, VkMemoryRequirements* pMemoryRequirements)
+{
+    NULL_CALL(vkGetImageMemoryRequirements);
+    pMemoryRequirements->size = ((NullObject*) (uintptr_t) image)->size;
+    pMemoryRequirements->alignment = NULL_MEMORY_ALIGNMENT;
+    pMemoryRequirements->memoryTypeBits = 1;
+}
+
+static VkResult vkBindImageMemoryNull(VkDevice device, VkImage image, VkDeviceMemory memory, VkDeviceSize memoryOffset)
+{
+    NULL_CALL(vkBindImageMemory);
+    return VK_SUCCESS;
+}
+
+// objects without state, created and destroyed with a handle
+
+#define NULL_CREATE(NAME, INFO, HANDLE) \
+    static VkResult NAME##Null(VkDevice device, const INFO* pCreateInfo, const VkAllocationCallbacks* pAllocator, HANDLE* pHandle) \
+    { \
+        NULL_CALL(NAME); \
+        *pHandle = (HANDLE) nullHandle(); \
+        return VK_SUCCESS; \
+    }
+
+#define NULL_DESTROY(NAME, HANDLE) \
+    static void NAME##Null(VkDevice device, HANDLE handle, const VkAllocationCallbacks* pAllocator) \
+    { \
+        NULL_CALL(NAME); \
+    }
+
+NULL_CREATE(vkCreateImageView, VkImageViewCreateInfo, VkImageView)
+NULL_DESTROY(vkDestroyImageView, VkImageView)
+NULL_CREATE(vkCreateSampler, VkSamplerCreateInfo, VkSampler)
+NULL_DESTROY(vkDestroySampler, VkSampler)
+NULL_CREATE(vkCreateFence, VkFenceCreateInfo, VkFence)
+NULL_DESTROY(vkDestroyFence, VkFence)
+NULL_CREATE(vkCreateSemaphore, VkSemaphoreCreateInfo, VkSemaphore)
+NULL_DESTROY(vkDestroySemaphore, VkSemaphore)
+NULL_CREATE(vkCreateCommandPool, VkCommandPoolCreateInfo, VkCommandPool)
+NULL_DESTROY(vkDestroyCommandPool, VkCommandPool)
+NULL_CREATE(vkCreateDescriptorPool, VkDescriptorPoolCreateInfo, VkDescriptorPool)
+NULL_DESTROY(vkDestroyDescriptorPool, VkDescriptorPool)
+NULL_CREATE(vkCreateDescriptorSetLayout, VkDescriptorSetLayoutCreateInfo, VkDescriptorSetLayout)
+NULL_DESTROY(vkDestroyDescriptorSetLayout, VkDescriptorSetLayout)
+NULL_CREATE(vkCreatePipelineLayout, VkPipelineLayoutCreateInfo, VkPipelineLayout)
+NULL_DESTROY(vkDestroyPipelineLayout, VkPipelineLayout)
+NULL_CREATE(vkCreatePipelineCache, VkPipelineCacheCreateInfo, VkPipelineCache)
+NULL_DESTROY(vkDestroyPipelineCache, VkPipelineCache)
+NULL_CREATE(vkCreateShaderModule, VkShaderModuleCreateInfo, VkShaderModule)
+NULL_DESTROY(vkDestroyShaderModule, VkShaderModule)
+NULL_CREATE(vkCreateRenderPass, VkRenderPassCreateInfo, VkRenderPass)
+NULL_DESTROY(vkDestroyRenderPass, VkRenderPass)
+NULL_CREATE(vkCreateFramebuffer, VkFramebufferCreateInfo, VkFramebuffer)
+NULL_DESTROY(vkDestroyFramebuffer, VkFramebuffer)
+NULL_CREATE(vkCreateSwapchainKHR, VkSwapchainCreateInfoKHR, VkSwapchainKHR)
+NULL_DESTROY(vkDestroySwapchainKHR, VkSwapchainKHR)
+NULL_DESTROY(vkDestroyPipeline, VkPipeline)
+
+#undef NULL_CREATE
+#undef NULL_DESTROY
+
+static VkResult vkCreateGraphicsPipelinesNull(VkDevice device, VkPipelineCache pipelineCache, uint32_t createInfoCount, const VkGraphicsPipelineCreateInfo* pCreateInfos, const VkAllocationCallbacks* pAllocator, VkPipeline* pPipelines)
+{
+    NULL_CALL(vkCreateGraphicsPipelines);
+    for (uint32_t i = 0; i < createInfoCount; i++)
+    {
+        pPipelines[i] = (VkPipeline) nullHandle();
+    }
+    return VK_SUCCESS;
+}
+
+static VkResult vkCreateComputePipelinesNull(VkDevice device, VkPipelineCache pipelineCache, uint32_t createInfoCount, const VkComputePipelineCreateInfo* pCreateInfos, const VkAllocationCallbacks* pAllocator, VkPipeline* pPipelines)
+{
+    NULL_CALL(vkCreateComputePipelines);
+    for (uint32_t i = 0; i < createInfoCount; i++)
+    {
+        pPipelines[i] = (VkPipeline) nullHandle();
+    }
+    return VK_SUCCESS;
+}
+
+static VkResult vkGetPipelineCacheDataNull(VkDevice device, VkPipelineCache pipelineCache, size_t* pDataSize, void* pData)
+{
+    NULL_CALL(vkGetPipelineCacheData);
+    *pDataSize = 0;
+    return VK_SUCCESS;
+}
+
+static VkResult vkAllocateDescriptorSetsNull(VkDevice device, const VkDescriptorSetAllocateInfo* pAllocateInfo, VkDescriptorSet* pDescriptorSets)
+{
+    NULL_CALL(vkAllocateDescriptorSets);
+    for (uint32_t i = 0; i < pAllocateInfo->descriptorSetCount; i++)
+    {
+        pDescriptorSets[i] = (VkDescriptorSet) nullHandle();
+    }
+    return VK_SUCCESS;
+}
+
+static void vkUpdateDescriptorSetsNull(VkDevice device, uint32_t descriptorWriteCount, const VkWriteDescriptorSet* pDescriptorWrites, uint32_t descriptorCopyCount, const VkCopyDescriptorSet* pDescriptorCopies)
+{
+    NULL_CALL(vkUpdateDescriptorSets);
+}
+
+static VkResult vkAllocateCommandBuffersNull(VkDevice device, const VkCommandBufferAllocateInfo* pAllocateInfo, VkCommandBuffer* pCommandBuffers)
+{
+    NULL_CALL(vkAllocateCommandBuffers);
+    for (uint32_t i = 0; i < pAllocateInfo->commandBufferCount; i++)
+    {
+        pCommandBuffers[i] = (VkCommandBuffer) nullHandle();
+    }
+    return VK_SUCCESS;
+}
+
+static void vkFreeCommandBuffersNull(VkDevice device, VkCommandPool commandPool, uint32_t commandBufferCount, const VkCommandBuffer* pCommandBuffers)
+{
+    NULL_CALL(vkFreeCommandBuffers);
+}
+
+// swapchains have no images, windows are rejected before the backend is selected
+
+static VkResult vkGetSwapchainImagesKHRNull(VkDevice device, VkSwapchainKHR swapchain, uint32_t* pSwapchainImageCount, VkImage* pSwapchainImages)
+{
+    NULL_CALL(vkGetSwapchainImagesKHR);
+    *pSwapchainImageCount = 0;
+    return VK_SUCCESS;
+}
+
+static VkResult vkAcquireNextImageKHRNull(VkDevice device, VkSwapchainKHR swapchain, uint64_t timeout, VkSemaphore semaphore, VkFence fence, uint32_t* pImageIndex)
+{
+    NULL_CALL(vkAcquireNextImageKHR);
+    return VK_ERROR_SURFACE_LOST_KHR;
+}
+
+static VkResult vkQueuePresentKHRNull(VkQueue queue, const VkPresentInfoKHR* pPresentInfo)
+{
+    NULL_CALL(vkQueuePresentKHR);
+    return VK_ERROR_SURFACE_LOST_KHR;
+}
+
+// synchronization completes immediately, nothing was executed
+
+static VkResult vkQueueSubmitNull(VkQueue queue, uint32_t submitCount, const VkSubmitInfo* pSubmits, VkFence fence)
+{
+    NULL_CALL(vkQueueSubmit);
+    return VK_SUCCESS;
+}
+
+static VkResult vkWaitForFencesNull(VkDevice device, uint32_t fenceCount, const VkFence* pFences, VkBool32 waitAll, uint64_t timeout)
+{
+    NULL_CALL(vkWaitForFences);
+    return VK_SUCCESS;
+}
+
+static VkResult vkResetFencesNull(VkDevice device, uint32_t fenceCount, const VkFence* pFences)
+{
+    NULL_CALL(vkResetFences);
+    return VK_SUCCESS;
+}
+
+static VkResult vkGetFenceStatusNull(VkDevice device, VkFence fence)
+{
+    NULL_CALL(vkGetFenceStatus);
+    return VK_SUCCESS;
+}
+
+static VkResult vkWaitSemaphoresNull(VkDevice device, const VkSemaphoreWaitInfo* pWaitInfo, uint64_t timeout)
+{
+    NULL_CALL(vkWaitSemaphores);
+    return VK_SUCCESS;
+}
+
+// command buffers
+
+static VkResult vkBeginCommandBufferNull(VkCommandBuffer commandBuffer, const VkCommandBufferBeginInfo* pBeginInfo)
+{
+    NULL_CALL(vkBeginCommandBuffer);
+    return VK_SUCCESS;
+}
+
+static VkResult vkEndCommandBufferNull(VkCommandBuffer commandBuffer)
+{
+    NULL_CALL(vkEndCommandBuffer);
+    return VK_SUCCESS;
+}
+
+static VkResult vkResetCommandBufferNull(VkCommandBuffer commandBuffer, VkCommandBufferResetFlags flags)
+{
+    NULL_CALL(vkResetCommandBuffer);
+    return VK_SUCCESS;
+}
+
+static void vkCmdBeginRenderPassNull(VkCommandBuffer commandBuffer, const VkRenderPassBeginInfo* pRenderPassBegin, VkSubpassContents contents)
+{
+    NULL_CALL(vkCmdBeginRenderPass);
+}
+
+static void vkCmdEndRenderPassNull(VkCommandBuffer commandBuffer)
+{
+    NULL_CALL(vkCmdEndRenderPass);
+}
+
+static void vkCmdBeginRenderingNull(VkCommandBuffer commandBuffer, const VkRenderingInfo* pRenderingInfo)
+{
+    NULL_CALL(vkCmdBeginRendering);
+}
+
+static void vkCmdEndRenderingNull(VkCommandBuffer commandBuffer)
+{
+    NULL_CALL(vkCmdEndRendering);
+}
+
+static void vkCmdBindDescriptorSetsNull(VkCommandBuffer commandBuffer, VkPipelineBindPoint pipelineBindPoint, VkPipelineLayout layout, uint32_t firstSet, uint32_t descriptorSetCount, const VkDescriptorSet* pDescriptorSets, uint32_t dynamicOffsetCount, const uint32_t* pDynamicOffsets)
+{
+    NULL_CALL(vkCmdBindDescriptorSets);
+}
+
+static void vkCmdBindIndexBufferNull(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset, VkIndexType indexType)
+{
+    NULL_CALL(vkCmdBindIndexBuffer);
+}
+
+static void vkCmdBindPipelineNull(VkCommandBuffer commandBuffer, VkPipelineBindPoint pipelineBindPoint, VkPipeline pipeline)
+{
+    NULL_CALL(vkCmdBindPipeline);
+}
+
+static void vkCmdBindVertexBuffersNull(VkCommandBuffer commandBuffer, uint32_t firstBinding, uint32_t bindingCount, const VkBuffer* pBuffers, const VkDeviceSize* pOffsets)
+{
+    NULL_CALL(vkCmdBindVertexBuffers);
+}
+
+static void vkCmdBlitImageNull(VkCommandBuffer commandBuffer, VkImage srcImage, VkImageLayout srcImageLayout, VkImage dstImage, VkImageLayout dstImageLayout, uint32_t regionCount, const VkImageBlit* pRegions, VkFilter filter)
+{
+    NULL_CALL(vkCmdBlitImage);
+}
+
+static void vkCmdClearColorImageNull(VkCommandBuffer commandBuffer, VkImage image, VkImageLayout imageLayout, const VkClearColorValue* pColor, uint32_t rangeCount, const VkImageSubresourceRange* pRanges)
+{
+    NULL_CALL(vkCmdClearColorImage);
+}
+
+static void vkCmdCopyBufferNull(VkCommandBuffer commandBuffer, VkBuffer srcBuffer, VkBuffer dstBuffer, uint32_t regionCount, const VkBufferCopy* pRegions)
+{
+    NULL_CALL(vkCmdCopyBuffer);
+}
+
+static void vkCmdCopyBufferToImageNull(VkCommandBuffer commandBuffer, VkBuffer srcBuffer, VkImage dstImage, VkImageLayout dstImageLayout, uint32_t regionCount, const VkBufferImageCopy* pRegions)
+{
+    NULL_CALL(vkCmdCopyBufferToImage);
+}
+
+static void vkCmdCopyImageNull(VkCommandBuffer commandBuffer, VkImage srcImage, VkImageLayout srcImageLayout, VkImage dstImage, VkImageLayout dstImageLayout, uint32_t regionCount, const VkImageCopy* pRegions)
+{
+    NULL_CALL(vkCmdCopyImage);
+}
+
+static void vkCmdCopyImageToBufferNull(VkCommandBuffer commandBuffer, VkImage srcImage, VkImageLayout srcImageLayout, VkBuffer dstBuffer, uint32_t regionCount, const VkBufferImageCopy* pRegions)
+{
+    NULL_CALL(vkCmdCopyImageToBuffer);
+}
+
+static void vkCmdDispatchNull(VkCommandBuffer commandBuffer, uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ)
+{
+    NULL_CALL(vkCmdDispatch);
+}
+
+static void vkCmdDrawIndexedNull(VkCommandBuffer commandBuffer, uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t vertexOffset, uint32_t firstInstance)
+{
+    NULL_CALL(vkCmdDrawIndexed);
+}
+
+static void vkCmdPipelineBarrierNull(VkCommandBuffer commandBuffer, VkPipelineStageFlags srcStageMask, VkPipelineStageFlags dstStageMask, VkDependencyFlags dependencyFlags, uint32_t memoryBarrierCount, const VkMemoryBarrier* pMemoryBarriers, uint32_t bufferMemoryBarrierCount, const VkBufferMemoryBarrier* pBufferMemoryBarriers, uint32_t imageMemoryBarrierCount, const VkImageMemoryBarrier* pImageMemoryBarriers)
+{
+    NULL_CALL(vkCmdPipelineBarrier);
+}
+
+static void vkCmdPipelineBarrier2Null(VkCommandBuffer commandBuffer, const VkDependencyInfo* pDependencyInfo)
+{
+    NULL_CALL(vkCmdPipelineBarrier2);
+}
+
+static void vkCmdPushConstantsNull(VkCommandBuffer commandBuffer, VkPipelineLayout layout, VkShaderStageFlags stageFlags, uint32_t offset, uint32_t size, const void* pValues)
+{
+    NULL_CALL(vkCmdPushConstants);
+}
+
+static void vkCmdSetCullModeNull(VkCommandBuffer commandBuffer, VkCullModeFlags cullMode)
+{
+    NULL_CALL(vkCmdSetCullMode);
+}
+
+static void vkCmdSetDepthCompareOpNull(VkCommandBuffer commandBuffer, VkCompareOp depthCompareOp)
+{
+    NULL_CALL(vkCmdSetDepthCompareOp);
+}
+
+static void vkCmdSetDepthTestEnableNull(VkCommandBuffer commandBuffer, VkBool32 depthTestEnable)
+{
+    NULL_CALL(vkCmdSetDepthTestEnable);
+}
+
+static void vkCmdSetDepthWriteEnableNull(VkCommandBuffer commandBuffer, VkBool32 depthWriteEnable)
+{
+    NULL_CALL(vkCmdSetDepthWriteEnable);
+}
+
+static void vkCmdSetFrontFaceNull(VkCommandBuffer commandBuffer, VkFrontFace frontFace)
+{
+    NULL_CALL(vkCmdSetFrontFace);
+}
+
+static void vkCmdSetPrimitiveTopologyNull(VkCommandBuffer commandBuffer, VkPrimitiveTopology primitiveTopology)
+{
+    NULL_CALL(vkCmdSetPrimitiveTopology);
+}
+
+static void vkCmdSetScissorNull(VkCommandBuffer commandBuffer, uint32_t firstScissor, uint32_t scissorCount, const VkRect2D* pScissors)
+{
+    NULL_CALL(vkCmdSetScissor);
+}
+
+static void vkCmdSetViewportNull(VkCommandBuffer commandBuffer, uint32_t firstViewport, uint32_t viewportCount, const VkViewport* pViewports)
+{
+    NULL_CALL(vkCmdSetViewport);
+}
+
+void dispatchUseNull(void)
+{
+    // a function missing here fails to compile, every entry point has its null version
+#define DISPATCH_SET_NULL(NAME) NAME = NAME##Null;
+    DISPATCH_FUNCTIONS(DISPATCH_SET_NULL)
+#undef DISPATCH_SET_NULL
+
+    vkGetInstanceProcAddr = vkGetInstanceProcAddrNull;
+}
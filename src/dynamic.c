@@ -0,0 +1,286 @@
+#include "dynamic.h"
+
+#include "debug.h"
+#include "init.h"
+#include "utils.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <vulkan/vulkan_core.h>
+
+// device local and host visible type in a heap large enough for the whole buffer, coherent types first
+static VkBool32 findDirectMemoryType(State* state, const VkMemoryRequirements* memReq, uint32_t* memoryTypeIndex, VkBool32* coherent)
+{
+    VkPhysicalDeviceMemoryProperties memProperties;
+    vkGetPhysicalDeviceMemoryProperties(state->physicalDevice, &memProperties);
+
+    VkMemoryPropertyFlags direct = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+    VkMemoryPropertyFlags preferred[] = {direct | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, direct};
+
+    for (uint32_t p = 0; p < sizeof(preferred) / sizeof(preferred[0]); p++)
+    {
+        for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++)
+        {
+            VkMemoryType type = memProperties.memoryTypes[i];
+
+            if (!(memReq->memoryTypeBits & (1u << i)) || (type.propertyFlags & preferred[p]) != preferred[p]) {
+                continue;
+            }
+
+            if (memReq->size > memProperties.memoryHeaps[type.heapIndex].size / DYNAMIC_BUFFER_HEAP_FRACTION) {
+                continue;
+            }
+
+            *memoryTypeIndex = i;
+            *coherent = (type.propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+            return VK_TRUE;
+        }
+    }
+
+    return VK_FALSE;
+}
+
+// first stage and access reading the uploaded data for every usage of the buffer
+static void uploadDestination(VkBufferUsageFlags usage, VkPipelineStageFlags2* stage, VkAccessFlags2* access)
+{
+    *stage = VK_PIPELINE_STAGE_2_NONE;
+    *access = VK_ACCESS_2_NONE;
+
+    if (usage & VK_BUFFER_USAGE_VERTEX_BUFFER_BIT) {
+        *stage |= VK_PIPELINE_STAGE_2_VERTEX_ATTRIBUTE_INPUT_BIT;
+        *access |= VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT;
+    }
+
+    if (usage & VK_BUFFER_USAGE_INDEX_BUFFER_BIT) {
+        *stage |= VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT;
+        *access |= VK_ACCESS_2_INDEX_READ_BIT;
+    }
+
+    if (usage & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT) {
+        *stage |= VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT;
+        *access |= VK_ACCESS_2_UNIFORM_READ_BIT;
+    }
+
+    if (usage & VK_BUFFER_USAGE_STORAGE_BUFFER_BIT) {
+        *stage |= VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+        *access |= VK_ACCESS_2_SHADER_STORAGE_READ_BIT;
+    }
+
+    if (*stage == VK_PIPELINE_STAGE_2_NONE) {
+        *stage = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+        *access = VK_ACCESS_2_MEMORY_READ_BIT;
+    }
+}
+
+void createDynamicBuffer(State* state, DynamicBuffer* dynamic, VkDeviceSize frameSize, VkBufferUsageFlags usage, const char* name)
+{
+    VkPhysicalDeviceProperties props;
+    vkGetPhysicalDeviceProperties(state->physicalDevice, &props);
+
+    // nonCoherentAtomSize is a power of two, flushed ranges never cross into the next region
+    dynamic->atomSize = props.limits.nonCoherentAtomSize > 0 ? props.limits.nonCoherentAtomSize : 1;
+    dynamic->frameSize = (frameSize + dynamic->atomSize - 1) & ~(dynamic->atomSize - 1);
+    dynamic->frame = 0;
+    dynamic->frameOffset = 0;
+    memset(dynamic->rangeCount, 0, sizeof(dynamic->rangeCount));
+    dynamic->stagingBuffer = VK_NULL_HANDLE;
+    dynamic->stagingMemory = VK_NULL_HANDLE;
+    uploadDestination(usage, &dynamic->dstStage, &dynamic->dstAccess);
+
+    VkBufferCreateInfo crtInf = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+
+        .size = dynamic->frameSize * MAX_FRAMES_IN_FLIGHT,
+        .usage = usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+    };
+
+    assertVk(vkCreateBuffer(state->device, &crtInf, state->allocator, &dynamic->buffer), "failed to create dynamic buffer", "created dynamic buffer");
+
+    VkMemoryRequirements memReq;
+    vkGetBufferMemoryRequirements(state->device, dynamic->buffer, &memReq);
+
+    uint32_t memoryTypeIndex;
+    dynamic->direct = !state->forceStaging && findDirectMemoryType(state, &memReq, &memoryTypeIndex, &dynamic->coherent);
+
+    if (!dynamic->direct) {
+        memoryTypeIndex = findMemoryType(state, memReq.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        dynamic->coherent = VK_TRUE;
+    }
+
+    VkMemoryAllocateInfo allocInf = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+        .pNext = NULL,
+        .allocationSize = memReq.size,
+        .memoryTypeIndex = memoryTypeIndex,
+    };
+
+    assertVk(vkAllocateMemory(state->device, &allocInf, state->allocator, &dynamic->memory), "failed to allocate dynamic buffer memory", "allocated dynamic buffer memory");
+    vkBindBufferMemory(state->device, dynamic->buffer, dynamic->memory, 0);
+
+    void* mapped;
+
+    if (dynamic->direct) {
+        assertVk(vkMapMemory(state->device, dynamic->memory, 0, VK_WHOLE_SIZE, 0, &mapped), "failed to map dynamic buffer", "mapped dynamic buffer");
+    }
+    else
+    {
+        // same partitioning as the device buffer, region of a frame is copied into the region of the same frame
+        createBuffer(state, dynamic->frameSize * MAX_FRAMES_IN_FLIGHT,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        &dynamic->stagingBuffer, &dynamic->stagingMemory);
+
+        assertVk(vkMapMemory(state->device, dynamic->stagingMemory, 0, VK_WHOLE_SIZE, 0, &mapped), "failed to map dynamic staging buffer", "mapped dynamic staging buffer");
+    }
+
+    dynamic->mapped = mapped;
+
+    LOG("%s: %llu bytes per frame, %s", name, (unsigned long long) dynamic->frameSize,
+        dynamic->direct ? (dynamic->coherent ? "written to device local memory" : "written to device local memory, flushed")
+                        : "copied from staging ring");
+}
+
+uint8_t* dynamicBufferBeginFrame(DynamicBuffer* dynamic, uint32_t frame)
+{
+    dynamic->frame = frame;
+    dynamic->frameOffset = (VkDeviceSize) frame * dynamic->frameSize;
+
+    return dynamic->mapped + dynamic->frameOffset;
+}
+
+void dynamicBufferWritten(DynamicBuffer* dynamic, VkDeviceSize offset, VkDeviceSize size)
+{
+    if (size == 0) {
+        return;
+    }
+
+    VkDeviceSize* rangeOffset = dynamic->rangeOffset[dynamic->frame];
+    VkDeviceSize* rangeSize = dynamic->rangeSize[dynamic->frame];
+    uint32_t* rangeCount = &dynamic->rangeCount[dynamic->frame];
+
+    // rewriting a pending range is common, every frame writes the same bytes
+    for (uint32_t i = 0; i < *rangeCount; i++)
+    {
+        if (offset >= rangeOffset[i] && offset + size <= rangeOffset[i] + rangeSize[i]) {
+            return;
+        }
+    }
+
+    if (*rangeCount == DYNAMIC_BUFFER_MAX_RANGES) {
+        // uploads the gap between both ranges as well, still within the region
+        uint32_t last = *rangeCount - 1;
+        VkDeviceSize begin = offset < rangeOffset[last] ? offset : rangeOffset[last];
+        VkDeviceSize end = offset + size > rangeOffset[last] + rangeSize[last] ? offset + size : rangeOffset[last] + rangeSize[last];
+
+        rangeOffset[last] = begin;
+        rangeSize[last] = end - begin;
+        return;
+    }
+
+    rangeOffset[*rangeCount] = offset;
+    rangeSize[*rangeCount] = size;
+    (*rangeCount)++;
+}
+
+void dynamicBufferRecordUpload(State* state, DynamicBuffer* dynamic, VkCommandBuffer commandBuffer)
+{
+    VkDeviceSize* rangeOffset = dynamic->rangeOffset[dynamic->frame];
+    VkDeviceSize* rangeSize = dynamic->rangeSize[dynamic->frame];
+    uint32_t rangeCount = dynamic->rangeCount[dynamic->frame];
+
+    if (rangeCount == 0) {
+        return;
+    }
+
+    dynamic->rangeCount[dynamic->frame] = 0;
+
+    if (dynamic->direct) {
+        // host writes to coherent memory are visible to the GPU at submit
+        if (!dynamic->coherent) {
+            VkMappedMemoryRange ranges[DYNAMIC_BUFFER_MAX_RANGES];
+
+            for (uint32_t i = 0; i < rangeCount; i++)
+            {
+                VkDeviceSize begin = (dynamic->frameOffset + rangeOffset[i]) & ~(dynamic->atomSize - 1);
+                VkDeviceSize end = (dynamic->frameOffset + rangeOffset[i] + rangeSize[i] + dynamic->atomSize - 1) & ~(dynamic->atomSize - 1);
+
+                ranges[i] = (VkMappedMemoryRange) {
+                    .sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
+                    .pNext = NULL,
+                    .memory = dynamic->memory,
+                    .offset = begin,
+                    .size = end - begin,
+                };
+            }
+
+            assertVk(vkFlushMappedMemoryRanges(state->device, rangeCount, ranges), "failed to flush dynamic buffer", "");
+        }
+
+        return;
+    }
+
+    VkBufferCopy regions[DYNAMIC_BUFFER_MAX_RANGES];
+
+    for (uint32_t i = 0; i < rangeCount; i++)
+    {
+        regions[i] = (VkBufferCopy) {
+            .srcOffset = dynamic->frameOffset + rangeOffset[i],
+            .dstOffset = dynamic->frameOffset + rangeOffset[i],
+            .size = rangeSize[i],
+        };
+    }
+
+    vkCmdCopyBuffer(commandBuffer, dynamic->stagingBuffer, dynamic->buffer, rangeCount, regions);
+
+    // the previous reader of this region finished before the frame fence signaled, only the copy needs ordering
+    VkBufferMemoryBarrier2 barrier = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
+        .pNext = NULL,
+
+        .srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT,
+        .srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+        .dstStageMask = dynamic->dstStage,
+        .dstAccessMask = dynamic->dstAccess,
+
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+
+        .buffer = dynamic->buffer,
+        .offset = dynamic->frameOffset,
+        .size = dynamic->frameSize,
+    };
+
+    VkDependencyInfo dependencyInf = {
+        .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+        .pNext = NULL,
+        .dependencyFlags = 0,
+
+        .memoryBarrierCount = 0,
+        .pMemoryBarriers = NULL,
+        .bufferMemoryBarrierCount = 1,
+        .pBufferMemoryBarriers = &barrier,
+        .imageMemoryBarrierCount = 0,
+        .pImageMemoryBarriers = NULL,
+    };
+
+    vkCmdPipelineBarrier2(commandBuffer, &dependencyInf);
+}
+
+void destroyDynamicBuffer(State* state, DynamicBuffer* dynamic)
+{
+    if (dynamic->direct) {
+        vkUnmapMemory(state->device, dynamic->memory);
+    }
+    else
+    {
+        vkUnmapMemory(state->device, dynamic->stagingMemory);
+        vkDestroyBuffer(state->device, dynamic->stagingBuffer, state->allocator);
+        vkFreeMemory(state->device, dynamic->stagingMemory, state->allocator);
+    }
+
+    vkDestroyBuffer(state->device, dynamic->buffer, state->allocator);
+    vkFreeMemory(state->device, dynamic->memory, state->allocator);
+}
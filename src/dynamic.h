@@ -0,0 +1,85 @@
+#ifndef __DYNAMIC_H__
+#define __DYNAMIC_H__
+
+#include "common.h"
+
+#include <stdint.h>
+#include <vulkan/vulkan_core.h>
+
+// written ranges tracked per frame, more writes are merged into the last range
+#define DYNAMIC_BUFFER_MAX_RANGES 4
+// direct writes only use a device local and host visible heap when the buffer takes at most this fraction of it,
+// small legacy BAR windows are left to the driver
+#define DYNAMIC_BUFFER_HEAP_FRACTION 4
+
+// buffer rewritten by the CPU every frame and split into one region per frame in flight,
+// written straight into device local memory when it is host visible (Resizable BAR, integrated GPUs),
+// otherwise into a host staging ring which is copied into the device local regions when recording
+typedef struct DynamicBuffer
+{
+    // device local, bound by draws in both modes
+    VkBuffer buffer;
+    VkDeviceMemory memory;
+    // VK_NULL_HANDLE when written directly
+    VkBuffer stagingBuffer;
+    VkDeviceMemory stagingMemory;
+    // regions of all frames, device memory when direct, staging memory otherwise
+    uint8_t* mapped;
+
+    VkBool32 direct;
+    // direct writes to non coherent memory are flushed in nonCoherentAtomSize units
+    VkBool32 coherent;
+    VkDeviceSize atomSize;
+
+    VkDeviceSize frameSize;
+    // region of frame passed to last dynamicBufferBeginFrame
+    uint32_t frame;
+    VkDeviceSize frameOffset;
+
+    // ranges relative to the region written since it was last uploaded or flushed,
+    // kept per region so frames which were updated but not recorded upload them later
+    VkDeviceSize rangeOffset[MAX_FRAMES_IN_FLIGHT][DYNAMIC_BUFFER_MAX_RANGES];
+    VkDeviceSize rangeSize[MAX_FRAMES_IN_FLIGHT][DYNAMIC_BUFFER_MAX_RANGES];
+    uint32_t rangeCount[MAX_FRAMES_IN_FLIGHT];
+
+    // stage and access reading the buffer, destination of the upload barrier
+    VkPipelineStageFlags2 dstStage;
+    VkAccessFlags2 dstAccess;
+} DynamicBuffer;
+
+/**
+ * @brief creates buffer with one region of frameSize bytes per frame in flight and maps it persistently
+ * @details prefers device local and host visible memory, falls back to a host staging ring copied by dynamicBufferRecordUpload
+ * Requires:
+    - Valid logical device in state
+ * @param frameSize bytes per frame in flight, rounded up to nonCoherentAtomSize
+ * @param usage how draws read the buffer, selects the destination of the upload barrier
+ * @param name logged with the selected mode
+ */
+void createDynamicBuffer(State* state, DynamicBuffer* dynamic, VkDeviceSize frameSize, VkBufferUsageFlags usage, const char* name);
+
+/**
+ * @brief selects region of given frame in flight and forgets ranges written before
+ * Requires:
+    - fence of the frame signaled, GPU no longer reads the region
+ * @return mapped region to write, write only, it can be uncached device memory
+ */
+uint8_t* dynamicBufferBeginFrame(DynamicBuffer* dynamic, uint32_t frame);
+
+/**
+ * @brief marks bytes of current region as written, only marked bytes reach the GPU
+ * @param offset relative to the region returned by dynamicBufferBeginFrame
+ */
+void dynamicBufferWritten(DynamicBuffer* dynamic, VkDeviceSize offset, VkDeviceSize size);
+
+/**
+ * @brief makes written ranges of current region visible to draws recorded after it
+ * @details flushes non coherent memory when written directly, otherwise records copy from staging ring and barrier
+ * Requires:
+    - commandBuffer recording outside of a render pass
+ */
+void dynamicBufferRecordUpload(State* state, DynamicBuffer* dynamic, VkCommandBuffer commandBuffer);
+
+void destroyDynamicBuffer(State* state, DynamicBuffer* dynamic);
+
+#endif // __DYNAMIC_H__
@@ -0,0 +1,325 @@
+#include "encoder.h"
+
+#include "debug.h"
+#include "init.h"
+#include "pipeline.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vulkan/vulkan_core.h>
+
+#define DRAW_KEY_DIGITS 8
+
+void createDrawQueue(State* state, uint32_t capacity)
+{
+    DrawQueue* queue = &state->drawQueue;
+
+    capacity = capacity > 0 ? capacity : 1;
+
+    // keys first, so the 8 byte arrays stay aligned
+    queue->block = malloc((size_t) capacity * 2 * (sizeof(uint64_t) + sizeof(uint32_t)));
+    assert_my(queue->block != NULL, "failed to allocate draw queue", "allocated draw queue");
+
+    queue->keys = queue->block;
+    queue->scratchKeys = queue->keys + capacity;
+    queue->items = (uint32_t*) (queue->scratchKeys + capacity);
+    queue->scratchItems = queue->items + capacity;
+
+    queue->count = 0;
+    queue->capacity = capacity;
+}
+
+uint64_t drawSortKey(DrawPass pass, uint32_t pipeline, uint32_t textureIndex, uint32_t materialIndex, float depth)
+{
+    // sign flip maps floats onto unsigned order, negative ones are mirrored below the positive ones
+    uint32_t depthBits;
+    memcpy(&depthBits, &depth, sizeof(depthBits));
+    depthBits = (depthBits & 0x80000000u) ? ~depthBits : depthBits | 0x80000000u;
+
+    if (pass == DRAW_PASS_TRANSPARENT) {
+        depthBits = ~depthBits;
+    }
+
+    // low bits of both indices, equal materials still end up next to each other
+    uint32_t material = (textureIndex & 0xFFu) << 8 | (materialIndex & 0xFFu);
+
+    return (uint64_t) pass << DRAW_KEY_PASS_SHIFT |
+        (uint64_t) (pipeline & DRAW_KEY_PIPELINE_MASK) << DRAW_KEY_PIPELINE_SHIFT |
+        (uint64_t) (material & DRAW_KEY_MATERIAL_MASK) << DRAW_KEY_MATERIAL_SHIFT |
+        depthBits;
+}
+
+void drawQueueReset(DrawQueue* queue)
+{
+    queue->count = 0;
+}
+
+void drawQueuePush(DrawQueue* queue, uint64_t key, uint32_t item)
+{
+    assert_my(queue->count < queue->capacity, "draw queue full", "");
+
+    queue->keys[queue->count] = key;
+    queue->items[queue->count] = item;
+    queue->count++;
+}
+
+void drawQueueSort(DrawQueue* queue)
+{
+    uint32_t count = queue->count;
+
+    if (count < 2) {
+        return;
+    }
+
+    // histograms of every digit from one pass over the keys
+    uint32_t histograms[DRAW_KEY_DIGITS][256];
+    memset(histograms, 0, sizeof(histograms));
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint64_t key = queue->keys[i];
+        for (uint32_t d = 0; d < DRAW_KEY_DIGITS; d++)
+        {
+            histograms[d][(key >> (d * 8)) & 0xFF]++;
+        }
+    }
+
+    uint64_t* keys = queue->keys;
+    uint32_t* items = queue->items;
+    uint64_t* outKeys = queue->scratchKeys;
+    uint32_t* outItems = queue->scratchItems;
+
+    for (uint32_t d = 0; d < DRAW_KEY_DIGITS; d++)
+    {
+        uint32_t shift = d * 8;
+        uint32_t* histogram = histograms[d];
+
+        // digit shared by every key would only copy, most of the key is usually constant within a frame
+        if (histogram[(keys[0] >> shift) & 0xFF] == count) {
+            continue;
+        }
+
+        uint32_t offset = 0;
+        for (uint32_t b = 0; b < 256; b++)
+        {
+            uint32_t bucket = histogram[b];
+            histogram[b] = offset;
+            offset += bucket;
+        }
+
+        // scattering in input order keeps the sort stable
+        for (uint32_t i = 0; i < count; i++)
+        {
+            uint32_t dst = histogram[(keys[i] >> shift) & 0xFF]++;
+            outKeys[dst] = keys[i];
+            outItems[dst] = items[i];
+        }
+
+        uint64_t* swapKeys = keys;
+        keys = outKeys;
+        outKeys = swapKeys;
+
+        uint32_t* swapItems = items;
+        items = outItems;
+        outItems = swapItems;
+    }
+
+    // result may have ended in scratch, the arrays trade roles instead of copying back
+    queue->keys = keys;
+    queue->items = items;
+    queue->scratchKeys = outKeys;
+    queue->scratchItems = outItems;
+}
+
+void destroyDrawQueue(State* state)
+{
+    free(state->drawQueue.block);
+}
+
+void encoderBegin(CommandEncoder* encoder, VkCommandBuffer commandBuffer, VkPipelineLayout layout)
+{
+    encoder->commandBuffer = commandBuffer;
+    encoder->layout = layout;
+    encoderInvalidate(encoder);
+}
+
+void encoderInvalidate(CommandEncoder* encoder)
+{
+    encoder->known = 0;
+    encoder->knownVertexBuffers = 0;
+    encoder->knownSets = 0;
+}
+
+// counts the command, returns VK_TRUE when it has to be recorded
+static VkBool32 encoderChanged(CommandEncoder* encoder, EncoderCommand command, VkBool32 same)
+{
+    if ((encoder->known >> command & 1) && same) {
+        encoder->elided[command]++;
+        return VK_FALSE;
+    }
+
+    encoder->known |= 1u << command;
+    encoder->issued[command]++;
+    return VK_TRUE;
+}
+
+void encoderBindPipeline(CommandEncoder* encoder, VkPipeline pipeline)
+{
+    if (encoderChanged(encoder, ENCODER_BIND_PIPELINE, encoder->pipeline == pipeline)) {
+        vkCmdBindPipeline(encoder->commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+        encoder->pipeline = pipeline;
+    }
+}
+
+void encoderBindVertexBuffers(CommandEncoder* encoder, uint32_t first, uint32_t count, const VkBuffer* buffers, const VkDeviceSize* offsets)
+{
+    // smallest range of bindings covering every change
+    uint32_t begin = UINT32_MAX;
+    uint32_t end = 0;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint32_t binding = first + i;
+        VkBool32 known = (encoder->knownVertexBuffers >> binding) & 1;
+
+        if (!known || encoder->vertexBuffers[binding] != buffers[i] || encoder->vertexOffsets[binding] != offsets[i]) {
+            begin = begin == UINT32_MAX ? i : begin;
+            end = i + 1;
+        }
+    }
+
+    if (begin == UINT32_MAX) {
+        encoder->elided[ENCODER_BIND_VERTEX_BUFFERS]++;
+        return;
+    }
+
+    encoder->issued[ENCODER_BIND_VERTEX_BUFFERS]++;
+    vkCmdBindVertexBuffers(encoder->commandBuffer, first + begin, end - begin, buffers + begin, offsets + begin);
+
+    for (uint32_t i = begin; i < end; i++)
+    {
+        encoder->vertexBuffers[first + i] = buffers[i];
+        encoder->vertexOffsets[first + i] = offsets[i];
+        encoder->knownVertexBuffers |= 1u << (first + i);
+    }
+}
+
+void encoderBindIndexBuffer(CommandEncoder* encoder, VkBuffer buffer, VkDeviceSize offset, VkIndexType indexType)
+{
+    VkBool32 same = encoder->indexBuffer == buffer && encoder->indexOffset == offset && encoder->indexType == indexType;
+
+    if (encoderChanged(encoder, ENCODER_BIND_INDEX_BUFFER, same)) {
+        vkCmdBindIndexBuffer(encoder->commandBuffer, buffer, offset, indexType);
+        encoder->indexBuffer = buffer;
+        encoder->indexOffset = offset;
+        encoder->indexType = indexType;
+    }
+}
+
+void encoderBindDescriptorSet(CommandEncoder* encoder, uint32_t index, VkDescriptorSet set, const uint32_t* dynamicOffset)
+{
+    uint32_t offset = dynamicOffset != NULL ? *dynamicOffset : UINT32_MAX;
+    VkBool32 known = (encoder->knownSets >> index) & 1;
+
+    if (known && encoder->sets[index] == set && encoder->setOffsets[index] == offset) {
+        encoder->elided[ENCODER_BIND_DESCRIPTOR_SET]++;
+        return;
+    }
+
+    encoder->issued[ENCODER_BIND_DESCRIPTOR_SET]++;
+    vkCmdBindDescriptorSets(encoder->commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, encoder->layout,
+        index, 1, &set, dynamicOffset != NULL ? 1 : 0, dynamicOffset);
+
+    encoder->sets[index] = set;
+    encoder->setOffsets[index] = offset;
+    encoder->knownSets |= 1u << index;
+}
+
+void encoderPushConstants(CommandEncoder* encoder, const DrawPushConstants* pushConstants)
+{
+    // no implicit padding in DrawPushConstants, comparing bytes is exact
+    VkBool32 same = memcmp(&encoder->pushConstants, pushConstants, sizeof(DrawPushConstants)) == 0;
+
+    if (encoderChanged(encoder, ENCODER_PUSH_CONSTANTS, same)) {
+        vkCmdPushConstants(encoder->commandBuffer, encoder->layout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+            0, sizeof(DrawPushConstants), pushConstants);
+        encoder->pushConstants = *pushConstants;
+    }
+}
+
+void encoderSetViewport(CommandEncoder* encoder, const VkViewport* viewport)
+{
+    VkBool32 same = memcmp(&encoder->viewport, viewport, sizeof(VkViewport)) == 0;
+
+    if (encoderChanged(encoder, ENCODER_SET_VIEWPORT, same)) {
+        vkCmdSetViewport(encoder->commandBuffer, 0, 1, viewport);
+        encoder->viewport = *viewport;
+    }
+}
+
+void encoderSetScissor(CommandEncoder* encoder, const VkRect2D* scissor)
+{
+    VkBool32 same = memcmp(&encoder->scissor, scissor, sizeof(VkRect2D)) == 0;
+
+    if (encoderChanged(encoder, ENCODER_SET_SCISSOR, same)) {
+        vkCmdSetScissor(encoder->commandBuffer, 0, 1, scissor);
+        encoder->scissor = *scissor;
+    }
+}
+
+void encoderSetDynamicState(CommandEncoder* encoder, State* state, const PipelineKey* key)
+{
+    if (!state->pipelines.extendedDynamicState) {
+        return;
+    }
+
+    const PipelineKey* bound = &encoder->dynamicState;
+    VkBool32 same = bound->cullMode == key->cullMode && bound->frontFace == key->frontFace && bound->topology == key->topology &&
+        bound->depthTest == key->depthTest && bound->depthWrite == key->depthWrite && bound->depthCompare == key->depthCompare;
+
+    if (encoderChanged(encoder, ENCODER_SET_DYNAMIC_STATE, same)) {
+        pipelineCacheSetDynamicState(state, encoder->commandBuffer, key);
+        encoder->dynamicState = *key;
+    }
+}
+
+void encoderDrawIndexed(CommandEncoder* encoder, uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t vertexOffset, uint32_t firstInstance)
+{
+    encoder->issued[ENCODER_DRAW]++;
+    vkCmdDrawIndexed(encoder->commandBuffer, indexCount, instanceCount, firstIndex, vertexOffset, firstInstance);
+}
+
+static const char* encoderCommandNames[ENCODER_COMMAND_COUNT] = {
+    [ENCODER_BIND_PIPELINE] = "bind pipeline",
+    [ENCODER_BIND_VERTEX_BUFFERS] = "bind vertex buffers",
+    [ENCODER_BIND_INDEX_BUFFER] = "bind index buffer",
+    [ENCODER_BIND_DESCRIPTOR_SET] = "bind descriptor set",
+    [ENCODER_PUSH_CONSTANTS] = "push constants",
+    [ENCODER_SET_VIEWPORT] = "set viewport",
+    [ENCODER_SET_SCISSOR] = "set scissor",
+    [ENCODER_SET_DYNAMIC_STATE] = "set dynamic state",
+    [ENCODER_DRAW] = "draw",
+};
+
+void encoderPrintStats(FILE* out, const CommandEncoder* encoder, uint64_t frames)
+{
+    double perFrame = frames > 0 ? 1.0 / (double) frames : 0.0;
+
+    fprintf(out, "%-24s %12s %12s %12s %12s\n", "encoder command", "issued", "elided", "issued/frame", "elided/frame");
+
+    uint64_t issued = 0;
+    uint64_t elided = 0;
+    for (uint32_t c = 0; c < ENCODER_COMMAND_COUNT; c++)
+    {
+        issued += encoder->issued[c];
+        elided += encoder->elided[c];
+        fprintf(out, "%-24s %12llu %12llu %12.2f %12.2f\n", encoderCommandNames[c],
+            (unsigned long long) encoder->issued[c], (unsigned long long) encoder->elided[c],
+            (double) encoder->issued[c] * perFrame, (double) encoder->elided[c] * perFrame);
+    }
+
+    fprintf(out, "%-24s %12llu %12llu %12.2f %12.2f\n", "total", (unsigned long long) issued, (unsigned long long) elided,
+        (double) issued * perFrame, (double) elided * perFrame);
+}
@@ -0,0 +1,181 @@
+#ifndef __ENCODER_H__
+#define __ENCODER_H__
+
+#include "common.h"
+#include "pipeline.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vulkan/vulkan_core.h>
+
+// pass of a queued draw, most significant field of its sort key
+typedef enum DrawPass
+{
+    // front to back
+    DRAW_PASS_OPAQUE,
+    // back to front
+    DRAW_PASS_TRANSPARENT,
+    DRAW_PASS_OVERLAY,
+} DrawPass;
+
+// 64 bit sort key: pass 4 | pipeline variant 12 | material 16 | depth 32
+#define DRAW_KEY_PASS_SHIFT 60
+#define DRAW_KEY_PIPELINE_SHIFT 48
+#define DRAW_KEY_MATERIAL_SHIFT 32
+#define DRAW_KEY_PIPELINE_MASK 0xFFFu
+#define DRAW_KEY_MATERIAL_MASK 0xFFFFu
+
+// draws of a frame with their sort keys, sorted by drawQueueSort
+typedef struct DrawQueue
+{
+    uint32_t count;
+    uint32_t capacity;
+
+    // one block, keys and items ping pong between the arrays and scratch while sorting
+    void* block;
+    uint64_t* keys;
+    // index into state->draws
+    uint32_t* items;
+    uint64_t* scratchKeys;
+    uint32_t* scratchItems;
+} DrawQueue;
+
+// commands the encoder tracks, every one is either issued or elided
+typedef enum EncoderCommand
+{
+    ENCODER_BIND_PIPELINE,
+    ENCODER_BIND_VERTEX_BUFFERS,
+    ENCODER_BIND_INDEX_BUFFER,
+    ENCODER_BIND_DESCRIPTOR_SET,
+    ENCODER_PUSH_CONSTANTS,
+    ENCODER_SET_VIEWPORT,
+    ENCODER_SET_SCISSOR,
+    // cull mode, front face, topology and depth state of extended dynamic state as one group
+    ENCODER_SET_DYNAMIC_STATE,
+    // never elided, counted so the binds can be compared to the work
+    ENCODER_DRAW,
+    ENCODER_COMMAND_COUNT,
+} EncoderCommand;
+
+#define ENCODER_MAX_VERTEX_BUFFERS 3
+#define ENCODER_MAX_DESCRIPTOR_SETS 2
+
+// graphics state bound on a command buffer, commands setting what is already bound are dropped
+// every command uses state->pipelineLayout, so binding a pipeline disturbs neither sets nor push constants
+typedef struct CommandEncoder
+{
+    VkCommandBuffer commandBuffer;
+    VkPipelineLayout layout;
+
+    // bit per EncoderCommand whose state below is known, cleared by encoderBegin
+    uint32_t known;
+    uint32_t knownVertexBuffers;
+    uint32_t knownSets;
+
+    VkPipeline pipeline;
+    VkBuffer vertexBuffers[ENCODER_MAX_VERTEX_BUFFERS];
+    VkDeviceSize vertexOffsets[ENCODER_MAX_VERTEX_BUFFERS];
+    VkBuffer indexBuffer;
+    VkDeviceSize indexOffset;
+    VkIndexType indexType;
+    VkDescriptorSet sets[ENCODER_MAX_DESCRIPTOR_SETS];
+    // UINT32_MAX for sets without dynamic offset
+    uint32_t setOffsets[ENCODER_MAX_DESCRIPTOR_SETS];
+    DrawPushConstants pushConstants;
+    VkViewport viewport;
+    VkRect2D scissor;
+    PipelineKey dynamicState;
+
+    // accumulated over every command buffer since startup
+    uint64_t issued[ENCODER_COMMAND_COUNT];
+    uint64_t elided[ENCODER_COMMAND_COUNT];
+} CommandEncoder;
+
+/**
+ * @brief allocates keys, items and their sort scratch for capacity draws
+ */
+void createDrawQueue(State* state, uint32_t capacity);
+
+/**
+ * @brief builds sort key ordering by pass, pipeline, material and depth, in that priority
+ * @details opaque draws sort front to back, transparent ones back to front
+ * @param pipeline pipeline cache variant, truncated to DRAW_KEY_PIPELINE_MASK
+ * @param material bindless indices only group draws, they are folded into DRAW_KEY_MATERIAL_MASK
+ * @param depth view depth, any float orders correctly
+ */
+uint64_t drawSortKey(DrawPass pass, uint32_t pipeline, uint32_t textureIndex, uint32_t materialIndex, float depth);
+
+/**
+ * @brief empties the queue, items of the last frame are dropped
+ */
+void drawQueueReset(DrawQueue* queue);
+
+/**
+ * @brief appends draw with its sort key
+ * Requires:
+    - queue->count < queue->capacity
+ * @param item index into state->draws
+ */
+void drawQueuePush(DrawQueue* queue, uint64_t key, uint32_t item);
+
+/**
+ * @brief sorts items by ascending key, equal keys keep push order
+ * @details LSD radix sort over 8 bit digits, digits equal in every key are skipped
+ */
+void drawQueueSort(DrawQueue* queue);
+
+void destroyDrawQueue(State* state);
+
+/**
+ * @brief starts tracking a command buffer, nothing is assumed bound on it
+ * @details counters keep accumulating
+ */
+void encoderBegin(CommandEncoder* encoder, VkCommandBuffer commandBuffer, VkPipelineLayout layout);
+
+/**
+ * @brief forgets bound state after commands were recorded past the encoder
+ */
+void encoderInvalidate(CommandEncoder* encoder);
+
+void encoderBindPipeline(CommandEncoder* encoder, VkPipeline pipeline);
+
+/**
+ * @brief binds buffers to bindings [first, first + count), only the changed subrange is issued
+ * Requires:
+    - first + count <= ENCODER_MAX_VERTEX_BUFFERS
+ */
+void encoderBindVertexBuffers(CommandEncoder* encoder, uint32_t first, uint32_t count, const VkBuffer* buffers, const VkDeviceSize* offsets);
+
+void encoderBindIndexBuffer(CommandEncoder* encoder, VkBuffer buffer, VkDeviceSize offset, VkIndexType indexType);
+
+/**
+ * @brief binds graphics descriptor set of the encoder's layout
+ * Requires:
+    - index < ENCODER_MAX_DESCRIPTOR_SETS
+ * @param dynamicOffset NULL for sets without dynamic buffer
+ */
+void encoderBindDescriptorSet(CommandEncoder* encoder, uint32_t index, VkDescriptorSet set, const uint32_t* dynamicOffset);
+
+/**
+ * @brief pushes the whole DrawPushConstants range to vertex and fragment stage
+ */
+void encoderPushConstants(CommandEncoder* encoder, const DrawPushConstants* pushConstants);
+
+void encoderSetViewport(CommandEncoder* encoder, const VkViewport* viewport);
+
+void encoderSetScissor(CommandEncoder* encoder, const VkRect2D* scissor);
+
+/**
+ * @brief sets the extended dynamic state of key, see pipelineCacheSetDynamicState
+ * @details does nothing without extended dynamic state
+ */
+void encoderSetDynamicState(CommandEncoder* encoder, State* state, const PipelineKey* key);
+
+void encoderDrawIndexed(CommandEncoder* encoder, uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t vertexOffset, uint32_t firstInstance);
+
+/**
+ * @brief prints issued and elided commands per kind and per frame
+ */
+void encoderPrintStats(FILE* out, const CommandEncoder* encoder, uint64_t frames);
+
+#endif // __ENCODER_H__
@@ -0,0 +1,595 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "export.h"
+
+#include "debug.h"
+#include "export_protocol.h"
+#include "init.h"
+#include "utils.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <vulkan/vulkan_core.h>
+
+// render loop polls the consumer this long before logging that it still waits
+#define EXPORT_WAIT_MS 100
+
+static void disconnectConsumer(State* state)
+{
+    FrameExport* frameExport = &state->frameExport;
+
+    close(frameExport->clientSocket);
+    frameExport->clientSocket = -1;
+
+    // nobody reads the images anymore, frames still in flight are just not announced
+    for (uint32_t i = 0; i < EXPORT_IMAGE_COUNT; i++)
+    {
+        frameExport->images[i].held = VK_FALSE;
+    }
+
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    {
+        frameExport->pendingImage[i] = UINT32_MAX;
+    }
+
+    LOG("export: consumer disconnected after %llu frames", (unsigned long long) frameExport->sent);
+}
+
+// returns 0 and drops the consumer when the socket is gone
+static int sendMessage(State* state, const ExportMessage* message, const int* fds, uint32_t fdCount)
+{
+    FrameExport* frameExport = &state->frameExport;
+
+    struct iovec iov = {
+        .iov_base = (void*) message,
+        .iov_len = sizeof(*message),
+    };
+
+    union {
+        struct cmsghdr header;
+        char buffer[CMSG_SPACE(sizeof(int) * EXPORT_MAX_IMAGES)];
+    } control;
+    memset(&control, 0, sizeof(control));
+
+    struct msghdr msg = {
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+    };
+
+    if (fdCount > 0) {
+        msg.msg_control = control.buffer;
+        msg.msg_controllen = CMSG_SPACE(sizeof(int) * fdCount);
+
+        struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int) * fdCount);
+        memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * fdCount);
+    }
+
+    if (sendmsg(frameExport->clientSocket, &msg, MSG_NOSIGNAL) != (ssize_t) sizeof(*message)) {
+        LOG_WARN("export: send failed (%s)", strerror(errno));
+        disconnectConsumer(state);
+        return 0;
+    }
+
+    return 1;
+}
+
+static void sendConfiguration(State* state)
+{
+    FrameExport* frameExport = &state->frameExport;
+
+    VkPhysicalDeviceIDProperties idProps = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES,
+        .pNext = NULL,
+    };
+
+    VkPhysicalDeviceProperties2 props = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+        .pNext = &idProps,
+    };
+
+    vkGetPhysicalDeviceProperties2(state->physicalDevice, &props);
+
+    ExportMessage message = {
+        .type = EXPORT_MESSAGE_CONFIGURE,
+        .version = EXPORT_PROTOCOL_VERSION,
+        .generation = frameExport->generation,
+        .format = (uint32_t) frameExport->format,
+        .width = state->targets[0].extent.width,
+        .height = state->targets[0].extent.height,
+        .usage = frameExport->usage,
+        .imageCount = EXPORT_IMAGE_COUNT,
+    };
+
+    memcpy(message.deviceUUID, idProps.deviceUUID, sizeof(message.deviceUUID));
+    memcpy(message.driverUUID, idProps.driverUUID, sizeof(message.driverUUID));
+
+    // every export creates a new fd, the receiving process gets its own duplicates
+    int fds[EXPORT_IMAGE_COUNT];
+    for (uint32_t i = 0; i < EXPORT_IMAGE_COUNT; i++)
+    {
+        VkMemoryGetFdInfoKHR getFdInf = {
+            .sType = VK_STRUCTURE_TYPE_MEMORY_GET_FD_INFO_KHR,
+            .pNext = NULL,
+            .memory = frameExport->images[i].memory,
+            .handleType = VK_EXTERNAL_MEMORY_HANDLE_TYPE_OPAQUE_FD_BIT,
+        };
+
+        assertVk(frameExport->getMemoryFd(state->device, &getFdInf, &fds[i]), "failed to export image memory", "exported image memory");
+        message.memorySize[i] = frameExport->images[i].size;
+    }
+
+    sendMessage(state, &message, fds, EXPORT_IMAGE_COUNT);
+
+    for (uint32_t i = 0; i < EXPORT_IMAGE_COUNT; i++)
+    {
+        close(fds[i]);
+    }
+}
+
+static void acceptConsumer(State* state)
+{
+    FrameExport* frameExport = &state->frameExport;
+
+    int client = accept(frameExport->listenSocket, NULL, NULL);
+    if (client < 0) {
+        return;
+    }
+
+    frameExport->clientSocket = client;
+    frameExport->sent = 0;
+    LOG("export: consumer connected on %s", frameExport->socketPath);
+
+    sendConfiguration(state);
+}
+
+// handles all queued release messages without blocking
+static void receiveReleases(State* state)
+{
+    FrameExport* frameExport = &state->frameExport;
+
+    while (frameExport->clientSocket >= 0)
+    {
+        ExportMessage message;
+        ssize_t received = recv(frameExport->clientSocket, &message, sizeof(message), MSG_DONTWAIT);
+
+        if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return;
+        }
+
+        if (received != (ssize_t) sizeof(message) || message.type != EXPORT_MESSAGE_RELEASE) {
+            disconnectConsumer(state);
+            return;
+        }
+
+        // releases of images destroyed by a resize are stale
+        if (message.generation == frameExport->generation && message.imageIndex < EXPORT_IMAGE_COUNT) {
+            frameExport->images[message.imageIndex].held = VK_FALSE;
+        }
+    }
+}
+
+static void createExportImages(State* state)
+{
+    FrameExport* frameExport = &state->frameExport;
+
+    for (uint32_t i = 0; i < EXPORT_IMAGE_COUNT; i++)
+    {
+        ExportImage* image = &frameExport->images[i];
+
+        VkExternalMemoryImageCreateInfo externalInf = {
+            .sType = VK_STRUCTURE_TYPE_EXTERNAL_MEMORY_IMAGE_CREATE_INFO,
+            .pNext = NULL,
+            .handleTypes = VK_EXTERNAL_MEMORY_HANDLE_TYPE_OPAQUE_FD_BIT,
+        };
+
+        // consumer creates the image with exactly these parameters before importing the memory
+        VkImageCreateInfo imageCrtInf = {
+            .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+            .pNext = &externalInf,
+            .flags = 0,
+            .imageType = VK_IMAGE_TYPE_2D,
+            .format = frameExport->format,
+            .extent = {state->targets[0].extent.width, state->targets[0].extent.height, 1},
+            .mipLevels = 1,
+            .arrayLayers = 1,
+            .samples = VK_SAMPLE_COUNT_1_BIT,
+            .tiling = VK_IMAGE_TILING_OPTIMAL,
+            .usage = frameExport->usage,
+            .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+            .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        };
+
+        assertVk(vkCreateImage(state->device, &imageCrtInf, state->allocator, &image->image), "failed to create export image", "created export image");
+
+        VkMemoryRequirements memReq;
+        vkGetImageMemoryRequirements(state->device, image->image, &memReq);
+
+        // dedicated allocation, some drivers can only export those and importers need it to know the layout
+        VkMemoryDedicatedAllocateInfo dedicatedInf = {
+            .sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO,
+            .pNext = NULL,
+            .image = image->image,
+            .buffer = VK_NULL_HANDLE,
+        };
+
+        VkExportMemoryAllocateInfo exportInf = {
+            .sType = VK_STRUCTURE_TYPE_EXPORT_MEMORY_ALLOCATE_INFO,
+            .pNext = &dedicatedInf,
+            .handleTypes = VK_EXTERNAL_MEMORY_HANDLE_TYPE_OPAQUE_FD_BIT,
+        };
+
+        VkMemoryAllocateInfo allocInf = {
+            .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+            .pNext = &exportInf,
+            .allocationSize = memReq.size,
+            .memoryTypeIndex = findMemoryType(state, memReq.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT),
+        };
+
+        assertVk(vkAllocateMemory(state->device, &allocInf, state->allocator, &image->memory), "failed to allocate export memory", "allocated export memory");
+        vkBindImageMemory(state->device, image->image, image->memory, 0);
+        image->size = memReq.size;
+
+        VkImageViewCreateInfo viewCrtInf = {
+            .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+            .pNext = NULL,
+            .flags = 0,
+            .image = image->image,
+            .viewType = VK_IMAGE_VIEW_TYPE_2D,
+            .format = frameExport->format,
+            .components = {VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY},
+            .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1},
+        };
+
+        assertVk(vkCreateImageView(state->device, &viewCrtInf, state->allocator, &image->view), "failed to create export image view", "created export image view");
+
+        image->semaphore = VK_NULL_HANDLE;
+        if (frameExport->syncFd) {
+            VkExportSemaphoreCreateInfo exportSemInf = {
+                .sType = VK_STRUCTURE_TYPE_EXPORT_SEMAPHORE_CREATE_INFO,
+                .pNext = NULL,
+                .handleTypes = VK_EXTERNAL_SEMAPHORE_HANDLE_TYPE_SYNC_FD_BIT,
+            };
+
+            VkSemaphoreCreateInfo semCrtInf = {
+                .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+                .pNext = &exportSemInf,
+                .flags = 0,
+            };
+
+            assertVk(vkCreateSemaphore(state->device, &semCrtInf, state->allocator, &image->semaphore), "failed to create export semaphore", "created export semaphore");
+        }
+
+        image->held = VK_FALSE;
+    }
+
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    {
+        frameExport->pendingImage[i] = UINT32_MAX;
+    }
+}
+
+static void destroyExportImages(State* state)
+{
+    FrameExport* frameExport = &state->frameExport;
+
+    for (uint32_t i = 0; i < EXPORT_IMAGE_COUNT; i++)
+    {
+        ExportImage* image = &frameExport->images[i];
+
+        vkDestroySemaphore(state->device, image->semaphore, state->allocator);
+        vkDestroyImageView(state->device, image->view, state->allocator);
+        vkDestroyImage(state->device, image->image, state->allocator);
+        vkFreeMemory(state->device, image->memory, state->allocator);
+    }
+}
+
+// exportable color attachments in the swapchain format, the pipeline renders into them unchanged
+static void checkExportSupport(State* state)
+{
+    FrameExport* frameExport = &state->frameExport;
+
+    VkPhysicalDeviceExternalImageFormatInfo externalFormatInf = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTERNAL_IMAGE_FORMAT_INFO,
+        .pNext = NULL,
+        .handleType = VK_EXTERNAL_MEMORY_HANDLE_TYPE_OPAQUE_FD_BIT,
+    };
+
+    VkPhysicalDeviceImageFormatInfo2 formatInf = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_IMAGE_FORMAT_INFO_2,
+        .pNext = &externalFormatInf,
+        .format = frameExport->format,
+        .type = VK_IMAGE_TYPE_2D,
+        .tiling = VK_IMAGE_TILING_OPTIMAL,
+        .usage = frameExport->usage,
+        .flags = 0,
+    };
+
+    VkExternalImageFormatProperties externalProps = {
+        .sType = VK_STRUCTURE_TYPE_EXTERNAL_IMAGE_FORMAT_PROPERTIES,
+        .pNext = NULL,
+    };
+
+    VkImageFormatProperties2 formatProps = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_FORMAT_PROPERTIES_2,
+        .pNext = &externalProps,
+    };
+
+    assertVk(vkGetPhysicalDeviceImageFormatProperties2(state->physicalDevice, &formatInf, &formatProps),
+        "swapchain format can not be used for exported images", "");
+    assert_my(externalProps.externalMemoryProperties.externalMemoryFeatures & VK_EXTERNAL_MEMORY_FEATURE_EXPORTABLE_BIT,
+        "image memory can not be exported as opaque fd", "image memory is exportable");
+
+    if (frameExport->syncFd) {
+        VkPhysicalDeviceExternalSemaphoreInfo semaphoreInf = {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTERNAL_SEMAPHORE_INFO,
+            .pNext = NULL,
+            .handleType = VK_EXTERNAL_SEMAPHORE_HANDLE_TYPE_SYNC_FD_BIT,
+        };
+
+        VkExternalSemaphoreProperties semaphoreProps = {
+            .sType = VK_STRUCTURE_TYPE_EXTERNAL_SEMAPHORE_PROPERTIES,
+            .pNext = NULL,
+        };
+
+        vkGetPhysicalDeviceExternalSemaphoreProperties(state->physicalDevice, &semaphoreInf, &semaphoreProps);
+        frameExport->syncFd = (semaphoreProps.externalSemaphoreFeatures & VK_EXTERNAL_SEMAPHORE_FEATURE_EXPORTABLE_BIT) != 0;
+    }
+}
+
+void createFrameExport(State* state, const char* socketPath)
+{
+    FrameExport* frameExport = &state->frameExport;
+
+    assert_my(state->useDynamicRendering, "frame export renders without framebuffers, enable dynamic rendering", "");
+
+    frameExport->format = state->swapchainFormat.format;
+    frameExport->usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    frameExport->generation = 0;
+    frameExport->current = 0;
+    frameExport->sending = VK_FALSE;
+    frameExport->sent = 0;
+    frameExport->stalls = 0;
+    frameExport->clientSocket = -1;
+
+    frameExport->getMemoryFd = (PFN_vkGetMemoryFdKHR) vkGetDeviceProcAddr(state->device, "vkGetMemoryFdKHR");
+    frameExport->getSemaphoreFd = (PFN_vkGetSemaphoreFdKHR) vkGetDeviceProcAddr(state->device, "vkGetSemaphoreFdKHR");
+    assert_my(frameExport->getMemoryFd, "vkGetMemoryFdKHR not available", "");
+    frameExport->syncFd = frameExport->syncFd && frameExport->getSemaphoreFd != NULL;
+
+    checkExportSupport(state);
+    createExportImages(state);
+
+    struct sockaddr_un address = {
+        .sun_family = AF_UNIX,
+    };
+    assert_my(strlen(socketPath) < sizeof(address.sun_path), "export socket path too long", "");
+    snprintf(address.sun_path, sizeof(address.sun_path), "%s", socketPath);
+    snprintf(frameExport->socketPath, sizeof(frameExport->socketPath), "%s", socketPath);
+
+    // message boundaries are kept, each message arrives whole with its fds
+    frameExport->listenSocket = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+    assert_my(frameExport->listenSocket >= 0, "failed to create export socket", "created export socket");
+
+    unlink(socketPath);
+    assert_my(bind(frameExport->listenSocket, (struct sockaddr*) &address, sizeof(address)) == 0, "failed to bind export socket", "bound export socket");
+    assert_my(listen(frameExport->listenSocket, 1) == 0, "failed to listen on export socket", "listening on export socket");
+
+    // render loop polls for the consumer, it never blocks on accept
+    fcntl(frameExport->listenSocket, F_SETFL, fcntl(frameExport->listenSocket, F_GETFL) | O_NONBLOCK);
+
+    LOG("export: %u images synchronized by %s, waiting for consumer on %s", EXPORT_IMAGE_COUNT,
+        frameExport->syncFd ? "sync file" : "fence", socketPath);
+}
+
+void frameExportResize(State* state)
+{
+    FrameExport* frameExport = &state->frameExport;
+
+    destroyExportImages(state);
+    frameExport->format = state->swapchainFormat.format;
+    createExportImages(state);
+
+    frameExport->generation++;
+
+    if (frameExport->clientSocket >= 0) {
+        sendConfiguration(state);
+    }
+}
+
+static void sendFrame(State* state, uint32_t imageIndex, uint64_t frame, int syncFd)
+{
+    FrameExport* frameExport = &state->frameExport;
+
+    ExportMessage message = {
+        .type = EXPORT_MESSAGE_FRAME,
+        .version = EXPORT_PROTOCOL_VERSION,
+        .generation = frameExport->generation,
+        .imageIndex = imageIndex,
+        .frame = frame,
+        .hasSyncFd = syncFd >= 0,
+    };
+
+    if (sendMessage(state, &message, &syncFd, syncFd >= 0 ? 1 : 0)) {
+        frameExport->sent++;
+    }
+}
+
+void frameExportCollect(State* state, uint32_t frameIndex)
+{
+    FrameExport* frameExport = &state->frameExport;
+
+    if (frameExport->pendingImage[frameIndex] == UINT32_MAX) {
+        return;
+    }
+
+    if (frameExport->clientSocket >= 0) {
+        sendFrame(state, frameExport->pendingImage[frameIndex], frameExport->pendingFrame[frameIndex], -1);
+    }
+
+    frameExport->pendingImage[frameIndex] = UINT32_MAX;
+}
+
+void frameExportBeginFrame(State* state, uint64_t frame)
+{
+    FrameExport* frameExport = &state->frameExport;
+
+    if (frameExport->clientSocket < 0) {
+        acceptConsumer(state);
+    }
+    receiveReleases(state);
+
+    // with one image more than frames in flight the next image is never used by the GPU,
+    // only the consumer can still hold it
+    uint32_t next = (frameExport->current + 1) % EXPORT_IMAGE_COUNT;
+
+    if (frameExport->clientSocket >= 0 && frameExport->images[next].held) {
+        frameExport->stalls++;
+
+        while (frameExport->clientSocket >= 0 && frameExport->images[next].held)
+        {
+            struct pollfd pfd = {
+                .fd = frameExport->clientSocket,
+                .events = POLLIN,
+            };
+
+            if (poll(&pfd, 1, EXPORT_WAIT_MS) == 0) {
+                LOG_DEBUG("export: waiting for consumer to release image %u", next);
+            }
+            receiveReleases(state);
+        }
+    }
+
+    frameExport->current = next;
+    frameExport->frame = frame;
+    frameExport->sending = frameExport->clientSocket >= 0;
+    frameExport->images[next].held = frameExport->sending;
+}
+
+void frameExportRecordCopy(State* state, VkCommandBuffer commandBuffer, VkImage swapchainImage)
+{
+    FrameExport* frameExport = &state->frameExport;
+    ExportImage* image = &frameExport->images[frameExport->current];
+
+    // the render graph moved both images into place, the consumer receives the exported image in GENERAL as read by the copy
+    // same format and extent, a plain copy instead of a blit
+    VkImageCopy region = {
+        .srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1},
+        .srcOffset = {0, 0, 0},
+        .dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1},
+        .dstOffset = {0, 0, 0},
+        .extent = {state->targets[0].extent.width, state->targets[0].extent.height, 1},
+    };
+
+    vkCmdCopyImage(commandBuffer, image->image, VK_IMAGE_LAYOUT_GENERAL, swapchainImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+    if (!frameExport->sending) {
+        return;
+    }
+
+    // release to the consumer's queue, its acquire barrier uses GENERAL as old and new layout too
+    VkImageMemoryBarrier2 release = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+        .pNext = NULL,
+        .srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+        .srcAccessMask = VK_ACCESS_2_NONE,
+        .dstStageMask = VK_PIPELINE_STAGE_2_NONE,
+        .dstAccessMask = VK_ACCESS_2_NONE,
+        .oldLayout = VK_IMAGE_LAYOUT_GENERAL,
+        .newLayout = VK_IMAGE_LAYOUT_GENERAL,
+        .srcQueueFamilyIndex = state->queueFamilyIndex,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_EXTERNAL,
+        .image = image->image,
+        .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1},
+    };
+
+    VkDependencyInfo releaseInf = {
+        .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+        .pNext = NULL,
+        .dependencyFlags = 0,
+        .imageMemoryBarrierCount = 1,
+        .pImageMemoryBarriers = &release,
+    };
+
+    vkCmdPipelineBarrier2(commandBuffer, &releaseInf);
+}
+
+VkSemaphore frameExportSemaphore(State* state)
+{
+    FrameExport* frameExport = &state->frameExport;
+
+    if (!frameExport->sending || !frameExport->syncFd) {
+        return VK_NULL_HANDLE;
+    }
+
+    return frameExport->images[frameExport->current].semaphore;
+}
+
+void frameExportEndFrame(State* state, uint32_t frameIndex)
+{
+    FrameExport* frameExport = &state->frameExport;
+
+    if (!frameExport->sending) {
+        return;
+    }
+
+    if (!frameExport->syncFd) {
+        // announced once the frame's fence signaled
+        frameExport->pendingImage[frameIndex] = frameExport->current;
+        frameExport->pendingFrame[frameIndex] = frameExport->frame;
+        return;
+    }
+
+    // exporting a sync file takes the pending signal out of the semaphore, so it is exported
+    // even when the consumer vanished since the frame began
+    VkSemaphoreGetFdInfoKHR getFdInf = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_GET_FD_INFO_KHR,
+        .pNext = NULL,
+        .semaphore = frameExport->images[frameExport->current].semaphore,
+        .handleType = VK_EXTERNAL_SEMAPHORE_HANDLE_TYPE_SYNC_FD_BIT,
+    };
+
+    int syncFd;
+    assertVk(frameExport->getSemaphoreFd(state->device, &getFdInf, &syncFd), "failed to export frame semaphore", "");
+
+    if (frameExport->clientSocket >= 0) {
+        sendFrame(state, frameExport->current, frameExport->frame, syncFd);
+    }
+
+    // sync file of an already signaled fence may be -1
+    if (syncFd >= 0) {
+        close(syncFd);
+    }
+}
+
+void destroyFrameExport(State* state)
+{
+    FrameExport* frameExport = &state->frameExport;
+
+    // device is idle, frames still waiting for their fence can be announced now
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    {
+        frameExportCollect(state, i);
+    }
+
+    if (frameExport->clientSocket >= 0) {
+        close(frameExport->clientSocket);
+    }
+    close(frameExport->listenSocket);
+    unlink(frameExport->socketPath);
+
+    destroyExportImages(state);
+
+    if (frameExport->stalls > 0) {
+        LOG_WARN("export: render loop waited for the consumer %llu times", (unsigned long long) frameExport->stalls);
+    }
+}
@@ -0,0 +1,117 @@
+#ifndef __EXPORT_H__
+#define __EXPORT_H__
+
+#include "common.h"
+
+#include <stdint.h>
+#include <vulkan/vulkan_core.h>
+
+// exported render targets, one more than frames in flight so the consumer can hold one without stalling rendering
+#define EXPORT_IMAGE_COUNT 3
+
+typedef struct ExportImage
+{
+    // dedicated memory exported as opaque fd
+    VkImage image;
+    VkDeviceMemory memory;
+    VkDeviceSize size;
+    VkImageView view;
+
+    // signaled by the frame rendering into the image, handed to the consumer as sync file
+    VkSemaphore semaphore;
+    // consumer reads the image until it sends the release message
+    VkBool32 held;
+} ExportImage;
+
+// renders into images shared with another process and announces every frame over a Unix socket
+typedef struct FrameExport
+{
+    ExportImage images[EXPORT_IMAGE_COUNT];
+    VkFormat format;
+    VkImageUsageFlags usage;
+    uint32_t generation;
+
+    // image rendered by the frame being recorded
+    uint32_t current;
+    uint64_t frame;
+    // current frame is sent, consumer was connected when it started
+    VkBool32 sending;
+
+    // sync file semaphores supported, otherwise frames are announced after their fence signaled
+    VkBool32 syncFd;
+    uint32_t pendingImage[MAX_FRAMES_IN_FLIGHT];
+    uint64_t pendingFrame[MAX_FRAMES_IN_FLIGHT];
+
+    char socketPath[108];
+    int listenSocket;
+    // -1 while no consumer is connected
+    int clientSocket;
+
+    PFN_vkGetMemoryFdKHR getMemoryFd;
+    PFN_vkGetSemaphoreFdKHR getSemaphoreFd;
+
+    uint64_t sent;
+    // frames the render loop waited for the consumer to release an image
+    uint64_t stalls;
+} FrameExport;
+
+/**
+ * @brief creates exportable render targets and listens for a consumer on a Unix socket
+ * @details frames are rendered into the exported images, copied to the swapchain for display
+ * and announced to the consumer, see export_protocol.h for the messages
+ * Requires:
+    - state->exportFrames was set before device and swapchain creation
+    - dynamic rendering
+ * @param socketPath path of the SOCK_SEQPACKET socket, replaced if it exists
+ */
+void createFrameExport(State* state, const char* socketPath);
+
+/**
+ * @brief recreates exported images with the swapchain extent and sends them to the consumer again
+ * Requires:
+    - device idle
+ */
+void frameExportResize(State* state);
+
+/**
+ * @brief announces frames of the given frame in flight when sync files are not supported
+ * Requires:
+    - fence of the frame in flight signaled
+ */
+void frameExportCollect(State* state, uint32_t frameIndex);
+
+/**
+ * @brief accepts consumer, processes its release messages and selects the image to render into
+ * @details waits only when the consumer holds every image the GPU is not using
+ */
+void frameExportBeginFrame(State* state, uint64_t frame);
+
+/**
+ * @brief records copy of the rendered image to the swapchain image and releases it to the external queue family
+ * Requires:
+    - exported image in VK_IMAGE_LAYOUT_GENERAL, swapchain image in VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+      both ordered before the transfer stage (render graph pass reading and writing them)
+ */
+void frameExportRecordCopy(State* state, VkCommandBuffer commandBuffer, VkImage swapchainImage);
+
+/**
+ * @brief semaphore the submit has to signal for the consumer
+ * @return VK_NULL_HANDLE when the frame is not sent or sync files are not supported
+ */
+VkSemaphore frameExportSemaphore(State* state);
+
+/**
+ * @brief sends the frame with its sync file right after submission
+ * Requires:
+    - command buffer of the frame submitted
+ */
+void frameExportEndFrame(State* state, uint32_t frameIndex);
+
+/**
+ * @brief closes the socket and destroys exported images
+ * Requires:
+    - device idle
+ */
+void destroyFrameExport(State* state);
+
+#endif // __EXPORT_H__
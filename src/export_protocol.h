@@ -0,0 +1,46 @@
+#ifndef __EXPORT_PROTOCOL_H__
+#define __EXPORT_PROTOCOL_H__
+
+#include <stdint.h>
+
+// messages between renderer and frame consumer over a SOCK_SEQPACKET Unix socket,
+// file descriptors travel as SCM_RIGHTS ancillary data of the message they belong to
+#define EXPORT_PROTOCOL_VERSION 1
+#define EXPORT_MAX_IMAGES 4
+
+typedef enum ExportMessageType
+{
+    // renderer -> consumer, one memory fd per image follows, sent on connect and whenever the images are recreated
+    EXPORT_MESSAGE_CONFIGURE = 1,
+    // renderer -> consumer, image holds a new frame, a sync file fd follows when hasSyncFd is set
+    EXPORT_MESSAGE_FRAME = 2,
+    // consumer -> renderer, consumer is done reading the image
+    EXPORT_MESSAGE_RELEASE = 3,
+} ExportMessageType;
+
+typedef struct ExportMessage
+{
+    uint32_t type;
+    uint32_t version;
+    // bumped when images are recreated, frames and releases of older generations are stale
+    uint32_t generation;
+    uint32_t imageIndex;
+    uint64_t frame;
+
+    // EXPORT_MESSAGE_CONFIGURE, consumer must pick the device with the same UUIDs and create identical images
+    uint8_t deviceUUID[16];
+    uint8_t driverUUID[16];
+    uint32_t format;
+    uint32_t width;
+    uint32_t height;
+    uint32_t usage;
+    uint32_t imageCount;
+    // allocation size of every image's memory, imports use the same size
+    uint64_t memorySize[EXPORT_MAX_IMAGES];
+
+    // EXPORT_MESSAGE_FRAME, without sync file the GPU finished the frame before it was announced
+    uint32_t hasSyncFd;
+    uint32_t padding;
+} ExportMessage;
+
+#endif // __EXPORT_PROTOCOL_H__
@@ -0,0 +1,637 @@
+#include "graph.h"
+
+#include "debug.h"
+#include "init.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <vulkan/vulkan_core.h>
+
+typedef struct GraphAccessInfo
+{
+    VkPipelineStageFlags2 stage;
+    VkAccessFlags2 access;
+    VkImageLayout layout;
+    VkBool32 write;
+} GraphAccessInfo;
+
+// only bits which exist in the original flags, render pass dependencies are built from the same table
+static const GraphAccessInfo accessInfos[GRAPH_ACCESS_COUNT] = {
+    [GRAPH_ACCESS_NONE] = {VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_UNDEFINED, VK_FALSE},
+    [GRAPH_ACCESS_COLOR_ATTACHMENT_WRITE] = {VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_TRUE},
+    [GRAPH_ACCESS_DEPTH_ATTACHMENT_WRITE] = {VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+        VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+        VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_TRUE},
+    [GRAPH_ACCESS_SAMPLED_FRAGMENT] = {VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT,
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_FALSE},
+    [GRAPH_ACCESS_SAMPLED_COMPUTE] = {VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT,
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_FALSE},
+    [GRAPH_ACCESS_STORAGE_WRITE_COMPUTE] = {VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_WRITE_BIT,
+        VK_IMAGE_LAYOUT_GENERAL, VK_TRUE},
+    [GRAPH_ACCESS_TRANSFER_READ] = {VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT,
+        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_FALSE},
+    [GRAPH_ACCESS_TRANSFER_WRITE] = {VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_TRUE},
+    [GRAPH_ACCESS_TRANSFER_READ_GENERAL] = {VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT,
+        VK_IMAGE_LAYOUT_GENERAL, VK_FALSE},
+    // presentation is ordered by the render finished semaphore, only the layout matters
+    [GRAPH_ACCESS_PRESENT] = {VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_FALSE},
+};
+
+// reads never need to be made available, only writes go into source access masks
+static VkAccessFlags2 writeAccess(const GraphAccessInfo* info)
+{
+    return info->write ? info->access & (VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+        VK_ACCESS_2_SHADER_WRITE_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT) : VK_ACCESS_2_NONE;
+}
+
+void graphBegin(RenderGraph* graph)
+{
+    graph->passCount = 0;
+    graph->resourceCount = 0;
+    graph->transientCount = 0;
+    graph->finalBarrierCount = 0;
+}
+
+static uint32_t addResource(RenderGraph* graph, const char* name, VkImageAspectFlags aspect)
+{
+    assert_my(graph->resourceCount < GRAPH_MAX_RESOURCES, "render graph resources exhausted, increase GRAPH_MAX_RESOURCES", "");
+
+    uint32_t index = graph->resourceCount++;
+    GraphResource* resource = &graph->resources[index];
+    memset(resource, 0, sizeof(*resource));
+
+    resource->name = name;
+    resource->aspect = aspect;
+    resource->transient = UINT32_MAX;
+
+    return index;
+}
+
+uint32_t graphImportImage(RenderGraph* graph, const char* name, VkImage image, VkImageView view,
+    VkImageAspectFlags aspect, GraphAccess initialAccess, GraphAccess finalAccess)
+{
+    uint32_t index = addResource(graph, name, aspect);
+    GraphResource* resource = &graph->resources[index];
+
+    resource->imported = VK_TRUE;
+    resource->image = image;
+    resource->view = view;
+    resource->initialAccess = initialAccess;
+    resource->finalAccess = finalAccess;
+
+    return index;
+}
+
+uint32_t graphCreateImage(RenderGraph* graph, const char* name, VkFormat format, VkExtent2D extent,
+    VkImageUsageFlags usage, VkImageAspectFlags aspect)
+{
+    uint32_t index = addResource(graph, name, aspect);
+
+    // declarations of the previous frame stay in the array until compile compares them
+    GraphTransient* transient = &graph->transients[graph->transientCount];
+    if (graph->transientCount >= graph->builtTransientCount) {
+        memset(transient, 0, sizeof(*transient));
+    }
+
+    if (transient->format != format || transient->extent.width != extent.width || transient->extent.height != extent.height ||
+        transient->usage != usage || transient->aspect != aspect) {
+        graph->transientsDirty = VK_TRUE;
+    }
+
+    transient->format = format;
+    transient->extent = extent;
+    transient->usage = usage;
+    transient->aspect = aspect;
+
+    graph->resources[index].transient = graph->transientCount++;
+
+    return index;
+}
+
+uint32_t graphAddPass(RenderGraph* graph, const char* name, GraphPassCallback callback, void* userData)
+{
+    assert_my(graph->passCount < GRAPH_MAX_PASSES, "render graph passes exhausted, increase GRAPH_MAX_PASSES", "");
+
+    uint32_t index = graph->passCount++;
+    GraphPass* pass = &graph->passes[index];
+
+    pass->name = name;
+    pass->callback = callback;
+    pass->userData = userData;
+    pass->useCount = 0;
+    pass->sideEffects = VK_FALSE;
+    pass->culled = VK_FALSE;
+    pass->barrierCount = 0;
+
+    return index;
+}
+
+void graphPassUse(RenderGraph* graph, uint32_t pass, uint32_t resource, GraphAccess access)
+{
+    GraphPass* graphPass = &graph->passes[pass];
+
+    assert_my(graphPass->useCount < GRAPH_MAX_PASS_USES, "render graph pass uses exhausted, increase GRAPH_MAX_PASS_USES", "");
+    assert_my(access != GRAPH_ACCESS_NONE && access != GRAPH_ACCESS_PRESENT, "access is only valid for imported images", "");
+
+    for (uint32_t i = 0; i < graphPass->useCount; i++)
+    {
+        assert_my(graphPass->uses[i].resource != resource, "pass uses image twice", "");
+    }
+
+    graphPass->uses[graphPass->useCount++] = (GraphUse) {resource, access};
+}
+
+void graphPassSideEffects(RenderGraph* graph, uint32_t pass)
+{
+    graph->passes[pass].sideEffects = VK_TRUE;
+}
+
+// walks passes backwards, a pass survives when it has side effects or writes an image somebody reads later
+static void cullPasses(RenderGraph* graph)
+{
+    VkBool32 needed[GRAPH_MAX_RESOURCES];
+
+    for (uint32_t i = 0; i < graph->resourceCount; i++)
+    {
+        needed[i] = graph->resources[i].imported && graph->resources[i].finalAccess != GRAPH_ACCESS_NONE;
+    }
+
+    graph->culledCount = 0;
+
+    for (uint32_t p = graph->passCount; p-- > 0;)
+    {
+        GraphPass* pass = &graph->passes[p];
+
+        VkBool32 alive = pass->sideEffects;
+        for (uint32_t i = 0; i < pass->useCount && !alive; i++)
+        {
+            alive = accessInfos[pass->uses[i].access].write && needed[pass->uses[i].resource];
+        }
+
+        pass->culled = !alive;
+        if (!alive) {
+            graph->culledCount++;
+            LOG_DEBUG("render graph: culled pass %s", pass->name);
+            continue;
+        }
+
+        // earlier writers of anything this pass touches are needed, partial writes keep older contents
+        for (uint32_t i = 0; i < pass->useCount; i++)
+        {
+            needed[pass->uses[i].resource] = VK_TRUE;
+        }
+    }
+}
+
+static void computeLifetimes(RenderGraph* graph)
+{
+    for (uint32_t i = 0; i < graph->transientCount; i++)
+    {
+        graph->transients[i].firstPass = UINT32_MAX;
+        graph->transients[i].lastPass = UINT32_MAX;
+    }
+
+    for (uint32_t p = 0; p < graph->passCount; p++)
+    {
+        GraphPass* pass = &graph->passes[p];
+        if (pass->culled) {
+            continue;
+        }
+
+        for (uint32_t i = 0; i < pass->useCount; i++)
+        {
+            uint32_t index = graph->resources[pass->uses[i].resource].transient;
+            if (index == UINT32_MAX) {
+                continue;
+            }
+
+            GraphTransient* transient = &graph->transients[index];
+            if (transient->firstPass == UINT32_MAX) {
+                transient->firstPass = p;
+            }
+            transient->lastPass = p;
+        }
+    }
+}
+
+static void destroyTransients(State* state, RenderGraph* graph)
+{
+    for (uint32_t i = 0; i < graph->builtTransientCount; i++)
+    {
+        GraphTransient* transient = &graph->transients[i];
+        if (transient->image == VK_NULL_HANDLE) {
+            continue;
+        }
+
+        vkDestroyImageView(state->device, transient->view, state->allocator);
+        vkDestroyImage(state->device, transient->image, state->allocator);
+        transient->view = VK_NULL_HANDLE;
+        transient->image = VK_NULL_HANDLE;
+    }
+
+    for (uint32_t i = 0; i < graph->slotCount; i++)
+    {
+        vkFreeMemory(state->device, graph->slots[i].memory, state->allocator);
+    }
+
+    graph->slotCount = 0;
+    graph->builtTransientCount = 0;
+}
+
+// images are placed in order of first use, an image reuses the first slot whose last user finished before it starts
+static uint32_t assignSlot(RenderGraph* graph, GraphTransient* transient)
+{
+    for (uint32_t i = 0; i < graph->slotCount; i++)
+    {
+        GraphSlot* slot = &graph->slots[i];
+        if (slot->lastPass < transient->firstPass && (slot->memoryTypeBits & transient->requirements.memoryTypeBits)) {
+            return i;
+        }
+    }
+
+    GraphSlot* slot = &graph->slots[graph->slotCount];
+    memset(slot, 0, sizeof(*slot));
+    slot->memoryTypeBits = UINT32_MAX;
+    slot->lazy = VK_TRUE;
+
+    return graph->slotCount++;
+}
+
+static void buildTransients(State* state, RenderGraph* graph)
+{
+    // images of frames in flight may still use the old memory, happens on resize only
+    vkDeviceWaitIdle(state->device);
+    destroyTransients(state, graph);
+
+    for (uint32_t i = 0; i < graph->transientCount; i++)
+    {
+        GraphTransient* transient = &graph->transients[i];
+        if (transient->firstPass == UINT32_MAX) {
+            continue;
+        }
+
+        VkImageCreateInfo crtInf = {
+            .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+            .pNext = NULL,
+            .flags = 0,
+
+            .imageType = VK_IMAGE_TYPE_2D,
+            .format = transient->format,
+            .extent = {transient->extent.width, transient->extent.height, 1},
+            .mipLevels = 1,
+            .arrayLayers = 1,
+            .samples = VK_SAMPLE_COUNT_1_BIT,
+            .tiling = VK_IMAGE_TILING_OPTIMAL,
+
+            .usage = transient->usage,
+            .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+            .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        };
+
+        assertVk(vkCreateImage(state->device, &crtInf, state->allocator, &transient->image), "failed to create transient image", "created transient image");
+        vkGetImageMemoryRequirements(state->device, transient->image, &transient->requirements);
+    }
+
+    // sorted by first use without moving the declarations, they are compared by index next frame
+    uint32_t order[GRAPH_MAX_RESOURCES];
+    uint32_t orderCount = 0;
+    for (uint32_t i = 0; i < graph->transientCount; i++)
+    {
+        if (graph->transients[i].firstPass == UINT32_MAX) {
+            continue;
+        }
+
+        uint32_t j = orderCount++;
+        for (; j > 0 && graph->transients[order[j - 1]].firstPass > graph->transients[i].firstPass; j--)
+        {
+            order[j] = order[j - 1];
+        }
+        order[j] = i;
+    }
+
+    VkDeviceSize requested = 0;
+    for (uint32_t i = 0; i < orderCount; i++)
+    {
+        GraphTransient* transient = &graph->transients[order[i]];
+
+        transient->slot = assignSlot(graph, transient);
+        GraphSlot* slot = &graph->slots[transient->slot];
+
+        slot->size = transient->requirements.size > slot->size ? transient->requirements.size : slot->size;
+        slot->alignment = transient->requirements.alignment > slot->alignment ? transient->requirements.alignment : slot->alignment;
+        slot->memoryTypeBits &= transient->requirements.memoryTypeBits;
+        slot->lastPass = transient->lastPass;
+        slot->lazy &= (transient->usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT) != 0;
+
+        requested += transient->requirements.size;
+    }
+
+    VkDeviceSize allocated = 0;
+    for (uint32_t i = 0; i < graph->slotCount; i++)
+    {
+        GraphSlot* slot = &graph->slots[i];
+
+        // lazily allocated memory is only committed when tile memory spills, fall back to plain device local
+        uint32_t memoryTypeIndex;
+        if (!slot->lazy || !tryFindMemoryType(state, slot->memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT, &memoryTypeIndex)) {
+            memoryTypeIndex = findMemoryType(state, slot->memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        }
+
+        VkMemoryAllocateInfo allocInf = {
+            .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+            .pNext = NULL,
+            .allocationSize = slot->size,
+            .memoryTypeIndex = memoryTypeIndex,
+        };
+
+        assertVk(vkAllocateMemory(state->device, &allocInf, state->allocator, &slot->memory), "failed to allocate transient memory", "allocated transient memory");
+        allocated += slot->size;
+    }
+
+    for (uint32_t i = 0; i < orderCount; i++)
+    {
+        GraphTransient* transient = &graph->transients[order[i]];
+
+        // every image of a slot starts at offset 0, the slot is as large and aligned as its largest image
+        vkBindImageMemory(state->device, transient->image, graph->slots[transient->slot].memory, 0);
+
+        VkImageViewCreateInfo viewCrtInf = {
+            .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+            .pNext = NULL,
+            .flags = 0,
+
+            .image = transient->image,
+            .viewType = VK_IMAGE_VIEW_TYPE_2D,
+            .format = transient->format,
+
+            .components.a = VK_COMPONENT_SWIZZLE_IDENTITY,
+            .components.r = VK_COMPONENT_SWIZZLE_IDENTITY,
+            .components.g = VK_COMPONENT_SWIZZLE_IDENTITY,
+            .components.b = VK_COMPONENT_SWIZZLE_IDENTITY,
+
+            .subresourceRange.aspectMask = transient->aspect,
+            .subresourceRange.baseArrayLayer = 0,
+            .subresourceRange.baseMipLevel = 0,
+            .subresourceRange.layerCount = 1,
+            .subresourceRange.levelCount = 1,
+        };
+
+        assertVk(vkCreateImageView(state->device, &viewCrtInf, state->allocator, &transient->view), "failed to create transient image view", "created transient image view");
+    }
+
+    graph->builtTransientCount = graph->transientCount;
+    graph->transientsDirty = VK_FALSE;
+
+    LOG_DEBUG("render graph: %u transient images in %u slots, %llu bytes instead of %llu", orderCount, graph->slotCount,
+        (unsigned long long) allocated, (unsigned long long) requested);
+}
+
+static VkImageMemoryBarrier2 imageBarrier(GraphResource* resource, VkImage image, VkImageLayout oldLayout,
+    VkPipelineStageFlags2 srcStage, VkAccessFlags2 srcAccess, const GraphAccessInfo* dst)
+{
+    return (VkImageMemoryBarrier2) {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+        .pNext = NULL,
+
+        .srcStageMask = srcStage,
+        .srcAccessMask = srcAccess,
+        .dstStageMask = dst->stage,
+        .dstAccessMask = dst->access,
+
+        .oldLayout = oldLayout,
+        .newLayout = dst->layout,
+
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+
+        .image = image,
+        .subresourceRange = {resource->aspect, 0, 1, 0, 1},
+    };
+}
+
+// tracks hazards of one resource, returns VK_TRUE and fills barrier when the access must wait for earlier ones
+static VkBool32 trackAccess(RenderGraph* graph, uint32_t index, GraphAccess access, VkImageMemoryBarrier2* barrier)
+{
+    GraphResource* resource = &graph->resources[index];
+    const GraphAccessInfo* dst = &accessInfos[access];
+    VkImage image = graphImage(graph, index);
+    VkBool32 emit = VK_FALSE;
+
+    if (!resource->used) {
+        // contents are undefined at first use
+        if (resource->imported) {
+            // waits on the stage of first use, semaphores guarding the image are waited on at the same stage
+            *barrier = imageBarrier(resource, image, VK_IMAGE_LAYOUT_UNDEFINED, dst->stage, VK_ACCESS_2_NONE, dst);
+        }
+        else
+        {
+            // memory was used by an aliased image before, possibly in the previous frame
+            GraphSlot* slot = &graph->slots[graph->transients[resource->transient].slot];
+            *barrier = imageBarrier(resource, image, VK_IMAGE_LAYOUT_UNDEFINED, slot->stages, slot->writeAccess, dst);
+        }
+
+        resource->firstStage = dst->stage;
+        resource->visibleStages = dst->stage;
+        resource->visibleAccess = dst->access;
+        emit = VK_TRUE;
+    }
+    else if (resource->layout != dst->layout || dst->write) {
+        // layout transitions and writes wait for every earlier read and write
+        VkPipelineStageFlags2 srcStage = resource->writeStage | resource->readStages;
+        if (resource->layout != dst->layout || srcStage != VK_PIPELINE_STAGE_2_NONE) {
+            *barrier = imageBarrier(resource, image, resource->layout, srcStage, resource->writeAccess, dst);
+            resource->visibleStages = dst->stage;
+            resource->visibleAccess = dst->access;
+            emit = VK_TRUE;
+        }
+    }
+    else if (resource->writeAccess != VK_ACCESS_2_NONE &&
+        ((dst->stage & ~resource->visibleStages) || (dst->access & ~resource->visibleAccess))) {
+        // read of a write not yet made visible to this stage, earlier readers do not need to finish
+        *barrier = imageBarrier(resource, image, resource->layout, resource->writeStage, resource->writeAccess, dst);
+        resource->visibleStages |= dst->stage;
+        resource->visibleAccess |= dst->access;
+        emit = VK_TRUE;
+    }
+
+    if (!resource->used && resource->imported) {
+        // imported images with known contents start from their initial access, nothing waits for the semaphore stage
+        const GraphAccessInfo* initial = &accessInfos[resource->initialAccess];
+        if (resource->initialAccess != GRAPH_ACCESS_NONE) {
+            barrier->oldLayout = initial->layout;
+            barrier->srcStageMask = initial->stage;
+            barrier->srcAccessMask = writeAccess(initial);
+            emit = initial->layout != dst->layout || initial->write || dst->write;
+        }
+    }
+
+    resource->used = VK_TRUE;
+    resource->layout = dst->layout;
+
+    if (dst->write) {
+        resource->writeStage = dst->stage;
+        resource->writeAccess = writeAccess(dst);
+        resource->readStages = VK_PIPELINE_STAGE_2_NONE;
+    }
+    else
+    {
+        resource->readStages |= dst->stage;
+    }
+
+    if (!resource->imported) {
+        GraphSlot* slot = &graph->slots[graph->transients[resource->transient].slot];
+        slot->stages = resource->writeStage | resource->readStages;
+        slot->writeAccess = resource->writeAccess;
+    }
+
+    return emit;
+}
+
+void graphCompile(State* state, RenderGraph* graph)
+{
+    cullPasses(graph);
+
+    // lifetimes of the last build are compared before they are overwritten
+    uint32_t firstPasses[GRAPH_MAX_RESOURCES];
+    uint32_t lastPasses[GRAPH_MAX_RESOURCES];
+    for (uint32_t i = 0; i < graph->transientCount; i++)
+    {
+        firstPasses[i] = graph->transients[i].firstPass;
+        lastPasses[i] = graph->transients[i].lastPass;
+    }
+
+    computeLifetimes(graph);
+
+    // lifetimes decide the slots, changed lifetimes rebuild like changed descriptions
+    VkBool32 changed = graph->transientsDirty || graph->builtTransientCount != graph->transientCount;
+    for (uint32_t i = 0; i < graph->transientCount && !changed; i++)
+    {
+        changed = firstPasses[i] != graph->transients[i].firstPass || lastPasses[i] != graph->transients[i].lastPass;
+    }
+
+    if (changed) {
+        buildTransients(state, graph);
+    }
+
+    graph->barrierCount = 0;
+
+    for (uint32_t p = 0; p < graph->passCount; p++)
+    {
+        GraphPass* pass = &graph->passes[p];
+        pass->barrierCount = 0;
+
+        if (pass->culled) {
+            continue;
+        }
+
+        for (uint32_t i = 0; i < pass->useCount; i++)
+        {
+            if (trackAccess(graph, pass->uses[i].resource, pass->uses[i].access, &pass->barriers[pass->barrierCount])) {
+                pass->barrierCount++;
+            }
+        }
+
+        graph->barrierCount += pass->barrierCount;
+    }
+
+    for (uint32_t i = 0; i < graph->resourceCount; i++)
+    {
+        GraphResource* resource = &graph->resources[i];
+        if (!resource->imported || resource->finalAccess == GRAPH_ACCESS_NONE) {
+            continue;
+        }
+
+        // image not touched by any pass keeps its initial access
+        if (!resource->used) {
+            if (resource->initialAccess == resource->finalAccess) {
+                continue;
+            }
+            resource->used = VK_TRUE;
+            resource->layout = accessInfos[resource->initialAccess].layout;
+            resource->writeStage = accessInfos[resource->initialAccess].stage;
+            resource->writeAccess = writeAccess(&accessInfos[resource->initialAccess]);
+        }
+
+        if (trackAccess(graph, i, resource->finalAccess, &graph->finalBarriers[graph->finalBarrierCount])) {
+            graph->finalBarrierCount++;
+        }
+    }
+
+    graph->barrierCount += graph->finalBarrierCount;
+}
+
+static void recordBarriers(VkCommandBuffer commandBuffer, const VkImageMemoryBarrier2* barriers, uint32_t count)
+{
+    if (count == 0) {
+        return;
+    }
+
+    VkDependencyInfo dependencyInf = {
+        .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+        .pNext = NULL,
+        .dependencyFlags = 0,
+
+        .imageMemoryBarrierCount = count,
+        .pImageMemoryBarriers = barriers,
+    };
+
+    vkCmdPipelineBarrier2(commandBuffer, &dependencyInf);
+}
+
+void graphExecute(State* state, RenderGraph* graph, VkCommandBuffer commandBuffer)
+{
+    for (uint32_t p = 0; p < graph->passCount; p++)
+    {
+        GraphPass* pass = &graph->passes[p];
+        if (pass->culled) {
+            continue;
+        }
+
+        // all uses of a pass wait in one call
+        recordBarriers(commandBuffer, pass->barriers, pass->barrierCount);
+        pass->callback(commandBuffer, state, pass->userData);
+    }
+
+    recordBarriers(commandBuffer, graph->finalBarriers, graph->finalBarrierCount);
+}
+
+VkImage graphImage(RenderGraph* graph, uint32_t resource)
+{
+    GraphResource* graphResource = &graph->resources[resource];
+    return graphResource->imported ? graphResource->image : graph->transients[graphResource->transient].image;
+}
+
+VkImageView graphImageView(RenderGraph* graph, uint32_t resource)
+{
+    GraphResource* graphResource = &graph->resources[resource];
+    return graphResource->imported ? graphResource->view : graph->transients[graphResource->transient].view;
+}
+
+VkPipelineStageFlags2 graphFirstStage(RenderGraph* graph, uint32_t resource)
+{
+    return graph->resources[resource].firstStage;
+}
+
+VkPipelineStageFlags2 graphAccessStage(GraphAccess access)
+{
+    return accessInfos[access].stage;
+}
+
+void graphSubpassDependency(VkSubpassDependency* dependency, GraphAccess before, GraphAccess after)
+{
+    const GraphAccessInfo* src = &accessInfos[before];
+    const GraphAccessInfo* dst = &accessInfos[after];
+
+    // undefined contents chain with the semaphore wait at the stage of first use, like first use in the graph
+    dependency->srcStageMask |= (VkPipelineStageFlags) (before == GRAPH_ACCESS_NONE ? dst->stage : src->stage);
+    dependency->srcAccessMask |= (VkAccessFlags) writeAccess(src);
+    dependency->dstStageMask |= (VkPipelineStageFlags) dst->stage;
+    dependency->dstAccessMask |= (VkAccessFlags) dst->access;
+}
+
+void destroyRenderGraph(State* state, RenderGraph* graph)
+{
+    destroyTransients(state, graph);
+}
@@ -0,0 +1,232 @@
+#ifndef __GRAPH_H__
+#define __GRAPH_H__
+
+#include "common.h"
+
+#include <stdint.h>
+#include <vulkan/vulkan_core.h>
+
+// limits of one frame's render graph, passes and resources are declared again every frame
+#define GRAPH_MAX_PASSES 32
+#define GRAPH_MAX_RESOURCES 32
+#define GRAPH_MAX_PASS_USES 8
+
+#define GRAPH_INVALID_RESOURCE UINT32_MAX
+
+// ways a pass uses an image, each maps to one stage, access and layout
+typedef enum GraphAccess
+{
+    // contents are not needed, only valid as initial access of imported images
+    GRAPH_ACCESS_NONE,
+    GRAPH_ACCESS_COLOR_ATTACHMENT_WRITE,
+    GRAPH_ACCESS_DEPTH_ATTACHMENT_WRITE,
+    GRAPH_ACCESS_SAMPLED_FRAGMENT,
+    GRAPH_ACCESS_SAMPLED_COMPUTE,
+    GRAPH_ACCESS_STORAGE_WRITE_COMPUTE,
+    GRAPH_ACCESS_TRANSFER_READ,
+    GRAPH_ACCESS_TRANSFER_WRITE,
+    // transfer source in GENERAL layout, images shared with other processes stay in it
+    GRAPH_ACCESS_TRANSFER_READ_GENERAL,
+    // only valid as final access of imported images
+    GRAPH_ACCESS_PRESENT,
+    GRAPH_ACCESS_COUNT,
+} GraphAccess;
+
+// records the commands of a pass, barriers for its declared uses are already recorded
+typedef void (*GraphPassCallback)(VkCommandBuffer commandBuffer, State* state, void* userData);
+
+typedef struct GraphUse
+{
+    uint32_t resource;
+    GraphAccess access;
+} GraphUse;
+
+typedef struct GraphPass
+{
+    const char* name;
+    GraphPassCallback callback;
+    void* userData;
+
+    GraphUse uses[GRAPH_MAX_PASS_USES];
+    uint32_t useCount;
+    // work outside the graph (host readback, sockets), never culled
+    VkBool32 sideEffects;
+    VkBool32 culled;
+
+    // computed by graphCompile, recorded as one barrier call before the callback
+    VkImageMemoryBarrier2 barriers[GRAPH_MAX_PASS_USES];
+    uint32_t barrierCount;
+} GraphPass;
+
+typedef struct GraphResource
+{
+    const char* name;
+    VkImageAspectFlags aspect;
+
+    // imported images live outside the graph, transient images are created and aliased by it
+    VkBool32 imported;
+    VkImage image;
+    VkImageView view;
+    GraphAccess initialAccess;
+    // GRAPH_ACCESS_NONE -> nothing reads the image after the graph
+    GraphAccess finalAccess;
+
+    // index into RenderGraph.transients for transient images
+    uint32_t transient;
+
+    // stage of first use, semaphores guarding imported images wait on it
+    VkPipelineStageFlags2 firstStage;
+
+    // hazard tracking while barriers are computed
+    VkBool32 used;
+    VkImageLayout layout;
+    VkPipelineStageFlags2 writeStage;
+    VkAccessFlags2 writeAccess;
+    VkPipelineStageFlags2 readStages;
+    VkPipelineStageFlags2 visibleStages;
+    VkAccessFlags2 visibleAccess;
+} GraphResource;
+
+// description and backing of a transient image, kept between frames and rebuilt only when descriptions change
+typedef struct GraphTransient
+{
+    VkFormat format;
+    VkExtent2D extent;
+    VkImageUsageFlags usage;
+    VkImageAspectFlags aspect;
+    // first and last pass using the image, UINT32_MAX when every user was culled
+    uint32_t firstPass;
+    uint32_t lastPass;
+
+    VkImage image;
+    VkImageView view;
+    VkMemoryRequirements requirements;
+    uint32_t slot;
+} GraphTransient;
+
+// memory shared by transient images whose lifetimes do not overlap
+typedef struct GraphSlot
+{
+    VkDeviceMemory memory;
+    VkDeviceSize size;
+    VkDeviceSize alignment;
+    uint32_t memoryTypeBits;
+    uint32_t lastPass;
+    // every image is a transient attachment, lazily allocated memory is preferred
+    VkBool32 lazy;
+
+    // last use of the memory by any image aliasing it, carried into the next frame
+    VkPipelineStageFlags2 stages;
+    VkAccessFlags2 writeAccess;
+} GraphSlot;
+
+// passes declare the images they use, barriers, layout transitions and transient memory follow from the declarations
+typedef struct RenderGraph
+{
+    GraphPass passes[GRAPH_MAX_PASSES];
+    uint32_t passCount;
+    GraphResource resources[GRAPH_MAX_RESOURCES];
+    uint32_t resourceCount;
+
+    // final transitions of imported images, recorded after the last pass
+    VkImageMemoryBarrier2 finalBarriers[GRAPH_MAX_RESOURCES];
+    uint32_t finalBarrierCount;
+
+    GraphTransient transients[GRAPH_MAX_RESOURCES];
+    uint32_t transientCount;
+    // transients with physical images, compared against the declarations of every frame
+    uint32_t builtTransientCount;
+    // a declaration differs from the built image
+    VkBool32 transientsDirty;
+    GraphSlot slots[GRAPH_MAX_RESOURCES];
+    uint32_t slotCount;
+
+    // statistics of the last compile
+    uint32_t culledCount;
+    uint32_t barrierCount;
+} RenderGraph;
+
+/**
+ * @brief forgets passes and resources of the previous frame, transient images are kept
+ */
+void graphBegin(RenderGraph* graph);
+
+/**
+ * @brief adds image owned outside the graph
+ * @param initialAccess last use before the graph, GRAPH_ACCESS_NONE when contents are not needed
+ *  (first barrier then waits on the stage of first use, which semaphore waits must use as well)
+ * @param finalAccess use after the graph the image is transitioned for, GRAPH_ACCESS_NONE when unused
+ * @return resource index
+ */
+uint32_t graphImportImage(RenderGraph* graph, const char* name, VkImage image, VkImageView view,
+    VkImageAspectFlags aspect, GraphAccess initialAccess, GraphAccess finalAccess);
+
+/**
+ * @brief adds image living only during the graph, its memory is shared with transients used by other passes
+ * @details contents are undefined at first use, images are recreated only when a frame declares different ones
+ * @return resource index
+ */
+uint32_t graphCreateImage(RenderGraph* graph, const char* name, VkFormat format, VkExtent2D extent,
+    VkImageUsageFlags usage, VkImageAspectFlags aspect);
+
+/**
+ * @brief appends pass, passes execute in the order they were added
+ * @return pass index
+ */
+uint32_t graphAddPass(RenderGraph* graph, const char* name, GraphPassCallback callback, void* userData);
+
+/**
+ * @brief declares use of resource by pass, writes are implied by the access
+ * Requires:
+    - resource used at most once per pass
+ */
+void graphPassUse(RenderGraph* graph, uint32_t pass, uint32_t resource, GraphAccess access);
+
+/**
+ * @brief keeps pass even when none of its images is used afterwards, for passes writing buffers or talking to other processes
+ */
+void graphPassSideEffects(RenderGraph* graph, uint32_t pass);
+
+/**
+ * @brief culls passes whose images nobody uses, places transient images into shared memory and computes barriers
+ * @details rebuilding transient images waits for the device, this only happens when declarations change
+ */
+void graphCompile(State* state, RenderGraph* graph);
+
+/**
+ * @brief records barriers and callbacks of remaining passes followed by final transitions of imported images
+ * Requires:
+    - graphCompile called after the last declaration
+ */
+void graphExecute(State* state, RenderGraph* graph, VkCommandBuffer commandBuffer);
+
+/**
+ * @brief image of resource, transient images exist after graphCompile
+ */
+VkImage graphImage(RenderGraph* graph, uint32_t resource);
+VkImageView graphImageView(RenderGraph* graph, uint32_t resource);
+
+/**
+ * @brief stage of first use of resource in the compiled graph, 0 when the resource is unused
+ */
+VkPipelineStageFlags2 graphFirstStage(RenderGraph* graph, uint32_t resource);
+
+/**
+ * @brief stage the access happens in
+ */
+VkPipelineStageFlags2 graphAccessStage(GraphAccess access);
+
+/**
+ * @brief adds masks ordering access after access before to render pass dependency
+ * @details same stage and access masks the graph uses for its barriers, no synchronization2 bits are used
+ */
+void graphSubpassDependency(VkSubpassDependency* dependency, GraphAccess before, GraphAccess after);
+
+/**
+ * @brief destroys transient images and their memory
+ * Requires:
+    - device idle
+ */
+void destroyRenderGraph(State* state, RenderGraph* graph);
+
+#endif // __GRAPH_H__
@@ -10,12 +10,28 @@
 #include <vulkan/vulkan_core.h>
 
 #include "utils.h"
+#include "batch.h"
+#include "encoder.h"
+#include "uniform.h"
+#include "bindless.h"
+#include "texture.h"
+#include "instance.h"
+#include "mesh.h"
+#include "visibility.h"
+#include "capture.h"
+#include "export.h"
+#include "graph.h"
+#include "pipeline.h"
+#include "postprocess.h"
+#include "latency.h"
+
+#include <cglm/cglm.h>
 
 Vertex vertices[] = {
-    {{-0.5f, -0.5f}, {1.0f, 0.0f, 0.0f}},
-    {{0.5f, -0.5f}, {0.0f, 1.0f, 0.0f}},
-    {{0.5f, 0.5f}, {0.0f, 0.0f, 1.0f}},
-    {{-0.5f, 0.5f}, {1.0f, 1.0f, 1.0f}}
+    {{-0.5f, -0.5f, 0.5f}, {1.0f, 0.0f, 0.0f}},
+    {{0.5f, -0.5f, 0.5f}, {0.0f, 1.0f, 0.0f}},
+    {{0.5f, 0.5f, 0.5f}, {0.0f, 0.0f, 1.0f}},
+    {{-0.5f, 0.5f, 0.5f}, {1.0f, 1.0f, 1.0f}}
 
 };
 
@@ -23,42 +39,41 @@ uint16_t indices[] = {
     0, 1, 2, 2, 3, 0
 };
 
-VkVertexInputBindingDescription bindingDescription = {
-    .binding = 0,
-    .stride = sizeof(Vertex),
-    .inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
-};
-
-VkVertexInputAttributeDescription attributeDescriptions[] = {
-    {
-        .location = 0,
-        .binding = 0,
-        .format = VK_FORMAT_R32G32_SFLOAT,
-        .offset = offsetof(Vertex, pos), 
-    },
-    {
-        .location = 1,
-        .binding = 0,
-        .format = VK_FORMAT_R32G32B32_SFLOAT,
-        .offset = offsetof(Vertex, color), 
-    }
+Draw draws[] = {
+    {.indexCount = 6, .firstIndex = 0, .vertexOffset = 0, .instanceCount = 1, .firstInstance = 0, .offset = {0.0f, 0.0f}, .textureIndex = BINDLESS_INVALID_INDEX, .materialIndex = BINDLESS_INVALID_INDEX, .depth = 0.5f, .pipelineVariant = PIPELINE_INVALID_VARIANT},
 };
 
 void init(State* state)
 {
     
-    // Init GLFW
-    assert_my(glfwInit(), "failed to intialize glfw", "initialized glfw");
+    state->targetCount = state->windowCount + state->headlessCount;
+    assert_my(state->targetCount > 0 && state->targetCount <= MAX_RENDER_TARGETS, "between 1 and MAX_RENDER_TARGETS render targets are supported", "");
 
-    // Create Window
-    createWindow(state);
+    // headless runs must work without a display, GLFW is not even initialized
+    if (state->windowCount > 0) {
+        // Init GLFW
+        assert_my(glfwInit(), "failed to intialize glfw", "initialized glfw");
+    }
+
+    // Create Windows
+    for (uint32_t i = 0; i < state->windowCount; i++)
+    {
+        createWindow(state, &state->targets[i], i);
+    }
     
+    // loader or null backend provides every Vulkan entry point
+    assert_my(dispatchInit(state->nullBackend ? DISPATCH_BACKEND_NULL : DISPATCH_BACKEND_VULKAN) == 0, "failed to load Vulkan", "loaded Vulkan");
+
     // Init vulkan instance
     assertVk(initVulkan(state, &state->instance), "failed to create instance", "Created instance");
+    dispatchLoadInstance(state->instance);
 
-    // Create Surface
-    VkResult rslt = glfwCreateWindowSurface(state->instance, state->window, state->allocator, &state->surface);
-    assertVk(rslt, "Failed to create window surface", "Created window surface");
+    // Create Surfaces
+    for (uint32_t i = 0; i < state->windowCount; i++)
+    {
+        VkResult rslt = glfwCreateWindowSurface(state->instance, state->targets[i].window, state->allocator, &state->targets[i].surface);
+        assertVk(rslt, "Failed to create window surface", "Created window surface");
+    }
 
     // Select Physical Device
     assertVk( selectPhysicalDevice(state, &state->physicalDevice), "Failed to select physical device", "Selected physical device" );
@@ -68,9 +83,18 @@ void init(State* state)
 
     // Create Logical Device
     createLogicalDevice(state);
+    dispatchLoadDevice(state->device);
 
     // Get Graphics queue
     vkGetDeviceQueue(state->device, state->queueFamilyIndex, 0, &state->graphicsQueue);
+    vkGetDeviceQueue(state->device, state->presentFamilyIndex, 0, &state->presentQueue);
+    if (state->asyncCompute) {
+        vkGetDeviceQueue(state->device, state->computeFamilyIndex, state->computeQueueIndex, &state->computeQueue);
+    }
+    else
+    {
+        state->computeQueue = state->graphicsQueue;
+    }
 
     // Create swapchain
     // Terms: 
@@ -82,26 +106,89 @@ void init(State* state)
     // VK_KHR_surface Instance extension (VK_KHR_SURFACE_EXTENSION_NAME)
     // VK_KHR_swapchain Device extension (VK_KHR_SWAPCHAIN_EXTENSION_NAME)
     
-    // set requested Image count will be overridden if invalid 
-    state->swapchainImageCount = REQUESTED_SWAPCHAIN_IMAGE_COUNT;
-    // set default extent 
-    state->extent.width = WINDOW_WIDTH;
-    state->extent.height = WINDOW_HEIGHT;
-
-    createSwapchain(state);
-    // retrieve swapchain images for vkImageViews
-    retrieveSwapchainImages(state);
-    createImageViews(state);
+    // one pipeline draws into every target, so all of them share the first window's format
+    if (state->windowCount > 0) {
+        state->swapchainFormat = selectSwapchainFormat(state, state->targets[0].surface);
+        state->presentLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    }
+    else
+    {
+        state->swapchainFormat = (VkSurfaceFormatKHR) {VK_FORMAT_B8G8R8A8_SRGB, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR};
+        state->presentLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    }
+
+    if (state->useDepth) {
+        state->depthFormat = findDepthFormat(state);
+    }
     
-    createRenderPass(state);
-    createGraphicsPipeline(state);
+    // dynamic rendering needs neither render pass nor framebuffers
+    if (!state->useDynamicRendering) {
+        createRenderPass(state);
+    }
+
+    for (uint32_t i = 0; i < state->targetCount; i++)
+    {
+        RenderTarget* target = &state->targets[i];
+
+        // set requested Image count will be overridden if invalid 
+        target->swapchainImageCount = REQUESTED_SWAPCHAIN_IMAGE_COUNT;
+        // set default extent 
+        target->extent.width = WINDOW_WIDTH;
+        target->extent.height = WINDOW_HEIGHT;
 
-    createFramebuffers(state);
+        createRenderTarget(state, target);
+    }
+
+    // pipeline layout references the uniform ring's and bindless descriptor set layouts
+    createUniformRing(state);
+    createBindlessTable(state);
+    glm_mat4_identity(state->viewTransform);
+
+    createGraphicsPipeline(state);
 
     createCommandPool(state);
+    createTextureStreamer(state);
+
+    // the quad goes into the mesh pool instead of its own vertex and index buffers
+    if (state->vertexPulling) {
+        createMeshPool(state, MESH_POOL_SIZE);
+        Mesh* quad = &state->meshes.meshes[meshPoolAdd(state, vertices, sizeof(vertices) / sizeof(vertices[0]), VERTEX_FORMAT_PACKED,
+            indices, sizeof(indices) / sizeof(indices[0]))];
+
+        draws[0].firstIndex = quad->firstIndex;
+        draws[0].vertexOffset = 0;
+        draws[0].vertexAddress = quad->vertexAddress;
+        draws[0].vertexFormat = quad->vertexFormat;
+    }
+    else
+    {
+        createVertexBuffer(state);
+        createIndexBuffer(state);
+    }
+
+    createInstanceStore(state, state->animatedInstanceCount > 0 ? state->animatedInstanceCount : 1);
 
-    createVertexBuffer(state);
-    createIndexBuffer(state);
+    if (state->hudQuads > 0) {
+        createBatcher(state);
+    }
+
+    state->draws = draws;
+    state->drawCount = sizeof(draws) / sizeof(draws[0]);
+    // the quad is drawn once per instance
+    draws[0].instanceCount = state->instances.count;
+
+    // bounds are indexed like the draws
+    createVisibility(state, state->drawCount);
+    createDrawQueue(state, state->drawCount);
+    vec3 instancesCenter;
+    vec3 instancesExtent;
+    instanceStoreBounds(&state->instances, instancesCenter, instancesExtent);
+    for (uint32_t i = 0; i < state->drawCount; i++)
+    {
+        // quad lies at z 0.5, the push constant offset moves the whole draw
+        vec3 center = {instancesCenter[0] + draws[i].offset[0], instancesCenter[1] + draws[i].offset[1], 0.5f};
+        visibilityAdd(&state->visibility, center, instancesExtent);
+    }
 
 
     allocateCommandBuffers(state);
@@ -109,7 +196,7 @@ void init(State* state)
     createSyncObject(state);    
 }
 
-void createWindow(State* state)
+void createWindow(State* state, RenderTarget* target, uint32_t index)
 {
     // Create Window
     // Set Window Hints
@@ -118,19 +205,87 @@ void createWindow(State* state)
     // no window resizing
     glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
 
-    state->window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "Vulkan Triangle", NULL, NULL);
-    assert_my(state->window, "failed to create window", "Created Window");
+    char title[64];
+    if (state->windowCount > 1) {
+        snprintf(title, sizeof(title), "Vulkan Triangle %u", index + 1);
+    }
+    else
+    {
+        snprintf(title, sizeof(title), "Vulkan Triangle");
+    }
+
+    target->window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, title, NULL, NULL);
+    assert_my(target->window, "failed to create window", "Created Window");
+
+    glfwSetWindowUserPointer(target->window, state);
+    glfwSetFramebufferSizeCallback(target->window, framebufferResizeCallback );
 
-    glfwSetWindowUserPointer(state->window, &state->frameBufferResized);
-    glfwSetFramebufferSizeCallback(state->window, framebufferResizeCallback );
+    // any input may change what is shown, on demand rendering draws a frame for it
+    glfwSetKeyCallback(target->window, keyCallback);
+    glfwSetMouseButtonCallback(target->window, mouseButtonCallback);
+    glfwSetCursorPosCallback(target->window, cursorPosCallback);
+    glfwSetScrollCallback(target->window, scrollCallback);
+    glfwSetWindowRefreshCallback(target->window, windowRefreshCallback);
 
 }
 
 void framebufferResizeCallback(GLFWwindow* window, int width, int height)
 {
-    VkBool32* framebufferResized = (VkBool32*) glfwGetWindowUserPointer(window);
+    State* state = (State*) glfwGetWindowUserPointer(window);
+
+    for (uint32_t i = 0; i < state->windowCount; i++)
+    {
+        if (state->targets[i].window == window) {
+            state->targets[i].frameBufferResized = VK_TRUE;
+        }
+    }
+
+    requestRedraw(state);
+}
+
+void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+    State* state = (State*) glfwGetWindowUserPointer(window);
+    latencyInput(state);
+    requestRedraw(state);
+}
 
-    *framebufferResized = VK_TRUE; 
+void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
+{
+    State* state = (State*) glfwGetWindowUserPointer(window);
+    latencyInput(state);
+    requestRedraw(state);
+}
+
+void cursorPosCallback(GLFWwindow* window, double x, double y)
+{
+    State* state = (State*) glfwGetWindowUserPointer(window);
+    latencyInput(state);
+    requestRedraw(state);
+}
+
+void scrollCallback(GLFWwindow* window, double x, double y)
+{
+    State* state = (State*) glfwGetWindowUserPointer(window);
+    latencyInput(state);
+    requestRedraw(state);
+}
+
+// window was uncovered or restored, its contents have to be drawn again
+void windowRefreshCallback(GLFWwindow* window)
+{
+    requestRedraw((State*) glfwGetWindowUserPointer(window));
+}
+
+void requestRedraw(State* state)
+{
+    // the tonemapped image of a frame is shown one frame later
+    state->redrawFrames = state->asyncCompute ? 2 : 1;
+}
+
+VkBool32 needsFrame(State* state)
+{
+    return !state->onDemand || state->redrawFrames > 0 || state->animatedInstanceCount > 0 || state->hudQuads > 0;
 }
 
 VkResult initVulkan(State* state, VkInstance* pInstance)
@@ -153,9 +308,9 @@ VkResult initVulkan(State* state, VkInstance* pInstance)
     // Loads all instance extensions required by glfw
 
     // glfw extension count
-    uint32_t glfwExtCnt;
+    uint32_t glfwExtCnt = 0;
 
-    const char** requiredExtensions = glfwGetRequiredInstanceExtensions(&glfwExtCnt); 
+    const char** requiredExtensions = state->windowCount > 0 ? glfwGetRequiredInstanceExtensions(&glfwExtCnt) : NULL; 
 
     VkInstanceCreateInfo crtInfo = {
 
@@ -197,6 +352,21 @@ VkResult selectPhysicalDevice(State* state, VkPhysicalDevice* physycalDevice)
     return rslt;
 }
 
+// headless runs present nothing, every family qualifies
+static VkBool32 familyPresents(State* state, uint32_t family)
+{
+    for (uint32_t i = 0; i < state->windowCount; i++)
+    {
+        VkBool32 supported = VK_FALSE;
+        vkGetPhysicalDeviceSurfaceSupportKHR(state->physicalDevice, family, state->targets[i].surface, &supported);
+        if (!supported) {
+            return VK_FALSE;
+        }
+    }
+
+    return VK_TRUE;
+}
+
 void pickQueueFamily(State* state)
 {
     uint32_t propCount;
@@ -208,49 +378,242 @@ void pickQueueFamily(State* state)
 
     assert_my(props,"failed to get queue families properties" , "queried queue family properties");
 
-    // picks first queue with grpahics bit
-    for (int i = 0; i<propCount; i++)
+    uint32_t graphics = UINT32_MAX;
+    uint32_t present = UINT32_MAX;
+    uint32_t compute = UINT32_MAX;
+
+    // graphics family which presents as well keeps swapchain images exclusive to one family
+    for (uint32_t i = 0; i < propCount; i++)
     {
-        if (props[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)
-        {
-            LOG("Selected queue family with index %d", i);
-            state->queueFamilyIndex = i;
+        if (!(props[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)) {
+            continue;
+        }
+
+        if (graphics == UINT32_MAX) {
+            graphics = i;
+        }
+
+        if (familyPresents(state, i)) {
+            graphics = i;
+            present = i;
+            break;
+        }
+    }
+
+    assert_my(graphics != UINT32_MAX, "device has no graphics queue family", "");
+
+    for (uint32_t i = 0; i < propCount && present == UINT32_MAX; i++)
+    {
+        if (familyPresents(state, i)) {
+            present = i;
+        }
+    }
+
+    assert_my(present != UINT32_MAX, "no queue family can present to every window", "");
+
+    // compute only families run independently of the graphics work on most hardware
+    for (uint32_t i = 0; i < propCount; i++)
+    {
+        if ((props[i].queueFlags & VK_QUEUE_COMPUTE_BIT) && !(props[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)) {
+            compute = i;
             break;
         }
     }
 
+    state->queueFamilyIndex = graphics;
+    state->presentFamilyIndex = present;
+    state->computeFamilyIndex = compute != UINT32_MAX ? compute : graphics;
+    // second queue of the graphics family can still overlap, a single queue only keeps the work ordered
+    state->computeQueueIndex = compute == UINT32_MAX && props[graphics].queueCount > 1 ? 1 : 0;
+
+    LOG("queue families: graphics %u, present %u, compute %u (queue %u)", graphics, present, state->computeFamilyIndex, state->computeQueueIndex);
+
+    if (state->asyncCompute && compute == UINT32_MAX && state->computeQueueIndex == 0) {
+        LOG_WARN("no separate compute queue, post processing shares the graphics queue");
+    }
+
     free(props);
     props = NULL;
 }
 
-void createLogicalDevice(State* state)
+// queues of the same family are created by one create info
+static void addQueueCreateInfo(VkDeviceQueueCreateInfo* infos, uint32_t* infoCount, uint32_t family, uint32_t queueCount, const float* priorities)
 {
-    float quePriority = 1;
-    VkDeviceQueueCreateInfo queCrtInfo = {
+    for (uint32_t i = 0; i < *infoCount; i++)
+    {
+        if (infos[i].queueFamilyIndex == family) {
+            infos[i].queueCount = queueCount > infos[i].queueCount ? queueCount : infos[i].queueCount;
+            return;
+        }
+    }
+
+    infos[(*infoCount)++] = (VkDeviceQueueCreateInfo) {
         .sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
         .pNext = NULL,
         .flags = 0, 
-        .queueFamilyIndex = state->queueFamilyIndex,
-        .queueCount = 1,
-        .pQueuePriorities = &quePriority,
+        .queueFamilyIndex = family,
+        .queueCount = queueCount,
+        .pQueuePriorities = priorities,
     };
+}
+
+void createLogicalDevice(State* state)
+{
+    float quePriorities[2] = {1, 1};
+    VkDeviceQueueCreateInfo queCrtInfos[3];
+    uint32_t queCrtInfoCount = 0;
+
+    addQueueCreateInfo(queCrtInfos, &queCrtInfoCount, state->queueFamilyIndex, 1, quePriorities);
+    addQueueCreateInfo(queCrtInfos, &queCrtInfoCount, state->presentFamilyIndex, 1, quePriorities);
+    if (state->asyncCompute) {
+        addQueueCreateInfo(queCrtInfos, &queCrtInfoCount, state->computeFamilyIndex, state->computeQueueIndex + 1, quePriorities);
+    }
 
     VkPhysicalDeviceFeatures deviceFeatures = {0};
 
+    // query Vulkan 1.2 / 1.3 features before enabling them
+    VkPhysicalDeviceVulkan13Features supported13 = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES,
+        .pNext = NULL,
+    };
+
+    VkPhysicalDeviceVulkan12Features supported12 = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+        .pNext = &supported13,
+    };
+
+    VkPhysicalDeviceFeatures2 supported = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+        .pNext = &supported12,
+    };
+
+    vkGetPhysicalDeviceFeatures2(state->physicalDevice, &supported);
+
+    if (state->useDynamicRendering) {
+        assert_my(supported13.dynamicRendering && supported13.synchronization2,
+        "device does not support dynamicRendering and synchronization2", "device supports dynamic rendering");
+    }
+
+    // graphics and compute submissions of a frame are chained by timeline semaphores
+    if (state->asyncCompute) {
+        assert_my(supported12.timelineSemaphore, "device does not support timeline semaphores, async compute is not supported", "device supports timeline semaphores");
+    }
+
+    // mesh pool vertices are addressed by pointer from the vertex shader
+    if (state->vertexPulling) {
+        assert_my(supported12.bufferDeviceAddress, "device does not support buffer device address, vertex pulling is not supported", "device supports buffer device address");
+    }
+
+    // block compressed textures are used by the streamer when available
+    state->textureCompressionBC = supported.features.textureCompressionBC;
+    deviceFeatures.textureCompressionBC = supported.features.textureCompressionBC;
+
+    // bindless set -> runtime sized, partially bound arrays written while in use
+    assert_my(supported12.descriptorIndexing && supported12.runtimeDescriptorArray && supported12.descriptorBindingPartiallyBound &&
+        supported12.descriptorBindingSampledImageUpdateAfterBind && supported12.descriptorBindingStorageBufferUpdateAfterBind &&
+        supported12.descriptorBindingUpdateUnusedWhilePending,
+    "device does not support descriptor indexing", "device supports descriptor indexing");
+
+    VkPhysicalDeviceVulkan13Features features13 = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES,
+        .pNext = NULL,
+
+        .dynamicRendering = state->useDynamicRendering,
+        .synchronization2 = state->useDynamicRendering,
+    };
+
+    VkPhysicalDeviceVulkan12Features features12 = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+        // only chain 1.3 features when used so older devices keep working with the render pass path
+        .pNext = state->useDynamicRendering ? &features13 : NULL,
+
+        .descriptorIndexing = VK_TRUE,
+        .runtimeDescriptorArray = VK_TRUE,
+        .descriptorBindingPartiallyBound = VK_TRUE,
+        .descriptorBindingSampledImageUpdateAfterBind = VK_TRUE,
+        .descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE,
+        .descriptorBindingUpdateUnusedWhilePending = VK_TRUE,
+        .timelineSemaphore = state->asyncCompute,
+        .bufferDeviceAddress = state->vertexPulling,
+        // indices come from push constants so they are dynamically uniform, non uniform indexing only when available
+        .shaderSampledImageArrayNonUniformIndexing = supported12.shaderSampledImageArrayNonUniformIndexing,
+        .shaderStorageBufferArrayNonUniformIndexing = supported12.shaderStorageBufferArrayNonUniformIndexing,
+    };
+
+
+    // presentation times of the first window for the latency measurement
+    VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR,
+        .pNext = &features12,
+
+        .presentWait = VK_TRUE,
+    };
+
+    VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR,
+        .pNext = &presentWaitFeatures,
+
+        .presentId = VK_TRUE,
+    };
+
+    if (state->measureLatency) {
+        latencySelectMode(state);
+    }
+
+    const char* extensions[5];
+    uint32_t extensionCount = 0;
+
+    if (state->windowCount > 0) {
+        extensions[extensionCount++] = VK_KHR_SWAPCHAIN_EXTENSION_NAME;
+    }
+
+    // frame export shares image memory and completion through file descriptors
+    if (state->exportFrames) {
+        uint32_t availableCount;
+        vkEnumerateDeviceExtensionProperties(state->physicalDevice, NULL, &availableCount, NULL);
+        VkExtensionProperties* available = malloc(sizeof(VkExtensionProperties) * availableCount);
+        vkEnumerateDeviceExtensionProperties(state->physicalDevice, NULL, &availableCount, available);
+
+        VkBool32 memoryFd = VK_FALSE;
+        VkBool32 semaphoreFd = VK_FALSE;
+        for (uint32_t i = 0; i < availableCount; i++)
+        {
+            memoryFd |= strcmp(available[i].extensionName, VK_KHR_EXTERNAL_MEMORY_FD_EXTENSION_NAME) == 0;
+            semaphoreFd |= strcmp(available[i].extensionName, VK_KHR_EXTERNAL_SEMAPHORE_FD_EXTENSION_NAME) == 0;
+        }
+        free(available);
+
+        assert_my(memoryFd, "device can not export memory as fd, frame export is not supported", "device supports memory fd export");
+        extensions[extensionCount++] = VK_KHR_EXTERNAL_MEMORY_FD_EXTENSION_NAME;
+
+        // without sync files frames are announced after their fence signaled
+        state->frameExport.syncFd = semaphoreFd;
+        if (semaphoreFd) {
+            extensions[extensionCount++] = VK_KHR_EXTERNAL_SEMAPHORE_FD_EXTENSION_NAME;
+        }
+    }
+
+    if (state->latency.mode == LATENCY_MODE_PRESENT_WAIT) {
+        extensions[extensionCount++] = VK_KHR_PRESENT_ID_EXTENSION_NAME;
+        extensions[extensionCount++] = VK_KHR_PRESENT_WAIT_EXTENSION_NAME;
+    }
+    else if (state->latency.mode == LATENCY_MODE_DISPLAY_TIMING) {
+        extensions[extensionCount++] = VK_GOOGLE_DISPLAY_TIMING_EXTENSION_NAME;
+    }
 
     VkDeviceCreateInfo crtInf  = {
         .sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO, 
-        .pNext = NULL,
+        .pNext = state->latency.mode == LATENCY_MODE_PRESENT_WAIT ? (void*) &presentIdFeatures : (void*) &features12,
 
         .flags = 0,
 
-        .queueCreateInfoCount = 1, 
-        .pQueueCreateInfos = &queCrtInfo, 
+        .queueCreateInfoCount = queCrtInfoCount, 
+        .pQueueCreateInfos = queCrtInfos, 
 
         .pEnabledFeatures = &deviceFeatures,
         // Extensions
-        .enabledExtensionCount = 1,
-        .ppEnabledExtensionNames = (const char *[] ){VK_KHR_SWAPCHAIN_EXTENSION_NAME},
+        .enabledExtensionCount = extensionCount,
+        .ppEnabledExtensionNames = extensions,
         
         // Deprecated
         .enabledLayerCount = 0,
@@ -262,23 +625,49 @@ void createLogicalDevice(State* state)
 
 }
 
-void createSwapchain(State* state)
+// copies in and out of the images of the first target, everything else only renders
+static VkImageUsageFlags targetImageUsage(State* state, RenderTarget* target)
 {
+    // tonemapped frames are copied into every target
+    VkImageUsageFlags postProcessUsage = state->asyncCompute ? VK_IMAGE_USAGE_TRANSFER_DST_BIT : 0;
+
+    if (target != &state->targets[0]) {
+        return postProcessUsage;
+    }
+
+    return postProcessUsage | (state->captureFrames ? VK_IMAGE_USAGE_TRANSFER_SRC_BIT : 0) | (state->exportFrames ? VK_IMAGE_USAGE_TRANSFER_DST_BIT : 0);
+}
+
+void createSwapchain(State* state, RenderTarget* target)
+{
+    // one queue presents every window, usually the graphics queue
+    VkBool32 presentSupported;
+    vkGetPhysicalDeviceSurfaceSupportKHR(state->physicalDevice, state->presentFamilyIndex, target->surface, &presentSupported);
+    assert_my(presentSupported, "queue family can not present to window", "");
+
+    // images rendered by one family and presented by another are shared instead of transferred every frame
+    uint32_t families[2] = {state->queueFamilyIndex, state->presentFamilyIndex};
+    VkBool32 sharedImages = state->presentFamilyIndex != state->queueFamilyIndex;
+
     VkSurfaceCapabilitiesKHR surfCaps;
-    vkGetPhysicalDeviceSurfaceCapabilitiesKHR(state->physicalDevice, state->surface, &surfCaps);
+    vkGetPhysicalDeviceSurfaceCapabilitiesKHR(state->physicalDevice, target->surface, &surfCaps);
+
+    assert_my(surfCaps.minImageCount <= MAX_SWAPCHAIN_IMAGES, "surface needs more images than MAX_SWAPCHAIN_IMAGES", "");
 
     // if swapchain image count is invalid override it to minimal image count
-    state->swapchainImageCount = (state->swapchainImageCount > surfCaps.maxImageCount || state->swapchainImageCount < surfCaps.minImageCount )? surfCaps.minImageCount : state->swapchainImageCount ;
+    target->swapchainImageCount = (target->swapchainImageCount > surfCaps.maxImageCount || target->swapchainImageCount < surfCaps.minImageCount )? surfCaps.minImageCount : target->swapchainImageCount ;
 
-    state->swapchainFormat = selectSwapchainFormat(state);
+    VkSurfaceFormatKHR format = selectSwapchainFormat(state, target->surface);
+    assert_my(format.format == state->swapchainFormat.format && format.colorSpace == state->swapchainFormat.colorSpace,
+        "windows need the same surface format, they share one pipeline", "");
 
     if (surfCaps.currentExtent.width != UINT32_MAX) {
-        state->extent = surfCaps.currentExtent;
+        target->extent = surfCaps.currentExtent;
     }
     else
     {
         int width, height;
-        glfwGetFramebufferSize(state->window, &width, &height);
+        glfwGetFramebufferSize(target->window, &width, &height);
 
         VkExtent2D actualExtent = {
             (width),
@@ -291,32 +680,45 @@ void createSwapchain(State* state)
 
 
 
+    if (state->captureFrames && target == &state->targets[0]) {
+        assert_my(surfCaps.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT, "swapchain images can not be copied, capture is not supported", "");
+    }
+
+    // exported image is copied into the swapchain image instead of rendering into it
+    if (state->exportFrames && target == &state->targets[0]) {
+        assert_my(surfCaps.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT, "swapchain images can not be copied to, export is not supported", "");
+    }
+
+    if (state->asyncCompute) {
+        assert_my(surfCaps.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT, "swapchain images can not be copied to, async compute is not supported", "");
+    }
+
     VkSwapchainCreateInfoKHR swpchnCrtInf = {
         .sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR,
         .pNext = NULL,
         .flags = 0,
         
-        .surface = state->surface,
-        .minImageCount = state->swapchainImageCount,
+        .surface = target->surface,
+        .minImageCount = target->swapchainImageCount,
         
         .imageFormat = state->swapchainFormat.format,
         .imageColorSpace = state->swapchainFormat.colorSpace,
 
-        .imageExtent = state->extent,
+        .imageExtent = target->extent,
         
         // for for non sterescopic 3d app this will be 1
         .imageArrayLayers = 1,
         
         // imageUsage specifies how will be the image used 
         // image can be used to create a VkImageView suitable for use as a color or resolve attachment in a VkFramebuffer.
-        .imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+        .imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | targetImageUsage(state, target),
         
         // decides if more queue families will have access to this image
-        .imageSharingMode = VK_SHARING_MODE_EXCLUSIVE,
+        .imageSharingMode = sharedImages ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE,
         
-        // since imageSharingmode is exclusive this must be 1  
-        .queueFamilyIndexCount = 1,
-        .pQueueFamilyIndices = &state->queueFamilyIndex,
+        // ignored while imageSharingMode is exclusive
+        .queueFamilyIndexCount = sharedImages ? 2 : 1,
+        .pQueueFamilyIndices = families,
 
         .preTransform = surfCaps.currentTransform,
 
@@ -331,37 +733,78 @@ void createSwapchain(State* state)
     };
 
     assertVk(
-    vkCreateSwapchainKHR(state->device, &swpchnCrtInf, state->allocator, &state->swapchain)
+    vkCreateSwapchainKHR(state->device, &swpchnCrtInf, state->allocator, &target->swapchain)
     , "failed to create swapchain", "created swapchain");
 
 }
 
-void retrieveSwapchainImages(State* state)
+void retrieveSwapchainImages(State* state, RenderTarget* target)
 {
-    vkGetSwapchainImagesKHR(state->device, state->swapchain, &state->swapchainImageCount, NULL);
-    
-    state->swapchainImages = (VkImage*) realloc(state->swapchainImages, sizeof(VkImage)*state->swapchainImageCount);
+    vkGetSwapchainImagesKHR(state->device, target->swapchain, &target->swapchainImageCount, NULL);
+
+    // the driver may create more images than requested
+    assert_my(target->swapchainImageCount <= MAX_SWAPCHAIN_IMAGES, "swapchain has more images than MAX_SWAPCHAIN_IMAGES", "");
 
-    assertVk(vkGetSwapchainImagesKHR(state->device, state->swapchain, &state->swapchainImageCount, state->swapchainImages)
+    assertVk(vkGetSwapchainImagesKHR(state->device, target->swapchain, &target->swapchainImageCount, target->swapchainImages)
     , "failed to retrieve swapchain images", "retrieved swapchain images");
 
-    LOG("retrieved %u Images", state->swapchainImageCount);
+    LOG("retrieved %u Images", target->swapchainImageCount);
 }
 
-void createImageViews(State* state)
+void createHeadlessImages(State* state, RenderTarget* target)
 {
-    if (state->imageViews == NULL) {
-        state->imageViews = malloc(sizeof(VkImageView)* state->swapchainImageCount);
+    // image of a frame in flight is free again once its fence signaled, images are picked by frame index
+    target->swapchainImageCount = MAX_FRAMES_IN_FLIGHT;
+
+    for (uint32_t i = 0; i < target->swapchainImageCount; i++)
+    {
+        VkImageCreateInfo crtInf = {
+            .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+            .pNext = NULL,
+            .flags = 0,
+
+            .imageType = VK_IMAGE_TYPE_2D,
+            .format = state->swapchainFormat.format,
+            .extent = {target->extent.width, target->extent.height, 1},
+            .mipLevels = 1,
+            .arrayLayers = 1,
+            .samples = VK_SAMPLE_COUNT_1_BIT,
+            .tiling = VK_IMAGE_TILING_OPTIMAL,
+
+            .usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | targetImageUsage(state, target),
+            .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+            .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        };
+
+        assertVk(vkCreateImage(state->device, &crtInf, state->allocator, &target->swapchainImages[i]), "failed to create headless image", "created headless image");
+
+        VkMemoryRequirements memReq;
+        vkGetImageMemoryRequirements(state->device, target->swapchainImages[i], &memReq);
+
+        VkMemoryAllocateInfo allocInf = {
+            .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+            .pNext = NULL,
+            .allocationSize = memReq.size,
+            .memoryTypeIndex = findMemoryType(state, memReq.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT),
+        };
+
+        assertVk(vkAllocateMemory(state->device, &allocInf, state->allocator, &target->imageMemory[i]), "failed to allocate headless image memory", "allocated headless image memory");
+        vkBindImageMemory(state->device, target->swapchainImages[i], target->imageMemory[i], 0);
     }
 
-    for (uint32_t i = 0; i < state->swapchainImageCount; i++)
+    LOG("created %u headless images %ux%u", target->swapchainImageCount, target->extent.width, target->extent.height);
+}
+
+void createImageViews(State* state, RenderTarget* target)
+{
+    for (uint32_t i = 0; i < target->swapchainImageCount; i++)
     {
         VkImageViewCreateInfo crtInf = {
             .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
             .pNext = NULL,
             .flags = 0,
 
-            .image = state->swapchainImages[i],
+            .image = target->swapchainImages[i],
             .viewType = VK_IMAGE_VIEW_TYPE_2D,
 
             .format = state->swapchainFormat.format,
@@ -377,39 +820,56 @@ void createImageViews(State* state)
             .subresourceRange.levelCount = 1,
         };
 
-        assertVk(vkCreateImageView(state->device, &crtInf, state->allocator, state->imageViews+i), 
+        assertVk(vkCreateImageView(state->device, &crtInf, state->allocator, target->imageViews+i), 
         "Failed to create image view", "created image view");
     }
 
 }
 
-VkSurfaceFormatKHR selectSwapchainFormat(State* state)
+void createRenderTarget(State* state, RenderTarget* target)
 {
-    uint32_t surfaceFormatCount;
-    VkSurfaceFormatKHR* formats;
+    if (target->window != NULL) {
+        createSwapchain(state, target);
+        // retrieve swapchain images for vkImageViews
+        retrieveSwapchainImages(state, target);
+    }
+    else
+    {
+        createHeadlessImages(state, target);
+    }
 
-    vkGetPhysicalDeviceSurfaceFormatsKHR(state->physicalDevice, state->surface, &surfaceFormatCount, NULL);
-    formats = (VkSurfaceFormatKHR*) malloc(sizeof(VkSurfaceFormatKHR) * surfaceFormatCount);
-    vkGetPhysicalDeviceSurfaceFormatsKHR(state->physicalDevice, state->surface, &surfaceFormatCount, formats);
+    createImageViews(state, target);
 
-    assert_my(formats,"failed to get formats" , "loaded formats");
+    // dynamic rendering takes depth images from the render graph
+    if (state->useDepth && !state->useDynamicRendering) {
+        createDepthResources(state, target);
+    }
+
+    if (!state->useDynamicRendering) {
+        createFramebuffers(state, target);
+    }
+}
+
+VkSurfaceFormatKHR selectSwapchainFormat(State* state, VkSurfaceKHR surface)
+{
+    // queried again by every swapchain recreation, formats past the capacity are never the sRGB ones anyway
+    VkSurfaceFormatKHR formats[SWAPCHAIN_MAX_SURFACE_FORMATS];
+    uint32_t surfaceFormatCount = SWAPCHAIN_MAX_SURFACE_FORMATS;
+
+    vkGetPhysicalDeviceSurfaceFormatsKHR(state->physicalDevice, surface, &surfaceFormatCount, formats);
+
+    assert_my(surfaceFormatCount > 0, "failed to get formats" , "loaded formats");
 
-    
     for (uint32_t i = 0; i < surfaceFormatCount; i++)
     {
         if ((formats[i].format == VK_FORMAT_B8G8R8A8_SRGB || formats[i].format == VK_FORMAT_R8G8B8A8_SRGB) && formats[i].colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR)
         {
+            LOG_DEBUG("found surface format with RGB8/sRGB format");
             return formats[i];
-            LOG("found surface format with RGB8/sRGB format");
-            break;
         }
     }
 
-    return  formats[0];
-
-    free(formats);
-    formats = NULL;
-
+    return formats[0];
 }
 
 void createRenderPass(State* state)
@@ -426,26 +886,55 @@ void createRenderPass(State* state)
         .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
 
         .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-        .finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+        // headless only runs have no swapchain extension and no present layout
+        .finalLayout = state->presentLayout,
+    };
+
+    // depth is cleared on load and discarded at the end, it never has to reach memory
+    VkAttachmentDescription depthAttachment = {
+        .flags = 0,
+        .format = state->depthFormat,
+        .samples = VK_SAMPLE_COUNT_1_BIT,
+
+        .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+        .storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+
+        .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+        .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+
+        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        .finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
     };
 
+    VkAttachmentDescription attachments[] = {colorAttachment, depthAttachment};
+
     VkAttachmentReference colorAttachmentReference = {
         .attachment = 0,
         .layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
     };
 
-    VkSubpassDependency dependency = {
-        .srcSubpass = VK_SUBPASS_EXTERNAL,
-        .dstSubpass = 0,
-    
-        .srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-        .srcAccessMask = 0,
-
-        .dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-        .dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+    VkAttachmentReference depthAttachmentReference = {
+        .attachment = 1,
+        .layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
+    };
 
+    // dependencies follow from the accesses before and after the pass, same masks the render graph uses
+    VkSubpassDependency dependencies[2] = {
+        {.srcSubpass = VK_SUBPASS_EXTERNAL, .dstSubpass = 0},
+        {.srcSubpass = 0, .dstSubpass = VK_SUBPASS_EXTERNAL},
     };
-    
+
+    // contents are not needed, the color write only waits for the image available semaphore
+    graphSubpassDependency(&dependencies[0], GRAPH_ACCESS_NONE, GRAPH_ACCESS_COLOR_ATTACHMENT_WRITE);
+
+    if (state->useDepth) {
+        // depth image is shared by all frames, previous frame's depth writes must finish before it is cleared
+        graphSubpassDependency(&dependencies[0], GRAPH_ACCESS_DEPTH_ATTACHMENT_WRITE, GRAPH_ACCESS_DEPTH_ATTACHMENT_WRITE);
+    }
+
+    // capture copies the image after the pass, the final layout transition must be ordered before the transfer
+    graphSubpassDependency(&dependencies[1], GRAPH_ACCESS_COLOR_ATTACHMENT_WRITE, GRAPH_ACCESS_TRANSFER_READ);
+
     VkSubpassDescription subpass = {
         .flags = 0,
 
@@ -454,6 +943,7 @@ void createRenderPass(State* state)
         // layout(location = 0) out vec4 outColor
         .colorAttachmentCount = 1,
         .pColorAttachments = &colorAttachmentReference,
+        .pDepthStencilAttachment = state->useDepth ? &depthAttachmentReference : NULL,
     };
 
     VkRenderPassCreateInfo renderPassCrtInf = {
@@ -461,14 +951,14 @@ void createRenderPass(State* state)
         .pNext = NULL,
         .flags =0,
 
-        .attachmentCount = 1,
-        .pAttachments = &colorAttachment,
+        .attachmentCount = state->useDepth ? 2 : 1,
+        .pAttachments = attachments,
         
         .subpassCount = 1,
         .pSubpasses = &subpass,
 
-        .dependencyCount = 1,
-        .pDependencies = &dependency,
+        .dependencyCount = state->captureFrames ? 2 : 1,
+        .pDependencies = dependencies,
 
     };
 
@@ -481,243 +971,176 @@ void createRenderPass(State* state)
 
 void createGraphicsPipeline(State* state)
 {
-    // TODO: 
-    // Shader stages ✓
-    // Vertex input -> specifies vertex input attribute and binding ✓
-    // Input assembly ✓
-    // Tesselation skipping
-    // Viewport ✓
-    // Rasterization ✓
-    // Multi smaple ✓
-    // Depth Stencil skipping
-    // Color Blending ✓
-    // dynamic states ✓
-
     // Shader stages: the shader modules that define the functionality of the programmable stages of the graphics pipeline
     // Fixed-function state: all of the structures that define the fixed-function stages of the pipeline, like input assembly, rasterizer, viewport and color blending
     // Pipeline layout: the uniform and push values referenced by the shader that can be updated at draw time
     // Render pass: the attachments(buffers) referenced by the pipeline stages and their usage
+    // all variants share the layout, shaders and fixed-function state come from their key (pipeline.c)
 
+    // Pipeline layout -> specify uniforms here
+    // set 0 -> dynamic uniform buffer of the uniform ring
+    // set 1 -> bindless textures and storage buffers
+    VkDescriptorSetLayout setLayouts[] = {state->uniforms.setLayout, state->bindless.setLayout};
+
+    // fragment stage reads the bindless indices
+    VkPushConstantRange pushConstantRange = {
+        .stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+        .offset = 0,
+        .size = sizeof(DrawPushConstants),
+    };
 
-    // Dynamic states 
-    VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
-
-    VkPipelineDynamicStateCreateInfo dynamicState = {
-
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+    VkPipelineLayoutCreateInfo pipelineLayoutCrtInf = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .pNext = NULL,
         .flags = 0,
 
-        .dynamicStateCount = 2,
-        .pDynamicStates = dynamicStates,
+        .setLayoutCount = sizeof(setLayouts) / sizeof(setLayouts[0]),
+        .pSetLayouts = setLayouts,
+        
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &pushConstantRange
     };
 
-    // Shader Stages
-    VkShaderModule shaderModules[2];
-    // vertex shader
-    shaderModules[0] = createShaderModule("shaders/main.vert.spv", state->device, state->allocator);
-    // fragment shader
-    shaderModules[1] = createShaderModule("shaders/main.frag.spv", state->device, state->allocator);
-    
-    VkPipelineShaderStageCreateInfo vertShaderStageInfo = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-        .stage = VK_SHADER_STAGE_VERTEX_BIT,
-
-        .module = shaderModules[0], // vertex shader module
-        .pName = "main",
-    };
+    assertVk(vkCreatePipelineLayout(state->device, &pipelineLayoutCrtInf, state->allocator, &state->pipelineLayout), "failed to Create Pipeline layout", "created pipeline layout");
 
-    VkPipelineShaderStageCreateInfo fragmentShaderStageInfo = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-        .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
+    createPipelineCache(state);
+    pipelineCacheAddShaders(state, "shaders/main.vert.spv", "shaders/main.frag.spv");
 
-        .module = shaderModules[1], // vertex shader module
-        .pName = "main",
-    };
+    // draws use the generic variant until their specialized one is compiled, it must exist before the first frame
+    pipelineKeyDefault(state, &state->pipelineKey);
 
-    VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragmentShaderStageInfo};
+    // meshes of every vertex format share the pulled variants
+    if (state->vertexPulling) {
+        state->pipelineKey.shaders = pipelineCacheAddShaders(state, "shaders/pulled.vert.spv", "shaders/main.frag.spv");
+        state->pipelineKey.vertexLayout = PIPELINE_VERTEX_PULLED;
+    }
+    state->graphicsPipeline = pipelineCacheGetBlocking(state, pipelineCacheRequest(state, &state->pipelineKey));
+}
 
-    // Vertex input state
-    VkPipelineVertexInputStateCreateInfo vertexInputCrtInf = {
+void createFramebuffers(State* state, RenderTarget* target)
+{
+    for (uint32_t i = 0; i < target->swapchainImageCount; i++)
+    {
+        VkImageView attachments[] = { target->imageViews[i], target->depthImageView };
 
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
-        .pNext = NULL,
-        .flags = 0,
-        
-        .vertexBindingDescriptionCount = 1,
-        .pVertexBindingDescriptions = &bindingDescription,
+        VkFramebufferCreateInfo crtInf = {
+            .sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
+            .pNext = NULL,
+            .flags = 0,
 
-        .vertexAttributeDescriptionCount = 2,
-        .pVertexAttributeDescriptions = attributeDescriptions,
-    };
+            .renderPass = state->renderPass,
 
-    // Assembly state
-    VkPipelineInputAssemblyStateCreateInfo inputAssemblyCrtInf = {
+            .attachmentCount = state->useDepth ? 2 : 1,
+            .pAttachments = attachments,
 
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
-        .pNext = NULL,
-        .flags = 0,
+            .width = target->extent.width,
+            .height = target->extent.height,
+            
+            .layers = 1,
+        };
 
-        .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
-        .primitiveRestartEnable = VK_FALSE
+        assertVk(vkCreateFramebuffer(state->device, &crtInf, state->allocator, &target->swapChainFrameBuffers[i]), 
+        "Failed to create frame buffer", "Created frambuffer");
     };
 
-    // Viewport    
-    VkPipelineViewportStateCreateInfo viewportCrtInf = {
-
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
-        .pNext = NULL,
-        .flags = 0,
-
-        .viewportCount = 1,
-        .scissorCount = 1,
-    };
+}
 
-    // Rasterization
-    VkPipelineRasterizationStateCreateInfo rasterizerCrtInf = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
-        .pNext = NULL,
-        .flags = 0,
+VkFormat findDepthFormat(State* state)
+{
+    // D16 is required to be supported as depth attachment, keep it as last resort
+    VkFormat candidates[] = {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D24_UNORM_S8_UINT, VK_FORMAT_D16_UNORM};
 
-        .depthClampEnable = VK_FALSE,
-        .rasterizerDiscardEnable = VK_FALSE,
+    for (uint32_t i = 0; i < sizeof(candidates) / sizeof(candidates[0]); i++)
+    {
+        VkFormatProperties props;
+        vkGetPhysicalDeviceFormatProperties(state->physicalDevice, candidates[i], &props);
 
-        .polygonMode = VK_POLYGON_MODE_FILL,
+        if (props.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT) {
+            return candidates[i];
+        }
+    }
 
-        .lineWidth = (float)1, // musn't be larger than 1 if wideLines aren't enabled
+    assert_my(0, "failed to find depth format", "");
+    return VK_FORMAT_UNDEFINED;
+}
 
-        .cullMode = VK_CULL_MODE_BACK_BIT,
-        .frontFace = VK_FRONT_FACE_CLOCKWISE,
-        
-        .depthBiasEnable = VK_FALSE,
-        .depthBiasClamp = (float)0,
-        .depthBiasConstantFactor = (float)0,
-        .depthBiasSlopeFactor = (float)0
-    };
+VkImageAspectFlags depthImageAspect(VkFormat format)
+{
+    return format == VK_FORMAT_D24_UNORM_S8_UINT ? VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT : VK_IMAGE_ASPECT_DEPTH_BIT;
+}
 
-    // Multisampling
-    VkPipelineMultisampleStateCreateInfo multisampleCrtInf = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+void createDepthResources(State* state, RenderTarget* target)
+{
+    VkImageCreateInfo crtInf = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
         .pNext = NULL,
         .flags = 0,
-        .sampleShadingEnable = VK_FALSE,
-        .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
-        .minSampleShading = (float)1,
-        .pSampleMask = NULL,
-        .alphaToCoverageEnable = VK_FALSE,
-        .alphaToOneEnable = VK_FALSE,
-    };
 
-    // Depth & Stencil testing
+        .imageType = VK_IMAGE_TYPE_2D,
+        .format = state->depthFormat,
+        .extent = {target->extent.width, target->extent.height, 1},
+        .mipLevels = 1,
+        .arrayLayers = 1,
+        .samples = VK_SAMPLE_COUNT_1_BIT,
+        .tiling = VK_IMAGE_TILING_OPTIMAL,
 
-    // Color blending 
-    VkPipelineColorBlendAttachmentState colorBlendAttachment = {
-        .colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
-        
-        .blendEnable = VK_FALSE,
+        // transient -> contents never leave the render pass, lets the driver skip backing memory
+        .usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+    };
 
-        .srcColorBlendFactor = VK_BLEND_FACTOR_ONE,
-        .dstColorBlendFactor = VK_BLEND_FACTOR_ZERO,
+    assertVk(vkCreateImage(state->device, &crtInf, state->allocator, &target->depthImage), "failed to create depth image", "created depth image");
 
-        .colorBlendOp = VK_BLEND_OP_ADD,
-        .srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
-        .dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO,
-        .alphaBlendOp = VK_BLEND_OP_ADD,
-    };
+    VkMemoryRequirements memReq;
+    vkGetImageMemoryRequirements(state->device, target->depthImage, &memReq);
 
-    VkPipelineColorBlendStateCreateInfo colorBlending = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
-        .logicOpEnable = VK_FALSE,
-        .logicOp = VK_LOGIC_OP_COPY,
-        .attachmentCount = 1,
-        .pAttachments = &colorBlendAttachment,
-        .blendConstants[0] = 0.0f,
-        .blendConstants[1] = 0.0f,
-        .blendConstants[2] = 0.0f,
-        .blendConstants[3] = 0.0f,
-    };
+    // lazily allocated memory is only committed when tile memory spills, fall back to plain device local
+    uint32_t memoryTypeIndex;
+    if (!tryFindMemoryType(state, memReq.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT, &memoryTypeIndex)) {
+        memoryTypeIndex = findMemoryType(state, memReq.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        LOG_DEBUG("lazily allocated memory not available for depth image");
+    }
 
-    // Pipeline layout -> specify uniforms here
-    VkPipelineLayoutCreateInfo pipelineLayoutCrtInf = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+    VkMemoryAllocateInfo allocInf = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
         .pNext = NULL,
-        .flags = 0,
-
-        .setLayoutCount = 0,
-        .pSetLayouts = NULL,
-        
-        .pushConstantRangeCount = 0,
-        .pPushConstantRanges = NULL
+        .allocationSize = memReq.size,
+        .memoryTypeIndex = memoryTypeIndex,
     };
 
-    assertVk(vkCreatePipelineLayout(state->device, &pipelineLayoutCrtInf, state->allocator, &state->pipelineLayout), "failed to Create Pipeline layout", "created pipeline layout");
-
+    assertVk(vkAllocateMemory(state->device, &allocInf, state->allocator, &target->depthImageMemory), "failed to allocate depth image memory", "allocated depth image memory");
+    vkBindImageMemory(state->device, target->depthImage, target->depthImageMemory, 0);
 
-    VkGraphicsPipelineCreateInfo graphicsPipelineCrtInf = {
-        .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+    VkImageViewCreateInfo viewCrtInf = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
         .pNext = NULL,
         .flags = 0,
 
-        .stageCount = 2,
-        .pStages = shaderStages,
+        .image = target->depthImage,
+        .viewType = VK_IMAGE_VIEW_TYPE_2D,
+        .format = state->depthFormat,
 
-        .pVertexInputState = &vertexInputCrtInf,
-        .pInputAssemblyState = &inputAssemblyCrtInf,
-        .pTessellationState = NULL, // skipped
-        .pViewportState = &viewportCrtInf,
-        .pRasterizationState = &rasterizerCrtInf,
-        .pMultisampleState = &multisampleCrtInf,
-        .pDepthStencilState = NULL,
-        .pColorBlendState = &colorBlending,
-        .pDynamicState = &dynamicState,
+        .components.a = VK_COMPONENT_SWIZZLE_IDENTITY,
+        .components.r = VK_COMPONENT_SWIZZLE_IDENTITY,
+        .components.g = VK_COMPONENT_SWIZZLE_IDENTITY,
+        .components.b = VK_COMPONENT_SWIZZLE_IDENTITY,
 
-        .layout = state->pipelineLayout,
-        .renderPass = state->renderPass,
-
-        .subpass = 0,
-
-        .basePipelineHandle = NULL,
-        .basePipelineIndex = -1,
+        .subresourceRange.aspectMask = depthImageAspect(state->depthFormat),
+        .subresourceRange.baseArrayLayer = 0,
+        .subresourceRange.baseMipLevel = 0,
+        .subresourceRange.layerCount = 1,
+        .subresourceRange.levelCount = 1,
     };
 
-    assertVk(vkCreateGraphicsPipelines(state->device, NULL, 1, &graphicsPipelineCrtInf, state->allocator, &state->graphicsPipeline),
-        "failed to create graphcis pipeline", "created graphics pipeline");
-
-
-    // delete shader modules 
-    vkDestroyShaderModule(state->device, shaderModules[0], state->allocator);
-    vkDestroyShaderModule(state->device, shaderModules[1], state->allocator);
+    assertVk(vkCreateImageView(state->device, &viewCrtInf, state->allocator, &target->depthImageView), "failed to create depth image view", "created depth image view");
 }
 
-void createFramebuffers(State* state)
+void destroyDepthResources(State* state, RenderTarget* target)
 {
-    if (state->swapChainFrameBuffers == NULL) {
-        state->swapChainFrameBuffers = (VkFramebuffer*) malloc(sizeof(VkFramebuffer)*state->swapchainImageCount);
-    }
-
-    for (uint32_t i = 0; i < state->swapchainImageCount; i++)
-    {
-        VkImageView attachments[] = { state->imageViews[i] };
-
-        VkFramebufferCreateInfo crtInf = {
-            .sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
-            .pNext = NULL,
-            .flags = 0,
-
-            .renderPass = state->renderPass,
-
-            .attachmentCount = 1,
-            .pAttachments = attachments,
-
-            .width = state->extent.width,
-            .height = state->extent.height,
-            
-            .layers = 1,
-        };
-
-        assertVk(vkCreateFramebuffer(state->device, &crtInf, state->allocator, &state->swapChainFrameBuffers[i]), 
-        "Failed to create frame buffer", "Created frambuffer");
-    };
-
+    vkDestroyImageView(state->device, target->depthImageView, state->allocator);
+    vkDestroyImage(state->device, target->depthImage, state->allocator);
+    vkFreeMemory(state->device, target->depthImageMemory, state->allocator);
 }
 
 void createCommandPool(State* state)
@@ -795,7 +1218,7 @@ void createIndexBuffer(State* state)
     vkFreeMemory(state->device, stagingBufferMemory, state->allocator);
 }
 
-uint32_t findMemoryType(State* state, uint32_t typeFilter, VkMemoryPropertyFlags properties)
+VkBool32 tryFindMemoryType(State* state, uint32_t typeFilter, VkMemoryPropertyFlags properties, uint32_t* memoryTypeIndex)
 {
     VkPhysicalDeviceMemoryProperties memProperties;
     vkGetPhysicalDeviceMemoryProperties(state->physicalDevice, &memProperties);
@@ -804,12 +1227,21 @@ uint32_t findMemoryType(State* state, uint32_t typeFilter, VkMemoryPropertyFlags
     {
         if (typeFilter & (1 << i) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties)
         {
-            return i;
+            *memoryTypeIndex = i;
+            return VK_TRUE;
         }
     }
 
-    assert_my(-1, "Failed to find memory type", "");
-    exit(EXIT_FAILURE);
+    return VK_FALSE;
+}
+
+uint32_t findMemoryType(State* state, uint32_t typeFilter, VkMemoryPropertyFlags properties)
+{
+    uint32_t memoryTypeIndex;
+
+    assert_my(tryFindMemoryType(state, typeFilter, properties, &memoryTypeIndex), "Failed to find memory type", "");
+
+    return memoryTypeIndex;
 }
 
 void allocateCommandBuffers(State* state)
@@ -824,8 +1256,6 @@ void allocateCommandBuffers(State* state)
         .commandPool = state->commandPool
     };
 
-    
-    state->commandBuffers = (VkCommandBuffer*) malloc(sizeof(VkCommandBuffer) * MAX_FRAMES_IN_FLIGHT);
 
     assertVk(vkAllocateCommandBuffers(state->device,&allocInf,state->commandBuffers),
     "failed to allocate command buffer", "allocated command buffer");
@@ -847,15 +1277,16 @@ void createSyncObject(State* state)
         .flags = VK_FENCE_CREATE_SIGNALED_BIT
     };
 
-    state->syncSemImgAvail = (VkSemaphore*) malloc(sizeof(VkSemaphore) * MAX_FRAMES_IN_FLIGHT);
-    state->syncSemRndrFinsh = (VkSemaphore*) malloc(sizeof(VkSemaphore) * MAX_FRAMES_IN_FLIGHT);
-    state->syncFenInFlight = (VkFence*) malloc(sizeof(VkFence) * MAX_FRAMES_IN_FLIGHT);
-
     for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
     {
-        assertVk(vkCreateSemaphore(state->device, &semCrtInf, state->allocator, &state->syncSemImgAvail[i]), "failed to create semaphore", "created semaphore");
-        assertVk(vkCreateSemaphore(state->device, &semCrtInf, state->allocator, &state->syncSemRndrFinsh[i]), "failed to create semaphore", "created semaphore");
         assertVk(vkCreateFence(state->device, &fenCrtInf, state->allocator, &state->syncFenInFlight[i]), "failed to create fence", "created fence");
+
+        // headless targets have nothing to acquire or present
+        for (uint32_t t = 0; t < state->windowCount; t++)
+        {
+            assertVk(vkCreateSemaphore(state->device, &semCrtInf, state->allocator, &state->targets[t].syncSemImgAvail[i]), "failed to create semaphore", "created semaphore");
+            assertVk(vkCreateSemaphore(state->device, &semCrtInf, state->allocator, &state->targets[t].syncSemRndrFinsh[i]), "failed to create semaphore", "created semaphore");
+        }
     }
 
 
@@ -864,17 +1295,42 @@ void createSyncObject(State* state)
 
 void cleanUp(State* state)
 {
+    // encodes the frames still sitting in readback slots
+    if (state->captureFrames) {
+        destroyCapture(state);
+    }
+
+    if (state->exportFrames) {
+        destroyFrameExport(state);
+    }
+
+    if (state->asyncCompute) {
+        destroyPostProcess(state);
+    }
+
+    if (state->measureLatency) {
+        destroyLatency(state);
+    }
+
+    destroyRenderGraph(state, &state->graph);
+
     for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
     {
-        vkDestroySemaphore(state->device, state->syncSemImgAvail[i], state->allocator);
-        vkDestroySemaphore(state->device, state->syncSemRndrFinsh[i], state->allocator);
+        for (uint32_t t = 0; t < state->windowCount; t++)
+        {
+            vkDestroySemaphore(state->device, state->targets[t].syncSemImgAvail[i], state->allocator);
+            vkDestroySemaphore(state->device, state->targets[t].syncSemRndrFinsh[i], state->allocator);
+        }
         vkDestroyFence(state->device, state->syncFenInFlight[i], state->allocator);
     }
 
     vkDestroyCommandPool(state->device, state->commandPool, state->allocator);
 
 
-    cleanUpSwapchain(state);
+    for (uint32_t i = 0; i < state->targetCount; i++)
+    {
+        cleanUpSwapchain(state, &state->targets[i]);
+    }
 
     // destroy buffers and free memory
     vkDestroyBuffer(state->device, state->indexBuffer, state->allocator);
@@ -883,34 +1339,77 @@ void cleanUp(State* state)
     vkDestroyBuffer(state->device, state->vertexBuffer, state->allocator);
     vkFreeMemory(state->device, state->vertexBufferMemory, state->allocator);
 
+    if (state->vertexPulling) {
+        destroyMeshPool(state);
+    }
 
-    vkDestroyPipeline(state->device, state->graphicsPipeline, state->allocator);
+    if (state->hudQuads > 0) {
+        destroyBatcher(state);
+    }
+
+
+    // owns state->graphicsPipeline as well
+    destroyPipelineCache(state);
     vkDestroyPipelineLayout(state->device, state->pipelineLayout, state->allocator);
+
+    destroyTextureStreamer(state);
+    destroyInstanceStore(state);
+    destroyVisibility(state);
+    destroyDrawQueue(state);
+    destroyUniformRing(state);
+    destroyBindlessTable(state);
     
-    vkDestroyRenderPass(state->device, state->renderPass, state->allocator);
+    if (!state->useDynamicRendering) {
+        vkDestroyRenderPass(state->device, state->renderPass, state->allocator);
+    }
 
 
-    vkDestroySurfaceKHR(state->instance, state->surface, state->allocator);
+    for (uint32_t i = 0; i < state->windowCount; i++)
+    {
+        vkDestroySurfaceKHR(state->instance, state->targets[i].surface, state->allocator);
+    }
     vkDestroyDevice(state->device, state->allocator);
     vkDestroyInstance(state->instance, state->allocator);
+    dispatchShutdown();
     
-    glfwDestroyWindow(state->window);
-    glfwTerminate();
+    if (state->windowCount > 0) {
+        for (uint32_t i = 0; i < state->windowCount; i++)
+        {
+            glfwDestroyWindow(state->targets[i].window);
+        }
+        glfwTerminate();
+    }
+
+    logShutdown();
     
     exit(EXIT_SUCCESS);
 
 }
 
-void cleanUpSwapchain(State* state)
+void cleanUpSwapchain(State* state, RenderTarget* target)
 {
-    for (uint32_t i = 0; i < state->swapchainImageCount; i++)
+    for (uint32_t i = 0; i < target->swapchainImageCount; i++)
     {
-        vkDestroyFramebuffer(state->device, state->swapChainFrameBuffers[i], state->allocator);
-        vkDestroyImageView(state->device, state->imageViews[i], state->allocator);
+        if (!state->useDynamicRendering) {
+            vkDestroyFramebuffer(state->device, target->swapChainFrameBuffers[i], state->allocator);
+        }
+        vkDestroyImageView(state->device, target->imageViews[i], state->allocator);
     }
     
-    vkDestroySwapchainKHR(state->device, state->swapchain, state->allocator);
+    if (state->useDepth && !state->useDynamicRendering) {
+        destroyDepthResources(state, target);
+    }
+    
+    if (target->window != NULL) {
+        vkDestroySwapchainKHR(state->device, target->swapchain, state->allocator);
+        return;
+    }
 
+    for (uint32_t i = 0; i < target->swapchainImageCount; i++)
+    {
+        vkDestroyImage(state->device, target->swapchainImages[i], state->allocator);
+        vkFreeMemory(state->device, target->imageMemory[i], state->allocator);
+    }
 }
 
 VkShaderModule createShaderModule(const char* pathToShader, VkDevice device, VkAllocationCallbacks* allocator)
@@ -1,50 +1,178 @@
 #ifndef __INIT_H__
 #define __INIT_H__
 
+#include <cglm/types.h>
 #include <stdint.h>
 #include <vulkan/vulkan_core.h>
+#include "dispatch.h"
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
+#include "batch.h"
+#include "bindless.h"
+#include "capture.h"
+#include "common.h"
+#include "dynamic.h"
+#include "encoder.h"
+#include "export.h"
+#include "graph.h"
+#include "instance.h"
+#include "latency.h"
+#include "mesh.h"
+#include "pipeline.h"
+#include "postprocess.h"
+#include "texture.h"
+#include "uniform.h"
+#include "visibility.h"
+
 #define WINDOW_WIDTH 800
 #define WINDOW_HEIGHT 600
 
 #define REQUESTED_SWAPCHAIN_IMAGE_COUNT 3
+// capacity of the per swapchain arrays, drivers may create a few more images than requested
+#define MAX_SWAPCHAIN_IMAGES 8
+// surface formats looked at when choosing the swapchain format
+#define SWAPCHAIN_MAX_SURFACE_FORMATS 64
+
+// per frame and per swapchain arrays start on their own cache line, no false sharing with neighbouring fields
+#define CACHE_LINE_SIZE 64
+#define CACHE_ALIGNED __attribute__((aligned(CACHE_LINE_SIZE)))
+
+// frames every frame in flight slot was used once, allocation free from then on under DEBUG_ALLOC
+#define ALLOC_GUARD_WARMUP_FRAMES MAX_FRAMES_IN_FLIGHT
 
-#define MAX_FRAMES_IN_FLIGHT 2
+// seconds on demand rendering waits for events, bounds how late finished texture uploads are noticed
+#define ON_DEMAND_WAIT_TIMEOUT 0.1
 
-typedef struct State
+// last part of a frame cap wait is spun, sleeps overshoot by up to a scheduler tick
+#define FRAME_CAP_SPIN_NS 500000ull
+
+// uniform block (std140) shared by all draws of a target, one is written into the uniform ring per target and frame
+typedef struct DrawUniforms
+{
+    mat4 transform;
+    float time;
+    float padding[3];
+} DrawUniforms;
+
+// index meaning no texture or buffer, shaders skip the lookup
+#define BINDLESS_INVALID_INDEX UINT32_MAX
+
+// one indexed draw of the scene
+typedef struct Draw
+{
+    uint32_t indexCount;
+    uint32_t firstIndex;
+    int32_t vertexOffset;
+
+    // instances of the instance store drawn with this draw
+    uint32_t instanceCount;
+    uint32_t firstInstance;
+
+    // translation pushed as push constant
+    vec2 offset;
+
+    // bindless material of the draw, BINDLESS_INVALID_INDEX when unused
+    uint32_t textureIndex;
+    uint32_t materialIndex;
+
+    // view depth of closest vertex, the draw queue orders opaque draws front to back by it every frame
+    float depth;
+
+    // mesh pool vertices when vertex pulling is used, firstIndex then points into the pool
+    VkDeviceAddress vertexAddress;
+    uint32_t vertexFormat;
+
+    // variant specialized for the material, requested again when the used bindless indices change
+    uint32_t pipelineVariant;
+    uint32_t pipelineFeatures;
+} Draw;
+
+// window with its swapchain or headless set of images, everything that depends on the surface or its extent
+struct RenderTarget
+{
+    // NULL for headless targets, they render into images they own and present nothing
+    GLFWwindow* window;
+    VkSurfaceKHR surface;
+
+    uint32_t swapchainImageCount;
+    VkExtent2D extent;
+    VkSwapchainKHR swapchain;
+
+    // fixed capacity so recreation never touches the heap [swapchainImageCount]
+    VkImage swapchainImages[MAX_SWAPCHAIN_IMAGES] CACHE_ALIGNED;
+    VkImageView imageViews[MAX_SWAPCHAIN_IMAGES] CACHE_ALIGNED;
+    VkFramebuffer swapChainFrameBuffers[MAX_SWAPCHAIN_IMAGES] CACHE_ALIGNED;
+    // memory of headless images [swapchainImageCount]
+    VkDeviceMemory imageMemory[MAX_SWAPCHAIN_IMAGES] CACHE_ALIGNED;
+
+    // optional depth attachment of the render pass path, recreated with swapchain
+    // dynamic rendering takes depth from the render graph instead, aliased between targets
+    VkImage depthImage;
+    VkDeviceMemory depthImageMemory;
+    VkImageView depthImageView;
+
+    // semaphore image available -> image from swapchain is available(rendered) [frames in flight], windows only
+    VkSemaphore syncSemImgAvail[MAX_FRAMES_IN_FLIGHT] CACHE_ALIGNED;
+    // semaphore render -> Rendering of image finished [frames in flight], windows only
+    VkSemaphore syncSemRndrFinsh[MAX_FRAMES_IN_FLIGHT] CACHE_ALIGNED;
+
+    // image rendered this frame, UINT32_MAX when the target is skipped (out of date swapchain)
+    uint32_t imageIndex;
+    // stage waiting for the image available semaphore, first use of the image in the recorded frame
+    VkPipelineStageFlags2 acquireStage;
+
+    VkBool32 frameBufferResized;
+};
+
+struct State
 {
     // allocator -> allocator for vulkan objects 
     VkAllocationCallbacks* allocator;
 
     // instance -> interface for 
     VkInstance instance;
-    GLFWwindow* window;
-    VkSurfaceKHR surface;
 
     VkPhysicalDevice physicalDevice;
+    // graphics family, submits rendering of every target
     uint32_t queueFamilyIndex;
+    // family presenting to every window, queueFamilyIndex whenever that one can
+    uint32_t presentFamilyIndex;
+    // compute only family when the device has one, otherwise queueFamilyIndex
+    uint32_t computeFamilyIndex;
+    // queue of computeFamilyIndex, 1 when the graphics family provides a second queue for compute
+    uint32_t computeQueueIndex;
     VkDevice device;
 
-    uint32_t swapchainImageCount;
-    VkExtent2D extent;
-    VkSurfaceFormatKHR swapchainFormat;
-    VkSwapchainKHR swapchain;
+    // windows first, then headless targets, targets[0] is the one captured and exported
+    RenderTarget targets[MAX_RENDER_TARGETS];
+    uint32_t targetCount;
+    // requested at startup, no windows -> no GLFW and no swapchain extension at all
+    uint32_t windowCount;
+    uint32_t headlessCount;
 
-    VkImage* swapchainImages;
-    VkImageView* imageViews;
-    VkFramebuffer* swapChainFrameBuffers;
+    // color format shared by all targets, the pipeline is built for exactly one
+    VkSurfaceFormatKHR swapchainFormat;
+    // layout targets are left in at the end of a frame, present source when windows exist
+    VkImageLayout presentLayout;
 
 
     VkQueue graphicsQueue;
-        
+    // same handles as graphicsQueue when the graphics family presents or computes as well
+    VkQueue presentQueue;
+    VkQueue computeQueue;
+
     VkCommandPool commandPool;
-    VkCommandBuffer* commandBuffers;
+    VkCommandBuffer commandBuffers[MAX_FRAMES_IN_FLIGHT] CACHE_ALIGNED;
 
     VkRenderPass renderPass;
     VkPipelineLayout pipelineLayout;
+    // generic variant handling every draw, used until a draw's specialized variant is compiled
     VkPipeline graphicsPipeline;
+    PipelineKey pipelineKey;
+    PipelineCache pipelines;
+    // pipeline cache file, NULL -> driver cache is not persisted
+    const char* pipelineCachePath;
 
     VkBuffer vertexBuffer;
     VkDeviceMemory vertexBufferMemory;
@@ -52,31 +180,96 @@ typedef struct State
    
     VkBuffer indexBuffer;
     VkDeviceMemory indexBufferMemory;
-    // sync objects
 
-    // semaphore image available -> image from swapchain is available(rendered) [swapchain image count]
-    VkSemaphore* syncSemImgAvail;
-    // semaphore render -> Rendering of image finished [swapchain image count]
-    VkSemaphore* syncSemRndrFinsh;
-    // Fence image in flight -> image is in flight [swapchain image count]
-    VkFence* syncFenInFlight;
+    Draw* draws;
+    uint32_t drawCount;
+    // visible draws of the frame in recording order
+    DrawQueue drawQueue;
+    CommandEncoder encoder;
 
-    VkBool32 frameBufferResized;
+    UniformRing uniforms;
+    // per frame data copied into the uniform block of every target
+    mat4 viewTransform;
+    float time;
+
+    BindlessTable bindless;
+    TextureStreamer textureStreamer;
+    InstanceStore instances;
+    // bounds of the draws, only visible draws are recorded
+    Visibility visibility;
+    // number of random animated instances spawned at startup, 0 -> single static quad
+    uint32_t animatedInstanceCount;
+    // multiplies the size of the random instances, large values make them cover the view many times, 0 -> 1
+    float instanceScale;
+
+    // optional depth attachment of every target
+    VkBool32 useDepth;
+    VkFormat depthFormat;
+
+    // images of targets[0] are created as transfer sources and copied to the host every frame
+    VkBool32 captureFrames;
+    Capture capture;
+
+    // render targets[0] into exported images and copy them to its images, requires dynamic rendering
+    VkBool32 exportFrames;
+    FrameExport frameExport;
+
+    // rebuilt every frame by dynamic rendering, owns the transient images
+    RenderGraph graph;
+
+    // scene rendered in HDR and tonemapped on the compute queue one frame later, requires dynamic rendering
+    VkBool32 asyncCompute;
+    PostProcess postProcess;
 
-} State;
+    // sync objects, per target semaphores live in the targets
+
+    // Fence image in flight -> image is in flight [frames in flight]
+    VkFence syncFenInFlight[MAX_FRAMES_IN_FLIGHT] CACHE_ALIGNED;
+
+    // optional device features, enabled at device creation when supported
+    VkBool32 textureCompressionBC;
+
+    // render with vkCmdBeginRendering (Vulkan 1.3) instead of VkRenderPass/VkFramebuffer, selected at startup
+    VkBool32 useDynamicRendering;
+
+    // Vulkan calls are counted and not executed, headless targets only
+    VkBool32 nullBackend;
+
+    // dynamic buffers use the staging ring even when device local memory is host visible
+    VkBool32 forceStaging;
+
+    // meshes are fetched by the vertex shader from the mesh pool instead of fixed vertex input
+    VkBool32 vertexPulling;
+    MeshPool meshes;
+
+    // 2D quads drawn over the scene, hudQuads of them are generated every frame, 0 -> batcher unused
+    Batcher batch;
+    uint32_t hudQuads;
+
+    // records when frames of the first window reach the display, reported with the trace summary
+    VkBool32 measureLatency;
+    Latency latency;
+
+    // draw only after input, resizes or scene changes, windows wait for events in between
+    VkBool32 onDemand;
+    // frames still to draw for the last change, counted down by drawFrame
+    uint32_t redrawFrames;
+
+};
 
 void init(State* state);
 
 /**
- * @brief Creates window specify window flags here
+ * @brief Creates window of the target specify window flags here
  * 
  * @param state 
+ * @param index number shown in the title when there are several windows
  */
-void createWindow(State* state);
+void createWindow(State* state, RenderTarget* target, uint32_t index);
 
 /**
  * @brief creates vulkan instance
- * @details Creates vulkan instance with glfw required instance extensions
+ * @details Creates vulkan instance with glfw required instance extensions, without any extension when no window is requested
  * @param state 
  */
 VkResult initVulkan(State* state, VkInstance* pInstance);
@@ -91,10 +284,13 @@ VkResult selectPhysicalDevice(State* state, VkPhysicalDevice* physycalDevice);
 
 
 /**
- * @brief sets queue family index in state to queue family with support for at least Graphics Queue
+ * @brief selects graphics, present and compute queue families
+ * @details prefers a graphics family presenting to every window and a compute family without graphics,
+ * falls back to the graphics family for both
  * Requires:
     - Valid instance in state
     - Valid physical device in state
+    - Surfaces of all windows created
  * @param state 
  */
  void pickQueueFamily(State* state);
@@ -110,20 +306,18 @@ VkResult selectPhysicalDevice(State* state, VkPhysicalDevice* physycalDevice);
 void createLogicalDevice(State* state);
 
 /**
- * @brief Creates a swapchain
+ * @brief Creates a swapchain of the window target
  * Requires:
     - Valid instance in state
     - Valid physical device in state
     - Valid queue family index
+    - state->swapchainFormat supported by the target's surface
 
     - Set required extent 
     - Set required image count
  * @param state 
  */
-void createSwapchain(State* state);
-VkSurfaceFormatKHR selectSwapchainFormat(State* state);
-void retrieveSwapchainImages(State* state);
-void createImageViews(State* state);
+void createSwapchain(State* state, RenderTarget* target);
 
 /**
  * @brief selects swapchain format of selected physical device in state
@@ -131,17 +325,62 @@ void createImageViews(State* state);
  * @param state 
  * @return VkSurfaceFormatKHR surface with RGB8/sRGB format or first available 
  */
+VkSurfaceFormatKHR selectSwapchainFormat(State* state, VkSurfaceKHR surface);
+void retrieveSwapchainImages(State* state, RenderTarget* target);
+
+/**
+ * @brief creates one image per frame in flight for a headless target, images stand in for swapchain images
+ * Requires:
+    - Set required extent
+ */
+void createHeadlessImages(State* state, RenderTarget* target);
+void createImageViews(State* state, RenderTarget* target);
+
+/**
+ * @brief creates swapchain or headless images with views, depth and framebuffers of the target
+ * Requires:
+    - render pass created unless dynamic rendering is used
+ */
+void createRenderTarget(State* state, RenderTarget* target);
+
 void createRenderPass(State* state);
 
 void createGraphicsPipeline(State* state);
 
-void createFramebuffers(State* state);
+void createFramebuffers(State* state, RenderTarget* target);
+
+/**
+ * @brief selects first depth format usable as optimal tiling depth attachment
+ */
+VkFormat findDepthFormat(State* state);
+
+/**
+ * @brief aspect flags of depth format, includes stencil for combined formats
+ */
+VkImageAspectFlags depthImageAspect(VkFormat format);
+
+/**
+ * @brief creates depth image with the target's extent
+ * @details image is transient and backed by lazily allocated memory where available,
+ * it is cleared on load and never stored so on tiled GPUs it can live in tile memory only
+ * Requires:
+    - Valid swapchain extent
+    - depthFormat selected
+ */
+void createDepthResources(State* state, RenderTarget* target);
+void destroyDepthResources(State* state, RenderTarget* target);
 
 void createCommandPool(State* state);
 
 void createVertexBuffer(State* state);
 uint32_t findMemoryType(State* state, uint32_t typeFilter, VkMemoryPropertyFlags properties);
 
+/**
+ * @brief same as findMemoryType but reports missing memory type instead of exiting
+ * @return VK_TRUE and index in memoryTypeIndex if suitable memory type exists
+ */
+VkBool32 tryFindMemoryType(State* state, uint32_t typeFilter, VkMemoryPropertyFlags properties, uint32_t* memoryTypeIndex);
+
 void createIndexBuffer(State* state);
 
 void allocateCommandBuffers(State* state);
@@ -150,9 +389,29 @@ void createSyncObject(State* state);
 
 
 void cleanUp(State* state);
-void cleanUpSwapchain(State* state);
+
+/**
+ * @brief destroys everything createRenderTarget created, window and surface stay
+ */
+void cleanUpSwapchain(State* state, RenderTarget* target);
 
 void framebufferResizeCallback(GLFWwindow* window, int width, int height);
+void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
+void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods);
+void cursorPosCallback(GLFWwindow* window, double x, double y);
+void scrollCallback(GLFWwindow* window, double x, double y);
+void windowRefreshCallback(GLFWwindow* window);
+
+/**
+ * @brief marks the scene as changed, on demand rendering draws frames until the change is visible
+ */
+void requestRedraw(State* state);
+
+/**
+ * @brief whether the next loop iteration has to draw, always true unless rendering on demand
+ * @details animated instances change every frame and keep on demand rendering drawing
+ */
+VkBool32 needsFrame(State* state);
 
 VkShaderModule createShaderModule(const char* pathToShader, VkDevice device, VkAllocationCallbacks* allocator);
 char* readShader(const char* filename, unsigned long* fileSize);
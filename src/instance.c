@@ -0,0 +1,478 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "instance.h"
+
+#include "debug.h"
+#include "init.h"
+#include "dynamic.h"
+#include "job.h"
+#include "simd.h"
+#include "utils.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vulkan/vulkan_core.h>
+
+#define INSTANCE_PI 3.14159265f
+#define INSTANCE_TWO_PI 6.28318531f
+// instances per parallel-for batch, multiple of 8 so every batch starts on an aligned transform
+#define INSTANCE_JOB_BATCH 16384
+
+typedef void (*InstanceKernel)(InstanceStore* store, uint32_t begin, uint32_t end, float dt, float* transforms);
+
+// scalar step of one instance, SIMD kernels do the same operations in the same order so results match exactly
+static inline void updateInstance(InstanceStore* store, uint32_t i, float dt, float* transform)
+{
+    float x = store->x[i] + store->velocityX[i] * dt;
+    float y = store->y[i] + store->velocityY[i] * dt;
+    float rotation = store->rotation[i] + store->angularVelocity[i] * dt;
+
+    // bounce off the borders of the world
+    if (x < -INSTANCE_WORLD_EXTENT || x > INSTANCE_WORLD_EXTENT) {
+        store->velocityX[i] = -store->velocityX[i];
+    }
+    if (y < -INSTANCE_WORLD_EXTENT || y > INSTANCE_WORLD_EXTENT) {
+        store->velocityY[i] = -store->velocityY[i];
+    }
+
+    x = x > -INSTANCE_WORLD_EXTENT ? x : -INSTANCE_WORLD_EXTENT;
+    x = x < INSTANCE_WORLD_EXTENT ? x : INSTANCE_WORLD_EXTENT;
+    y = y > -INSTANCE_WORLD_EXTENT ? y : -INSTANCE_WORLD_EXTENT;
+    y = y < INSTANCE_WORLD_EXTENT ? y : INSTANCE_WORLD_EXTENT;
+
+    // keep rotation small so it does not lose precision over time
+    rotation = rotation - (rotation > INSTANCE_PI ? INSTANCE_TWO_PI : 0.0f);
+    rotation = rotation + (rotation < -INSTANCE_PI ? INSTANCE_TWO_PI : 0.0f);
+
+    store->x[i] = x;
+    store->y[i] = y;
+    store->rotation[i] = rotation;
+
+    transform[0] = x;
+    transform[1] = y;
+    transform[2] = rotation;
+    transform[3] = store->scale[i];
+}
+
+void instanceKernelUpdateScalar(InstanceStore* store, uint32_t begin, uint32_t end, float dt, float* transforms)
+{
+    for (uint32_t i = begin; i < end; i++)
+    {
+        updateInstance(store, i, dt, transforms + (size_t) i * 4);
+    }
+}
+
+#ifdef SIMD_X86
+
+static void instanceKernelSse2(InstanceStore* store, uint32_t begin, uint32_t end, float dt, float* transforms)
+{
+    const __m128 dtv = _mm_set1_ps(dt);
+    const __m128 lo = _mm_set1_ps(-INSTANCE_WORLD_EXTENT);
+    const __m128 hi = _mm_set1_ps(INSTANCE_WORLD_EXTENT);
+    const __m128 pi = _mm_set1_ps(INSTANCE_PI);
+    const __m128 negPi = _mm_set1_ps(-INSTANCE_PI);
+    const __m128 twoPi = _mm_set1_ps(INSTANCE_TWO_PI);
+    const __m128 sign = _mm_set1_ps(-0.0f);
+
+    uint32_t i = begin;
+    for (; i + 4 <= end; i += 4)
+    {
+        __m128 vx = _mm_loadu_ps(store->velocityX + i);
+        __m128 vy = _mm_loadu_ps(store->velocityY + i);
+
+        __m128 x = _mm_add_ps(_mm_loadu_ps(store->x + i), _mm_mul_ps(vx, dtv));
+        __m128 y = _mm_add_ps(_mm_loadu_ps(store->y + i), _mm_mul_ps(vy, dtv));
+        __m128 rotation = _mm_add_ps(_mm_loadu_ps(store->rotation + i), _mm_mul_ps(_mm_loadu_ps(store->angularVelocity + i), dtv));
+
+        __m128 outX = _mm_or_ps(_mm_cmplt_ps(x, lo), _mm_cmpgt_ps(x, hi));
+        __m128 outY = _mm_or_ps(_mm_cmplt_ps(y, lo), _mm_cmpgt_ps(y, hi));
+        _mm_storeu_ps(store->velocityX + i, _mm_xor_ps(vx, _mm_and_ps(outX, sign)));
+        _mm_storeu_ps(store->velocityY + i, _mm_xor_ps(vy, _mm_and_ps(outY, sign)));
+
+        x = _mm_min_ps(_mm_max_ps(x, lo), hi);
+        y = _mm_min_ps(_mm_max_ps(y, lo), hi);
+
+        rotation = _mm_sub_ps(rotation, _mm_and_ps(_mm_cmpgt_ps(rotation, pi), twoPi));
+        rotation = _mm_add_ps(rotation, _mm_and_ps(_mm_cmplt_ps(rotation, negPi), twoPi));
+
+        _mm_storeu_ps(store->x + i, x);
+        _mm_storeu_ps(store->y + i, y);
+        _mm_storeu_ps(store->rotation + i, rotation);
+
+        // columns -> one vec4 per instance, streamed past the cache into write combined memory
+        __m128 scale = _mm_loadu_ps(store->scale + i);
+        _MM_TRANSPOSE4_PS(x, y, rotation, scale);
+
+        float* out = transforms + (size_t) i * 4;
+        _mm_stream_ps(out + 0, x);
+        _mm_stream_ps(out + 4, y);
+        _mm_stream_ps(out + 8, rotation);
+        _mm_stream_ps(out + 12, scale);
+    }
+
+    _mm_sfence();
+
+    instanceKernelUpdateScalar(store, i, end, dt, transforms);
+}
+
+__attribute__((target("avx")))
+static void instanceKernelAvx(InstanceStore* store, uint32_t begin, uint32_t end, float dt, float* transforms)
+{
+    // 32 byte aligned output needs an even instance index
+    uint32_t i = begin;
+    if (i & 1 && i < end) {
+        instanceKernelUpdateScalar(store, i, i + 1, dt, transforms);
+        i++;
+    }
+
+    const __m256 dtv = _mm256_set1_ps(dt);
+    const __m256 lo = _mm256_set1_ps(-INSTANCE_WORLD_EXTENT);
+    const __m256 hi = _mm256_set1_ps(INSTANCE_WORLD_EXTENT);
+    const __m256 pi = _mm256_set1_ps(INSTANCE_PI);
+    const __m256 negPi = _mm256_set1_ps(-INSTANCE_PI);
+    const __m256 twoPi = _mm256_set1_ps(INSTANCE_TWO_PI);
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+
+    for (; i + 8 <= end; i += 8)
+    {
+        __m256 vx = _mm256_loadu_ps(store->velocityX + i);
+        __m256 vy = _mm256_loadu_ps(store->velocityY + i);
+
+        __m256 x = _mm256_add_ps(_mm256_loadu_ps(store->x + i), _mm256_mul_ps(vx, dtv));
+        __m256 y = _mm256_add_ps(_mm256_loadu_ps(store->y + i), _mm256_mul_ps(vy, dtv));
+        __m256 rotation = _mm256_add_ps(_mm256_loadu_ps(store->rotation + i), _mm256_mul_ps(_mm256_loadu_ps(store->angularVelocity + i), dtv));
+
+        __m256 outX = _mm256_or_ps(_mm256_cmp_ps(x, lo, _CMP_LT_OQ), _mm256_cmp_ps(x, hi, _CMP_GT_OQ));
+        __m256 outY = _mm256_or_ps(_mm256_cmp_ps(y, lo, _CMP_LT_OQ), _mm256_cmp_ps(y, hi, _CMP_GT_OQ));
+        _mm256_storeu_ps(store->velocityX + i, _mm256_xor_ps(vx, _mm256_and_ps(outX, sign)));
+        _mm256_storeu_ps(store->velocityY + i, _mm256_xor_ps(vy, _mm256_and_ps(outY, sign)));
+
+        x = _mm256_min_ps(_mm256_max_ps(x, lo), hi);
+        y = _mm256_min_ps(_mm256_max_ps(y, lo), hi);
+
+        rotation = _mm256_sub_ps(rotation, _mm256_and_ps(_mm256_cmp_ps(rotation, pi, _CMP_GT_OQ), twoPi));
+        rotation = _mm256_add_ps(rotation, _mm256_and_ps(_mm256_cmp_ps(rotation, negPi, _CMP_LT_OQ), twoPi));
+
+        _mm256_storeu_ps(store->x + i, x);
+        _mm256_storeu_ps(store->y + i, y);
+        _mm256_storeu_ps(store->rotation + i, rotation);
+
+        __m256 scale = _mm256_loadu_ps(store->scale + i);
+
+        // 4x8 -> 8x4 transpose, each 128 bit lane holds one instance after the permutes
+        __m256 xy0 = _mm256_unpacklo_ps(x, y);
+        __m256 xy1 = _mm256_unpackhi_ps(x, y);
+        __m256 rs0 = _mm256_unpacklo_ps(rotation, scale);
+        __m256 rs1 = _mm256_unpackhi_ps(rotation, scale);
+
+        __m256 i04 = _mm256_shuffle_ps(xy0, rs0, _MM_SHUFFLE(1, 0, 1, 0));
+        __m256 i15 = _mm256_shuffle_ps(xy0, rs0, _MM_SHUFFLE(3, 2, 3, 2));
+        __m256 i26 = _mm256_shuffle_ps(xy1, rs1, _MM_SHUFFLE(1, 0, 1, 0));
+        __m256 i37 = _mm256_shuffle_ps(xy1, rs1, _MM_SHUFFLE(3, 2, 3, 2));
+
+        float* out = transforms + (size_t) i * 4;
+        _mm256_stream_ps(out + 0, _mm256_permute2f128_ps(i04, i15, 0x20));
+        _mm256_stream_ps(out + 8, _mm256_permute2f128_ps(i26, i37, 0x20));
+        _mm256_stream_ps(out + 16, _mm256_permute2f128_ps(i04, i15, 0x31));
+        _mm256_stream_ps(out + 24, _mm256_permute2f128_ps(i26, i37, 0x31));
+    }
+
+    _mm_sfence();
+
+    instanceKernelUpdateScalar(store, i, end, dt, transforms);
+}
+
+#endif // SIMD_X86
+
+#ifdef SIMD_NEON
+
+static void instanceKernelNeon(InstanceStore* store, uint32_t begin, uint32_t end, float dt, float* transforms)
+{
+    const float32x4_t dtv = vdupq_n_f32(dt);
+    const float32x4_t lo = vdupq_n_f32(-INSTANCE_WORLD_EXTENT);
+    const float32x4_t hi = vdupq_n_f32(INSTANCE_WORLD_EXTENT);
+    const float32x4_t pi = vdupq_n_f32(INSTANCE_PI);
+    const float32x4_t negPi = vdupq_n_f32(-INSTANCE_PI);
+    const float32x4_t twoPi = vdupq_n_f32(INSTANCE_TWO_PI);
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+
+    uint32_t i = begin;
+    for (; i + 4 <= end; i += 4)
+    {
+        float32x4_t vx = vld1q_f32(store->velocityX + i);
+        float32x4_t vy = vld1q_f32(store->velocityY + i);
+
+        float32x4_t x = vaddq_f32(vld1q_f32(store->x + i), vmulq_f32(vx, dtv));
+        float32x4_t y = vaddq_f32(vld1q_f32(store->y + i), vmulq_f32(vy, dtv));
+        float32x4_t rotation = vaddq_f32(vld1q_f32(store->rotation + i), vmulq_f32(vld1q_f32(store->angularVelocity + i), dtv));
+
+        uint32x4_t outX = vorrq_u32(vcltq_f32(x, lo), vcgtq_f32(x, hi));
+        uint32x4_t outY = vorrq_u32(vcltq_f32(y, lo), vcgtq_f32(y, hi));
+        vst1q_f32(store->velocityX + i, vbslq_f32(outX, vnegq_f32(vx), vx));
+        vst1q_f32(store->velocityY + i, vbslq_f32(outY, vnegq_f32(vy), vy));
+
+        x = vminq_f32(vmaxq_f32(x, lo), hi);
+        y = vminq_f32(vmaxq_f32(y, lo), hi);
+
+        rotation = vsubq_f32(rotation, vbslq_f32(vcgtq_f32(rotation, pi), twoPi, zero));
+        rotation = vaddq_f32(rotation, vbslq_f32(vcltq_f32(rotation, negPi), twoPi, zero));
+
+        vst1q_f32(store->x + i, x);
+        vst1q_f32(store->y + i, y);
+        vst1q_f32(store->rotation + i, rotation);
+
+        // interleaving store writes one vec4 per instance
+        float32x4x4_t transform = {{x, y, rotation, vld1q_f32(store->scale + i)}};
+        vst4q_f32(transforms + (size_t) i * 4, transform);
+    }
+
+    instanceKernelUpdateScalar(store, i, end, dt, transforms);
+}
+
+#endif // SIMD_NEON
+
+// only written by instanceKernelSelect before any job updates instances, scalar until then
+static InstanceKernel selectedKernel = instanceKernelUpdateScalar;
+static SimdLevel selectedLevel = SIMD_LEVEL_SCALAR;
+
+void instanceKernelSelect(void)
+{
+    SimdLevel level = simdDetect();
+    InstanceKernel kernel = instanceKernelUpdateScalar;
+
+#if defined(SIMD_X86)
+    if (level == SIMD_LEVEL_AVX) {
+        kernel = instanceKernelAvx;
+    }
+    else if (level == SIMD_LEVEL_SSE2) {
+        kernel = instanceKernelSse2;
+    }
+#elif defined(SIMD_NEON)
+    kernel = instanceKernelNeon;
+#endif
+
+    selectedKernel = kernel;
+    selectedLevel = level;
+}
+
+void instanceKernelUpdate(InstanceStore* store, uint32_t begin, uint32_t end, float dt, float* transforms)
+{
+    selectedKernel(store, begin, end, dt, transforms);
+}
+
+const char* instanceKernelName(void)
+{
+    return simdLevelName(selectedLevel);
+}
+
+// carves all arrays out of one aligned block, returns 0 on allocation failure
+static int allocateArrays(InstanceStore* store, uint32_t capacity)
+{
+    float* arrays = simdAllocArrays(&capacity, 8);
+    if (arrays == NULL) {
+        return 0;
+    }
+
+    store->block = arrays;
+    store->x = arrays;
+    store->y = arrays + capacity;
+    store->rotation = arrays + capacity * 2;
+    store->scale = arrays + capacity * 3;
+    store->velocityX = arrays + capacity * 4;
+    store->velocityY = arrays + capacity * 5;
+    store->angularVelocity = arrays + capacity * 6;
+    store->color = (uint32_t*) (arrays + capacity * 7);
+
+    store->count = 0;
+    store->capacity = capacity;
+
+    return 1;
+}
+
+uint32_t instanceStoreAdd(InstanceStore* store, float x, float y, float rotation, float scale, uint32_t color,
+    float velocityX, float velocityY, float angularVelocity)
+{
+    if (store->count == store->capacity) {
+        return UINT32_MAX;
+    }
+
+    uint32_t i = store->count++;
+
+    store->x[i] = x;
+    store->y[i] = y;
+    store->rotation[i] = rotation;
+    store->scale[i] = scale;
+    store->velocityX[i] = velocityX;
+    store->velocityY[i] = velocityY;
+    store->angularVelocity[i] = angularVelocity;
+    store->color[i] = color;
+
+    store->colorVersion++;
+
+    return i;
+}
+
+static void fillRandom(InstanceStore* store, uint32_t count, uint32_t seed, float scale)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        instanceStoreAdd(store,
+            simdRandomRange(&seed, -1.2f, 1.2f), simdRandomRange(&seed, -1.2f, 1.2f), simdRandomRange(&seed, -4.0f, 4.0f), simdRandomRange(&seed, 0.01f, 0.05f) * scale,
+            seed | 0xFF000000u,
+            simdRandomRange(&seed, -0.5f, 0.5f), simdRandomRange(&seed, -0.5f, 0.5f), simdRandomRange(&seed, -2.0f, 2.0f));
+    }
+}
+
+uint32_t instanceKernelVerify(uint32_t count, uint32_t steps)
+{
+    InstanceStore reference = {0};
+    InstanceStore simd = {0};
+
+    float* referenceOut = NULL;
+    float* simdOut = NULL;
+
+    if (!allocateArrays(&reference, count) || !allocateArrays(&simd, count) ||
+        posix_memalign((void**) &referenceOut, 32, (size_t) reference.capacity * 4 * sizeof(float)) != 0 ||
+        posix_memalign((void**) &simdOut, 32, (size_t) simd.capacity * 4 * sizeof(float)) != 0) {
+        assert_my(0, "failed to allocate instance verification data", "");
+    }
+
+    fillRandom(&reference, count, 0x9E3779B9u, 1.0f);
+    fillRandom(&simd, count, 0x9E3779B9u, 1.0f);
+
+    uint32_t mismatches = 0;
+
+    for (uint32_t step = 0; step < steps; step++)
+    {
+        // odd begin exercises the scalar prologue and tail of the SIMD kernels
+        uint32_t begin = count > 1 ? 1 : 0;
+        instanceKernelUpdateScalar(&reference, 0, begin, 0.016f, referenceOut);
+        instanceKernelUpdateScalar(&reference, begin, count, 0.016f, referenceOut);
+        instanceKernelUpdateScalar(&simd, 0, begin, 0.016f, simdOut);
+        instanceKernelUpdate(&simd, begin, count, 0.016f, simdOut);
+
+        mismatches += memcmp(referenceOut, simdOut, (size_t) count * 4 * sizeof(float)) != 0;
+    }
+
+    // state arrays must match as well, velocities flip on bounces
+    mismatches += memcmp(reference.block, simd.block, (size_t) reference.capacity * sizeof(float) * 8) != 0;
+
+    free(referenceOut);
+    free(simdOut);
+    free(reference.block);
+    free(simd.block);
+
+    return mismatches;
+}
+
+void createInstanceStore(State* state, uint32_t capacity)
+{
+    InstanceStore* store = &state->instances;
+
+    instanceKernelSelect();
+    LOG("instance kernel: %s", instanceKernelName());
+
+    assert_my(allocateArrays(store, capacity), "failed to allocate instance store", "allocated instance store");
+
+    store->colorOffset = (VkDeviceSize) store->capacity * 4 * sizeof(float);
+    VkDeviceSize frameSize = store->colorOffset + (VkDeviceSize) store->capacity * sizeof(uint32_t);
+    frameSize = (frameSize + INSTANCE_REGION_ALIGNMENT - 1) & ~(VkDeviceSize) (INSTANCE_REGION_ALIGNMENT - 1);
+
+    // written by the CPU every frame, device local memory is written directly when the host can map it
+    createDynamicBuffer(state, &store->dynamic, frameSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, "instance buffer");
+
+    // colors of every frame region are out of date
+    store->colorVersion = 1;
+    memset(store->frameColorVersion, 0, sizeof(store->frameColorVersion));
+
+    if (state->animatedInstanceCount == 0) {
+        // single static instance keeps the original quad
+        instanceStoreAdd(store, 0.0f, 0.0f, 0.0f, 1.0f, 0xFFFFFFFFu, 0.0f, 0.0f, 0.0f);
+    }
+    else
+    {
+        fillRandom(store, state->animatedInstanceCount, (uint32_t) state->animatedInstanceCount * 2654435761u | 1u,
+            state->instanceScale > 0.0f ? state->instanceScale : 1.0f);
+    }
+
+    LOG("instance store: %u instances", store->count);
+}
+
+void instanceStoreBounds(const InstanceStore* store, vec3 center, vec3 extent)
+{
+    float minX = INFINITY, minY = INFINITY, maxX = -INFINITY, maxY = -INFINITY;
+
+    for (uint32_t i = 0; i < store->count; i++)
+    {
+        // unit quad rotates freely, half of its diagonal bounds it
+        float radius = store->scale[i] * 0.70710678f;
+        int moving = store->velocityX[i] != 0.0f || store->velocityY[i] != 0.0f;
+
+        float lowX = moving ? -INSTANCE_WORLD_EXTENT : store->x[i];
+        float highX = moving ? INSTANCE_WORLD_EXTENT : store->x[i];
+        float lowY = moving ? -INSTANCE_WORLD_EXTENT : store->y[i];
+        float highY = moving ? INSTANCE_WORLD_EXTENT : store->y[i];
+
+        minX = lowX - radius < minX ? lowX - radius : minX;
+        maxX = highX + radius > maxX ? highX + radius : maxX;
+        minY = lowY - radius < minY ? lowY - radius : minY;
+        maxY = highY + radius > maxY ? highY + radius : maxY;
+    }
+
+    if (store->count == 0) {
+        minX = minY = maxX = maxY = 0.0f;
+    }
+
+    center[0] = (minX + maxX) * 0.5f;
+    center[1] = (minY + maxY) * 0.5f;
+    center[2] = 0.0f;
+    extent[0] = (maxX - minX) * 0.5f;
+    extent[1] = (maxY - minY) * 0.5f;
+    extent[2] = 0.0f;
+}
+
+typedef struct InstanceUpdateJob
+{
+    InstanceStore* store;
+    float dt;
+    float* transforms;
+} InstanceUpdateJob;
+
+static void instanceUpdateRange(void* data, uint32_t begin, uint32_t end)
+{
+    InstanceUpdateJob* job = data;
+    instanceKernelUpdate(job->store, begin, end, job->dt, job->transforms);
+}
+
+void instanceStoreUpdate(State* state, uint32_t frame, float dt)
+{
+    InstanceStore* store = &state->instances;
+
+    uint8_t* region = dynamicBufferBeginFrame(&store->dynamic, frame);
+
+    InstanceUpdateJob job = {
+        .store = store,
+        .dt = dt,
+        .transforms = (float*) region
+    };
+    jobParallelFor(store->count, INSTANCE_JOB_BATCH, instanceUpdateRange, &job);
+    dynamicBufferWritten(&store->dynamic, 0, (VkDeviceSize) store->count * 4 * sizeof(float));
+
+    if (store->frameColorVersion[frame] != store->colorVersion) {
+        memcpy(region + store->colorOffset, store->color, (size_t) store->count * sizeof(uint32_t));
+        dynamicBufferWritten(&store->dynamic, store->colorOffset, (VkDeviceSize) store->count * sizeof(uint32_t));
+        store->frameColorVersion[frame] = store->colorVersion;
+    }
+}
+
+void destroyInstanceStore(State* state)
+{
+    InstanceStore* store = &state->instances;
+
+    destroyDynamicBuffer(state, &store->dynamic);
+
+    free(store->block);
+    store->block = NULL;
+}
@@ -0,0 +1,110 @@
+#ifndef __INSTANCE_H__
+#define __INSTANCE_H__
+
+#include "common.h"
+#include "dynamic.h"
+
+#include <cglm/types.h>
+#include <stdint.h>
+#include <vulkan/vulkan_core.h>
+
+// instance transforms are written per frame in flight, regions are aligned for 32 byte streaming stores
+#define INSTANCE_REGION_ALIGNMENT 256
+
+// animated instances bounce inside this square
+#define INSTANCE_WORLD_EXTENT 1.0f
+
+// structure of arrays instance data, CPU kernels animate it and write the transforms
+// straight into persistently mapped memory read as per instance vertex attributes
+typedef struct InstanceStore
+{
+    uint32_t count;
+    uint32_t capacity;
+
+    // one 32 byte aligned block, each array padded to multiple of 8 elements
+    void* block;
+    float* x;
+    float* y;
+    float* rotation;
+    float* scale;
+    float* velocityX;
+    float* velocityY;
+    float* angularVelocity;
+    // packed R8G8B8A8
+    uint32_t* color;
+
+    // bumped when colors change, colors are only copied to frame regions which are out of date
+    uint32_t colorVersion;
+    uint32_t frameColorVersion[MAX_FRAMES_IN_FLIGHT];
+
+    // per frame region -> capacity vec4 transforms (x, y, rotation, scale) followed by capacity colors,
+    // bound at dynamic.frameOffset when recording
+    DynamicBuffer dynamic;
+    VkDeviceSize colorOffset;
+} InstanceStore;
+
+/**
+ * @brief allocates structure of arrays storage and persistently mapped per frame instance buffer
+ * @details selects the SIMD kernel, make kernel_check verifies it against the scalar reference
+ * Requires:
+    - Valid logical device in state
+ * @param capacity max instances, rounded up to multiple of 8
+ */
+void createInstanceStore(State* state, uint32_t capacity);
+
+/**
+ * @brief appends instance
+ * @param color packed R8G8B8A8
+ * @return index of instance, UINT32_MAX when store is full
+ */
+uint32_t instanceStoreAdd(InstanceStore* store, float x, float y, float rotation, float scale, uint32_t color,
+    float velocityX, float velocityY, float angularVelocity);
+
+/**
+ * @brief animates all instances and writes their transforms into region of given frame in flight
+ * Requires:
+    - fence of the frame signaled, GPU no longer reads the region
+ */
+void instanceStoreUpdate(State* state, uint32_t frame, float dt);
+
+/**
+ * @brief axis aligned box containing every instance now and after any number of updates
+ * @details moving instances can reach the whole world square, static ones stay where they are
+ */
+void instanceStoreBounds(const InstanceStore* store, vec3 center, vec3 extent);
+
+/**
+ * @brief advances instances [begin, end) by dt and writes vec4 (x, y, rotation, scale) per instance into transforms
+ * @details uses widest SIMD kernel supported by the CPU (AVX, SSE2 or NEON), transforms must be 32 byte aligned
+ */
+void instanceKernelUpdate(InstanceStore* store, uint32_t begin, uint32_t end, float dt, float* transforms);
+
+/**
+ * @brief scalar reference of instanceKernelUpdate, results are bit identical
+ */
+void instanceKernelUpdateScalar(InstanceStore* store, uint32_t begin, uint32_t end, float dt, float* transforms);
+
+/**
+ * @brief picks the kernel instanceKernelUpdate runs for the widest instruction set of the CPU
+ * @details the scalar kernel runs until then, called by createInstanceStore
+ * Requires:
+    - no instance update running
+ */
+void instanceKernelSelect(void);
+
+/**
+ * @brief runs SIMD and scalar kernels on same random instances and compares the results
+ * Requires:
+    - instanceKernelSelect called, the scalar kernel would only be compared with itself
+ * @return number of mismatching values, 0 when kernels agree
+ */
+uint32_t instanceKernelVerify(uint32_t count, uint32_t steps);
+
+/**
+ * @brief name of kernel selected by instanceKernelUpdate
+ */
+const char* instanceKernelName(void);
+
+void destroyInstanceStore(State* state);
+
+#endif // __INSTANCE_H__
@@ -0,0 +1,463 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "job.h"
+
+#include "debug.h"
+#include "trace.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+// failed steal rounds before an idle worker goes to sleep
+#define JOB_SPIN_ROUNDS 256
+// sleeping workers wake up on their own after this long in case a wake up was missed
+#define JOB_SLEEP_NS 1000000
+
+#define JOB_CACHE_LINE 64
+
+struct Job
+{
+    // NULL while slot is free
+    JobFunction function;
+    JobRangeFunction rangeFunction;
+    void* data;
+    uint32_t begin;
+    uint32_t end;
+
+    JobCounter* counter;
+    // next job waiting on the same counter
+    Job* next;
+};
+
+// Chase-Lev deque, owner pushes and pops at bottom, thieves take from top
+typedef struct JobDeque
+{
+    int64_t top;
+    char padTop[JOB_CACHE_LINE - sizeof(int64_t)];
+    int64_t bottom;
+    char padBottom[JOB_CACHE_LINE - sizeof(int64_t)];
+
+    Job* jobs[JOB_DEQUE_SIZE];
+} JobDeque;
+
+typedef struct JobWorker
+{
+    JobDeque deque;
+
+    Job pool[JOB_POOL_SIZE];
+    uint32_t poolNext;
+
+    uint32_t random;
+    pthread_t thread;
+} __attribute__((aligned(JOB_CACHE_LINE))) JobWorker;
+
+static JobWorker* jobWorkers = NULL;
+static uint32_t jobWorkerCount = 0;
+static int jobRunning = 0;
+
+static int jobSleepingWorkers = 0;
+static pthread_mutex_t jobSleepMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t jobSleepCond = PTHREAD_COND_INITIALIZER;
+
+// index into jobWorkers, threads which are not workers can not submit jobs
+static __thread uint32_t jobThreadIndex = UINT32_MAX;
+
+static int dequePush(JobDeque* deque, Job* job)
+{
+    int64_t bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED);
+    int64_t top = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+
+    if (bottom - top >= JOB_DEQUE_SIZE) {
+        return 0;
+    }
+
+    __atomic_store_n(&deque->jobs[bottom & (JOB_DEQUE_SIZE - 1)], job, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+
+    return 1;
+}
+
+static Job* dequePop(JobDeque* deque)
+{
+    int64_t bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED) - 1;
+    __atomic_store_n(&deque->bottom, bottom, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    int64_t top = __atomic_load_n(&deque->top, __ATOMIC_RELAXED);
+
+    if (top > bottom) {
+        // empty
+        __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+
+    Job* job = __atomic_load_n(&deque->jobs[bottom & (JOB_DEQUE_SIZE - 1)], __ATOMIC_RELAXED);
+
+    if (top == bottom) {
+        // last job, race against thieves for it
+        if (!__atomic_compare_exchange_n(&deque->top, &top, top + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+            job = NULL;
+        }
+        __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+    }
+
+    return job;
+}
+
+static Job* dequeSteal(JobDeque* deque)
+{
+    int64_t top = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    int64_t bottom = __atomic_load_n(&deque->bottom, __ATOMIC_ACQUIRE);
+
+    if (top >= bottom) {
+        return NULL;
+    }
+
+    Job* job = __atomic_load_n(&deque->jobs[top & (JOB_DEQUE_SIZE - 1)], __ATOMIC_RELAXED);
+
+    if (!__atomic_compare_exchange_n(&deque->top, &top, top + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+        return NULL;
+    }
+
+    return job;
+}
+
+static int dequeEmpty(JobDeque* deque)
+{
+    return __atomic_load_n(&deque->bottom, __ATOMIC_ACQUIRE) <= __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+}
+
+static JobWorker* currentWorker(void)
+{
+    assert_my(jobThreadIndex < jobWorkerCount, "jobs can only be submitted from the main thread or from jobs", "");
+    return &jobWorkers[jobThreadIndex];
+}
+
+static Job* allocateJob(void)
+{
+    JobWorker* worker = currentWorker();
+    Job* job = &worker->pool[worker->poolNext++ & (JOB_POOL_SIZE - 1)];
+
+    assert_my(__atomic_load_n(&job->function, __ATOMIC_ACQUIRE) == NULL && __atomic_load_n(&job->rangeFunction, __ATOMIC_ACQUIRE) == NULL,
+        "job pool exhausted, too many unfinished jobs", "");
+
+    return job;
+}
+
+static void executeJob(Job* job);
+
+static void pushJob(Job* job)
+{
+    if (!dequePush(&currentWorker()->deque, job)) {
+        // deque full, running the job now keeps submission non blocking
+        executeJob(job);
+        return;
+    }
+
+    // pairs with the fence in workerSleep, either the sleeper sees the job or we see the sleeper
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&jobSleepingWorkers, __ATOMIC_RELAXED) > 0) {
+        pthread_mutex_lock(&jobSleepMutex);
+        pthread_cond_signal(&jobSleepCond);
+        pthread_mutex_unlock(&jobSleepMutex);
+    }
+}
+
+static void counterFinish(JobCounter* counter)
+{
+    // announced before the decrement, a waiter seeing zero pending jobs then also sees this job finishing
+    __atomic_add_fetch(&counter->finishing, 1, __ATOMIC_RELAXED);
+
+    if (__atomic_sub_fetch(&counter->pending, 1, __ATOMIC_ACQ_REL) == 0) {
+        // every thread that sees zero takes the list it finds, so each continuation is scheduled once
+        Job* continuation = __atomic_exchange_n(&counter->continuations, NULL, __ATOMIC_ACQ_REL);
+        while (continuation != NULL)
+        {
+            Job* next = continuation->next;
+            pushJob(continuation);
+            continuation = next;
+        }
+    }
+
+    // last access, the counter may be gone right after
+    __atomic_sub_fetch(&counter->finishing, 1, __ATOMIC_RELEASE);
+}
+
+static void executeJob(Job* job)
+{
+    JobCounter* counter = job->counter;
+
+    if (job->rangeFunction != NULL) {
+        job->rangeFunction(job->data, job->begin, job->end);
+    }
+    else
+    {
+        job->function(job->data);
+    }
+
+    // slot can be reused by its owner as soon as it is released
+    __atomic_store_n(&job->rangeFunction, NULL, __ATOMIC_RELAXED);
+    __atomic_store_n(&job->function, NULL, __ATOMIC_RELEASE);
+
+    if (counter != NULL) {
+        counterFinish(counter);
+    }
+}
+
+// pops own job or steals from random victim, returns 0 when no work was found
+static int runOneJob(void)
+{
+    JobWorker* worker = &jobWorkers[jobThreadIndex];
+    Job* job = dequePop(&worker->deque);
+
+    for (uint32_t attempt = 0; job == NULL && attempt < jobWorkerCount; attempt++)
+    {
+        worker->random ^= worker->random << 13;
+        worker->random ^= worker->random >> 17;
+        worker->random ^= worker->random << 5;
+
+        uint32_t victim = worker->random % jobWorkerCount;
+        if (victim != jobThreadIndex) {
+            job = dequeSteal(&jobWorkers[victim].deque);
+        }
+    }
+
+    if (job == NULL) {
+        return 0;
+    }
+
+    executeJob(job);
+    return 1;
+}
+
+static int anyJobQueued(void)
+{
+    for (uint32_t i = 0; i < jobWorkerCount; i++)
+    {
+        if (!dequeEmpty(&jobWorkers[i].deque)) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static void workerSleep(void)
+{
+    pthread_mutex_lock(&jobSleepMutex);
+
+    __atomic_add_fetch(&jobSleepingWorkers, 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    if (!anyJobQueued() && __atomic_load_n(&jobRunning, __ATOMIC_ACQUIRE)) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += JOB_SLEEP_NS;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+
+        pthread_cond_timedwait(&jobSleepCond, &jobSleepMutex, &deadline);
+    }
+
+    __atomic_sub_fetch(&jobSleepingWorkers, 1, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&jobSleepMutex);
+}
+
+static void* workerMain(void* arg)
+{
+    jobThreadIndex = (uint32_t) (uintptr_t) arg;
+
+    if (traceEnabledFlag) {
+        char name[32];
+        snprintf(name, sizeof(name), "worker %u", jobThreadIndex);
+        traceSetThreadName(name);
+    }
+
+    uint32_t idleRounds = 0;
+
+    while (__atomic_load_n(&jobRunning, __ATOMIC_ACQUIRE))
+    {
+        if (runOneJob()) {
+            idleRounds = 0;
+        }
+        else if (++idleRounds > JOB_SPIN_ROUNDS) {
+            workerSleep();
+            idleRounds = 0;
+        }
+    }
+
+    return NULL;
+}
+
+void jobSystemInit(uint32_t threadCount)
+{
+    if (threadCount == 0) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        threadCount = cores > 0 ? (uint32_t) cores : 1;
+    }
+
+    jobWorkerCount = threadCount < JOB_MAX_THREADS ? threadCount : JOB_MAX_THREADS;
+
+    void* workers = NULL;
+    assert_my(posix_memalign(&workers, JOB_CACHE_LINE, sizeof(JobWorker) * jobWorkerCount) == 0, "failed to allocate job workers", "allocated job workers");
+    jobWorkers = workers;
+
+    for (uint32_t i = 0; i < jobWorkerCount; i++)
+    {
+        JobWorker* worker = &jobWorkers[i];
+
+        worker->deque.top = 0;
+        worker->deque.bottom = 0;
+        worker->poolNext = 0;
+        worker->random = 0x9E3779B9u * (i + 1);
+
+        for (uint32_t j = 0; j < JOB_POOL_SIZE; j++)
+        {
+            worker->pool[j].function = NULL;
+            worker->pool[j].rangeFunction = NULL;
+        }
+    }
+
+    jobThreadIndex = 0;
+    __atomic_store_n(&jobRunning, 1, __ATOMIC_RELEASE);
+
+    for (uint32_t i = 1; i < jobWorkerCount; i++)
+    {
+        assert_my(pthread_create(&jobWorkers[i].thread, NULL, workerMain, (void*) (uintptr_t) i) == 0, "failed to start job worker", "started job worker");
+    }
+
+    LOG("job system: %u threads", jobWorkerCount);
+}
+
+void jobSystemShutdown(void)
+{
+    if (jobWorkers == NULL) {
+        return;
+    }
+
+    __atomic_store_n(&jobRunning, 0, __ATOMIC_RELEASE);
+
+    pthread_mutex_lock(&jobSleepMutex);
+    pthread_cond_broadcast(&jobSleepCond);
+    pthread_mutex_unlock(&jobSleepMutex);
+
+    for (uint32_t i = 1; i < jobWorkerCount; i++)
+    {
+        pthread_join(jobWorkers[i].thread, NULL);
+    }
+
+    free(jobWorkers);
+    jobWorkers = NULL;
+    jobWorkerCount = 0;
+    jobThreadIndex = UINT32_MAX;
+}
+
+uint32_t jobThreadCount(void)
+{
+    return jobWorkerCount > 0 ? jobWorkerCount : 1;
+}
+
+void jobRun(JobFunction function, void* data, JobCounter* counter)
+{
+    if (counter != NULL) {
+        __atomic_add_fetch(&counter->pending, 1, __ATOMIC_RELAXED);
+    }
+
+    Job* job = allocateJob();
+    job->function = function;
+    job->rangeFunction = NULL;
+    job->data = data;
+    job->counter = counter;
+    job->next = NULL;
+
+    pushJob(job);
+}
+
+void jobRunAfter(JobCounter* dependency, JobFunction function, void* data, JobCounter* counter)
+{
+    if (counter != NULL) {
+        __atomic_add_fetch(&counter->pending, 1, __ATOMIC_RELAXED);
+    }
+
+    Job* job = allocateJob();
+    job->function = function;
+    job->rangeFunction = NULL;
+    job->data = data;
+    job->counter = counter;
+
+    // guard keeps the dependency from completing while the job is linked in,
+    // dropping it schedules the job right away if everything already finished
+    __atomic_add_fetch(&dependency->pending, 1, __ATOMIC_ACQ_REL);
+
+    Job* head = __atomic_load_n(&dependency->continuations, __ATOMIC_RELAXED);
+    do
+    {
+        job->next = head;
+    } while (!__atomic_compare_exchange_n(&dependency->continuations, &head, job, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+    counterFinish(dependency);
+}
+
+void jobWait(JobCounter* counter)
+{
+    // threads outside the job system can only wait, they own no deque to help from
+    int canHelp = jobThreadIndex < jobWorkerCount;
+
+    while (__atomic_load_n(&counter->pending, __ATOMIC_ACQUIRE) > 0 || __atomic_load_n(&counter->finishing, __ATOMIC_ACQUIRE) > 0)
+    {
+        if (!canHelp || !runOneJob()) {
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#endif
+        }
+    }
+}
+
+void jobParallelFor(uint32_t count, uint32_t batchSize, JobRangeFunction function, void* data)
+{
+    if (batchSize == 0) {
+        batchSize = 1;
+    }
+
+    if (jobWorkers == NULL || count <= batchSize) {
+        function(data, 0, count);
+        return;
+    }
+
+    // grow batches in multiples of batchSize so callers relying on the batch alignment keep it
+    uint32_t maxBatches = JOB_POOL_SIZE / 2;
+    uint32_t batches = (count + batchSize - 1) / batchSize;
+    if (batches > maxBatches) {
+        batchSize *= (batches + maxBatches - 1) / maxBatches;
+    }
+
+    JobCounter counter = {0};
+
+    // caller runs the first batch itself, the rest is up for stealing
+    for (uint32_t begin = batchSize; begin < count; begin += batchSize)
+    {
+        __atomic_add_fetch(&counter.pending, 1, __ATOMIC_RELAXED);
+
+        Job* job = allocateJob();
+        job->function = NULL;
+        job->rangeFunction = function;
+        job->data = data;
+        job->begin = begin;
+        job->end = count - begin > batchSize ? begin + batchSize : count;
+        job->counter = &counter;
+        job->next = NULL;
+
+        pushJob(job);
+    }
+
+    function(data, 0, batchSize);
+
+    jobWait(&counter);
+}
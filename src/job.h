@@ -0,0 +1,71 @@
+#ifndef __JOB_H__
+#define __JOB_H__
+
+#include <stdint.h>
+
+// worker threads including the main thread
+#define JOB_MAX_THREADS 64
+// jobs each thread can have queued at once (must be power of two), pushing into a full deque runs the job inline
+#define JOB_DEQUE_SIZE 4096
+// job slots per thread, reused round robin so at most this many jobs submitted by one thread may be unfinished
+#define JOB_POOL_SIZE 4096
+
+typedef void (*JobFunction)(void* data);
+typedef void (*JobRangeFunction)(void* data, uint32_t begin, uint32_t end);
+
+typedef struct Job Job;
+
+// counts unfinished jobs, zero initialize before first use
+// jobs scheduled with jobRunAfter start once the counter drops to zero
+typedef struct JobCounter
+{
+    int32_t pending;
+    // finishing jobs still touching the counter after their decrement, jobWait waits for them too
+    // so the counter may go out of scope as soon as jobWait returns
+    int32_t finishing;
+    Job* continuations;
+} JobCounter;
+
+/**
+ * @brief starts worker threads, calling thread becomes worker 0
+ * @param threadCount threads executing jobs including the calling thread, 0 -> one per core
+ */
+void jobSystemInit(uint32_t threadCount);
+
+/**
+ * @brief stops and joins worker threads
+ * Requires:
+    - no jobs pending
+ */
+void jobSystemShutdown(void);
+
+/**
+ * @brief threads executing jobs including the calling thread, 1 when job system is not running
+ */
+uint32_t jobThreadCount(void);
+
+/**
+ * @brief pushes job onto calling thread's deque, idle workers steal it
+ * @param counter incremented now and decremented when job finished, may be NULL
+ * Requires:
+    - called from main thread or from a job
+ */
+void jobRun(JobFunction function, void* data, JobCounter* counter);
+
+/**
+ * @brief schedules job once all jobs counted by dependency finished, runs immediately if none are pending
+ */
+void jobRunAfter(JobCounter* dependency, JobFunction function, void* data, JobCounter* counter);
+
+/**
+ * @brief executes other jobs until counter reaches zero, never sleeps
+ */
+void jobWait(JobCounter* counter);
+
+/**
+ * @brief splits [0, count) into batches of batchSize and runs them on all threads, returns when all finished
+ * @details runs inline when job system is not running or count fits into one batch
+ */
+void jobParallelFor(uint32_t count, uint32_t batchSize, JobRangeFunction function, void* data);
+
+#endif // __JOB_H__
@@ -0,0 +1,383 @@
+#include "latency.h"
+
+#include "debug.h"
+#include "init.h"
+#include "trace.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vulkan/vulkan_core.h>
+
+// past presentation times read per call while polling
+#define LATENCY_TIMING_BATCH 8
+
+static void latencyRecord(const LatencyFrame* frame, uint64_t photonTime)
+{
+    if (frame->inputTime != 0) {
+        traceRecord(TRACE_STAGE_INPUT_TO_PHOTON, frame->frame, frame->inputTime, photonTime);
+    }
+    traceRecord(TRACE_STAGE_ACQUIRE_TO_PHOTON, frame->frame, frame->acquireTime, photonTime);
+    traceRecord(TRACE_STAGE_SUBMIT_TO_PHOTON, frame->frame, frame->submitTime, photonTime);
+}
+
+static void* latencyWaiterMain(void* arg)
+{
+    State* state = arg;
+    Latency* latency = &state->latency;
+
+    if (traceEnabledFlag) {
+        traceSetThreadName("latency");
+    }
+
+    pthread_mutex_lock(&latency->mutex);
+    for (;;)
+    {
+        while (latency->running && latency->queueHead == latency->queueTail)
+        {
+            pthread_cond_wait(&latency->queued, &latency->mutex);
+        }
+
+        if (!latency->running) {
+            break;
+        }
+
+        LatencyFrame frame = latency->queue[latency->queueTail % LATENCY_QUEUE_SIZE];
+        VkSwapchainKHR swapchain = latency->swapchain;
+        pthread_mutex_unlock(&latency->mutex);
+
+        // returns as soon as the first pixel of the frame is visible
+        VkResult rslt = latency->waitForPresent(state->device, swapchain, frame.presentId, LATENCY_WAIT_TIMEOUT_NS);
+        uint64_t photonTime = traceNow();
+
+        pthread_mutex_lock(&latency->mutex);
+
+        // a frame the display has not shown yet is waited for again unless its swapchain goes away
+        if (rslt == VK_TIMEOUT && !latency->draining) {
+            continue;
+        }
+
+        if (rslt == VK_SUCCESS) {
+            latencyRecord(&frame, photonTime);
+        }
+        else
+        {
+            latency->dropped++;
+        }
+
+        latency->queueTail++;
+        if (latency->queueHead == latency->queueTail) {
+            pthread_cond_broadcast(&latency->drained);
+        }
+    }
+    pthread_mutex_unlock(&latency->mutex);
+
+    return NULL;
+}
+
+// matches past presentation times to the queued frames, frames the driver reports nothing for are dropped
+static void latencyPoll(State* state)
+{
+    Latency* latency = &state->latency;
+
+    if (latency->mode != LATENCY_MODE_DISPLAY_TIMING || latency->queueHead == latency->queueTail) {
+        return;
+    }
+
+    VkPastPresentationTimingGOOGLE timings[LATENCY_TIMING_BATCH];
+    VkResult rslt;
+
+    do
+    {
+        uint32_t count = LATENCY_TIMING_BATCH;
+        rslt = latency->getPastPresentationTiming(state->device, latency->swapchain, &count, timings);
+        if (rslt != VK_SUCCESS && rslt != VK_INCOMPLETE) {
+            return;
+        }
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            while (latency->queueHead != latency->queueTail)
+            {
+                LatencyFrame* frame = &latency->queue[latency->queueTail % LATENCY_QUEUE_SIZE];
+                if (frame->presentId > timings[i].presentID) {
+                    break;
+                }
+
+                // display timing reports on the monotonic clock traceNow reads
+                if (frame->presentId == timings[i].presentID) {
+                    latencyRecord(frame, timings[i].actualPresentTime);
+                }
+                else
+                {
+                    latency->dropped++;
+                }
+                latency->queueTail++;
+            }
+        }
+    } while (rslt == VK_INCOMPLETE);
+}
+
+static VkBool32 latencyHasExtension(const VkExtensionProperties* available, uint32_t availableCount, const char* name)
+{
+    for (uint32_t i = 0; i < availableCount; i++)
+    {
+        if (strcmp(available[i].extensionName, name) == 0) {
+            return VK_TRUE;
+        }
+    }
+    return VK_FALSE;
+}
+
+void latencySelectMode(State* state)
+{
+    state->latency.mode = LATENCY_MODE_NONE;
+
+    uint32_t availableCount;
+    vkEnumerateDeviceExtensionProperties(state->physicalDevice, NULL, &availableCount, NULL);
+    VkExtensionProperties* available = malloc(sizeof(VkExtensionProperties) * availableCount);
+    vkEnumerateDeviceExtensionProperties(state->physicalDevice, NULL, &availableCount, available);
+
+    VkBool32 presentWait = latencyHasExtension(available, availableCount, VK_KHR_PRESENT_ID_EXTENSION_NAME) &&
+        latencyHasExtension(available, availableCount, VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+    VkBool32 displayTiming = latencyHasExtension(available, availableCount, VK_GOOGLE_DISPLAY_TIMING_EXTENSION_NAME);
+    free(available);
+
+    if (presentWait) {
+        VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures = {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR,
+            .pNext = NULL,
+        };
+
+        VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures = {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR,
+            .pNext = &presentWaitFeatures,
+        };
+
+        VkPhysicalDeviceFeatures2 supported = {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+            .pNext = &presentIdFeatures,
+        };
+
+        vkGetPhysicalDeviceFeatures2(state->physicalDevice, &supported);
+        presentWait = presentIdFeatures.presentId && presentWaitFeatures.presentWait;
+    }
+
+    if (presentWait) {
+        state->latency.mode = LATENCY_MODE_PRESENT_WAIT;
+        LOG("latency: measuring with VK_KHR_present_wait");
+    }
+    else if (displayTiming) {
+        state->latency.mode = LATENCY_MODE_DISPLAY_TIMING;
+        LOG("latency: measuring with VK_GOOGLE_display_timing");
+    }
+    else
+    {
+        LOG_WARN("latency: device can not report presentation times, only input to submit is measured");
+    }
+}
+
+void createLatency(State* state)
+{
+    Latency* latency = &state->latency;
+
+    latency->nextPresentId = 0;
+    latency->swapchain = state->targets[0].swapchain;
+    latency->queueHead = 0;
+    latency->queueTail = 0;
+    latency->dropped = 0;
+
+    if (latency->mode == LATENCY_MODE_DISPLAY_TIMING) {
+        latency->getPastPresentationTiming = (PFN_vkGetPastPresentationTimingGOOGLE) vkGetDeviceProcAddr(state->device, "vkGetPastPresentationTimingGOOGLE");
+        assert_my(latency->getPastPresentationTiming, "vkGetPastPresentationTimingGOOGLE not available", "");
+    }
+
+    if (latency->mode != LATENCY_MODE_PRESENT_WAIT) {
+        return;
+    }
+
+    latency->waitForPresent = (PFN_vkWaitForPresentKHR) vkGetDeviceProcAddr(state->device, "vkWaitForPresentKHR");
+    assert_my(latency->waitForPresent, "vkWaitForPresentKHR not available", "");
+
+    pthread_mutex_init(&latency->mutex, NULL);
+    pthread_cond_init(&latency->queued, NULL);
+    pthread_cond_init(&latency->drained, NULL);
+    latency->running = 1;
+    latency->draining = 0;
+
+    assert_my(pthread_create(&latency->waiter, NULL, latencyWaiterMain, state) == 0, "failed to start latency waiter", "started latency waiter");
+}
+
+void latencyInput(State* state)
+{
+    if (state->measureLatency && state->latency.pendingInput == 0) {
+        state->latency.pendingInput = traceNow();
+    }
+}
+
+void latencyBeginFrame(State* state, uint64_t frame)
+{
+    Latency* latency = &state->latency;
+
+    if (latency->mode == LATENCY_MODE_DISPLAY_TIMING) {
+        latencyPoll(state);
+    }
+
+    // input of a frame the first window skipped counts for the next one
+    latency->current = (LatencyFrame) {
+        .frame = frame,
+        .presentId = 0,
+        .inputTime = latency->pendingInput,
+        .acquireTime = traceNow(),
+        .submitTime = 0,
+    };
+    latency->pendingInput = 0;
+}
+
+void latencySubmitted(State* state)
+{
+    LatencyFrame* current = &state->latency.current;
+
+    current->submitTime = traceNow();
+    if (current->inputTime != 0) {
+        traceRecord(TRACE_STAGE_INPUT_TO_SUBMIT, current->frame, current->inputTime, current->submitTime);
+    }
+}
+
+void latencyChainPresent(State* state, VkPresentInfoKHR* presentInfo, RenderTarget** presented, uint32_t presentCount)
+{
+    Latency* latency = &state->latency;
+
+    if (latency->mode == LATENCY_MODE_NONE) {
+        return;
+    }
+
+    latency->current.presentId = 0;
+    for (uint32_t i = 0; i < presentCount; i++)
+    {
+        uint64_t presentId = 0;
+        if (presented[i] == &state->targets[0]) {
+            presentId = ++latency->nextPresentId;
+            latency->current.presentId = presentId;
+        }
+
+        latency->presentIds[i] = presentId;
+        latency->presentTimes[i] = (VkPresentTimeGOOGLE) {
+            .presentID = (uint32_t) presentId,
+            .desiredPresentTime = 0,
+        };
+    }
+
+    if (latency->mode == LATENCY_MODE_PRESENT_WAIT) {
+        latency->presentIdInfo = (VkPresentIdKHR) {
+            .sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR,
+            .pNext = presentInfo->pNext,
+            .swapchainCount = presentCount,
+            .pPresentIds = latency->presentIds,
+        };
+        presentInfo->pNext = &latency->presentIdInfo;
+    }
+    else
+    {
+        latency->presentTimesInfo = (VkPresentTimesInfoGOOGLE) {
+            .sType = VK_STRUCTURE_TYPE_PRESENT_TIMES_INFO_GOOGLE,
+            .pNext = presentInfo->pNext,
+            .swapchainCount = presentCount,
+            .pTimes = latency->presentTimes,
+        };
+        presentInfo->pNext = &latency->presentTimesInfo;
+    }
+}
+
+void latencyPresented(State* state, RenderTarget** presented, const VkResult* presentResults, uint32_t presentCount)
+{
+    Latency* latency = &state->latency;
+
+    if (latency->mode == LATENCY_MODE_NONE || latency->current.presentId == 0) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < presentCount; i++)
+    {
+        if (presented[i] != &state->targets[0]) {
+            continue;
+        }
+
+        // an out of date swapchain did not show the frame
+        if (presentResults[i] != VK_SUCCESS && presentResults[i] != VK_SUBOPTIMAL_KHR) {
+            return;
+        }
+    }
+
+    if (latency->mode == LATENCY_MODE_PRESENT_WAIT) {
+        pthread_mutex_lock(&latency->mutex);
+    }
+
+    // a display stuck behind is not waited for, the newest frames are what the measurement is missing
+    if (latency->queueHead - latency->queueTail == LATENCY_QUEUE_SIZE) {
+        latency->dropped++;
+    }
+    else
+    {
+        latency->swapchain = state->targets[0].swapchain;
+        latency->queue[latency->queueHead % LATENCY_QUEUE_SIZE] = latency->current;
+        latency->queueHead++;
+    }
+
+    if (latency->mode == LATENCY_MODE_PRESENT_WAIT) {
+        pthread_cond_signal(&latency->queued);
+        pthread_mutex_unlock(&latency->mutex);
+    }
+}
+
+void latencySwapchainRetired(State* state, RenderTarget* target)
+{
+    Latency* latency = &state->latency;
+
+    if (latency->mode == LATENCY_MODE_NONE || target != &state->targets[0]) {
+        return;
+    }
+
+    // times of frames already shown are still readable from the old swapchain
+    if (latency->mode == LATENCY_MODE_DISPLAY_TIMING) {
+        latencyPoll(state);
+        latency->dropped += latency->queueHead - latency->queueTail;
+        latency->queueTail = latency->queueHead;
+        return;
+    }
+
+    // waiter gives up on frames still waiting after its timeout
+    pthread_mutex_lock(&latency->mutex);
+    latency->draining = 1;
+    while (latency->queueHead != latency->queueTail)
+    {
+        pthread_cond_wait(&latency->drained, &latency->mutex);
+    }
+    latency->draining = 0;
+    pthread_mutex_unlock(&latency->mutex);
+}
+
+void destroyLatency(State* state)
+{
+    Latency* latency = &state->latency;
+
+    if (latency->mode == LATENCY_MODE_PRESENT_WAIT) {
+        latencySwapchainRetired(state, &state->targets[0]);
+
+        pthread_mutex_lock(&latency->mutex);
+        latency->running = 0;
+        pthread_cond_broadcast(&latency->queued);
+        pthread_mutex_unlock(&latency->mutex);
+
+        pthread_join(latency->waiter, NULL);
+
+        pthread_cond_destroy(&latency->drained);
+        pthread_cond_destroy(&latency->queued);
+        pthread_mutex_destroy(&latency->mutex);
+    }
+
+    if (latency->dropped > 0) {
+        LOG("latency: %llu presented frames were not measured", (unsigned long long) latency->dropped);
+    }
+}
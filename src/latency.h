@@ -0,0 +1,135 @@
+#ifndef __LATENCY_H__
+#define __LATENCY_H__
+
+#include "common.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <vulkan/vulkan_core.h>
+
+// frames of the first window waiting for their presentation time, older frames are dropped when the display falls behind
+#define LATENCY_QUEUE_SIZE 16
+// vkWaitForPresentKHR returns after this long so a retired swapchain does not block its recreation, nanoseconds
+#define LATENCY_WAIT_TIMEOUT_NS 100000000ull
+
+// how the time a frame reached the display is found
+typedef enum LatencyMode
+{
+    // only input to submit is measured
+    LATENCY_MODE_NONE,
+    // VK_KHR_present_wait, a thread waits for every frame's present id
+    LATENCY_MODE_PRESENT_WAIT,
+    // VK_GOOGLE_display_timing, past presentation times are polled every frame
+    LATENCY_MODE_DISPLAY_TIMING,
+} LatencyMode;
+
+// timestamps of one frame on the trace clock, 0 when not recorded
+typedef struct LatencyFrame
+{
+    uint64_t frame;
+    uint64_t presentId;
+    // first input handled since the previous frame
+    uint64_t inputTime;
+    uint64_t acquireTime;
+    uint64_t submitTime;
+} LatencyFrame;
+
+// input to photon measurement of the first window, results are trace stages
+typedef struct Latency
+{
+    int mode;
+
+    // first input since the last frame, taken in the GLFW callback
+    uint64_t pendingInput;
+    // frame being recorded
+    LatencyFrame current;
+    uint64_t nextPresentId;
+
+    // chained into the present info, one entry per presented swapchain
+    VkPresentIdKHR presentIdInfo;
+    uint64_t presentIds[MAX_RENDER_TARGETS];
+    VkPresentTimesInfoGOOGLE presentTimesInfo;
+    VkPresentTimeGOOGLE presentTimes[MAX_RENDER_TARGETS];
+
+    PFN_vkWaitForPresentKHR waitForPresent;
+    PFN_vkGetPastPresentationTimingGOOGLE getPastPresentationTiming;
+    // swapchain of the first window the queued frames were presented to
+    VkSwapchainKHR swapchain;
+
+    // presented frames, consumed by the waiter thread or by polling, protected by mutex
+    pthread_t waiter;
+    int running;
+    // set while the swapchain is about to be destroyed, frames still waiting are dropped
+    int draining;
+    pthread_mutex_t mutex;
+    pthread_cond_t queued;
+    pthread_cond_t drained;
+    LatencyFrame queue[LATENCY_QUEUE_SIZE];
+    uint32_t queueHead;
+    uint32_t queueTail;
+
+    // frames dropped because the queue was full or the swapchain was recreated
+    uint64_t dropped;
+} Latency;
+
+/**
+ * @brief picks how presentation times of the first window are found, VK_KHR_present_wait before VK_GOOGLE_display_timing
+ * @details sets state->latency.mode, createLogicalDevice enables the extensions and features of the mode
+ * Requires:
+    - state->measureLatency set
+    - physical device selected
+ */
+void latencySelectMode(State* state);
+
+/**
+ * @brief loads the functions of the mode and starts the thread waiting for presented frames
+ * Requires:
+    - logical device and render targets created
+ */
+void createLatency(State* state);
+
+/**
+ * @brief remembers the time of the first input since the last measured frame
+ * @details called from the GLFW input callbacks, GLFW does not timestamp events
+ */
+void latencyInput(State* state);
+
+/**
+ * @brief starts measuring a frame once the first window acquired its image, collects polled presentation times
+ */
+void latencyBeginFrame(State* state, uint64_t frame);
+
+/**
+ * @brief records the submission of the measured frame and its input to submit latency
+ */
+void latencySubmitted(State* state);
+
+/**
+ * @brief chains present ids into presentInfo, only the first window's swapchain gets a non zero id
+ * Requires:
+    - latencyBeginFrame called this frame
+ */
+void latencyChainPresent(State* state, VkPresentInfoKHR* presentInfo, RenderTarget** presented, uint32_t presentCount);
+
+/**
+ * @brief queues the measured frame when the first window presented it
+ * Requires:
+    - presentInfo chained with latencyChainPresent
+ */
+void latencyPresented(State* state, RenderTarget** presented, const VkResult* presentResults, uint32_t presentCount);
+
+/**
+ * @brief finishes or drops the frames queued for target's swapchain before it is destroyed
+ * Requires:
+    - device idle
+ */
+void latencySwapchainRetired(State* state, RenderTarget* target);
+
+/**
+ * @brief stops the waiting thread
+ * Requires:
+    - device idle
+ */
+void destroyLatency(State* state);
+
+#endif // __LATENCY_H__
@@ -0,0 +1,237 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "log.h"
+#include "debug.h"
+
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// one message in the ring, sequence tells producers and the consumer whose turn the slot is
+typedef struct LogSlot
+{
+    uint64_t sequence;
+
+    int level;
+    int line;
+    const char* file;
+    const char* func;
+
+    char message[LOG_MESSAGE_SIZE];
+} LogSlot;
+
+int logLevel = LOG_LEVEL_INFO;
+
+static LogSlot logRing[LOG_RING_SIZE];
+static uint64_t logEnqueuePos = 0;
+static uint64_t logDequeuePos = 0;
+static uint64_t logDropped = 0;
+
+static int logRunning = 0;
+static pthread_t logThread;
+// serializes consumers (background thread and fatal/shutdown flushes), producers never take it
+static pthread_mutex_t logDrainMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static const char* logLevelNames[] = {"error", "warn", "info", "debug"};
+
+static void logOutput(int level, const char* file, const char* func, int line, const char* message)
+{
+    switch (level)
+    {
+    case LOG_LEVEL_ERROR:
+        fprintf(stderr, ERRMSG("%s") " in %s->%s on line %d\n", message, file, func, line);
+        break;
+    case LOG_LEVEL_WARN:
+        fprintf(stderr, WARNMSG("%s") " in %s->%s on line %d\n", message, file, func, line);
+        break;
+    default:
+        fprintf(stdout, SUCCESMSG("%s") "\n", message);
+        break;
+    }
+}
+
+// consumes messages from the ring, caller must hold logDrainMutex
+static uint32_t logDrainLocked(void)
+{
+    uint32_t drained = 0;
+
+    for (;;)
+    {
+        LogSlot* slot = &logRing[logDequeuePos & (LOG_RING_SIZE - 1)];
+        uint64_t sequence = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+
+        if (sequence != logDequeuePos + 1) {
+            break;
+        }
+
+        logOutput(slot->level, slot->file, slot->func, slot->line, slot->message);
+
+        // hand slot back to producers for next lap of the ring
+        __atomic_store_n(&slot->sequence, logDequeuePos + LOG_RING_SIZE, __ATOMIC_RELEASE);
+        logDequeuePos++;
+        drained++;
+    }
+
+    if (drained) {
+        fflush(stdout);
+    }
+
+    return drained;
+}
+
+static void logDrain(void)
+{
+    pthread_mutex_lock(&logDrainMutex);
+    logDrainLocked();
+    pthread_mutex_unlock(&logDrainMutex);
+}
+
+static void* logThreadMain(void* arg)
+{
+    (void) arg;
+    struct timespec idle = {.tv_sec = 0, .tv_nsec = 1000000};
+
+    while (__atomic_load_n(&logRunning, __ATOMIC_ACQUIRE))
+    {
+        pthread_mutex_lock(&logDrainMutex);
+        uint32_t drained = logDrainLocked();
+        pthread_mutex_unlock(&logDrainMutex);
+
+        if (drained == 0) {
+            nanosleep(&idle, NULL);
+        }
+    }
+
+    return NULL;
+}
+
+void logInit(void)
+{
+    for (uint64_t i = 0; i < LOG_RING_SIZE; i++)
+    {
+        logRing[i].sequence = i;
+    }
+
+    logEnqueuePos = 0;
+    logDequeuePos = 0;
+
+    __atomic_store_n(&logRunning, 1, __ATOMIC_RELEASE);
+    if (pthread_create(&logThread, NULL, logThreadMain, NULL) != 0) {
+        // fall back to synchronous logging
+        __atomic_store_n(&logRunning, 0, __ATOMIC_RELEASE);
+    }
+}
+
+void logShutdown(void)
+{
+    if (__atomic_exchange_n(&logRunning, 0, __ATOMIC_ACQ_REL)) {
+        pthread_join(logThread, NULL);
+    }
+
+    logDrain();
+
+    uint64_t dropped = __atomic_load_n(&logDropped, __ATOMIC_RELAXED);
+    if (dropped) {
+        fprintf(stderr, WARNMSG("log ring buffer was full, %llu messages dropped") "\n", (unsigned long long) dropped);
+    }
+}
+
+// returns 0 when the ring is full
+static int logEnqueue(int level, const char* file, const char* func, int line, const char* format, va_list args)
+{
+    uint64_t pos = __atomic_load_n(&logEnqueuePos, __ATOMIC_RELAXED);
+    LogSlot* slot;
+
+    // bounded multi producer queue, claim slot whose sequence matches our position
+    for (;;)
+    {
+        slot = &logRing[pos & (LOG_RING_SIZE - 1)];
+        uint64_t sequence = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+        int64_t diff = (int64_t) (sequence - pos);
+
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&logEnqueuePos, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        }
+        else if (diff < 0) {
+            // ring is full, never block the caller
+            return 0;
+        }
+        else
+        {
+            pos = __atomic_load_n(&logEnqueuePos, __ATOMIC_RELAXED);
+        }
+    }
+
+    slot->level = level;
+    slot->file = file;
+    slot->func = func;
+    slot->line = line;
+    vsnprintf(slot->message, LOG_MESSAGE_SIZE, format, args);
+
+    __atomic_store_n(&slot->sequence, pos + 1, __ATOMIC_RELEASE);
+
+    return 1;
+}
+
+void logWrite(int level, const char* file, const char* func, int line, const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+
+    int queued = 0;
+    if (__atomic_load_n(&logRunning, __ATOMIC_ACQUIRE)) {
+        va_list queueArgs;
+        va_copy(queueArgs, args);
+        queued = logEnqueue(level, file, func, line, format, queueArgs);
+        va_end(queueArgs);
+
+        // only chatter is dropped on overflow, warnings and errors are written directly
+        if (!queued && level > LOG_LEVEL_WARN) {
+            __atomic_fetch_add(&logDropped, 1, __ATOMIC_RELAXED);
+            queued = 1;
+        }
+    }
+
+    if (!queued) {
+        char message[LOG_MESSAGE_SIZE];
+        vsnprintf(message, sizeof(message), format, args);
+        logOutput(level, file, func, line, message);
+    }
+
+    va_end(args);
+}
+
+void logFatal(const char* file, const char* func, int line, const char* format, ...)
+{
+    char message[LOG_MESSAGE_SIZE];
+
+    va_list args;
+    va_start(args, format);
+    vsnprintf(message, sizeof(message), format, args);
+    va_end(args);
+
+    // keep ordering, everything logged before the failure is written first
+    logDrain();
+    logOutput(LOG_LEVEL_ERROR, file, func, line, message);
+    fflush(stderr);
+
+    exit(EXIT_FAILURE);
+}
+
+int logParseLevel(const char* name)
+{
+    for (int i = 0; i < (int) (sizeof(logLevelNames) / sizeof(logLevelNames[0])); i++)
+    {
+        if (strcmp(name, logLevelNames[i]) == 0) {
+            return i;
+        }
+    }
+
+    return -1;
+}
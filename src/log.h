@@ -0,0 +1,53 @@
+#ifndef __LOG_H__
+#define __LOG_H__
+
+#include <stdint.h>
+
+// log levels, plain defines so they can be compared by the preprocessor
+#define LOG_LEVEL_ERROR 0
+#define LOG_LEVEL_WARN  1
+#define LOG_LEVEL_INFO  2
+#define LOG_LEVEL_DEBUG 3
+
+// messages above this level are compiled out entirely (-DLOG_COMPILE_LEVEL=LOG_LEVEL_INFO for release)
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL LOG_LEVEL_DEBUG
+#endif
+
+// number of messages the ring buffer holds before producers start dropping (must be power of two)
+#define LOG_RING_SIZE 1024
+#define LOG_MESSAGE_SIZE 240
+
+// runtime level, messages above it are skipped before any formatting happens
+extern int logLevel;
+
+/**
+ * @brief starts background thread draining the log ring buffer
+ * @details until called (and after logShutdown) messages are written synchronously
+ */
+void logInit(void);
+
+/**
+ * @brief stops background thread and writes all pending messages
+ */
+void logShutdown(void);
+
+/**
+ * @brief formats message into the ring buffer, never blocks, drops message when ring is full
+ */
+void logWrite(int level, const char* file, const char* func, int line, const char* format, ...)
+    __attribute__((format(printf, 5, 6)));
+
+/**
+ * @brief writes all pending messages followed by this one with source location and exits with failure
+ */
+void logFatal(const char* file, const char* func, int line, const char* format, ...)
+    __attribute__((format(printf, 4, 5), noreturn));
+
+/**
+ * @brief parses level name (error, warn, info, debug)
+ * @return level or -1 if name is unknown
+ */
+int logParseLevel(const char* name);
+
+#endif // __LOG_H__
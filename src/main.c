@@ -6,6 +6,11 @@
  * 
  */
 
+// clock_nanosleep
+#define _POSIX_C_SOURCE 200112L
+
+#include "capture.h"
+#include "export.h"
 #include "debug.h"
 #include "utils.h"
 #include <cglm/types.h>
@@ -13,6 +18,9 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
 
 #include <cglm/cglm.h>
 #include <vulkan/vulkan_core.h>
@@ -20,28 +28,373 @@
 #include <GLFW/glfw3.h>
 
 #include "init.h"
+#include "alloc.h"
+#include "batch.h"
+#include "encoder.h"
+#include "instance.h"
+#include "job.h"
+#include "postprocess.h"
+#include "latency.h"
+#include "texture.h"
+#include "trace.h"
+#include "uniform.h"
+#include "visibility.h"
 
 void drawFrame(State* state);
 uint32_t currentFrame = 0;
+// number of frames drawn since start, used to correlate trace events
+uint64_t frameCount = 0;
+// animation clock starts at zero, windows or not
+uint64_t startTime = 0;
+
+// run ends as soon as any window is closed
+static int windowsShouldClose(State* state)
+{
+    for (uint32_t i = 0; i < state->windowCount; i++)
+    {
+        if (glfwWindowShouldClose(state->targets[i].window)) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+// waits for the start of the next frame of a capped frame rate, late frames restart the schedule instead of catching up
+static void waitFrameDeadline(uint64_t* deadline, uint64_t period)
+{
+    uint64_t now = traceNow();
+
+    if (now >= *deadline) {
+        *deadline = now + period;
+        return;
+    }
+
+    if (*deadline - now > FRAME_CAP_SPIN_NS) {
+        uint64_t wake = *deadline - FRAME_CAP_SPIN_NS;
+        struct timespec wakeTime = {
+            .tv_sec = (time_t) (wake / 1000000000ull),
+            .tv_nsec = (long) (wake % 1000000000ull),
+        };
+
+        // absolute deadline, an interrupted sleep simply continues
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wakeTime, NULL) == EINTR) {}
+    }
+
+    while (traceNow() < *deadline) {}
+
+    *deadline += period;
+}
 
-int main(void)
+// dashboard stand in, small animated cells wrapping over the first target, second half blends additively
+static void buildHud(State* state)
+{
+    VkExtent2D extent = state->targets[0].extent;
+    uint32_t columns = extent.width / HUD_CELL_PITCH > 0 ? extent.width / HUD_CELL_PITCH : 1;
+    uint32_t rows = extent.height / HUD_CELL_PITCH > 0 ? extent.height / HUD_CELL_PITCH : 1;
+    uint32_t tick = (uint32_t) (state->time * 60.0f);
+    uint32_t column = 0;
+    uint32_t row = 0;
+
+    for (uint32_t i = 0; i < state->hudQuads; i++)
+    {
+        if (i == state->hudQuads / 2) {
+            batchSetBlend(state, PIPELINE_BLEND_ADDITIVE);
+        }
+
+        uint32_t level = (i * 37u + tick) & 0xFFu;
+        uint32_t color = level | (255u - level) << 8 | ((i * 11u) & 0xFFu) << 16 | 0xC0u << 24;
+
+        if (!batchQuad(state, (float) (column * HUD_CELL_PITCH), (float) (row * HUD_CELL_PITCH), HUD_CELL_SIZE, HUD_CELL_SIZE, color)) {
+            break;
+        }
+
+        // counters instead of divisions, the loop runs tens of thousands of times per frame
+        if (++column == columns) {
+            column = 0;
+            row = row + 1 == rows ? 0 : row + 1;
+        }
+    }
+}
+
+int main(int argc, char** argv)
 { 
     State state = {
         .allocator = NULL
     };
 
+    // path of Chrome/Perfetto trace written on exit, tracing is disabled when NULL
+    const char* tracePath = NULL;
+    // texture streamed in and applied to the scene once uploaded
+    const char* texturePath = NULL;
+    // threads running jobs including the main thread, 0 -> one per core
+    uint32_t jobThreads = 0;
+    // every frame is written into the directory when set
+    CaptureFileWriter captureWriter = {
+        .format = CAPTURE_FILE_PNG
+    };
+    // frames are shared with a consumer process connecting to this socket when set
+    const char* exportPath = NULL;
+    // stop after this many frames, 0 -> until a window is closed
+    uint64_t frameLimit = 0;
+    // frames per second drawn at most, 0 -> as fast as presentation allows
+    uint32_t maxFps = 0;
+    // per stage statistics written on exit for the bench scripts when set
+    const char* summaryPath = NULL;
+    // every target is recreated each this many frames, 0 -> only when out of date
+    uint64_t recreateInterval = 0;
+    int windowsSet = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            tracePath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--texture") == 0 && i + 1 < argc) {
+            texturePath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--instances") == 0 && i + 1 < argc) {
+            state.animatedInstanceCount = (uint32_t) strtoul(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            jobThreads = (uint32_t) strtoul(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+            snprintf(captureWriter.directory, sizeof(captureWriter.directory), "%s", argv[++i]);
+            state.captureFrames = VK_TRUE;
+        }
+        else if (strcmp(argv[i], "--capture-format") == 0 && i + 1 < argc && (strcmp(argv[i + 1], "png") == 0 || strcmp(argv[i + 1], "pam") == 0)) {
+            captureWriter.format = strcmp(argv[++i], "png") == 0 ? CAPTURE_FILE_PNG : CAPTURE_FILE_PAM;
+        }
+        else if (strcmp(argv[i], "--export") == 0 && i + 1 < argc) {
+            exportPath = argv[++i];
+            state.exportFrames = VK_TRUE;
+        }
+        else if (strcmp(argv[i], "--windows") == 0 && i + 1 < argc) {
+            state.windowCount = (uint32_t) strtoul(argv[++i], NULL, 10);
+            windowsSet = 1;
+        }
+        else if (strcmp(argv[i], "--headless") == 0 && i + 1 < argc) {
+            state.headlessCount = (uint32_t) strtoul(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            frameLimit = strtoull(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "--dynamic-rendering") == 0) {
+            state.useDynamicRendering = VK_TRUE;
+        }
+        else if (strcmp(argv[i], "--depth") == 0) {
+            state.useDepth = VK_TRUE;
+        }
+        else if (strcmp(argv[i], "--on-demand") == 0) {
+            state.onDemand = VK_TRUE;
+        }
+        else if (strcmp(argv[i], "--max-fps") == 0 && i + 1 < argc) {
+            maxFps = (uint32_t) strtoul(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "--instance-scale") == 0 && i + 1 < argc) {
+            state.instanceScale = strtof(argv[++i], NULL);
+        }
+        else if (strcmp(argv[i], "--recreate-every") == 0 && i + 1 < argc) {
+            recreateInterval = strtoull(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "--summary") == 0 && i + 1 < argc) {
+            summaryPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--null-backend") == 0) {
+            state.nullBackend = VK_TRUE;
+        }
+        else if (strcmp(argv[i], "--hud") == 0 && i + 1 < argc) {
+            state.hudQuads = (uint32_t) strtoul(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "--vertex-pulling") == 0) {
+            state.vertexPulling = VK_TRUE;
+        }
+        else if (strcmp(argv[i], "--force-staging") == 0) {
+            state.forceStaging = VK_TRUE;
+        }
+        else if (strcmp(argv[i], "--latency") == 0) {
+            state.measureLatency = VK_TRUE;
+        }
+        else if (strcmp(argv[i], "--async-compute") == 0) {
+            state.asyncCompute = VK_TRUE;
+        }
+        else if (strcmp(argv[i], "--pipeline-cache") == 0 && i + 1 < argc) {
+            state.pipelineCachePath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--log-level") == 0 && i + 1 < argc && logParseLevel(argv[i + 1]) >= 0) {
+            logLevel = logParseLevel(argv[++i]);
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [--trace trace.json] [--log-level error|warn|info|debug] [--dynamic-rendering] [--depth] [--texture file.ktx2|file.pam] [--instances count] [--instance-scale factor] [--threads count] [--capture directory] [--capture-format png|pam] [--export socket] [--windows count] [--headless count] [--frames count] [--pipeline-cache file] [--async-compute] [--on-demand] [--max-fps fps] [--latency] [--recreate-every frames] [--summary stats.tsv] [--null-backend] [--force-staging] [--vertex-pulling] [--hud quads]\n", argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // latencies and bench statistics are reported as trace stages
+    if (tracePath != NULL || state.measureLatency || summaryPath != NULL) {
+        traceSetEnabled(1);
+        traceSetThreadName("main");
+    }
+
+    // one window unless targets were asked for, --headless alone renders without any window
+    if (!windowsSet) {
+        state.windowCount = state.headlessCount > 0 ? 0 : 1;
+    }
+
+    if (state.windowCount == 0 && frameLimit == 0) {
+        fprintf(stderr, "headless runs need --frames\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // nothing is executed, there is no image a window could show
+    if (state.nullBackend && state.windowCount > 0) {
+        fprintf(stderr, "--null-backend renders headless targets only, use --headless without --windows\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // both replace the image the scene is rendered into
+    if (state.asyncCompute && state.exportFrames) {
+        fprintf(stderr, "--async-compute can not be combined with --export\n");
+        exit(EXIT_FAILURE);
+    }
+
+    logInit();
+    jobSystemInit(jobThreads);
+
+    // nothing wakes a headless run, it has to keep drawing to reach --frames
+    if (state.onDemand && state.windowCount == 0) {
+        LOG_WARN("on demand rendering needs a window, headless targets draw every frame");
+        state.onDemand = VK_FALSE;
+    }
+
+    // only presentation to a window can be measured
+    if (state.measureLatency && state.windowCount == 0) {
+        LOG_WARN("latency measurement needs a window, it is disabled");
+        state.measureLatency = VK_FALSE;
+    }
+
+    // exported images replace the swapchain image as attachment, framebuffers would be bound to the latter
+    if (state.exportFrames && !state.useDynamicRendering) {
+        LOG("frame export enables dynamic rendering");
+        state.useDynamicRendering = VK_TRUE;
+    }
+
+    // the tonemap is fed through render graph barriers
+    if (state.asyncCompute && !state.useDynamicRendering) {
+        LOG("async compute enables dynamic rendering");
+        state.useDynamicRendering = VK_TRUE;
+    }
 
     init(&state);
 
-    while (!glfwWindowShouldClose(state.window))
+    if (state.captureFrames) {
+        createCapture(&state, captureFileCallback, &captureWriter, CAPTURE_DEFAULT_ENCODERS);
+    }
+
+    if (state.exportFrames) {
+        createFrameExport(&state, exportPath);
+    }
+
+    if (state.asyncCompute) {
+        createPostProcess(&state);
+    }
+
+    if (state.measureLatency) {
+        createLatency(&state);
+    }
+
+    uint32_t sceneTexture = texturePath != NULL ? textureRequest(&state, texturePath) : TEXTURE_INVALID_HANDLE;
+
+    startTime = traceNow();
+    uint64_t framePeriod = maxFps > 0 ? 1000000000ull / maxFps : 0;
+    uint64_t frameDeadline = startTime;
+
+    // first frame is always drawn
+    requestRedraw(&state);
+
+    // call counts of the null backend cover the frame loop, not initialization
+    dispatchResetCalls();
+
+    while (!windowsShouldClose(&state) && (frameLimit == 0 || frameCount < frameLimit))
     {
         // Proccess all pending events
-        glfwPollEvents();
+        // with nothing to draw the thread sleeps until input arrives, the timeout notices finished texture uploads
+        if (state.windowCount > 0 && needsFrame(&state)) {
+            glfwPollEvents();
+        }
+        else if (state.windowCount > 0) {
+            glfwWaitEventsTimeout(ON_DEMAND_WAIT_TIMEOUT);
+        }
+
+        // scene is drawn untextured until the upload finished
+        textureStreamerUpdate(&state);
+        if (sceneTexture != TEXTURE_INVALID_HANDLE) {
+            uint32_t textureIndex = textureBindlessIndex(&state, sceneTexture);
+            if (textureIndex != state.draws[0].textureIndex) {
+                state.draws[0].textureIndex = textureIndex;
+                requestRedraw(&state);
+            }
+        }
+
+        if (!needsFrame(&state)) {
+            continue;
+        }
+
+        if (framePeriod > 0) {
+            TRACE_BEGIN(capStart);
+            waitFrameDeadline(&frameDeadline, framePeriod);
+            TRACE_END(capStart, TRACE_STAGE_FRAME_CAP, frameCount);
+        }
+
+        // steady state frames and recreations must not touch the heap, fatal under DEBUG_ALLOC
+        VkBool32 steadyState = frameCount >= ALLOC_GUARD_WARMUP_FRAMES;
+        if (steadyState) {
+            ALLOC_GUARD_BEGIN("steady state frame");
+        }
+
+        // swapchain recreation storm of the bench, resizes are handled where they are detected
+        if (recreateInterval > 0 && frameCount > 0 && frameCount % recreateInterval == 0) {
+            for (uint32_t i = 0; i < state.targetCount; i++)
+            {
+                TRACE_BEGIN(recreateStart);
+                recreateRenderTarget(&state, &state.targets[i]);
+                TRACE_END(recreateStart, TRACE_STAGE_RECREATE_SWAPCHAIN, frameCount);
+            }
+        }
+
         drawFrame(&state);
 
+        if (steadyState) {
+            ALLOC_GUARD_END();
+        }
+
     }
 
     vkDeviceWaitIdle(state.device);
+
+    jobSystemShutdown();
+
+    if (tracePath != NULL || state.measureLatency) {
+        tracePrintSummary(stdout);
+    }
+
+    if (state.nullBackend) {
+        dispatchPrintCalls(stdout, frameCount);
+    }
+
+    if (tracePath != NULL || state.nullBackend) {
+        encoderPrintStats(stdout, &state.encoder, frameCount);
+    }
+
+    if (summaryPath != NULL) {
+        assert_my(traceWriteSummary(summaryPath) == 0, "failed to write summary", "wrote summary");
+    }
+
+    if (tracePath != NULL) {
+        assert_my(traceWriteChromeJson(tracePath) == 0, "failed to write trace", "wrote trace");
+    }
     
     cleanUp(&state);
 
@@ -49,6 +402,65 @@ int main(void)
 }
 
 
+// single vkQueuePresentKHR for all windows rendered this frame
+static void presentTargets(State* state, VkSemaphore* renderFinished, VkSwapchainKHR* swapchains, uint32_t* imageIndices,
+    RenderTarget** presented, uint32_t presentCount)
+{
+    // waits on : image rendered
+    // signals: nothing
+    // per swapchain results, one window going out of date does not hide the others' results
+    VkResult presentResults[MAX_RENDER_TARGETS];
+    VkPresentInfoKHR presentInf = {
+        .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
+        .pNext = NULL,
+
+        .waitSemaphoreCount = presentCount,
+        .pWaitSemaphores = renderFinished,
+
+        .swapchainCount = presentCount,
+        .pSwapchains = swapchains,
+        .pImageIndices = imageIndices,
+
+        .pResults = presentResults,
+    };
+
+    if (state->measureLatency) {
+        latencyChainPresent(state, &presentInf, presented, presentCount);
+    }
+
+    // present queue is the graphics queue unless that family can not present
+    TRACE_BEGIN(presentStart);
+    VkResult queuePresentRslt = vkQueuePresentKHR(state->presentQueue, &presentInf);
+    TRACE_END(presentStart, TRACE_STAGE_PRESENT, frameCount);
+
+    if (queuePresentRslt != VK_SUCCESS && queuePresentRslt != VK_SUBOPTIMAL_KHR && queuePresentRslt != VK_ERROR_OUT_OF_DATE_KHR)
+    {
+        assert_my(0, "failed to present swap chain image", "");
+    }
+
+    // queued before an out of date swapchain is recreated
+    if (state->measureLatency) {
+        latencyPresented(state, presented, presentResults, presentCount);
+    }
+
+    for (uint32_t i = 0; i < presentCount; i++)
+    {
+        RenderTarget* target = presented[i];
+
+        if (presentResults[i] == VK_ERROR_OUT_OF_DATE_KHR || presentResults[i] == VK_SUBOPTIMAL_KHR || target->frameBufferResized)
+        {
+            target->frameBufferResized = VK_FALSE;
+            TRACE_BEGIN(recreateStart);
+            recreateRenderTarget(state, target);
+            TRACE_END(recreateStart, TRACE_STAGE_RECREATE_SWAPCHAIN, frameCount);
+        } 
+        else if (presentResults[i] != VK_SUCCESS)
+        {
+            assert_my(0, "failed to present swap chain image", "");
+        }
+    }
+}
+
 void drawFrame(State* state)
 {
     // overview of draw frame function
@@ -58,80 +470,215 @@ void drawFrame(State* state)
     // submit the recorded command buffer
     // present swapchain image
 
+    TRACE_BEGIN(frameStart);
+
+    TRACE_BEGIN(fenceStart);
     vkWaitForFences(state->device, 1, state->syncFenInFlight + currentFrame, VK_TRUE, UINT64_MAX);
+    TRACE_END(fenceStart, TRACE_STAGE_FENCE_WAIT, frameCount);
 
-    // refers to vkImage in swapchian images array (state.swapchainImages)
-    // image index
-    uint32_t imgIndex;
-    VkResult acquireImagerslt = vkAcquireNextImageKHR(state->device, state->swapchain, UINT64_MAX , state->syncSemImgAvail[currentFrame], NULL, &imgIndex);
+    // GPU finished with this frame's uniform and instance regions
+    uniformRingBeginFrame(state, currentFrame);
 
-    if (acquireImagerslt == VK_ERROR_OUT_OF_DATE_KHR) {
-        recreateSwapchain(state);
-        return;
-    } 
-    else if ((acquireImagerslt != VK_SUCCESS) && (acquireImagerslt != VK_SUBOPTIMAL_KHR))
+    // copy recorded MAX_FRAMES_IN_FLIGHT frames ago landed, encoders take it from here
+    if (state->captureFrames) {
+        captureCollect(state, currentFrame);
+    }
+
+    // without sync files the consumer learns about a frame once its fence signaled
+    if (state->exportFrames) {
+        frameExportCollect(state, currentFrame);
+    }
+
+    // images of this frame in flight are still read by the tonemap of the frame which rendered them
+    if (state->asyncCompute) {
+        postProcessBeginFrame(state, currentFrame);
+    }
+
+    // clamped so a stall does not teleport instances through the world borders
+    float now = (float) ((double) (traceNow() - startTime) * 1e-9);
+    float dt = now - state->time < 0.1f ? now - state->time : 0.1f;
+    state->time = now;
+
+    TRACE_BEGIN(instancesStart);
+    instanceStoreUpdate(state, currentFrame, dt);
+    TRACE_END(instancesStart, TRACE_STAGE_INSTANCES, frameCount);
+
+    TRACE_BEGIN(cullStart);
+    visibilityCull(&state->visibility, state->viewTransform);
+    TRACE_END(cullStart, TRACE_STAGE_CULL, frameCount);
+
+    if (state->hudQuads > 0) {
+        TRACE_BEGIN(batchStart);
+        batchBegin(state, currentFrame);
+        buildHud(state);
+        batchEnd(state);
+        TRACE_END(batchStart, TRACE_STAGE_BATCH, frameCount);
+    }
+
+    // every window acquires its image, one submission renders all targets and one present shows all windows
+    VkSemaphore waitSemaphores[MAX_RENDER_TARGETS + 1];
+    VkPipelineStageFlags waitStages[MAX_RENDER_TARGETS + 1];
+    VkSemaphore signalSemaphores[MAX_RENDER_TARGETS + 2];
+    VkSwapchainKHR swapchains[MAX_RENDER_TARGETS];
+    uint32_t imageIndices[MAX_RENDER_TARGETS];
+    RenderTarget* presented[MAX_RENDER_TARGETS];
+    uint32_t presentCount = 0;
+    uint32_t renderCount = 0;
+
+    TRACE_BEGIN(acquireStart);
+    for (uint32_t i = 0; i < state->targetCount; i++)
     {
-        assert_my(-1, "failed to acquire swapchain image", "");
+        RenderTarget* target = &state->targets[i];
+
+        // headless image of this frame in flight is free since the fence wait
+        if (target->window == NULL) {
+            target->imageIndex = currentFrame % target->swapchainImageCount;
+            renderCount++;
+            continue;
+        }
+
+        // refers to vkImage in swapchian images array (target->swapchainImages)
+        VkResult acquireImagerslt = vkAcquireNextImageKHR(state->device, target->swapchain, UINT64_MAX , target->syncSemImgAvail[currentFrame], NULL, &target->imageIndex);
+
+        // other windows still get their frame, this one is rebuilt and skipped
+        if (acquireImagerslt == VK_ERROR_OUT_OF_DATE_KHR) {
+            TRACE_BEGIN(recreateStart);
+            recreateRenderTarget(state, target);
+            TRACE_END(recreateStart, TRACE_STAGE_RECREATE_SWAPCHAIN, frameCount);
+            target->imageIndex = UINT32_MAX;
+            continue;
+        } 
+        else if ((acquireImagerslt != VK_SUCCESS) && (acquireImagerslt != VK_SUBOPTIMAL_KHR))
+        {
+            assert_my(0, "failed to acquire swapchain image", "");
+        }
+
+        waitSemaphores[presentCount] = target->syncSemImgAvail[currentFrame];
+        signalSemaphores[presentCount] = target->syncSemRndrFinsh[currentFrame];
+        swapchains[presentCount] = target->swapchain;
+        imageIndices[presentCount] = target->imageIndex;
+        presented[presentCount] = target;
+        presentCount++;
+        renderCount++;
+    }
+    TRACE_END(acquireStart, TRACE_STAGE_ACQUIRE, frameCount);
+
+    // every target was out of date and recreated, the spike still gets its frame slice next to acquire and recreate
+    if (renderCount == 0) {
+        TRACE_END(frameStart, TRACE_STAGE_FRAME, frameCount);
+        return;
     }
 
     vkResetFences(state->device, 1, state->syncFenInFlight + currentFrame );
 
+    // capture and export follow the first target and sit the frame out with it
+    VkBool32 primaryRendered = state->targets[0].imageIndex != UINT32_MAX;
+
+    // acquire of the first window returned, presentation of this frame is measured from here
+    VkBool32 measured = state->measureLatency && primaryRendered;
+    if (measured) {
+        latencyBeginFrame(state, frameCount);
+    }
+
+    if (state->captureFrames && primaryRendered) {
+        captureBeginFrame(state, currentFrame, frameCount);
+    }
+
+    if (state->exportFrames && primaryRendered) {
+        frameExportBeginFrame(state, frameCount);
+    }
+
+    TRACE_BEGIN(recordStart);
     vkResetCommandBuffer(state->commandBuffers[currentFrame], 0);
-    recordCommandBuffer(state->commandBuffers[currentFrame], imgIndex, state);
-    
-    VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
+    recordCommandBuffer(state->commandBuffers[currentFrame], state);
+    TRACE_END(recordStart, TRACE_STAGE_RECORD, frameCount);
+
+    // recording found the first use of every acquired image, nothing before it waits for the semaphore
+    for (uint32_t i = 0; i < presentCount; i++)
+    {
+        waitStages[i] = (VkPipelineStageFlags) presented[i]->acquireStage;
+    }
+
+    // exported frame additionally signals the semaphore its sync file is taken from
+    VkSemaphore exportSemaphore = state->exportFrames && primaryRendered ? frameExportSemaphore(state) : VK_NULL_HANDLE;
+    uint32_t signalCount = presentCount;
+    if (exportSemaphore != VK_NULL_HANDLE) {
+        signalSemaphores[signalCount++] = exportSemaphore;
+    }
+
+    // timeline values are read for timeline semaphores only, binary semaphores keep 0
+    uint64_t waitValues[MAX_RENDER_TARGETS + 1] = {0};
+    uint64_t signalValues[MAX_RENDER_TARGETS + 2] = {0};
+    uint32_t waitCount = presentCount;
+
+    VkTimelineSemaphoreSubmitInfo timelineInf = {
+        .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+        .pNext = NULL,
+    };
+
+    // copy of the previous frame waits for its tonemap, the scene itself does not, the tonemap of this frame waits for all of it
+    if (state->asyncCompute) {
+        waitSemaphores[waitCount] = state->postProcess.computeTimeline;
+        waitStages[waitCount] = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        waitValues[waitCount++] = state->postProcess.submitted;
+
+        signalSemaphores[signalCount] = state->postProcess.graphicsTimeline;
+        signalValues[signalCount++] = state->postProcess.submitted + 1;
+
+        timelineInf.waitSemaphoreValueCount = waitCount;
+        timelineInf.pWaitSemaphoreValues = waitValues;
+        timelineInf.signalSemaphoreValueCount = signalCount;
+        timelineInf.pSignalSemaphoreValues = signalValues;
+    }
 
     // submit info
-    // waits on image available
-    // signals render finished
+    // waits on image available of every window
+    // signals render finished of every window
     VkSubmitInfo sbmtInf = {
         .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-        .pNext = NULL,
+        .pNext = state->asyncCompute ? &timelineInf : NULL,
 
         .pWaitDstStageMask = waitStages,
 
-        .waitSemaphoreCount = 1,
-        .pWaitSemaphores = state->syncSemImgAvail + currentFrame,
+        .waitSemaphoreCount = waitCount,
+        .pWaitSemaphores = waitSemaphores,
 
         .commandBufferCount = 1,
         .pCommandBuffers = state->commandBuffers + currentFrame,
 
-        .signalSemaphoreCount = 1,
-        .pSignalSemaphores = state->syncSemRndrFinsh + currentFrame,
+        .signalSemaphoreCount = signalCount,
+        .pSignalSemaphores = signalSemaphores,
     };
 
     // signals fence in flight
+    TRACE_BEGIN(submitStart);
     vkQueueSubmit(state->graphicsQueue, 1, &sbmtInf, state->syncFenInFlight[currentFrame] );
+    TRACE_END(submitStart, TRACE_STAGE_SUBMIT, frameCount);
 
-    // waits on : image rendered
-    // signals: nothing
-    VkPresentInfoKHR presentInf = {
-        .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
-        .pNext = NULL,
+    if (measured) {
+        latencySubmitted(state);
+    }
 
-        .waitSemaphoreCount = 1,
-        .pWaitSemaphores = state->syncSemRndrFinsh + currentFrame,
+    // runs on the compute queue while the next frame is rendered
+    if (state->asyncCompute) {
+        postProcessSubmit(state);
+    }
 
-        .swapchainCount = 1,
-        .pSwapchains = &state->swapchain,
-        .pImageIndices = &imgIndex,
+    if (state->exportFrames && primaryRendered) {
+        frameExportEndFrame(state, currentFrame);
+    }
 
-        .pResults = NULL,
-    };
+    if (presentCount > 0) {
+        presentTargets(state, signalSemaphores, swapchains, imageIndices, presented, presentCount);
+    }
 
-    // graphics queue should be present queue but graphics queue in this case also supports presenting
-    VkResult queuePresentRslt = vkQueuePresentKHR(state->graphicsQueue, &presentInf);
+    TRACE_END(frameStart, TRACE_STAGE_FRAME, frameCount);
 
-    if (queuePresentRslt == VK_ERROR_OUT_OF_DATE_KHR || queuePresentRslt == VK_SUBOPTIMAL_KHR || state->frameBufferResized)
-    {
-        state->frameBufferResized = VK_FALSE;
-        recreateSwapchain(state);
-    } 
-    else if (queuePresentRslt != VK_SUCCESS)
-    {
-        assert_my(-1, "failed to present swap chain image", "");
+    if (state->redrawFrames > 0) {
+        state->redrawFrames--;
     }
 
     currentFrame = (currentFrame+1) % MAX_FRAMES_IN_FLIGHT; 
+    frameCount++;
 
 }
\ No newline at end of file
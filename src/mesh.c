@@ -0,0 +1,163 @@
+#include "mesh.h"
+
+#include "debug.h"
+#include "init.h"
+#include "utils.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <vulkan/vulkan_core.h>
+
+void createMeshPool(State* state, VkDeviceSize size)
+{
+    MeshPool* pool = &state->meshes;
+
+    // vertices are read through the device address, indices by the index fetch of the same buffer
+    VkBufferCreateInfo crtInf = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+
+        .size = size,
+        .usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
+            VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+    };
+
+    assertVk(vkCreateBuffer(state->device, &crtInf, state->allocator, &pool->buffer), "failed to create mesh pool", "created mesh pool");
+
+    VkMemoryRequirements memReq;
+    vkGetBufferMemoryRequirements(state->device, pool->buffer, &memReq);
+
+    VkMemoryAllocateFlagsInfo flagsInf = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO,
+        .pNext = NULL,
+        .flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT,
+        .deviceMask = 0,
+    };
+
+    VkMemoryAllocateInfo allocInf = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+        .pNext = &flagsInf,
+        .allocationSize = memReq.size,
+        .memoryTypeIndex = findMemoryType(state, memReq.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT),
+    };
+
+    assertVk(vkAllocateMemory(state->device, &allocInf, state->allocator, &pool->memory), "failed to allocate mesh pool memory", "allocated mesh pool memory");
+    vkBindBufferMemory(state->device, pool->buffer, pool->memory, 0);
+
+    VkBufferDeviceAddressInfo addressInf = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO,
+        .pNext = NULL,
+        .buffer = pool->buffer,
+    };
+
+    pool->address = vkGetBufferDeviceAddress(state->device, &addressInf);
+    pool->size = size;
+    pool->head = 0;
+    pool->meshCount = 0;
+
+    LOG("mesh pool: %llu bytes at device address 0x%llx", (unsigned long long) size, (unsigned long long) pool->address);
+}
+
+uint32_t vertexFormatSize(VertexFormat format)
+{
+    switch (format)
+    {
+        case VERTEX_FORMAT_PACKED:
+            return 3 * sizeof(float) + sizeof(uint32_t);
+        default:
+            return sizeof(Vertex);
+    }
+}
+
+static uint32_t packColor(const float* color)
+{
+    uint32_t packed = 0;
+
+    for (uint32_t c = 0; c < 3; c++)
+    {
+        float value = color[c] < 0.0f ? 0.0f : (color[c] > 1.0f ? 1.0f : color[c]);
+        packed |= (uint32_t) (value * 255.0f + 0.5f) << (c * 8);
+    }
+
+    // opaque, the vertex color has no alpha
+    return packed | 0xFF000000u;
+}
+
+static void encodeVertices(const Vertex* vertices, uint32_t vertexCount, VertexFormat format, uint8_t* out)
+{
+    if (format == VERTEX_FORMAT_FLOAT) {
+        memcpy(out, vertices, (size_t) vertexCount * sizeof(Vertex));
+        return;
+    }
+
+    for (uint32_t i = 0; i < vertexCount; i++)
+    {
+        uint8_t* vertex = out + (size_t) i * vertexFormatSize(format);
+        uint32_t color = packColor(vertices[i].color);
+
+        memcpy(vertex, vertices[i].pos, 3 * sizeof(float));
+        memcpy(vertex + 3 * sizeof(float), &color, sizeof(color));
+    }
+}
+
+uint32_t meshPoolAdd(State* state, const Vertex* vertices, uint32_t vertexCount, VertexFormat format,
+    const uint16_t* indices, uint32_t indexCount)
+{
+    MeshPool* pool = &state->meshes;
+
+    VkDeviceSize vertexOffset = (pool->head + MESH_POOL_ALIGNMENT - 1) & ~(VkDeviceSize) (MESH_POOL_ALIGNMENT - 1);
+    VkDeviceSize vertexBytes = (VkDeviceSize) vertexCount * vertexFormatSize(format);
+    // every format is a multiple of 4 bytes, indices directly follow the vertices
+    VkDeviceSize indexBytes = (VkDeviceSize) indexCount * sizeof(uint32_t);
+    VkDeviceSize size = vertexBytes + indexBytes;
+
+    assert_my(pool->meshCount < MESH_POOL_MAX_MESHES && vertexOffset + size <= pool->size,
+        "mesh pool exhausted, increase MESH_POOL_SIZE or MESH_POOL_MAX_MESHES", "");
+
+    VkBuffer stagingBuffer;
+    VkDeviceMemory stagingBufferMemory;
+
+    createBuffer(state, size,
+    VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+    &stagingBuffer, &stagingBufferMemory);
+
+    void* data;
+    assertVk(vkMapMemory(state->device, stagingBufferMemory, 0, size, 0, &data), "failed to map mesh staging buffer", "");
+
+    encodeVertices(vertices, vertexCount, format, data);
+
+    uint32_t* indexData = (uint32_t*) ((uint8_t*) data + vertexBytes);
+    for (uint32_t i = 0; i < indexCount; i++)
+    {
+        indexData[i] = indices[i];
+    }
+
+    vkUnmapMemory(state->device, stagingBufferMemory);
+
+    copyBufferRegion(state, stagingBuffer, 0, pool->buffer, vertexOffset, size);
+
+    vkDestroyBuffer(state->device, stagingBuffer, state->allocator);
+    vkFreeMemory(state->device, stagingBufferMemory, state->allocator);
+
+    pool->head = vertexOffset + size;
+
+    Mesh* mesh = &pool->meshes[pool->meshCount];
+    mesh->vertexAddress = pool->address + vertexOffset;
+    mesh->vertexFormat = format;
+    mesh->vertexCount = vertexCount;
+    mesh->firstIndex = (uint32_t) ((vertexOffset + vertexBytes) / sizeof(uint32_t));
+    mesh->indexCount = indexCount;
+
+    return pool->meshCount++;
+}
+
+void destroyMeshPool(State* state)
+{
+    MeshPool* pool = &state->meshes;
+
+    vkDestroyBuffer(state->device, pool->buffer, state->allocator);
+    vkFreeMemory(state->device, pool->memory, state->allocator);
+}
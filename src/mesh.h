@@ -0,0 +1,83 @@
+#ifndef __MESH_H__
+#define __MESH_H__
+
+#include "common.h"
+
+#include <cglm/types.h>
+#include <stdint.h>
+#include <vulkan/vulkan_core.h>
+
+// vertex of the built in meshes, VERTEX_FORMAT_FLOAT stores it as is
+typedef struct Vertex
+{
+    vec3 pos;
+    vec3 color;
+} Vertex;
+
+// layouts decoded by pulled.vert, values must match the shader
+typedef enum VertexFormat
+{
+    // vec3 position, vec3 color -> Vertex, 24 bytes
+    VERTEX_FORMAT_FLOAT = 0,
+    // vec3 position, R8G8B8A8 color, 16 bytes
+    VERTEX_FORMAT_PACKED = 1,
+} VertexFormat;
+
+// bytes of the mesh pool, vertices and indices of every mesh
+#define MESH_POOL_SIZE (16u * 1024 * 1024)
+#define MESH_POOL_MAX_MESHES 64
+// vertex data of each mesh starts at this alignment, enough for any format read by pulled.vert
+#define MESH_POOL_ALIGNMENT 16
+
+typedef struct Mesh
+{
+    // first vertex, pushed per draw
+    VkDeviceAddress vertexAddress;
+    VertexFormat vertexFormat;
+    uint32_t vertexCount;
+    // 32 bit indices in the pool bound as index buffer, relative to the mesh's first vertex
+    uint32_t firstIndex;
+    uint32_t indexCount;
+} Mesh;
+
+// one device local storage buffer holding the vertices and indices of all meshes,
+// vertices are addressed by buffer device address so meshes of any format share one pipeline
+typedef struct MeshPool
+{
+    VkBuffer buffer;
+    VkDeviceMemory memory;
+    VkDeviceAddress address;
+    VkDeviceSize size;
+    // bump allocator, meshes are never removed
+    VkDeviceSize head;
+
+    Mesh meshes[MESH_POOL_MAX_MESHES];
+    uint32_t meshCount;
+} MeshPool;
+
+/**
+ * @brief creates device local mesh pool with a buffer device address
+ * Requires:
+    - Valid logical device in state, created with bufferDeviceAddress enabled
+    - state->commandPool created
+ * @param size bytes of vertices and indices of all meshes
+ */
+void createMeshPool(State* state, VkDeviceSize size);
+
+/**
+ * @brief encodes vertices into format and uploads them with their indices through a staging buffer
+ * @details waits for the upload, meant for load time
+ * @param indices relative to the first vertex, widened to 32 bit
+ * @return index into state->meshes.meshes, exits when pool is full
+ */
+uint32_t meshPoolAdd(State* state, const Vertex* vertices, uint32_t vertexCount, VertexFormat format,
+    const uint16_t* indices, uint32_t indexCount);
+
+/**
+ * @brief bytes of one vertex of format
+ */
+uint32_t vertexFormatSize(VertexFormat format);
+
+void destroyMeshPool(State* state);
+
+#endif // __MESH_H__
@@ -0,0 +1,702 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "pipeline.h"
+
+#include "debug.h"
+#include "init.h"
+#include "utils.h"
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vulkan/vulkan_core.h>
+
+// binding 0 -> quad vertices, bindings 1 and 2 -> per instance streams of the instance store
+static const VkVertexInputBindingDescription instancedBindings[] = {
+    {
+        .binding = 0,
+        .stride = sizeof(Vertex),
+        .inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
+    },
+    {
+        .binding = 1,
+        .stride = sizeof(float) * 4,
+        .inputRate = VK_VERTEX_INPUT_RATE_INSTANCE,
+    },
+    {
+        .binding = 2,
+        .stride = sizeof(uint32_t),
+        .inputRate = VK_VERTEX_INPUT_RATE_INSTANCE,
+    },
+};
+
+static const VkVertexInputAttributeDescription instancedAttributes[] = {
+    {
+        .location = 0,
+        .binding = 0,
+        .format = VK_FORMAT_R32G32B32_SFLOAT,
+        .offset = offsetof(Vertex, pos),
+    },
+    {
+        .location = 1,
+        .binding = 0,
+        .format = VK_FORMAT_R32G32B32_SFLOAT,
+        .offset = offsetof(Vertex, color),
+    },
+    {
+        // x, y, rotation, scale
+        .location = 2,
+        .binding = 1,
+        .format = VK_FORMAT_R32G32B32A32_SFLOAT,
+        .offset = 0,
+    },
+    {
+        .location = 3,
+        .binding = 2,
+        .format = VK_FORMAT_R8G8B8A8_UNORM,
+        .offset = 0,
+    },
+};
+
+// binding 0 -> corners of the batcher's quads
+static const VkVertexInputBindingDescription batchBindings[] = {
+    {
+        .binding = 0,
+        .stride = sizeof(BatchVertex),
+        .inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
+    },
+};
+
+static const VkVertexInputAttributeDescription batchAttributes[] = {
+    {
+        .location = 0,
+        .binding = 0,
+        .format = VK_FORMAT_R32G32_SFLOAT,
+        .offset = offsetof(BatchVertex, x),
+    },
+    {
+        .location = 1,
+        .binding = 0,
+        .format = VK_FORMAT_R32G32_SFLOAT,
+        .offset = offsetof(BatchVertex, u),
+    },
+    {
+        .location = 2,
+        .binding = 0,
+        .format = VK_FORMAT_R8G8B8A8_UNORM,
+        .offset = offsetof(BatchVertex, color),
+    },
+};
+
+static const VkPipelineVertexInputStateCreateInfo vertexLayouts[PIPELINE_VERTEX_LAYOUT_COUNT] = {
+    [PIPELINE_VERTEX_INSTANCED] = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+
+        .vertexBindingDescriptionCount = sizeof(instancedBindings) / sizeof(instancedBindings[0]),
+        .pVertexBindingDescriptions = instancedBindings,
+
+        .vertexAttributeDescriptionCount = sizeof(instancedAttributes) / sizeof(instancedAttributes[0]),
+        .pVertexAttributeDescriptions = instancedAttributes,
+    },
+    // same per instance streams, binding 0 and its attributes are fetched by pulled.vert
+    [PIPELINE_VERTEX_PULLED] = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+
+        .vertexBindingDescriptionCount = sizeof(instancedBindings) / sizeof(instancedBindings[0]) - 1,
+        .pVertexBindingDescriptions = instancedBindings + 1,
+
+        .vertexAttributeDescriptionCount = sizeof(instancedAttributes) / sizeof(instancedAttributes[0]) - 2,
+        .pVertexAttributeDescriptions = instancedAttributes + 2,
+    },
+    [PIPELINE_VERTEX_BATCH] = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+
+        .vertexBindingDescriptionCount = sizeof(batchBindings) / sizeof(batchBindings[0]),
+        .pVertexBindingDescriptions = batchBindings,
+
+        .vertexAttributeDescriptionCount = sizeof(batchAttributes) / sizeof(batchAttributes[0]),
+        .pVertexAttributeDescriptions = batchAttributes,
+    },
+};
+
+// FNV-1a over the key, keys hold no padding
+static uint64_t hashKey(const PipelineKey* key)
+{
+    const uint8_t* bytes = (const uint8_t*) key;
+    uint64_t hash = 14695981039346656037ull;
+
+    for (size_t i = 0; i < sizeof(*key); i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+// dynamic topology may only change within the class the pipeline was created with
+static VkPrimitiveTopology topologyClass(VkPrimitiveTopology topology)
+{
+    switch (topology)
+    {
+        case VK_PRIMITIVE_TOPOLOGY_POINT_LIST:
+            return VK_PRIMITIVE_TOPOLOGY_POINT_LIST;
+        case VK_PRIMITIVE_TOPOLOGY_LINE_LIST:
+        case VK_PRIMITIVE_TOPOLOGY_LINE_STRIP:
+            return VK_PRIMITIVE_TOPOLOGY_LINE_LIST;
+        default:
+            return VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    }
+}
+
+static VkPipelineColorBlendAttachmentState blendAttachment(PipelineBlend blend)
+{
+    VkPipelineColorBlendAttachmentState attachment = {
+        .colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
+
+        .blendEnable = blend != PIPELINE_BLEND_OPAQUE,
+
+        .srcColorBlendFactor = VK_BLEND_FACTOR_ONE,
+        .dstColorBlendFactor = VK_BLEND_FACTOR_ZERO,
+
+        .colorBlendOp = VK_BLEND_OP_ADD,
+        .srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
+        .dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO,
+        .alphaBlendOp = VK_BLEND_OP_ADD,
+    };
+
+    if (blend == PIPELINE_BLEND_ALPHA) {
+        attachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+        attachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+        attachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    }
+    else if (blend == PIPELINE_BLEND_ADDITIVE) {
+        attachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+        attachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+        attachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    }
+
+    return attachment;
+}
+
+// runs on a compiler thread, everything it reads from state is fixed before the first variant is queued
+static VkBool32 compileVariant(State* state, PipelineVariant* variant)
+{
+    PipelineCache* cache = &state->pipelines;
+    const PipelineKey* key = &variant->key;
+
+    VkDynamicState dynamicStates[] = {
+        VK_DYNAMIC_STATE_VIEWPORT,
+        VK_DYNAMIC_STATE_SCISSOR,
+        VK_DYNAMIC_STATE_CULL_MODE,
+        VK_DYNAMIC_STATE_FRONT_FACE,
+        VK_DYNAMIC_STATE_PRIMITIVE_TOPOLOGY,
+        VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE,
+        VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE,
+        VK_DYNAMIC_STATE_DEPTH_COMPARE_OP,
+    };
+
+    VkPipelineDynamicStateCreateInfo dynamicState = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+        .flags = 0,
+
+        .dynamicStateCount = cache->extendedDynamicState ? sizeof(dynamicStates) / sizeof(dynamicStates[0]) : 2,
+        .pDynamicStates = dynamicStates,
+    };
+
+    // one 32 bit constant per id, ids a shader does not declare are ignored
+    VkSpecializationMapEntry specializationEntries[PIPELINE_MAX_SPECIALIZATION];
+    for (uint32_t i = 0; i < PIPELINE_MAX_SPECIALIZATION; i++)
+    {
+        specializationEntries[i] = (VkSpecializationMapEntry) {
+            .constantID = i,
+            .offset = i * sizeof(uint32_t),
+            .size = sizeof(uint32_t),
+        };
+    }
+
+    VkSpecializationInfo specialization = {
+        .mapEntryCount = PIPELINE_MAX_SPECIALIZATION,
+        .pMapEntries = specializationEntries,
+        .dataSize = sizeof(key->specialization),
+        .pData = key->specialization,
+    };
+
+    VkPipelineShaderStageCreateInfo shaderStages[] = {
+        {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .stage = VK_SHADER_STAGE_VERTEX_BIT,
+            .module = cache->shaders[key->shaders].vertex,
+            .pName = "main",
+            .pSpecializationInfo = &specialization,
+        },
+        {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
+            .module = cache->shaders[key->shaders].fragment,
+            .pName = "main",
+            .pSpecializationInfo = &specialization,
+        },
+    };
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssemblyCrtInf = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+
+        .topology = (VkPrimitiveTopology) key->topology,
+        .primitiveRestartEnable = VK_FALSE
+    };
+
+    VkPipelineViewportStateCreateInfo viewportCrtInf = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+
+        .viewportCount = 1,
+        .scissorCount = 1,
+    };
+
+    VkPipelineRasterizationStateCreateInfo rasterizerCrtInf = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+
+        .depthClampEnable = VK_FALSE,
+        .rasterizerDiscardEnable = VK_FALSE,
+
+        .polygonMode = VK_POLYGON_MODE_FILL,
+
+        .lineWidth = (float)1, // musn't be larger than 1 if wideLines aren't enabled
+
+        .cullMode = key->cullMode,
+        .frontFace = (VkFrontFace) key->frontFace,
+
+        .depthBiasEnable = VK_FALSE,
+        .depthBiasClamp = (float)0,
+        .depthBiasConstantFactor = (float)0,
+        .depthBiasSlopeFactor = (float)0
+    };
+
+    VkPipelineMultisampleStateCreateInfo multisampleCrtInf = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .sampleShadingEnable = VK_FALSE,
+        .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
+        .minSampleShading = (float)1,
+        .pSampleMask = NULL,
+        .alphaToCoverageEnable = VK_FALSE,
+        .alphaToOneEnable = VK_FALSE,
+    };
+
+    VkPipelineDepthStencilStateCreateInfo depthStencilCrtInf = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+
+        .depthTestEnable = key->depthTest,
+        .depthWriteEnable = key->depthWrite,
+        .depthCompareOp = (VkCompareOp) key->depthCompare,
+
+        .depthBoundsTestEnable = VK_FALSE,
+        .minDepthBounds = 0.0f,
+        .maxDepthBounds = 1.0f,
+
+        .stencilTestEnable = VK_FALSE,
+    };
+
+    VkPipelineColorBlendAttachmentState colorBlendAttachment = blendAttachment((PipelineBlend) key->blend);
+
+    VkPipelineColorBlendStateCreateInfo colorBlending = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+        .logicOpEnable = VK_FALSE,
+        .logicOp = VK_LOGIC_OP_COPY,
+        .attachmentCount = 1,
+        .pAttachments = &colorBlendAttachment,
+    };
+
+    VkFormat colorFormat = (VkFormat) key->colorFormat;
+
+    // with dynamic rendering attachment formats are given here instead of by a render pass
+    VkPipelineRenderingCreateInfo renderingCrtInf = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO,
+        .pNext = NULL,
+
+        .colorAttachmentCount = 1,
+        .pColorAttachmentFormats = &colorFormat,
+        .depthAttachmentFormat = (VkFormat) key->depthFormat,
+        .stencilAttachmentFormat = VK_FORMAT_UNDEFINED,
+    };
+
+    VkGraphicsPipelineCreateInfo graphicsPipelineCrtInf = {
+        .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+        .pNext = state->useDynamicRendering ? &renderingCrtInf : NULL,
+        .flags = 0,
+
+        .stageCount = 2,
+        .pStages = shaderStages,
+
+        .pVertexInputState = &vertexLayouts[key->vertexLayout],
+        .pInputAssemblyState = &inputAssemblyCrtInf,
+        .pTessellationState = NULL,
+        .pViewportState = &viewportCrtInf,
+        .pRasterizationState = &rasterizerCrtInf,
+        .pMultisampleState = &multisampleCrtInf,
+        .pDepthStencilState = key->depthFormat != VK_FORMAT_UNDEFINED ? &depthStencilCrtInf : NULL,
+        .pColorBlendState = &colorBlending,
+        .pDynamicState = &dynamicState,
+
+        .layout = state->pipelineLayout,
+        .renderPass = state->useDynamicRendering ? VK_NULL_HANDLE : state->renderPass,
+
+        .subpass = 0,
+
+        .basePipelineHandle = NULL,
+        .basePipelineIndex = -1,
+    };
+
+    // the driver cache is internally synchronized, compilers share it
+    VkResult result = vkCreateGraphicsPipelines(state->device, cache->cache, 1, &graphicsPipelineCrtInf, state->allocator, &variant->pipeline);
+    if (result != VK_SUCCESS) {
+        LOG_WARN("pipeline variant %016llx failed to compile (VkResult %d)", (unsigned long long) variant->hash, result);
+        variant->pipeline = VK_NULL_HANDLE;
+        return VK_FALSE;
+    }
+
+    return VK_TRUE;
+}
+
+static void* pipelineCompilerMain(void* arg)
+{
+    State* state = arg;
+    PipelineCache* cache = &state->pipelines;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&cache->mutex);
+        while (cache->running && cache->queueHead == cache->queueTail)
+        {
+            pthread_cond_wait(&cache->queued, &cache->mutex);
+        }
+
+        // queue is drained before the compilers stop
+        if (cache->queueHead == cache->queueTail) {
+            pthread_mutex_unlock(&cache->mutex);
+            break;
+        }
+
+        uint32_t index = cache->queue[cache->queueTail % PIPELINE_CACHE_CAPACITY];
+        cache->queueTail++;
+        pthread_mutex_unlock(&cache->mutex);
+
+        PipelineVariant* variant = &cache->variants[index];
+        VkBool32 compiled = compileVariant(state, variant);
+
+        pthread_mutex_lock(&cache->mutex);
+        __atomic_store_n(&variant->status, compiled ? PIPELINE_STATUS_READY : PIPELINE_STATUS_FAILED, __ATOMIC_RELEASE);
+        pthread_cond_broadcast(&cache->compiled);
+        pthread_mutex_unlock(&cache->mutex);
+    }
+
+    return NULL;
+}
+
+// data of another driver or device is dropped here, drivers are required to reject it too but not all do
+static void* loadCacheData(State* state, const char* path, size_t* size)
+{
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        return NULL;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long fileSize = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    // VkPipelineCacheHeaderVersionOne: size, version, vendor, device, pipeline cache UUID
+    const size_t headerSize = 16 + VK_UUID_SIZE;
+    if (fileSize < (long) headerSize) {
+        fclose(file);
+        return NULL;
+    }
+
+    uint8_t* data = malloc((size_t) fileSize);
+    assert_my(data, "failed to allocate pipeline cache data", "");
+    size_t read = fread(data, 1, (size_t) fileSize, file);
+    fclose(file);
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(state->physicalDevice, &properties);
+
+    uint32_t header[4];
+    memcpy(header, data, sizeof(header));
+
+    if (read != (size_t) fileSize || header[1] != VK_PIPELINE_CACHE_HEADER_VERSION_ONE || header[2] != properties.vendorID ||
+        header[3] != properties.deviceID || memcmp(data + 16, properties.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+        LOG("pipeline cache %s belongs to another device or driver, starting empty", path);
+        free(data);
+        return NULL;
+    }
+
+    *size = (size_t) fileSize;
+    return data;
+}
+
+static void saveCacheData(State* state, const char* path)
+{
+    size_t size;
+    if (vkGetPipelineCacheData(state->device, state->pipelines.cache, &size, NULL) != VK_SUCCESS || size == 0) {
+        return;
+    }
+
+    void* data = malloc(size);
+    assert_my(data, "failed to allocate pipeline cache data", "");
+
+    FILE* file = NULL;
+    if (vkGetPipelineCacheData(state->device, state->pipelines.cache, &size, data) == VK_SUCCESS) {
+        file = fopen(path, "wb");
+    }
+
+    if (file == NULL || fwrite(data, 1, size, file) != size) {
+        LOG_WARN("failed to write pipeline cache %s", path);
+    }
+    else
+    {
+        LOG_DEBUG("wrote pipeline cache %s, %zu bytes", path, size);
+    }
+
+    if (file != NULL) {
+        fclose(file);
+    }
+    free(data);
+}
+
+void createPipelineCache(State* state)
+{
+    PipelineCache* cache = &state->pipelines;
+
+    memset(cache->variants, 0, sizeof(cache->variants));
+    cache->variantCount = 0;
+    cache->shaderCount = 0;
+    cache->path = state->pipelineCachePath;
+    cache->queueHead = 0;
+    cache->queueTail = 0;
+
+    // cull mode, front face, topology and depth state became core dynamic state in 1.3
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(state->physicalDevice, &properties);
+    cache->extendedDynamicState = properties.apiVersion >= VK_API_VERSION_1_3;
+
+    size_t initialSize = 0;
+    void* initialData = cache->path != NULL ? loadCacheData(state, cache->path, &initialSize) : NULL;
+
+    VkPipelineCacheCreateInfo crtInf = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+
+        .initialDataSize = initialSize,
+        .pInitialData = initialData,
+    };
+
+    assertVk(vkCreatePipelineCache(state->device, &crtInf, state->allocator, &cache->cache), "failed to create pipeline cache", "created pipeline cache");
+    free(initialData);
+
+    pthread_mutex_init(&cache->mutex, NULL);
+    pthread_cond_init(&cache->queued, NULL);
+    pthread_cond_init(&cache->compiled, NULL);
+
+    cache->running = 1;
+    for (uint32_t i = 0; i < PIPELINE_COMPILER_COUNT; i++)
+    {
+        assert_my(pthread_create(&cache->compilers[i], NULL, pipelineCompilerMain, state) == 0, "failed to start pipeline compiler", "started pipeline compiler");
+    }
+
+    LOG("pipelines: %u compiler threads, extended dynamic state %s, cache %s%s", PIPELINE_COMPILER_COUNT,
+        cache->extendedDynamicState ? "on" : "off", cache->path != NULL ? cache->path : "not persisted",
+        initialSize > 0 ? " (loaded)" : "");
+}
+
+uint32_t pipelineCacheAddShaders(State* state, const char* vertexPath, const char* fragmentPath)
+{
+    PipelineCache* cache = &state->pipelines;
+    assert_my(cache->shaderCount < PIPELINE_MAX_SHADERS, "pipeline shaders exhausted, increase PIPELINE_MAX_SHADERS", "");
+
+    PipelineShaders* shaders = &cache->shaders[cache->shaderCount];
+    shaders->vertex = createShaderModule(vertexPath, state->device, state->allocator);
+    shaders->fragment = createShaderModule(fragmentPath, state->device, state->allocator);
+
+    return cache->shaderCount++;
+}
+
+void pipelineKeyDefault(State* state, PipelineKey* key)
+{
+    memset(key, 0, sizeof(*key));
+
+    key->shaders = 0;
+    key->vertexLayout = PIPELINE_VERTEX_INSTANCED;
+    for (uint32_t i = 0; i < PIPELINE_MAX_SPECIALIZATION; i++)
+    {
+        key->specialization[i] = VK_TRUE;
+    }
+
+    key->topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    key->cullMode = VK_CULL_MODE_BACK_BIT;
+    key->frontFace = VK_FRONT_FACE_CLOCKWISE;
+    key->depthTest = state->useDepth;
+    key->depthWrite = state->useDepth;
+    key->depthCompare = VK_COMPARE_OP_LESS;
+
+    key->blend = PIPELINE_BLEND_OPAQUE;
+    // with async compute the scene is rendered in HDR and tonemapped into the targets afterwards
+    key->colorFormat = state->asyncCompute ? POST_PROCESS_HDR_FORMAT : state->swapchainFormat.format;
+    key->depthFormat = state->useDepth ? state->depthFormat : VK_FORMAT_UNDEFINED;
+}
+
+uint32_t pipelineCacheRequest(State* state, const PipelineKey* key)
+{
+    PipelineCache* cache = &state->pipelines;
+
+    // variants differing only in dynamic state are the same pipeline
+    PipelineKey normalized = *key;
+    if (cache->extendedDynamicState) {
+        normalized.topology = topologyClass((VkPrimitiveTopology) key->topology);
+        normalized.cullMode = 0;
+        normalized.frontFace = 0;
+        normalized.depthTest = 0;
+        normalized.depthWrite = 0;
+        normalized.depthCompare = 0;
+    }
+
+    uint64_t hash = hashKey(&normalized);
+    uint32_t index = (uint32_t) hash % PIPELINE_CACHE_CAPACITY;
+
+    for (;;)
+    {
+        PipelineVariant* variant = &cache->variants[index];
+
+        // entries leave EMPTY on this thread only, compilers never touch empty entries
+        if (__atomic_load_n(&variant->status, __ATOMIC_RELAXED) == PIPELINE_STATUS_EMPTY) {
+            break;
+        }
+
+        if (variant->hash == hash && memcmp(&variant->key, &normalized, sizeof(normalized)) == 0) {
+            return index;
+        }
+
+        index = (index + 1) % PIPELINE_CACHE_CAPACITY;
+    }
+
+    // one entry stays empty so probing always ends
+    assert_my(cache->variantCount + 1 < PIPELINE_CACHE_CAPACITY, "pipeline variants exhausted, increase PIPELINE_CACHE_CAPACITY", "");
+    cache->variantCount++;
+
+    PipelineVariant* variant = &cache->variants[index];
+    variant->hash = hash;
+    variant->key = normalized;
+    variant->pipeline = VK_NULL_HANDLE;
+
+    pthread_mutex_lock(&cache->mutex);
+    __atomic_store_n(&variant->status, PIPELINE_STATUS_QUEUED, __ATOMIC_RELAXED);
+    cache->queue[cache->queueHead % PIPELINE_CACHE_CAPACITY] = index;
+    cache->queueHead++;
+    pthread_cond_signal(&cache->queued);
+    pthread_mutex_unlock(&cache->mutex);
+
+    LOG_DEBUG("pipelines: queued variant %016llx, %u variants", (unsigned long long) hash, cache->variantCount);
+
+    return index;
+}
+
+VkPipeline pipelineCacheGet(State* state, uint32_t variant)
+{
+    PipelineVariant* pipelineVariant = &state->pipelines.variants[variant];
+
+    if (__atomic_load_n(&pipelineVariant->status, __ATOMIC_ACQUIRE) != PIPELINE_STATUS_READY) {
+        return VK_NULL_HANDLE;
+    }
+
+    return pipelineVariant->pipeline;
+}
+
+VkPipeline pipelineCacheGetBlocking(State* state, uint32_t variant)
+{
+    PipelineCache* cache = &state->pipelines;
+    PipelineVariant* pipelineVariant = &cache->variants[variant];
+
+    pthread_mutex_lock(&cache->mutex);
+    while (__atomic_load_n(&pipelineVariant->status, __ATOMIC_ACQUIRE) == PIPELINE_STATUS_QUEUED)
+    {
+        pthread_cond_wait(&cache->compiled, &cache->mutex);
+    }
+    pthread_mutex_unlock(&cache->mutex);
+
+    assert_my(pipelineVariant->status == PIPELINE_STATUS_READY, "failed to create graphics pipeline", "created graphics pipeline");
+    return pipelineVariant->pipeline;
+}
+
+void pipelineCacheSetDynamicState(State* state, VkCommandBuffer commandBuffer, const PipelineKey* key)
+{
+    if (!state->pipelines.extendedDynamicState) {
+        return;
+    }
+
+    vkCmdSetCullMode(commandBuffer, key->cullMode);
+    vkCmdSetFrontFace(commandBuffer, (VkFrontFace) key->frontFace);
+    vkCmdSetPrimitiveTopology(commandBuffer, (VkPrimitiveTopology) key->topology);
+    vkCmdSetDepthTestEnable(commandBuffer, key->depthTest);
+    vkCmdSetDepthWriteEnable(commandBuffer, key->depthWrite);
+    vkCmdSetDepthCompareOp(commandBuffer, (VkCompareOp) key->depthCompare);
+}
+
+void destroyPipelineCache(State* state)
+{
+    PipelineCache* cache = &state->pipelines;
+
+    pthread_mutex_lock(&cache->mutex);
+    cache->running = 0;
+    pthread_cond_broadcast(&cache->queued);
+    pthread_mutex_unlock(&cache->mutex);
+
+    for (uint32_t i = 0; i < PIPELINE_COMPILER_COUNT; i++)
+    {
+        pthread_join(cache->compilers[i], NULL);
+    }
+
+    uint32_t compiled = 0;
+    for (uint32_t i = 0; i < PIPELINE_CACHE_CAPACITY; i++)
+    {
+        if (cache->variants[i].status == PIPELINE_STATUS_READY) {
+            vkDestroyPipeline(state->device, cache->variants[i].pipeline, state->allocator);
+            compiled++;
+        }
+    }
+
+    LOG_DEBUG("pipelines: destroyed %u of %u variants", compiled, cache->variantCount);
+
+    if (cache->path != NULL) {
+        saveCacheData(state, cache->path);
+    }
+
+    vkDestroyPipelineCache(state->device, cache->cache, state->allocator);
+
+    for (uint32_t i = 0; i < cache->shaderCount; i++)
+    {
+        vkDestroyShaderModule(state->device, cache->shaders[i].vertex, state->allocator);
+        vkDestroyShaderModule(state->device, cache->shaders[i].fragment, state->allocator);
+    }
+
+    pthread_mutex_destroy(&cache->mutex);
+    pthread_cond_destroy(&cache->queued);
+    pthread_cond_destroy(&cache->compiled);
+}
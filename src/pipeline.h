@@ -0,0 +1,170 @@
+#ifndef __PIPELINE_H__
+#define __PIPELINE_H__
+
+#include "common.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <vulkan/vulkan_core.h>
+
+// variants kept by the pipeline cache, entries are never removed so indices stay valid
+#define PIPELINE_CACHE_CAPACITY 256
+#define PIPELINE_MAX_SHADERS 8
+#define PIPELINE_MAX_SPECIALIZATION 4
+#define PIPELINE_COMPILER_COUNT 2
+
+#define PIPELINE_INVALID_VARIANT UINT32_MAX
+
+// constant_id of the specialization constants in main.frag, a false constant removes the lookup
+#define PIPELINE_SPECIALIZATION_TEXTURES 0
+#define PIPELINE_SPECIALIZATION_MATERIALS 1
+
+typedef enum PipelineVertexLayout
+{
+    // quad vertices with per instance transforms and colors of the instance store
+    PIPELINE_VERTEX_INSTANCED,
+    // per instance streams only, vertices are fetched from the mesh pool by the shader
+    PIPELINE_VERTEX_PULLED,
+    // BatchVertex quads of the batcher
+    PIPELINE_VERTEX_BATCH,
+    PIPELINE_VERTEX_LAYOUT_COUNT,
+} PipelineVertexLayout;
+
+typedef enum PipelineBlend
+{
+    PIPELINE_BLEND_OPAQUE,
+    PIPELINE_BLEND_ALPHA,
+    PIPELINE_BLEND_ADDITIVE,
+    PIPELINE_BLEND_COUNT,
+} PipelineBlend;
+
+// everything a graphics pipeline is built from, only 32 bit fields so keys hash and compare as plain memory
+typedef struct PipelineKey
+{
+    // index returned by pipelineCacheAddShaders
+    uint32_t shaders;
+    // PipelineVertexLayout
+    uint32_t vertexLayout;
+    // values of constant_id 0 to PIPELINE_MAX_SPECIALIZATION - 1
+    uint32_t specialization[PIPELINE_MAX_SPECIALIZATION];
+
+    // cleared from the key when extended dynamic state sets them per command buffer
+    uint32_t topology;
+    uint32_t cullMode;
+    uint32_t frontFace;
+    uint32_t depthTest;
+    uint32_t depthWrite;
+    uint32_t depthCompare;
+
+    // PipelineBlend
+    uint32_t blend;
+    uint32_t colorFormat;
+    // VK_FORMAT_UNDEFINED without depth attachment
+    uint32_t depthFormat;
+} PipelineKey;
+
+typedef enum PipelineStatus
+{
+    PIPELINE_STATUS_EMPTY,
+    // waiting for or being built by a compiler thread
+    PIPELINE_STATUS_QUEUED,
+    PIPELINE_STATUS_READY,
+    PIPELINE_STATUS_FAILED,
+} PipelineStatus;
+
+typedef struct PipelineVariant
+{
+    // PipelineStatus, accessed atomically, compiler thread owns pipeline while QUEUED
+    int status;
+    uint64_t hash;
+    PipelineKey key;
+    VkPipeline pipeline;
+} PipelineVariant;
+
+typedef struct PipelineShaders
+{
+    VkShaderModule vertex;
+    VkShaderModule fragment;
+} PipelineShaders;
+
+// lazily built pipeline variants looked up by hash of their key, compiled on background threads
+typedef struct PipelineCache
+{
+    // driver cache shared by all compiles, loaded from and saved to path when one is given
+    VkPipelineCache cache;
+    const char* path;
+
+    PipelineShaders shaders[PIPELINE_MAX_SHADERS];
+    uint32_t shaderCount;
+
+    // open addressing on the key hash
+    PipelineVariant variants[PIPELINE_CACHE_CAPACITY];
+    uint32_t variantCount;
+
+    // cull mode, front face, topology and depth state are recorded per command buffer (Vulkan 1.3 device)
+    VkBool32 extendedDynamicState;
+
+    pthread_t compilers[PIPELINE_COMPILER_COUNT];
+    int running;
+
+    // variants waiting for a compiler, protected by mutex, every variant is queued at most once
+    pthread_mutex_t mutex;
+    pthread_cond_t queued;
+    pthread_cond_t compiled;
+    uint32_t queue[PIPELINE_CACHE_CAPACITY];
+    uint32_t queueHead;
+    uint32_t queueTail;
+} PipelineCache;
+
+/**
+ * @brief creates driver pipeline cache and starts compiler threads
+ * @details extended dynamic state is used when the device supports Vulkan 1.3
+ * Requires:
+    - state->pipelineLayout created
+    - state->renderPass created unless dynamic rendering is used
+ */
+void createPipelineCache(State* state);
+
+/**
+ * @brief loads vertex and fragment shader used by variants
+ * @return index for PipelineKey.shaders
+ */
+uint32_t pipelineCacheAddShaders(State* state, const char* vertexPath, const char* fragmentPath);
+
+/**
+ * @brief fills key with the state every draw of the scene uses, every specialization constant enabled
+ */
+void pipelineKeyDefault(State* state, PipelineKey* key);
+
+/**
+ * @brief finds variant of key, new variants are queued for a compiler thread
+ * @details never waits, state covered by extended dynamic state is removed from the key before hashing
+ * @return variant index, valid as long as the cache exists
+ */
+uint32_t pipelineCacheRequest(State* state, const PipelineKey* key);
+
+/**
+ * @brief pipeline of variant, VK_NULL_HANDLE while it is compiling or when compilation failed
+ */
+VkPipeline pipelineCacheGet(State* state, uint32_t variant);
+
+/**
+ * @brief pipeline of variant, waits for its compiler thread
+ * Requires:
+    - variant must compile, exits otherwise
+ */
+VkPipeline pipelineCacheGetBlocking(State* state, uint32_t variant);
+
+/**
+ * @brief records state of key that is dynamic in every variant, once per command buffer before drawing
+ */
+void pipelineCacheSetDynamicState(State* state, VkCommandBuffer commandBuffer, const PipelineKey* key);
+
+/**
+ * @brief waits for compiler threads, destroys variants and writes driver cache to its file
+ * Requires:
+    - device idle
+ */
+void destroyPipelineCache(State* state);
+
+#endif // __PIPELINE_H__
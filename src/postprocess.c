@@ -0,0 +1,521 @@
+#include "postprocess.h"
+
+#include "debug.h"
+#include "init.h"
+#include "utils.h"
+
+#include <stdint.h>
+#include <vulkan/vulkan_core.h>
+
+#define POST_PROCESS_HDR_BINDING 0
+#define POST_PROCESS_LDR_BINDING 1
+
+static void createPostProcessImage(State* state, PostProcessImage* image, VkExtent2D extent, VkFormat format, VkImageUsageFlags usage)
+{
+    // both families use the images, concurrent sharing spares the ownership transfers
+    uint32_t families[2] = {state->queueFamilyIndex, state->computeFamilyIndex};
+    VkBool32 shared = state->computeFamilyIndex != state->queueFamilyIndex;
+
+    VkImageCreateInfo crtInf = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+
+        .imageType = VK_IMAGE_TYPE_2D,
+        .format = format,
+        .extent = {extent.width, extent.height, 1},
+        .mipLevels = 1,
+        .arrayLayers = 1,
+        .samples = VK_SAMPLE_COUNT_1_BIT,
+        .tiling = VK_IMAGE_TILING_OPTIMAL,
+
+        .usage = usage,
+        .sharingMode = shared ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE,
+        .queueFamilyIndexCount = shared ? 2 : 1,
+        .pQueueFamilyIndices = families,
+        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+    };
+
+    assertVk(vkCreateImage(state->device, &crtInf, state->allocator, &image->image), "failed to create post process image", "created post process image");
+
+    VkMemoryRequirements memReq;
+    vkGetImageMemoryRequirements(state->device, image->image, &memReq);
+
+    VkMemoryAllocateInfo allocInf = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+        .pNext = NULL,
+        .allocationSize = memReq.size,
+        .memoryTypeIndex = findMemoryType(state, memReq.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT),
+    };
+
+    assertVk(vkAllocateMemory(state->device, &allocInf, state->allocator, &image->memory), "failed to allocate post process image memory", "allocated post process image memory");
+    vkBindImageMemory(state->device, image->image, image->memory, 0);
+
+    VkImageViewCreateInfo viewCrtInf = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+
+        .image = image->image,
+        .viewType = VK_IMAGE_VIEW_TYPE_2D,
+        .format = format,
+        .components.r = VK_COMPONENT_SWIZZLE_IDENTITY,
+        .components.g = VK_COMPONENT_SWIZZLE_IDENTITY,
+        .components.b = VK_COMPONENT_SWIZZLE_IDENTITY,
+        .components.a = VK_COMPONENT_SWIZZLE_IDENTITY,
+
+        .subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+        .subresourceRange.baseMipLevel = 0,
+        .subresourceRange.levelCount = 1,
+        .subresourceRange.baseArrayLayer = 0,
+        .subresourceRange.layerCount = 1,
+    };
+
+    assertVk(vkCreateImageView(state->device, &viewCrtInf, state->allocator, &image->view), "failed to create post process image view", "created post process image view");
+}
+
+static void destroyPostProcessImage(State* state, PostProcessImage* image)
+{
+    vkDestroyImageView(state->device, image->view, state->allocator);
+    vkDestroyImage(state->device, image->image, state->allocator);
+    vkFreeMemory(state->device, image->memory, state->allocator);
+}
+
+static void createTargetImages(State* state, RenderTarget* target)
+{
+    PostProcess* postProcess = &state->postProcess;
+    PostProcessTarget* images = &postProcess->targets[target - state->targets];
+
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    {
+        createPostProcessImage(state, &images->hdr[i], target->extent, POST_PROCESS_HDR_FORMAT,
+            VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
+        createPostProcessImage(state, &images->ldr[i], target->extent, POST_PROCESS_LDR_FORMAT,
+            VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
+
+        VkDescriptorImageInfo hdrInf = {
+            .sampler = postProcess->sampler,
+            .imageView = images->hdr[i].view,
+            .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        };
+
+        VkDescriptorImageInfo ldrInf = {
+            .sampler = VK_NULL_HANDLE,
+            .imageView = images->ldr[i].view,
+            .imageLayout = VK_IMAGE_LAYOUT_GENERAL,
+        };
+
+        VkWriteDescriptorSet writes[] = {
+            {
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .pNext = NULL,
+                .dstSet = images->sets[i],
+                .dstBinding = POST_PROCESS_HDR_BINDING,
+                .dstArrayElement = 0,
+                .descriptorCount = 1,
+                .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                .pImageInfo = &hdrInf,
+            },
+            {
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .pNext = NULL,
+                .dstSet = images->sets[i],
+                .dstBinding = POST_PROCESS_LDR_BINDING,
+                .dstArrayElement = 0,
+                .descriptorCount = 1,
+                .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                .pImageInfo = &ldrInf,
+            },
+        };
+
+        vkUpdateDescriptorSets(state->device, sizeof(writes) / sizeof(writes[0]), writes, 0, NULL);
+    }
+
+    images->previous = UINT32_MAX;
+    images->current = UINT32_MAX;
+}
+
+static void destroyTargetImages(State* state, PostProcessTarget* images)
+{
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    {
+        destroyPostProcessImage(state, &images->hdr[i]);
+        destroyPostProcessImage(state, &images->ldr[i]);
+    }
+}
+
+static void checkPostProcessSupport(State* state)
+{
+    VkFormatProperties hdrProps;
+    VkFormatProperties ldrProps;
+    VkFormatProperties targetProps;
+
+    vkGetPhysicalDeviceFormatProperties(state->physicalDevice, POST_PROCESS_HDR_FORMAT, &hdrProps);
+    vkGetPhysicalDeviceFormatProperties(state->physicalDevice, POST_PROCESS_LDR_FORMAT, &ldrProps);
+    vkGetPhysicalDeviceFormatProperties(state->physicalDevice, state->swapchainFormat.format, &targetProps);
+
+    assert_my((hdrProps.optimalTilingFeatures & VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT) && (hdrProps.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT),
+        "HDR format can not be rendered and sampled, async compute is not supported", "");
+    assert_my((ldrProps.optimalTilingFeatures & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT) && (ldrProps.optimalTilingFeatures & VK_FORMAT_FEATURE_BLIT_SRC_BIT),
+        "tonemapped format can not be stored and copied, async compute is not supported", "");
+    // the blit converts to the target format, sRGB encoding included
+    assert_my(targetProps.optimalTilingFeatures & VK_FORMAT_FEATURE_BLIT_DST_BIT,
+        "target format can not be blitted to, async compute is not supported", "");
+}
+
+static void createTonemapPipeline(State* state)
+{
+    PostProcess* postProcess = &state->postProcess;
+
+    VkDescriptorSetLayoutBinding bindings[] = {
+        {
+            .binding = POST_PROCESS_HDR_BINDING,
+            .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .descriptorCount = 1,
+            .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+            .pImmutableSamplers = NULL,
+        },
+        {
+            .binding = POST_PROCESS_LDR_BINDING,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+            .descriptorCount = 1,
+            .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+            .pImmutableSamplers = NULL,
+        },
+    };
+
+    VkDescriptorSetLayoutCreateInfo layoutCrtInf = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+
+        .bindingCount = sizeof(bindings) / sizeof(bindings[0]),
+        .pBindings = bindings,
+    };
+
+    assertVk(vkCreateDescriptorSetLayout(state->device, &layoutCrtInf, state->allocator, &postProcess->setLayout),
+    "failed to create post process descriptor set layout", "created post process descriptor set layout");
+
+    // one set per target and frame in flight, rewritten when the target is resized
+    VkDescriptorPoolSize poolSizes[] = {
+        {.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .descriptorCount = MAX_RENDER_TARGETS * MAX_FRAMES_IN_FLIGHT},
+        {.type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, .descriptorCount = MAX_RENDER_TARGETS * MAX_FRAMES_IN_FLIGHT},
+    };
+
+    VkDescriptorPoolCreateInfo poolCrtInf = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+
+        .maxSets = MAX_RENDER_TARGETS * MAX_FRAMES_IN_FLIGHT,
+        .poolSizeCount = sizeof(poolSizes) / sizeof(poolSizes[0]),
+        .pPoolSizes = poolSizes,
+    };
+
+    assertVk(vkCreateDescriptorPool(state->device, &poolCrtInf, state->allocator, &postProcess->descriptorPool),
+    "failed to create post process descriptor pool", "created post process descriptor pool");
+
+    VkSamplerCreateInfo samplerCrtInf = {
+        .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+
+        .magFilter = VK_FILTER_NEAREST,
+        .minFilter = VK_FILTER_NEAREST,
+        .mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+
+        .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+
+        .mipLodBias = 0.0f,
+        .anisotropyEnable = VK_FALSE,
+        .maxAnisotropy = 1.0f,
+        .compareEnable = VK_FALSE,
+        .compareOp = VK_COMPARE_OP_ALWAYS,
+        .minLod = 0.0f,
+        .maxLod = 0.0f,
+        .borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK,
+        .unnormalizedCoordinates = VK_FALSE,
+    };
+
+    assertVk(vkCreateSampler(state->device, &samplerCrtInf, state->allocator, &postProcess->sampler),
+    "failed to create post process sampler", "created post process sampler");
+
+    VkPipelineLayoutCreateInfo pipelineLayoutCrtInf = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+
+        .setLayoutCount = 1,
+        .pSetLayouts = &postProcess->setLayout,
+        .pushConstantRangeCount = 0,
+        .pPushConstantRanges = NULL,
+    };
+
+    assertVk(vkCreatePipelineLayout(state->device, &pipelineLayoutCrtInf, state->allocator, &postProcess->pipelineLayout),
+    "failed to create post process pipeline layout", "created post process pipeline layout");
+
+    VkShaderModule module = createShaderModule("shaders/tonemap.comp.spv", state->device, state->allocator);
+
+    VkComputePipelineCreateInfo pipelineCrtInf = {
+        .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+
+        .stage = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .pNext = NULL,
+            .flags = 0,
+            .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+            .module = module,
+            .pName = "main",
+            .pSpecializationInfo = NULL,
+        },
+        .layout = postProcess->pipelineLayout,
+        .basePipelineHandle = VK_NULL_HANDLE,
+        .basePipelineIndex = -1,
+    };
+
+    // shares the driver cache of the graphics variants
+    assertVk(vkCreateComputePipelines(state->device, state->pipelines.cache, 1, &pipelineCrtInf, state->allocator, &postProcess->pipeline),
+    "failed to create tonemap pipeline", "created tonemap pipeline");
+
+    vkDestroyShaderModule(state->device, module, state->allocator);
+}
+
+static VkSemaphore createTimeline(State* state)
+{
+    VkSemaphoreTypeCreateInfo typeCrtInf = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+        .pNext = NULL,
+        .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+        .initialValue = 0,
+    };
+
+    VkSemaphoreCreateInfo crtInf = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+        .pNext = &typeCrtInf,
+        .flags = 0,
+    };
+
+    VkSemaphore semaphore;
+    assertVk(vkCreateSemaphore(state->device, &crtInf, state->allocator, &semaphore), "failed to create timeline semaphore", "created timeline semaphore");
+
+    return semaphore;
+}
+
+void createPostProcess(State* state)
+{
+    PostProcess* postProcess = &state->postProcess;
+
+    checkPostProcessSupport(state);
+    createTonemapPipeline(state);
+
+    VkCommandPoolCreateInfo poolCrtInf = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+        .pNext = NULL,
+        .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+
+        .queueFamilyIndex = state->computeFamilyIndex,
+    };
+
+    assertVk(vkCreateCommandPool(state->device, &poolCrtInf, state->allocator, &postProcess->commandPool),
+    "failed to create compute command pool", "created compute command pool");
+
+    VkCommandBufferAllocateInfo allocInf = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .pNext = NULL,
+
+        .commandPool = postProcess->commandPool,
+        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+        .commandBufferCount = MAX_FRAMES_IN_FLIGHT,
+    };
+
+    assertVk(vkAllocateCommandBuffers(state->device, &allocInf, postProcess->commandBuffers),
+    "failed to allocate compute command buffers", "allocated compute command buffers");
+
+    postProcess->graphicsTimeline = createTimeline(state);
+    postProcess->computeTimeline = createTimeline(state);
+    postProcess->submitted = 0;
+
+    VkDescriptorSetLayout setLayouts[MAX_FRAMES_IN_FLIGHT];
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    {
+        setLayouts[i] = postProcess->setLayout;
+    }
+
+    for (uint32_t i = 0; i < state->targetCount; i++)
+    {
+        VkDescriptorSetAllocateInfo setAllocInf = {
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+            .pNext = NULL,
+
+            .descriptorPool = postProcess->descriptorPool,
+            .descriptorSetCount = MAX_FRAMES_IN_FLIGHT,
+            .pSetLayouts = setLayouts,
+        };
+
+        assertVk(vkAllocateDescriptorSets(state->device, &setAllocInf, postProcess->targets[i].sets),
+        "failed to allocate post process descriptor sets", "allocated post process descriptor sets");
+
+        createTargetImages(state, &state->targets[i]);
+    }
+
+    LOG("post processing on compute family %u, %s", state->computeFamilyIndex,
+        state->computeQueue != state->graphicsQueue ? "overlapping graphics" : "sharing the graphics queue");
+}
+
+void postProcessResize(State* state, RenderTarget* target)
+{
+    destroyTargetImages(state, &state->postProcess.targets[target - state->targets]);
+    createTargetImages(state, target);
+}
+
+void postProcessBeginFrame(State* state, uint32_t frameIndex)
+{
+    PostProcess* postProcess = &state->postProcess;
+    postProcess->frameIndex = frameIndex;
+
+    // the graphics fence covers the frame rendered into these images, not the tonemap reading them one frame later
+    if (postProcess->submitted + 1 > MAX_FRAMES_IN_FLIGHT) {
+        uint64_t value = postProcess->submitted + 1 - MAX_FRAMES_IN_FLIGHT;
+
+        VkSemaphoreWaitInfo waitInf = {
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+            .pNext = NULL,
+            .flags = 0,
+
+            .semaphoreCount = 1,
+            .pSemaphores = &postProcess->computeTimeline,
+            .pValues = &value,
+        };
+
+        assertVk(vkWaitSemaphores(state->device, &waitInf, UINT64_MAX), "failed to wait for tonemap", "");
+    }
+}
+
+void postProcessRecordCopy(State* state, VkCommandBuffer commandBuffer, RenderTarget* target, VkImage targetImage)
+{
+    PostProcessTarget* images = &state->postProcess.targets[target - state->targets];
+
+    VkImageSubresourceRange range = {
+        .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+        .baseMipLevel = 0,
+        .levelCount = 1,
+        .baseArrayLayer = 0,
+        .layerCount = 1,
+    };
+
+    if (images->previous == UINT32_MAX) {
+        VkClearColorValue black = {{0.0f, 0.0f, 0.0f, 1.0f}};
+        vkCmdClearColorImage(commandBuffer, targetImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &black, 1, &range);
+        return;
+    }
+
+    VkImageBlit region = {
+        .srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1},
+        .srcOffsets = {{0, 0, 0}, {(int32_t) target->extent.width, (int32_t) target->extent.height, 1}},
+        .dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1},
+        .dstOffsets = {{0, 0, 0}, {(int32_t) target->extent.width, (int32_t) target->extent.height, 1}},
+    };
+
+    // same extent, the blit only converts the format
+    vkCmdBlitImage(commandBuffer, images->ldr[images->previous].image, VK_IMAGE_LAYOUT_GENERAL,
+        targetImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region, VK_FILTER_NEAREST);
+}
+
+void postProcessSubmit(State* state)
+{
+    PostProcess* postProcess = &state->postProcess;
+    VkCommandBuffer commandBuffer = postProcess->commandBuffers[postProcess->frameIndex];
+
+    VkCommandBufferBeginInfo beginInf = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .pNext = NULL,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+        .pInheritanceInfo = NULL,
+    };
+
+    vkResetCommandBuffer(commandBuffer, 0);
+    assertVk(vkBeginCommandBuffer(commandBuffer, &beginInf), "failed to begin compute command buffer", "");
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, postProcess->pipeline);
+
+    for (uint32_t i = 0; i < state->targetCount; i++)
+    {
+        PostProcessTarget* images = &postProcess->targets[i];
+        if (images->current == UINT32_MAX) {
+            continue;
+        }
+
+        // the graphics frame which copied the old contents finished before this submission starts
+        transitionImageLayout(commandBuffer, images->ldr[images->current].image, VK_IMAGE_ASPECT_COLOR_BIT,
+            VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL,
+            VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE,
+            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_WRITE_BIT);
+
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, postProcess->pipelineLayout,
+            0, 1, &images->sets[images->current], 0, NULL);
+
+        VkExtent2D extent = state->targets[i].extent;
+        vkCmdDispatch(commandBuffer, (extent.width + POST_PROCESS_GROUP_SIZE - 1) / POST_PROCESS_GROUP_SIZE,
+            (extent.height + POST_PROCESS_GROUP_SIZE - 1) / POST_PROCESS_GROUP_SIZE, 1);
+
+        images->previous = images->current;
+        images->current = UINT32_MAX;
+    }
+
+    assertVk(vkEndCommandBuffer(commandBuffer), "failed to record compute command buffer", "");
+
+    // one tonemap per graphics submission keeps both timelines counting the same frames
+    uint64_t frame = ++postProcess->submitted;
+    VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+    VkTimelineSemaphoreSubmitInfo timelineInf = {
+        .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+        .pNext = NULL,
+
+        .waitSemaphoreValueCount = 1,
+        .pWaitSemaphoreValues = &frame,
+        .signalSemaphoreValueCount = 1,
+        .pSignalSemaphoreValues = &frame,
+    };
+
+    VkSubmitInfo submitInf = {
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .pNext = &timelineInf,
+
+        .waitSemaphoreCount = 1,
+        .pWaitSemaphores = &postProcess->graphicsTimeline,
+        .pWaitDstStageMask = &waitStage,
+
+        .commandBufferCount = 1,
+        .pCommandBuffers = &commandBuffer,
+
+        .signalSemaphoreCount = 1,
+        .pSignalSemaphores = &postProcess->computeTimeline,
+    };
+
+    assertVk(vkQueueSubmit(state->computeQueue, 1, &submitInf, VK_NULL_HANDLE), "failed to submit tonemap", "");
+}
+
+void destroyPostProcess(State* state)
+{
+    PostProcess* postProcess = &state->postProcess;
+
+    for (uint32_t i = 0; i < state->targetCount; i++)
+    {
+        destroyTargetImages(state, &postProcess->targets[i]);
+    }
+
+    vkDestroySemaphore(state->device, postProcess->graphicsTimeline, state->allocator);
+    vkDestroySemaphore(state->device, postProcess->computeTimeline, state->allocator);
+    vkDestroyCommandPool(state->device, postProcess->commandPool, state->allocator);
+
+    vkDestroyPipeline(state->device, postProcess->pipeline, state->allocator);
+    vkDestroyPipelineLayout(state->device, postProcess->pipelineLayout, state->allocator);
+    vkDestroySampler(state->device, postProcess->sampler, state->allocator);
+    vkDestroyDescriptorPool(state->device, postProcess->descriptorPool, state->allocator);
+    vkDestroyDescriptorSetLayout(state->device, postProcess->setLayout, state->allocator);
+}
@@ -0,0 +1,107 @@
+#ifndef __POSTPROCESS_H__
+#define __POSTPROCESS_H__
+
+#include "common.h"
+
+#include <stdint.h>
+#include <vulkan/vulkan_core.h>
+
+// async compute post processing, formats of the rendered scene and of its tonemapped copy
+#define POST_PROCESS_HDR_FORMAT VK_FORMAT_R16G16B16A16_SFLOAT
+#define POST_PROCESS_LDR_FORMAT VK_FORMAT_R8G8B8A8_UNORM
+// work group edge of the tonemap shader
+#define POST_PROCESS_GROUP_SIZE 8
+
+typedef struct PostProcessImage
+{
+    VkImage image;
+    VkDeviceMemory memory;
+    VkImageView view;
+} PostProcessImage;
+
+// images of one target, one set per frame in flight, shared by the graphics and compute families
+typedef struct PostProcessTarget
+{
+    // scene rendered by the graphics queue, sampled by the tonemap
+    PostProcessImage hdr[MAX_FRAMES_IN_FLIGHT];
+    // written by the compute queue, copied to the target by the next frame
+    PostProcessImage ldr[MAX_FRAMES_IN_FLIGHT];
+    VkDescriptorSet sets[MAX_FRAMES_IN_FLIGHT];
+
+    // frame in flight whose ldr image holds the last tonemapped frame, UINT32_MAX -> nothing to show yet
+    uint32_t previous;
+    // frame in flight rendered by the frame being recorded, UINT32_MAX when the target is skipped
+    uint32_t current;
+} PostProcessTarget;
+
+// tonemaps the scene on the compute queue while the graphics queue renders the next frame
+typedef struct PostProcess
+{
+    PostProcessTarget targets[MAX_RENDER_TARGETS];
+
+    VkDescriptorSetLayout setLayout;
+    VkDescriptorPool descriptorPool;
+    VkSampler sampler;
+    VkPipelineLayout pipelineLayout;
+    VkPipeline pipeline;
+
+    // pool of the compute family, one command buffer per frame in flight
+    VkCommandPool commandPool;
+    VkCommandBuffer commandBuffers[MAX_FRAMES_IN_FLIGHT];
+
+    // timelines count submissions, value n -> graphics work or tonemap of the n-th frame finished
+    VkSemaphore graphicsTimeline;
+    VkSemaphore computeTimeline;
+    uint64_t submitted;
+    // frame in flight being recorded
+    uint32_t frameIndex;
+} PostProcess;
+
+/**
+ * @brief creates the tonemap pipeline, its command buffers on the compute family and images of every target
+ * @details frame n is rendered into an HDR image, tonemapped on the compute queue while frame n + 1 renders
+ * and copied to the target by frame n + 1, the first frame shows black
+ * Requires:
+    - state->asyncCompute was set before device creation
+    - dynamic rendering
+    - render targets created
+ */
+void createPostProcess(State* state);
+
+/**
+ * @brief recreates images of target with its extent, the next frame shows black again
+ * Requires:
+    - device idle
+ */
+void postProcessResize(State* state, RenderTarget* target);
+
+/**
+ * @brief waits until the tonemap which used the frame in flight last finished
+ */
+void postProcessBeginFrame(State* state, uint32_t frameIndex);
+
+/**
+ * @brief records copy of the target's last tonemapped frame, clear when there is none
+ * Requires:
+    - target image in VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL and the previous ldr image in VK_IMAGE_LAYOUT_GENERAL,
+      both ordered before the transfer stage (render graph pass reading and writing them)
+    - graphics submission waits for postProcess.computeTimeline at postProcess.submitted
+ */
+void postProcessRecordCopy(State* state, VkCommandBuffer commandBuffer, RenderTarget* target, VkImage targetImage);
+
+/**
+ * @brief submits the tonemap of every target rendered this frame to the compute queue
+ * @details waits for the graphics submission on postProcess.graphicsTimeline at postProcess.submitted + 1
+ * Requires:
+    - graphics submission of the frame signals that value
+ */
+void postProcessSubmit(State* state);
+
+/**
+ * @brief destroys images, pipeline and semaphores
+ * Requires:
+    - device idle
+ */
+void destroyPostProcess(State* state);
+
+#endif // __POSTPROCESS_H__
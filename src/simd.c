@@ -0,0 +1,66 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "simd.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+SimdLevel simdDetect(void)
+{
+#if defined(SIMD_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx")) {
+        return SIMD_LEVEL_AVX;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return SIMD_LEVEL_SSE2;
+    }
+    return SIMD_LEVEL_SCALAR;
+#elif defined(SIMD_NEON)
+    return SIMD_LEVEL_NEON;
+#else
+    return SIMD_LEVEL_SCALAR;
+#endif
+}
+
+const char* simdLevelName(SimdLevel level)
+{
+    switch (level)
+    {
+    case SIMD_LEVEL_SSE2:
+        return "sse2";
+    case SIMD_LEVEL_AVX:
+        return "avx";
+    case SIMD_LEVEL_NEON:
+        return "neon";
+    default:
+        return "scalar";
+    }
+}
+
+float* simdAllocArrays(uint32_t* capacity, uint32_t count)
+{
+    // multiple of 8 -> every array starts 32 byte aligned
+    *capacity = (*capacity + 7) & ~7u;
+    size_t size = (size_t) *capacity * count * sizeof(float);
+
+    void* block;
+    if (posix_memalign(&block, 32, size) != 0) {
+        return NULL;
+    }
+
+    memset(block, 0, size);
+
+    return block;
+}
+
+float simdRandomRange(uint32_t* seed, float min, float max)
+{
+    *seed ^= *seed << 13;
+    *seed ^= *seed >> 17;
+    *seed ^= *seed << 5;
+
+    return min + (max - min) * (float) (*seed >> 8) / (float) (1u << 24);
+}
@@ -0,0 +1,49 @@
+#ifndef __SIMD_H__
+#define __SIMD_H__
+
+#include <stdint.h>
+
+// intrinsics of the structure of arrays kernels, x86 kernels pick AVX or SSE2 at runtime, NEON is always present on ARM
+// NEON kernels multiply and add separately, a fused multiply add would not match the scalar references
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SIMD_X86 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define SIMD_NEON 1
+#endif
+
+// widest instruction set the CPU runs
+typedef enum SimdLevel
+{
+    SIMD_LEVEL_SCALAR,
+    SIMD_LEVEL_SSE2,
+    SIMD_LEVEL_AVX,
+    SIMD_LEVEL_NEON,
+} SimdLevel;
+
+/**
+ * @brief detects widest instruction set supported by the CPU
+ */
+SimdLevel simdDetect(void);
+
+/**
+ * @brief lower case name of the level, e.g. "avx"
+ */
+const char* simdLevelName(SimdLevel level);
+
+/**
+ * @brief allocates one zeroed 32 byte aligned block holding count float sized arrays
+ * @details capacity is rounded up to multiple of 8 -> every array i starts 32 byte aligned at block + capacity * i
+ * @param capacity elements per array, replaced by the rounded capacity
+ * @return block to free with free(), NULL on allocation failure
+ */
+float* simdAllocArrays(uint32_t* capacity, uint32_t count);
+
+/**
+ * @brief deterministic random float in [min, max) from xorshift32, for reproducible kernel verification and benchmarks
+ * @param seed state advanced by the call, must not be 0
+ */
+float simdRandomRange(uint32_t* seed, float min, float max);
+
+#endif // __SIMD_H__
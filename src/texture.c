@@ -0,0 +1,718 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "texture.h"
+
+#include "bindless.h"
+#include "debug.h"
+#include "init.h"
+#include "utils.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vulkan/vulkan_core.h>
+
+// staging offsets of mip levels, multiple of every supported block size and of 4
+#define TEXTURE_STAGING_ALIGNMENT 16
+
+static const uint8_t ktx2Identifier[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+
+// KTX2 header following the identifier, all fields little endian,
+// followed by 64 bit supercompression global data offset and length which are not used
+typedef struct Ktx2Header
+{
+    uint32_t vkFormat;
+    uint32_t typeSize;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t layerCount;
+    uint32_t faceCount;
+    uint32_t levelCount;
+    uint32_t supercompressionScheme;
+
+    uint32_t dfdByteOffset;
+    uint32_t dfdByteLength;
+    uint32_t kvdByteOffset;
+    uint32_t kvdByteLength;
+} Ktx2Header;
+
+typedef struct Ktx2Level
+{
+    uint64_t byteOffset;
+    uint64_t byteLength;
+    uint64_t uncompressedByteLength;
+} Ktx2Level;
+
+// size of 4x4 block for BCn formats or of texel for uncompressed, 0 if format is not supported
+static uint32_t formatBlockSize(VkFormat format, VkBool32* compressed)
+{
+    *compressed = VK_TRUE;
+
+    switch (format)
+    {
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+        *compressed = VK_FALSE;
+        return 4;
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+    case VK_FORMAT_BC4_UNORM_BLOCK:
+    case VK_FORMAT_BC4_SNORM_BLOCK:
+        return 8;
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+    case VK_FORMAT_BC5_UNORM_BLOCK:
+    case VK_FORMAT_BC5_SNORM_BLOCK:
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+        return 16;
+    default:
+        return 0;
+    }
+}
+
+static uint32_t maxU32(uint32_t a, uint32_t b)
+{
+    return a > b ? a : b;
+}
+
+static VkDeviceSize mipLevelSize(uint32_t width, uint32_t height, uint32_t blockSize, VkBool32 compressed)
+{
+    if (compressed) {
+        return (VkDeviceSize) ((width + 3) / 4) * ((height + 3) / 4) * blockSize;
+    }
+
+    return (VkDeviceSize) width * height * blockSize;
+}
+
+static VkDeviceSize alignStaging(VkDeviceSize offset)
+{
+    return (offset + TEXTURE_STAGING_ALIGNMENT - 1) & ~(VkDeviceSize) (TEXTURE_STAGING_ALIGNMENT - 1);
+}
+
+static void* createStaging(State* state, Texture* texture, VkDeviceSize size)
+{
+    createBuffer(state, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+    &texture->stagingBuffer, &texture->stagingMemory);
+
+    void* mapped;
+    assertVk(vkMapMemory(state->device, texture->stagingMemory, 0, VK_WHOLE_SIZE, 0, &mapped), "failed to map texture staging buffer", "mapped texture staging buffer");
+
+    return mapped;
+}
+
+// chooses number of mip levels, checks the format can be sampled and blitted
+static int selectMipLevels(State* state, Texture* texture, uint32_t fileLevels, VkBool32 compressed)
+{
+    VkFormatProperties props;
+    vkGetPhysicalDeviceFormatProperties(state->physicalDevice, texture->format, &props);
+
+    if (!(props.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT)) {
+        LOG_WARN("%s: format %d can not be sampled", texture->path, texture->format);
+        return 0;
+    }
+
+    texture->loadedMipLevels = fileLevels;
+    texture->mipLevels = fileLevels;
+
+    if (fileLevels > 1) {
+        return 1;
+    }
+
+    uint32_t fullLevels = 1;
+    for (uint32_t size = maxU32(texture->width, texture->height); size > 1; size >>= 1)
+    {
+        fullLevels++;
+    }
+
+    // compressed formats can not be blit destinations
+    VkFormatFeatureFlags blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    if (!compressed && (props.optimalTilingFeatures & blitFeatures) == blitFeatures) {
+        texture->mipLevels = fullLevels;
+    }
+    else if (fullLevels > 1) {
+        LOG_WARN("%s: mips can not be generated for format %d", texture->path, texture->format);
+    }
+
+    return 1;
+}
+
+static int loadKtx2(State* state, Texture* texture, FILE* file)
+{
+    Ktx2Header header;
+    uint64_t supercompressionGlobalData[2];
+    if (fread(&header, sizeof(header), 1, file) != 1 || fread(supercompressionGlobalData, sizeof(supercompressionGlobalData), 1, file) != 1) {
+        LOG_WARN("%s: truncated KTX2 header", texture->path);
+        return 0;
+    }
+
+    if (header.pixelDepth > 1 || header.layerCount > 1 || header.faceCount != 1 || header.supercompressionScheme != 0) {
+        LOG_WARN("%s: only plain 2D KTX2 textures are supported", texture->path);
+        return 0;
+    }
+
+    // levelCount 0 -> file has no mips and asks for them to be generated
+    uint32_t fileLevels = maxU32(header.levelCount, 1);
+    if (fileLevels > TEXTURE_MAX_MIPS || header.pixelWidth == 0 || header.pixelHeight == 0) {
+        LOG_WARN("%s: invalid KTX2 dimensions", texture->path);
+        return 0;
+    }
+
+    VkBool32 compressed;
+    uint32_t blockSize = formatBlockSize((VkFormat) header.vkFormat, &compressed);
+    if (blockSize == 0 || (compressed && !state->textureCompressionBC)) {
+        LOG_WARN("%s: unsupported KTX2 format %u", texture->path, header.vkFormat);
+        return 0;
+    }
+
+    texture->format = (VkFormat) header.vkFormat;
+    texture->width = header.pixelWidth;
+    texture->height = header.pixelHeight;
+
+    Ktx2Level levels[TEXTURE_MAX_MIPS];
+    if (fread(levels, sizeof(Ktx2Level), fileLevels, file) != fileLevels) {
+        LOG_WARN("%s: truncated KTX2 level index", texture->path);
+        return 0;
+    }
+
+    if (!selectMipLevels(state, texture, fileLevels, compressed)) {
+        return 0;
+    }
+
+    VkDeviceSize stagingSize = 0;
+    for (uint32_t i = 0; i < fileLevels; i++)
+    {
+        uint32_t width = maxU32(texture->width >> i, 1);
+        uint32_t height = maxU32(texture->height >> i, 1);
+
+        // copies read exactly the level size, anything else would read past the level
+        if (levels[i].byteLength != mipLevelSize(width, height, blockSize, compressed)) {
+            LOG_WARN("%s: KTX2 level %u has unexpected size", texture->path, i);
+            return 0;
+        }
+
+        texture->regions[i] = (VkBufferImageCopy) {
+            .bufferOffset = alignStaging(stagingSize),
+            .bufferRowLength = 0,
+            .bufferImageHeight = 0,
+
+            .imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .imageSubresource.mipLevel = i,
+            .imageSubresource.baseArrayLayer = 0,
+            .imageSubresource.layerCount = 1,
+
+            .imageOffset = {0, 0, 0},
+            .imageExtent = {width, height, 1},
+        };
+
+        stagingSize = texture->regions[i].bufferOffset + levels[i].byteLength;
+    }
+
+    uint8_t* mapped = createStaging(state, texture, stagingSize);
+
+    for (uint32_t i = 0; i < fileLevels; i++)
+    {
+        if (fseek(file, (long) levels[i].byteOffset, SEEK_SET) != 0 ||
+            fread(mapped + texture->regions[i].bufferOffset, 1, levels[i].byteLength, file) != levels[i].byteLength) {
+            LOG_WARN("%s: truncated KTX2 level %u", texture->path, i);
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+// PAM (netpbm P7) with RGB_ALPHA tuples is raw RGBA8 with a small text header
+static int loadPam(State* state, Texture* texture, FILE* file)
+{
+    char line[128];
+    uint32_t width = 0, height = 0, depth = 0, maxval = 0;
+
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        if (strncmp(line, "ENDHDR", 6) == 0) {
+            break;
+        }
+
+        unsigned value;
+        if (sscanf(line, "WIDTH %u", &value) == 1) width = value;
+        else if (sscanf(line, "HEIGHT %u", &value) == 1) height = value;
+        else if (sscanf(line, "DEPTH %u", &value) == 1) depth = value;
+        else if (sscanf(line, "MAXVAL %u", &value) == 1) maxval = value;
+    }
+
+    if (width == 0 || height == 0 || depth != 4 || maxval != 255) {
+        LOG_WARN("%s: only 8 bit RGBA PAM files are supported", texture->path);
+        return 0;
+    }
+
+    texture->format = VK_FORMAT_R8G8B8A8_SRGB;
+    texture->width = width;
+    texture->height = height;
+
+    if (!selectMipLevels(state, texture, 1, VK_FALSE)) {
+        return 0;
+    }
+
+    VkDeviceSize size = mipLevelSize(width, height, 4, VK_FALSE);
+
+    texture->regions[0] = (VkBufferImageCopy) {
+        .bufferOffset = 0,
+        .bufferRowLength = 0,
+        .bufferImageHeight = 0,
+
+        .imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+        .imageSubresource.mipLevel = 0,
+        .imageSubresource.baseArrayLayer = 0,
+        .imageSubresource.layerCount = 1,
+
+        .imageOffset = {0, 0, 0},
+        .imageExtent = {width, height, 1},
+    };
+
+    uint8_t* mapped = createStaging(state, texture, size);
+
+    if (fread(mapped, 1, size, file) != size) {
+        LOG_WARN("%s: truncated PAM data", texture->path);
+        return 0;
+    }
+
+    return 1;
+}
+
+// image is created on the I/O thread as well so the main thread only records commands
+static void createTextureImage(State* state, Texture* texture)
+{
+    VkImageUsageFlags usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    if (texture->mipLevels > texture->loadedMipLevels) {
+        usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    }
+
+    VkImageCreateInfo crtInf = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+
+        .imageType = VK_IMAGE_TYPE_2D,
+        .format = texture->format,
+        .extent = {texture->width, texture->height, 1},
+        .mipLevels = texture->mipLevels,
+        .arrayLayers = 1,
+        .samples = VK_SAMPLE_COUNT_1_BIT,
+        .tiling = VK_IMAGE_TILING_OPTIMAL,
+
+        .usage = usage,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+    };
+
+    assertVk(vkCreateImage(state->device, &crtInf, state->allocator, &texture->image), "failed to create texture image", "created texture image");
+
+    VkMemoryRequirements memReq;
+    vkGetImageMemoryRequirements(state->device, texture->image, &memReq);
+
+    VkMemoryAllocateInfo allocInf = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+        .pNext = NULL,
+        .allocationSize = memReq.size,
+        .memoryTypeIndex = findMemoryType(state, memReq.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT),
+    };
+
+    assertVk(vkAllocateMemory(state->device, &allocInf, state->allocator, &texture->imageMemory), "failed to allocate texture memory", "allocated texture memory");
+    vkBindImageMemory(state->device, texture->image, texture->imageMemory, 0);
+}
+
+static void destroyStaging(State* state, Texture* texture)
+{
+    if (texture->stagingBuffer != VK_NULL_HANDLE) {
+        vkDestroyBuffer(state->device, texture->stagingBuffer, state->allocator);
+        vkFreeMemory(state->device, texture->stagingMemory, state->allocator);
+        texture->stagingBuffer = VK_NULL_HANDLE;
+        texture->stagingMemory = VK_NULL_HANDLE;
+    }
+}
+
+static void loadTexture(State* state, Texture* texture)
+{
+    FILE* file = fopen(texture->path, "rb");
+    if (file == NULL) {
+        LOG_WARN("failed to open texture %s", texture->path);
+        __atomic_store_n(&texture->status, TEXTURE_STATUS_FAILED, __ATOMIC_RELEASE);
+        return;
+    }
+
+    uint8_t identifier[12];
+    int loaded = 0;
+
+    if (fread(identifier, 1, sizeof(identifier), file) == sizeof(identifier)) {
+        if (memcmp(identifier, ktx2Identifier, sizeof(identifier)) == 0) {
+            loaded = loadKtx2(state, texture, file);
+        }
+        else if (memcmp(identifier, "P7\n", 3) == 0) {
+            // header lines start right after the magic
+            fseek(file, 3, SEEK_SET);
+            loaded = loadPam(state, texture, file);
+        }
+        else
+        {
+            LOG_WARN("%s: unknown texture file format", texture->path);
+        }
+    }
+
+    fclose(file);
+
+    if (!loaded) {
+        destroyStaging(state, texture);
+        __atomic_store_n(&texture->status, TEXTURE_STATUS_FAILED, __ATOMIC_RELEASE);
+        return;
+    }
+
+    createTextureImage(state, texture);
+    LOG_DEBUG("loaded texture %s (%ux%u, %u mips)", texture->path, texture->width, texture->height, texture->mipLevels);
+
+    // hands slot over to the main thread
+    __atomic_store_n(&texture->status, TEXTURE_STATUS_LOADED, __ATOMIC_RELEASE);
+}
+
+static void* textureThreadMain(void* arg)
+{
+    State* state = arg;
+    TextureStreamer* streamer = &state->textureStreamer;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&streamer->mutex);
+        while (streamer->running && streamer->queueHead == streamer->queueTail)
+        {
+            pthread_cond_wait(&streamer->cond, &streamer->mutex);
+        }
+
+        if (!streamer->running) {
+            pthread_mutex_unlock(&streamer->mutex);
+            break;
+        }
+
+        uint32_t index = streamer->queue[streamer->queueTail % TEXTURE_MAX_COUNT];
+        streamer->queueTail++;
+        pthread_mutex_unlock(&streamer->mutex);
+
+        loadTexture(state, &streamer->textures[index]);
+    }
+
+    return NULL;
+}
+
+void createTextureStreamer(State* state)
+{
+    TextureStreamer* streamer = &state->textureStreamer;
+
+    streamer->textures = (Texture*) calloc(TEXTURE_MAX_COUNT, sizeof(Texture));
+    assert_my(streamer->textures, "failed to allocate texture slots", "allocated texture slots");
+    streamer->textureCount = 0;
+    streamer->queueHead = 0;
+    streamer->queueTail = 0;
+
+    VkCommandPoolCreateInfo poolCrtInf = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+        .pNext = NULL,
+        // upload command buffers are recorded once and freed after their fence signals
+        .flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+        .queueFamilyIndex = state->queueFamilyIndex,
+    };
+
+    assertVk(vkCreateCommandPool(state->device, &poolCrtInf, state->allocator, &streamer->commandPool), "failed to create texture command pool", "created texture command pool");
+
+    pthread_mutex_init(&streamer->mutex, NULL);
+    pthread_cond_init(&streamer->cond, NULL);
+
+    streamer->running = 1;
+    assert_my(pthread_create(&streamer->thread, NULL, textureThreadMain, state) == 0, "failed to start texture thread", "started texture thread");
+}
+
+uint32_t textureRequest(State* state, const char* path)
+{
+    TextureStreamer* streamer = &state->textureStreamer;
+
+    if (streamer->textureCount == TEXTURE_MAX_COUNT) {
+        LOG_WARN("all %d texture slots are used", TEXTURE_MAX_COUNT);
+        return TEXTURE_INVALID_HANDLE;
+    }
+
+    uint32_t handle = streamer->textureCount++;
+    Texture* texture = &streamer->textures[handle];
+
+    snprintf(texture->path, sizeof(texture->path), "%s", path);
+    texture->bindlessIndex = BINDLESS_INVALID_INDEX;
+    texture->status = TEXTURE_STATUS_QUEUED;
+
+    // slot indices are never reused so the queue can not overflow
+    pthread_mutex_lock(&streamer->mutex);
+    streamer->queue[streamer->queueHead % TEXTURE_MAX_COUNT] = handle;
+    streamer->queueHead++;
+    pthread_cond_signal(&streamer->cond);
+    pthread_mutex_unlock(&streamer->mutex);
+
+    return handle;
+}
+
+static void imageBarrier(VkCommandBuffer commandBuffer, VkImage image, uint32_t baseMipLevel, uint32_t levelCount,
+    VkImageLayout oldLayout, VkImageLayout newLayout,
+    VkPipelineStageFlags srcStage, VkAccessFlags srcAccess,
+    VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+{
+    VkImageMemoryBarrier barrier = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .pNext = NULL,
+
+        .srcAccessMask = srcAccess,
+        .dstAccessMask = dstAccess,
+
+        .oldLayout = oldLayout,
+        .newLayout = newLayout,
+
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+
+        .image = image,
+        .subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+        .subresourceRange.baseMipLevel = baseMipLevel,
+        .subresourceRange.levelCount = levelCount,
+        .subresourceRange.baseArrayLayer = 0,
+        .subresourceRange.layerCount = 1,
+    };
+
+    vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, NULL, 0, NULL, 1, &barrier);
+}
+
+// each level is blitted from the previous one, then handed to the fragment shader
+static void recordMipGeneration(VkCommandBuffer commandBuffer, Texture* texture)
+{
+    int32_t width = (int32_t) texture->width;
+    int32_t height = (int32_t) texture->height;
+
+    for (uint32_t level = 1; level < texture->mipLevels; level++)
+    {
+        imageBarrier(commandBuffer, texture->image, level - 1, 1,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+
+        int32_t nextWidth = width > 1 ? width / 2 : 1;
+        int32_t nextHeight = height > 1 ? height / 2 : 1;
+
+        VkImageBlit blit = {
+            .srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .srcSubresource.mipLevel = level - 1,
+            .srcSubresource.baseArrayLayer = 0,
+            .srcSubresource.layerCount = 1,
+            .srcOffsets = {{0, 0, 0}, {width, height, 1}},
+
+            .dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .dstSubresource.mipLevel = level,
+            .dstSubresource.baseArrayLayer = 0,
+            .dstSubresource.layerCount = 1,
+            .dstOffsets = {{0, 0, 0}, {nextWidth, nextHeight, 1}},
+        };
+
+        vkCmdBlitImage(commandBuffer,
+            texture->image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            texture->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            1, &blit, VK_FILTER_LINEAR);
+
+        imageBarrier(commandBuffer, texture->image, level - 1, 1,
+            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+
+        width = nextWidth;
+        height = nextHeight;
+    }
+
+    imageBarrier(commandBuffer, texture->image, texture->mipLevels - 1, 1,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+}
+
+static void submitUpload(State* state, Texture* texture)
+{
+    TextureStreamer* streamer = &state->textureStreamer;
+
+    VkCommandBufferAllocateInfo allocInf = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .pNext = NULL,
+        .commandPool = streamer->commandPool,
+        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+        .commandBufferCount = 1,
+    };
+
+    assertVk(vkAllocateCommandBuffers(state->device, &allocInf, &texture->commandBuffer), "failed to allocate texture upload command buffer", "allocated texture upload command buffer");
+
+    VkCommandBufferBeginInfo beginInf = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .pNext = NULL,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+        .pInheritanceInfo = NULL,
+    };
+
+    assertVk(vkBeginCommandBuffer(texture->commandBuffer, &beginInf), "failed to begin texture upload", "");
+
+    imageBarrier(texture->commandBuffer, texture->image, 0, texture->mipLevels,
+        VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+
+    vkCmdCopyBufferToImage(texture->commandBuffer, texture->stagingBuffer, texture->image,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, texture->loadedMipLevels, texture->regions);
+
+    if (texture->mipLevels > texture->loadedMipLevels) {
+        recordMipGeneration(texture->commandBuffer, texture);
+    }
+    else
+    {
+        imageBarrier(texture->commandBuffer, texture->image, 0, texture->mipLevels,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+    }
+
+    assertVk(vkEndCommandBuffer(texture->commandBuffer), "failed to record texture upload", "");
+
+    VkFenceCreateInfo fenceCrtInf = {
+        .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+    };
+
+    assertVk(vkCreateFence(state->device, &fenceCrtInf, state->allocator, &texture->fence), "failed to create texture upload fence", "");
+
+    VkSubmitInfo submitInf = {
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .pNext = NULL,
+
+        .commandBufferCount = 1,
+        .pCommandBuffers = &texture->commandBuffer,
+    };
+
+    // the texture is not referenced by any frame until its fence signals, no semaphore needed
+    assertVk(vkQueueSubmit(state->graphicsQueue, 1, &submitInf, texture->fence), "failed to submit texture upload", "");
+}
+
+static void publishTexture(State* state, Texture* texture)
+{
+    TextureStreamer* streamer = &state->textureStreamer;
+
+    vkFreeCommandBuffers(state->device, streamer->commandPool, 1, &texture->commandBuffer);
+    vkDestroyFence(state->device, texture->fence, state->allocator);
+    texture->commandBuffer = VK_NULL_HANDLE;
+    texture->fence = VK_NULL_HANDLE;
+
+    destroyStaging(state, texture);
+
+    VkImageViewCreateInfo viewCrtInf = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+
+        .image = texture->image,
+        .viewType = VK_IMAGE_VIEW_TYPE_2D,
+        .format = texture->format,
+
+        .components.a = VK_COMPONENT_SWIZZLE_IDENTITY,
+        .components.r = VK_COMPONENT_SWIZZLE_IDENTITY,
+        .components.g = VK_COMPONENT_SWIZZLE_IDENTITY,
+        .components.b = VK_COMPONENT_SWIZZLE_IDENTITY,
+
+        .subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+        .subresourceRange.baseArrayLayer = 0,
+        .subresourceRange.baseMipLevel = 0,
+        .subresourceRange.layerCount = 1,
+        .subresourceRange.levelCount = texture->mipLevels,
+    };
+
+    assertVk(vkCreateImageView(state->device, &viewCrtInf, state->allocator, &texture->imageView), "failed to create texture image view", "created texture image view");
+
+    texture->bindlessIndex = bindlessRegisterTexture(state, texture->imageView, VK_NULL_HANDLE);
+    texture->status = texture->bindlessIndex != BINDLESS_INVALID_INDEX ? TEXTURE_STATUS_READY : TEXTURE_STATUS_FAILED;
+
+    LOG_DEBUG("texture %s ready at bindless index %u", texture->path, texture->bindlessIndex);
+}
+
+void textureStreamerUpdate(State* state)
+{
+    TextureStreamer* streamer = &state->textureStreamer;
+    uint32_t submitted = 0;
+
+    for (uint32_t i = 0; i < streamer->textureCount; i++)
+    {
+        Texture* texture = &streamer->textures[i];
+        int status = __atomic_load_n(&texture->status, __ATOMIC_ACQUIRE);
+
+        if (status == TEXTURE_STATUS_LOADED && submitted < TEXTURE_UPLOADS_PER_UPDATE) {
+            submitUpload(state, texture);
+            texture->status = TEXTURE_STATUS_UPLOADING;
+            submitted++;
+        }
+        else if (status == TEXTURE_STATUS_UPLOADING && vkGetFenceStatus(state->device, texture->fence) == VK_SUCCESS) {
+            publishTexture(state, texture);
+        }
+    }
+}
+
+uint32_t textureBindlessIndex(State* state, uint32_t handle)
+{
+    TextureStreamer* streamer = &state->textureStreamer;
+
+    if (handle >= streamer->textureCount || __atomic_load_n(&streamer->textures[handle].status, __ATOMIC_ACQUIRE) != TEXTURE_STATUS_READY) {
+        return BINDLESS_INVALID_INDEX;
+    }
+
+    return streamer->textures[handle].bindlessIndex;
+}
+
+void destroyTextureStreamer(State* state)
+{
+    TextureStreamer* streamer = &state->textureStreamer;
+
+    pthread_mutex_lock(&streamer->mutex);
+    streamer->running = 0;
+    pthread_cond_signal(&streamer->cond);
+    pthread_mutex_unlock(&streamer->mutex);
+    pthread_join(streamer->thread, NULL);
+
+    // thread is joined and device idle, every slot can be released regardless of status
+    for (uint32_t i = 0; i < streamer->textureCount; i++)
+    {
+        Texture* texture = &streamer->textures[i];
+
+        if (texture->fence != VK_NULL_HANDLE) {
+            vkDestroyFence(state->device, texture->fence, state->allocator);
+        }
+
+        destroyStaging(state, texture);
+
+        if (texture->imageView != VK_NULL_HANDLE) {
+            vkDestroyImageView(state->device, texture->imageView, state->allocator);
+        }
+
+        if (texture->image != VK_NULL_HANDLE) {
+            vkDestroyImage(state->device, texture->image, state->allocator);
+            vkFreeMemory(state->device, texture->imageMemory, state->allocator);
+        }
+    }
+
+    // frees remaining command buffers as well
+    vkDestroyCommandPool(state->device, streamer->commandPool, state->allocator);
+
+    pthread_cond_destroy(&streamer->cond);
+    pthread_mutex_destroy(&streamer->mutex);
+
+    free(streamer->textures);
+    streamer->textures = NULL;
+}
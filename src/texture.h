@@ -0,0 +1,119 @@
+#ifndef __TEXTURE_H__
+#define __TEXTURE_H__
+
+#include "common.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <vulkan/vulkan_core.h>
+
+// max textures the streamer tracks, one slot per requested file
+#define TEXTURE_MAX_COUNT 256
+// enough mip levels for 32768x32768
+#define TEXTURE_MAX_MIPS 16
+// uploads submitted per textureStreamerUpdate call, bounds main thread recording time
+#define TEXTURE_UPLOADS_PER_UPDATE 4
+
+#define TEXTURE_INVALID_HANDLE UINT32_MAX
+
+// life cycle of streamed texture, owner of the slot changes with the status
+typedef enum TextureStatus
+{
+    // queued for I/O thread
+    TEXTURE_STATUS_QUEUED,
+    // staging buffer and image filled by I/O thread, waiting for main thread to record upload
+    TEXTURE_STATUS_LOADED,
+    // upload submitted, waiting for its fence
+    TEXTURE_STATUS_UPLOADING,
+    // sampled image published in the bindless table
+    TEXTURE_STATUS_READY,
+    TEXTURE_STATUS_FAILED,
+} TextureStatus;
+
+typedef struct Texture
+{
+    // TextureStatus, accessed atomically, I/O thread owns the slot until LOADED
+    int status;
+    char path[256];
+
+    VkFormat format;
+    uint32_t width;
+    uint32_t height;
+    uint32_t mipLevels;
+    // levels stored in file, remaining levels are blitted on the GPU
+    uint32_t loadedMipLevels;
+
+    VkBuffer stagingBuffer;
+    VkDeviceMemory stagingMemory;
+    VkBufferImageCopy regions[TEXTURE_MAX_MIPS];
+
+    VkImage image;
+    VkDeviceMemory imageMemory;
+    VkImageView imageView;
+
+    VkCommandBuffer commandBuffer;
+    VkFence fence;
+
+    uint32_t bindlessIndex;
+} Texture;
+
+// background loader, the I/O thread reads files into staging memory
+// and the main thread records uploads and publishes finished textures
+typedef struct TextureStreamer
+{
+    Texture* textures;
+    // written by main thread only
+    uint32_t textureCount;
+
+    pthread_t thread;
+    int running;
+
+    // indices of queued textures, protected by mutex
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    uint32_t queue[TEXTURE_MAX_COUNT];
+    uint32_t queueHead;
+    uint32_t queueTail;
+
+    // upload command buffers, used by main thread only
+    VkCommandPool commandPool;
+} TextureStreamer;
+
+/**
+ * @brief starts texture I/O thread and creates upload command pool
+ * Requires:
+    - Valid logical device and graphics queue in state
+    - Bindless table created
+ * @param state
+ */
+void createTextureStreamer(State* state);
+
+/**
+ * @brief queues texture file for loading, never blocks on I/O
+ * @details supported files: KTX2 (RGBA8 or BC1/BC3/BC4/BC5/BC7, 2D, no supercompression)
+ * and PAM (P7, RGB_ALPHA, maxval 255) as raw RGBA8
+ * Main thread only
+ * @return handle of texture, TEXTURE_INVALID_HANDLE when all slots are used
+ */
+uint32_t textureRequest(State* state, const char* path);
+
+/**
+ * @brief records and submits uploads of loaded textures, publishes textures whose upload fence signaled
+ * @details polls fences with vkGetFenceStatus, never waits, call once per frame from main thread
+ */
+void textureStreamerUpdate(State* state);
+
+/**
+ * @brief bindless index of texture
+ * @return index to use in draws, BINDLESS_INVALID_INDEX until texture is ready
+ */
+uint32_t textureBindlessIndex(State* state, uint32_t handle);
+
+/**
+ * @brief stops I/O thread and destroys all textures
+ * Requires:
+    - device idle
+ */
+void destroyTextureStreamer(State* state);
+
+#endif // __TEXTURE_H__
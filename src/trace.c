@@ -0,0 +1,424 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include "trace.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct TraceStageStats
+{
+    uint64_t count;
+    uint64_t totalNs;
+    uint64_t minNs;
+    uint64_t maxNs;
+    uint32_t histogram[TRACE_HISTOGRAM_BUCKETS];
+} TraceStageStats;
+
+typedef struct TraceThread
+{
+    TraceEvent events[TRACE_RING_SIZE];
+    // total number of events ever written, only written by owning thread
+    uint64_t head;
+
+    TraceStageStats stats[TRACE_STAGE_COUNT];
+
+    char name[32];
+    uint32_t id;
+} TraceThread;
+
+int traceEnabledFlag = 0;
+
+static TraceThread* traceThreads[TRACE_MAX_THREADS];
+static uint32_t traceThreadCount = 0;
+
+static __thread TraceThread* traceLocal = NULL;
+static __thread int traceLocalFailed = 0;
+
+static const char* traceStageNames[TRACE_STAGE_COUNT] = {
+    [TRACE_STAGE_FRAME] = "frame",
+    [TRACE_STAGE_FENCE_WAIT] = "fence wait",
+    [TRACE_STAGE_ACQUIRE] = "acquire",
+    [TRACE_STAGE_RECORD] = "record",
+    [TRACE_STAGE_SUBMIT] = "submit",
+    [TRACE_STAGE_PRESENT] = "present",
+    [TRACE_STAGE_RECREATE_SWAPCHAIN] = "recreate swapchain",
+    [TRACE_STAGE_INSTANCES] = "instances",
+    [TRACE_STAGE_CULL] = "cull",
+    [TRACE_STAGE_BATCH] = "batch",
+    [TRACE_STAGE_FRAME_CAP] = "frame cap",
+    [TRACE_STAGE_INPUT_TO_SUBMIT] = "input to submit",
+    [TRACE_STAGE_INPUT_TO_PHOTON] = "input to photon",
+    [TRACE_STAGE_ACQUIRE_TO_PHOTON] = "acquire to photon",
+    [TRACE_STAGE_SUBMIT_TO_PHOTON] = "submit to photon",
+};
+
+uint64_t traceNow(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + (uint64_t) ts.tv_nsec;
+}
+
+void traceSetEnabled(int enabled)
+{
+    traceEnabledFlag = enabled;
+}
+
+const char* traceStageName(TraceStage stage)
+{
+    return stage < TRACE_STAGE_COUNT ? traceStageNames[stage] : "unknown";
+}
+
+static TraceThread* traceRegisterThread(void)
+{
+    if (traceLocal != NULL || traceLocalFailed) {
+        return traceLocal;
+    }
+
+    uint32_t id = __atomic_fetch_add(&traceThreadCount, 1, __ATOMIC_RELAXED);
+    TraceThread* thread = id < TRACE_MAX_THREADS ? calloc(1, sizeof(TraceThread)) : NULL;
+
+    if (thread == NULL) {
+        traceLocalFailed = 1;
+        return NULL;
+    }
+
+    thread->id = id;
+    snprintf(thread->name, sizeof(thread->name), "thread %u", id);
+    for (uint32_t i = 0; i < TRACE_STAGE_COUNT; i++)
+    {
+        thread->stats[i].minNs = UINT64_MAX;
+    }
+
+    __atomic_store_n(&traceThreads[id], thread, __ATOMIC_RELEASE);
+    traceLocal = thread;
+
+    return thread;
+}
+
+void traceSetThreadName(const char* name)
+{
+    TraceThread* thread = traceRegisterThread();
+
+    if (thread != NULL) {
+        snprintf(thread->name, sizeof(thread->name), "%s", name);
+    }
+}
+
+static uint32_t traceBucket(uint64_t ns)
+{
+    if (ns < (1u << TRACE_SUB_BUCKET_BITS)) {
+        return (uint32_t) ns;
+    }
+
+    uint32_t msb = 63 - __builtin_clzll(ns);
+    uint32_t sub = (ns >> (msb - TRACE_SUB_BUCKET_BITS)) & ((1u << TRACE_SUB_BUCKET_BITS) - 1);
+
+    return ((msb - TRACE_SUB_BUCKET_BITS + 1) << TRACE_SUB_BUCKET_BITS) + sub;
+}
+
+// smallest duration falling into bucket
+static uint64_t traceBucketLow(uint32_t bucket)
+{
+    if (bucket < (1u << TRACE_SUB_BUCKET_BITS)) {
+        return bucket;
+    }
+
+    uint32_t msb = (bucket >> TRACE_SUB_BUCKET_BITS) + TRACE_SUB_BUCKET_BITS - 1;
+    uint64_t sub = bucket & ((1u << TRACE_SUB_BUCKET_BITS) - 1);
+
+    return (1ull << msb) | (sub << (msb - TRACE_SUB_BUCKET_BITS));
+}
+
+void traceRecord(TraceStage stage, uint64_t frame, uint64_t startNs, uint64_t endNs)
+{
+    TraceThread* thread = traceRegisterThread();
+
+    if (thread == NULL || stage >= TRACE_STAGE_COUNT) {
+        return;
+    }
+
+    uint64_t duration = endNs > startNs ? endNs - startNs : 0;
+
+    TraceEvent* event = &thread->events[thread->head & (TRACE_RING_SIZE - 1)];
+    event->frame = frame;
+    event->startNs = startNs;
+    event->endNs = endNs;
+    event->stage = stage;
+
+    TraceStageStats* stats = &thread->stats[stage];
+    stats->count++;
+    stats->totalNs += duration;
+    stats->minNs = duration < stats->minNs ? duration : stats->minNs;
+    stats->maxNs = duration > stats->maxNs ? duration : stats->maxNs;
+    stats->histogram[traceBucket(duration)]++;
+
+    __atomic_store_n(&thread->head, thread->head + 1, __ATOMIC_RELEASE);
+}
+
+static uint32_t traceThreadsRegistered(void)
+{
+    uint32_t count = __atomic_load_n(&traceThreadCount, __ATOMIC_ACQUIRE);
+    return count < TRACE_MAX_THREADS ? count : TRACE_MAX_THREADS;
+}
+
+// index of oldest event still held by ring
+static uint64_t traceFirstEvent(uint64_t head)
+{
+    return head > TRACE_RING_SIZE ? head - TRACE_RING_SIZE : 0;
+}
+
+// thread names are set by callers, quotes and backslashes must not end the JSON string early
+static void traceWriteJsonString(FILE* file, const char* text)
+{
+    fputc('"', file);
+
+    for (const char* c = text; *c != '\0'; c++)
+    {
+        if (*c == '"' || *c == '\\') {
+            fputc('\\', file);
+            fputc(*c, file);
+        }
+        else if ((unsigned char) *c < 0x20) {
+            fprintf(file, "\\u%04x", (unsigned char) *c);
+        }
+        else
+        {
+            fputc(*c, file);
+        }
+    }
+
+    fputc('"', file);
+}
+
+int traceWriteChromeJson(const char* path)
+{
+    FILE* file = fopen(path, "w");
+    if (file == NULL) {
+        return -1;
+    }
+
+    // all timestamps are relative to oldest buffered event so values stay readable
+    uint64_t origin = UINT64_MAX;
+    uint32_t threadCount = traceThreadsRegistered();
+
+    for (uint32_t t = 0; t < threadCount; t++)
+    {
+        TraceThread* thread = __atomic_load_n(&traceThreads[t], __ATOMIC_ACQUIRE);
+        if (thread == NULL) {
+            continue;
+        }
+
+        uint64_t head = __atomic_load_n(&thread->head, __ATOMIC_ACQUIRE);
+        for (uint64_t i = traceFirstEvent(head); i < head; i++)
+        {
+            uint64_t start = thread->events[i & (TRACE_RING_SIZE - 1)].startNs;
+            origin = start < origin ? start : origin;
+        }
+    }
+
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+    const char* separator = "";
+    for (uint32_t t = 0; t < threadCount; t++)
+    {
+        TraceThread* thread = __atomic_load_n(&traceThreads[t], __ATOMIC_ACQUIRE);
+        if (thread == NULL) {
+            continue;
+        }
+
+        fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", separator, thread->id);
+        traceWriteJsonString(file, thread->name);
+        fprintf(file, "}}");
+        separator = ",\n";
+
+        uint64_t head = __atomic_load_n(&thread->head, __ATOMIC_ACQUIRE);
+        for (uint64_t i = traceFirstEvent(head); i < head; i++)
+        {
+            TraceEvent* event = &thread->events[i & (TRACE_RING_SIZE - 1)];
+            uint64_t duration = event->endNs > event->startNs ? event->endNs - event->startNs : 0;
+
+            fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%llu}}",
+                separator, traceStageName(event->stage), thread->id,
+                (double) (event->startNs - origin) / 1000.0, (double) duration / 1000.0,
+                (unsigned long long) event->frame);
+        }
+    }
+
+    fprintf(file, "\n]}\n");
+
+    int failed = ferror(file);
+    fclose(file);
+
+    return failed ? -1 : 0;
+}
+
+static uint64_t tracePercentile(const TraceStageStats* stats, double percentile)
+{
+    uint64_t target = (uint64_t) (percentile * (double) stats->count);
+    uint64_t seen = 0;
+
+    for (uint32_t b = 0; b < TRACE_HISTOGRAM_BUCKETS; b++)
+    {
+        seen += stats->histogram[b];
+        if (seen > target) {
+            return traceBucketLow(b);
+        }
+    }
+
+    return stats->maxNs;
+}
+
+// merges statistics of a stage over all threads
+static void traceMergeStage(uint32_t stage, uint32_t threadCount, TraceStageStats* merged)
+{
+    memset(merged, 0, sizeof(*merged));
+    merged->minNs = UINT64_MAX;
+
+    for (uint32_t t = 0; t < threadCount; t++)
+    {
+        TraceThread* thread = __atomic_load_n(&traceThreads[t], __ATOMIC_ACQUIRE);
+        if (thread == NULL) {
+            continue;
+        }
+
+        TraceStageStats* stats = &thread->stats[stage];
+        merged->count += stats->count;
+        merged->totalNs += stats->totalNs;
+        merged->minNs = stats->minNs < merged->minNs ? stats->minNs : merged->minNs;
+        merged->maxNs = stats->maxNs > merged->maxNs ? stats->maxNs : merged->maxNs;
+
+        for (uint32_t b = 0; b < TRACE_HISTOGRAM_BUCKETS; b++)
+        {
+            merged->histogram[b] += stats->histogram[b];
+        }
+    }
+}
+
+// per stage statistics, tab separated lines for files or aligned columns followed by histograms for reading
+static void traceWriteStages(FILE* out, int aligned)
+{
+    uint32_t threadCount = traceThreadsRegistered();
+
+    if (aligned) {
+        fprintf(out, "%-20s %10s %10s %10s %10s %10s %10s\n", "stage", "count", "avg us", "p50 us", "p99 us", "min us", "max us");
+    }
+    else
+    {
+        fprintf(out, "# stage\tcount\tavg_us\tp50_us\tp99_us\tmin_us\tmax_us\n");
+    }
+
+    for (uint32_t s = 0; s < TRACE_STAGE_COUNT; s++)
+    {
+        TraceStageStats merged;
+        traceMergeStage(s, threadCount, &merged);
+
+        if (merged.count == 0) {
+            continue;
+        }
+
+        fprintf(out, aligned ? "%-20s %10llu %10.1f %10.1f %10.1f %10.1f %10.1f\n" : "%s\t%llu\t%.1f\t%.1f\t%.1f\t%.1f\t%.1f\n",
+            traceStageName(s), (unsigned long long) merged.count,
+            (double) merged.totalNs / (double) merged.count / 1000.0,
+            (double) tracePercentile(&merged, 0.50) / 1000.0,
+            (double) tracePercentile(&merged, 0.99) / 1000.0,
+            (double) merged.minNs / 1000.0, (double) merged.maxNs / 1000.0);
+
+        if (!aligned) {
+            continue;
+        }
+
+        // histogram with bar length relative to fullest bucket
+        uint32_t fullest = 0;
+        for (uint32_t b = 0; b < TRACE_HISTOGRAM_BUCKETS; b++)
+        {
+            fullest = merged.histogram[b] > fullest ? merged.histogram[b] : fullest;
+        }
+
+        for (uint32_t b = 0; b < TRACE_HISTOGRAM_BUCKETS; b++)
+        {
+            if (merged.histogram[b] == 0) {
+                continue;
+            }
+
+            char bar[41];
+            uint32_t length = (uint32_t) ((uint64_t) merged.histogram[b] * 40 / fullest);
+            length = length ? length : 1;
+            memset(bar, '#', length);
+            bar[length] = '\0';
+
+            fprintf(out, "    >= %10.1f us %8u %s\n", (double) traceBucketLow(b) / 1000.0, merged.histogram[b], bar);
+        }
+    }
+}
+
+int traceWriteSummary(const char* path)
+{
+    FILE* file = fopen(path, "w");
+    if (file == NULL) {
+        return -1;
+    }
+
+    traceWriteStages(file, 0);
+
+    int failed = ferror(file);
+    fclose(file);
+
+    return failed ? -1 : 0;
+}
+
+void tracePrintSummary(FILE* out)
+{
+    uint32_t threadCount = traceThreadsRegistered();
+
+    traceWriteStages(out, 1);
+
+    // find slowest buffered frame and print what it consisted of
+    uint64_t slowestFrame = 0;
+    uint64_t slowestDuration = 0;
+
+    for (uint32_t t = 0; t < threadCount; t++)
+    {
+        TraceThread* thread = __atomic_load_n(&traceThreads[t], __ATOMIC_ACQUIRE);
+        if (thread == NULL) {
+            continue;
+        }
+
+        uint64_t head = __atomic_load_n(&thread->head, __ATOMIC_ACQUIRE);
+        for (uint64_t i = traceFirstEvent(head); i < head; i++)
+        {
+            TraceEvent* event = &thread->events[i & (TRACE_RING_SIZE - 1)];
+            if (event->stage == TRACE_STAGE_FRAME && event->endNs - event->startNs > slowestDuration) {
+                slowestDuration = event->endNs - event->startNs;
+                slowestFrame = event->frame;
+            }
+        }
+    }
+
+    if (slowestDuration == 0) {
+        return;
+    }
+
+    fprintf(out, "slowest buffered frame %llu took %.1f us:\n", (unsigned long long) slowestFrame, (double) slowestDuration / 1000.0);
+
+    for (uint32_t t = 0; t < threadCount; t++)
+    {
+        TraceThread* thread = __atomic_load_n(&traceThreads[t], __ATOMIC_ACQUIRE);
+        if (thread == NULL) {
+            continue;
+        }
+
+        uint64_t head = __atomic_load_n(&thread->head, __ATOMIC_ACQUIRE);
+        for (uint64_t i = traceFirstEvent(head); i < head; i++)
+        {
+            TraceEvent* event = &thread->events[i & (TRACE_RING_SIZE - 1)];
+            if (event->frame == slowestFrame && event->stage != TRACE_STAGE_FRAME) {
+                fprintf(out, "    %-20s %10.1f us (%s)\n", traceStageName(event->stage),
+                    (double) (event->endNs - event->startNs) / 1000.0, thread->name);
+            }
+        }
+    }
+}
@@ -0,0 +1,98 @@
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include <stdint.h>
+#include <stdio.h>
+
+// number of events kept per thread, older events are overwritten (must be power of two)
+#define TRACE_RING_SIZE 8192
+#define TRACE_MAX_THREADS 32
+
+// histogram buckets: 4 linear sub buckets per power of two nanoseconds
+#define TRACE_SUB_BUCKET_BITS 2
+#define TRACE_HISTOGRAM_BUCKETS (64 << TRACE_SUB_BUCKET_BITS)
+
+typedef enum TraceStage
+{
+    TRACE_STAGE_FRAME,
+    TRACE_STAGE_FENCE_WAIT,
+    TRACE_STAGE_ACQUIRE,
+    TRACE_STAGE_RECORD,
+    TRACE_STAGE_SUBMIT,
+    TRACE_STAGE_PRESENT,
+    TRACE_STAGE_RECREATE_SWAPCHAIN,
+    TRACE_STAGE_INSTANCES,
+    TRACE_STAGE_CULL,
+    TRACE_STAGE_BATCH,
+    TRACE_STAGE_FRAME_CAP,
+    // latency of frames of the first window, recorded with --latency
+    TRACE_STAGE_INPUT_TO_SUBMIT,
+    TRACE_STAGE_INPUT_TO_PHOTON,
+    TRACE_STAGE_ACQUIRE_TO_PHOTON,
+    TRACE_STAGE_SUBMIT_TO_PHOTON,
+
+    TRACE_STAGE_COUNT
+} TraceStage;
+
+typedef struct TraceEvent
+{
+    uint64_t frame;
+    uint64_t startNs;
+    uint64_t endNs;
+    uint32_t stage;
+} TraceEvent;
+
+// runtime switch, checked inline by the macros so disabled tracing costs one branch
+extern int traceEnabledFlag;
+
+#ifdef NO_TRACE
+#define TRACE_BEGIN(VAR) uint64_t VAR = 0; (void) VAR
+#define TRACE_END(VAR, STAGE, FRAME) (void) (VAR)
+#else
+#define TRACE_BEGIN(VAR) uint64_t VAR = traceEnabledFlag ? traceNow() : 0
+#define TRACE_END(VAR, STAGE, FRAME) do { if (traceEnabledFlag) { traceRecord((STAGE), (FRAME), (VAR), traceNow()); } } while (0)
+#endif
+
+/**
+ * @brief monotonic clock in nanoseconds
+ */
+uint64_t traceNow(void);
+
+void traceSetEnabled(int enabled);
+
+/**
+ * @brief names calling thread in the dumped trace, registers thread if needed
+ */
+void traceSetThreadName(const char* name);
+
+/**
+ * @brief stores event into calling thread's ring buffer and updates stage histogram
+ * @details lock free, first call from a thread allocates its ring buffer
+ */
+void traceRecord(TraceStage stage, uint64_t frame, uint64_t startNs, uint64_t endNs);
+
+const char* traceStageName(TraceStage stage);
+
+/**
+ * @brief writes all buffered events as Chrome trace event JSON (loadable in Perfetto / chrome://tracing)
+ * Requires:
+    - traced threads are quiescent
+ * @return 0 on success
+ */
+int traceWriteChromeJson(const char* path);
+
+/**
+ * @brief writes per stage statistics as tab separated lines, one per recorded stage
+ * @details columns: stage, count, avg_us, p50_us, p99_us, min_us, max_us, first line is a # comment naming them
+ * Requires:
+    - traced threads are quiescent
+ * @return 0 on success
+ */
+int traceWriteSummary(const char* path);
+
+/**
+ * @brief prints per stage percentiles, histograms and the breakdown of the slowest frame
+ */
+void tracePrintSummary(FILE* out);
+
+#endif // __TRACE_H__
@@ -0,0 +1,135 @@
+#include "uniform.h"
+
+#include "debug.h"
+#include "init.h"
+#include "utils.h"
+
+#include <stdint.h>
+#include <vulkan/vulkan_core.h>
+
+void createUniformRing(State* state)
+{
+    UniformRing* ring = &state->uniforms;
+
+    VkPhysicalDeviceProperties props;
+    vkGetPhysicalDeviceProperties(state->physicalDevice, &props);
+    ring->alignment = props.limits.minUniformBufferOffsetAlignment;
+
+    // host coherent -> writes are visible to the GPU at submit without flushing
+    createBuffer(state, UNIFORM_RING_FRAME_SIZE * MAX_FRAMES_IN_FLIGHT,
+    VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+    &ring->buffer, &ring->memory);
+
+    void* mapped;
+    assertVk(vkMapMemory(state->device, ring->memory, 0, VK_WHOLE_SIZE, 0, &mapped), "failed to map uniform ring", "mapped uniform ring");
+    ring->mapped = mapped;
+
+    ring->head = 0;
+    ring->end = UNIFORM_RING_FRAME_SIZE;
+
+    VkDescriptorSetLayoutBinding binding = {
+        .binding = 0,
+        .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+        .descriptorCount = 1,
+        .stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+        .pImmutableSamplers = NULL,
+    };
+
+    VkDescriptorSetLayoutCreateInfo layoutCrtInf = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+
+        .bindingCount = 1,
+        .pBindings = &binding,
+    };
+
+    assertVk(vkCreateDescriptorSetLayout(state->device, &layoutCrtInf, state->allocator, &ring->setLayout),
+    "failed to create uniform descriptor set layout", "created uniform descriptor set layout");
+
+    VkDescriptorPoolSize poolSize = {
+        .type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+        .descriptorCount = 1,
+    };
+
+    VkDescriptorPoolCreateInfo poolCrtInf = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+
+        .maxSets = 1,
+        .poolSizeCount = 1,
+        .pPoolSizes = &poolSize,
+    };
+
+    assertVk(vkCreateDescriptorPool(state->device, &poolCrtInf, state->allocator, &ring->descriptorPool),
+    "failed to create uniform descriptor pool", "created uniform descriptor pool");
+
+    VkDescriptorSetAllocateInfo allocInf = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .pNext = NULL,
+
+        .descriptorPool = ring->descriptorPool,
+        .descriptorSetCount = 1,
+        .pSetLayouts = &ring->setLayout,
+    };
+
+    assertVk(vkAllocateDescriptorSets(state->device, &allocInf, &ring->set), "failed to allocate uniform descriptor set", "allocated uniform descriptor set");
+
+    // the descriptor covers one block, which block is selected by the dynamic offset at bind time
+    VkDescriptorBufferInfo bufferInf = {
+        .buffer = ring->buffer,
+        .offset = 0,
+        .range = sizeof(DrawUniforms),
+    };
+
+    VkWriteDescriptorSet write = {
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .pNext = NULL,
+
+        .dstSet = ring->set,
+        .dstBinding = 0,
+        .dstArrayElement = 0,
+        .descriptorCount = 1,
+        .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+        .pBufferInfo = &bufferInf,
+    };
+
+    vkUpdateDescriptorSets(state->device, 1, &write, 0, NULL);
+}
+
+void uniformRingBeginFrame(State* state, uint32_t frame)
+{
+    state->uniforms.head = (VkDeviceSize) frame * UNIFORM_RING_FRAME_SIZE;
+    state->uniforms.end = state->uniforms.head + UNIFORM_RING_FRAME_SIZE;
+}
+
+void* uniformRingAlloc(State* state, VkDeviceSize size, uint32_t* dynamicOffset)
+{
+    UniformRing* ring = &state->uniforms;
+
+    // alignment is guaranteed to be a power of two
+    VkDeviceSize offset = (ring->head + ring->alignment - 1) & ~(ring->alignment - 1);
+
+    if (offset + size > ring->end) {
+        return NULL;
+    }
+
+    ring->head = offset + size;
+    *dynamicOffset = (uint32_t) offset;
+
+    return ring->mapped + offset;
+}
+
+void destroyUniformRing(State* state)
+{
+    UniformRing* ring = &state->uniforms;
+
+    vkDestroyDescriptorPool(state->device, ring->descriptorPool, state->allocator);
+    vkDestroyDescriptorSetLayout(state->device, ring->setLayout, state->allocator);
+
+    vkUnmapMemory(state->device, ring->memory);
+    vkDestroyBuffer(state->device, ring->buffer, state->allocator);
+    vkFreeMemory(state->device, ring->memory, state->allocator);
+}
@@ -0,0 +1,54 @@
+#ifndef __UNIFORM_H__
+#define __UNIFORM_H__
+
+#include "common.h"
+
+#include <stdint.h>
+#include <vulkan/vulkan_core.h>
+
+// bytes of the uniform ring reserved for each frame in flight
+#define UNIFORM_RING_FRAME_SIZE (64 * 1024)
+
+// persistently mapped uniform buffer split into one region per frame in flight,
+// allocations are bumped inside the current frame's region and addressed by dynamic offsets
+typedef struct UniformRing
+{
+    VkBuffer buffer;
+    VkDeviceMemory memory;
+    uint8_t* mapped;
+
+    VkDeviceSize alignment;
+    VkDeviceSize head;
+    VkDeviceSize end;
+
+    VkDescriptorSetLayout setLayout;
+    VkDescriptorPool descriptorPool;
+    // single descriptor set with dynamic uniform buffer, never updated after creation
+    VkDescriptorSet set;
+} UniformRing;
+
+/**
+ * @brief creates persistently mapped uniform ring and its dynamic uniform buffer descriptor set
+ * Requires:
+    - Valid logical device in state
+ * @param state 
+ */
+void createUniformRing(State* state);
+
+/**
+ * @brief resets bump allocator to region of given frame in flight
+ * Requires:
+    - fence of the frame signaled, GPU no longer reads the region
+ */
+void uniformRingBeginFrame(State* state, uint32_t frame);
+
+/**
+ * @brief allocates aligned block in current frame's region
+ * @param dynamicOffset offset to pass to vkCmdBindDescriptorSets
+ * @return mapped pointer to write block to, NULL when frame region is exhausted
+ */
+void* uniformRingAlloc(State* state, VkDeviceSize size, uint32_t* dynamicOffset);
+
+void destroyUniformRing(State* state);
+
+#endif // __UNIFORM_H__
@@ -1,6 +1,18 @@
 #include "utils.h"
 #include "debug.h"
 #include "init.h"
+#include "batch.h"
+#include "dynamic.h"
+#include "encoder.h"
+#include "uniform.h"
+#include "capture.h"
+#include "export.h"
+#include "graph.h"
+#include "pipeline.h"
+#include "postprocess.h"
+#include "latency.h"
+
+#include <cglm/cglm.h>
 
 #include <stdint.h>
 #include <stdio.h>
@@ -13,6 +25,11 @@ double clamp(int d, int min, int max)
 }
 
 void copyBuffer(State* state, VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size)
+{
+    copyBufferRegion(state, srcBuffer, 0, dstBuffer, 0, size);
+}
+
+void copyBufferRegion(State* state, VkBuffer srcBuffer, VkDeviceSize srcOffset, VkBuffer dstBuffer, VkDeviceSize dstOffset, VkDeviceSize size)
 {
     VkCommandBufferAllocateInfo allocInfo = {0};
     allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -30,8 +47,8 @@ void copyBuffer(State* state, VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSi
     vkBeginCommandBuffer(commandBuffer, &beginInfo);
 
     VkBufferCopy copyRegion = {0};
-    copyRegion.srcOffset = 0; // Optional
-    copyRegion.dstOffset = 0; // Optional
+    copyRegion.srcOffset = srcOffset;
+    copyRegion.dstOffset = dstOffset;
     copyRegion.size = size;
 
     vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
@@ -50,42 +67,67 @@ void copyBuffer(State* state, VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSi
 
 }
 
-void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex, State* state)
+// specialized variant of the draw's material, the generic pipeline while it compiles
+static VkPipeline drawPipeline(State* state, Draw* draw)
 {
-    VkCommandBufferBeginInfo beginInf = {
-        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-        .pNext = NULL,
-        .flags = 0,
+    uint32_t features = (draw->textureIndex != BINDLESS_INVALID_INDEX) | (draw->materialIndex != BINDLESS_INVALID_INDEX) << 1;
 
-        .pInheritanceInfo = NULL
-    };
+    if (draw->pipelineVariant == PIPELINE_INVALID_VARIANT || draw->pipelineFeatures != features) {
+        PipelineKey key = state->pipelineKey;
+        key.specialization[PIPELINE_SPECIALIZATION_TEXTURES] = (features & 1) != 0;
+        key.specialization[PIPELINE_SPECIALIZATION_MATERIALS] = (features & 2) != 0;
 
-    assertVk( vkBeginCommandBuffer(commandBuffer, &beginInf),
-    "failed to begin recording command buffer", "began command buffer recording");
+        draw->pipelineVariant = pipelineCacheRequest(state, &key);
+        draw->pipelineFeatures = features;
+    }
 
-    VkClearValue clearValue = {{{0,0,0}}};
+    VkPipeline pipeline = pipelineCacheGet(state, draw->pipelineVariant);
+    return pipeline != VK_NULL_HANDLE ? pipeline : state->graphicsPipeline;
+}
 
-    VkRenderPassBeginInfo renderPassBeginInf = {
-        .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+// visible draws keyed by pass, pipeline, material and depth, sorted once for every target of the frame
+static void queueVisibleDraws(State* state)
+{
+    DrawQueue* queue = &state->drawQueue;
+    DrawPass pass = state->pipelineKey.blend == PIPELINE_BLEND_OPAQUE ? DRAW_PASS_OPAQUE : DRAW_PASS_TRANSPARENT;
 
-        .renderPass = state->renderPass,
-        .framebuffer = state->swapChainFrameBuffers[imageIndex],
+    drawQueueReset(queue);
 
-        .renderArea.offset = {0,0},
-        .renderArea.extent = state->extent,
-        // clear color
-        .clearValueCount = 1,
-        .pClearValues = &clearValue
-    };
-    vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInf, VK_SUBPASS_CONTENTS_INLINE);
+    for (uint32_t i = 0; i < state->visibility.visibleCount; i++)
+    {
+        uint32_t index = state->visibility.visible[i];
+        Draw* draw = &state->draws[index];
 
-    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, state->graphicsPipeline);
-    
-    VkDeviceSize offsets[] = {0}; 
+        // requests the draw's variant, the key groups draws by it even while the generic pipeline stands in
+        drawPipeline(state, draw);
+        drawQueuePush(queue, drawSortKey(pass, draw->pipelineVariant, draw->textureIndex, draw->materialIndex, draw->depth), index);
+    }
 
-    vkCmdBindVertexBuffers(commandBuffer, 0, 1, &state->vertexBuffer, offsets);
+    drawQueueSort(queue);
+}
 
-    vkCmdBindIndexBuffer(commandBuffer, state->indexBuffer, 0, VK_INDEX_TYPE_UINT16);
+// draws of the scene into the pass or rendering begun for target, only extent differs between targets
+static void recordDraws(VkCommandBuffer commandBuffer, State* state, RenderTarget* target)
+{
+    CommandEncoder* encoder = &state->encoder;
+
+    // every variant has this state dynamic, setting it once covers all pipeline binds below
+    encoderSetDynamicState(encoder, state, &state->pipelineKey);
+
+    // instance streams point into the region written this frame
+    VkBuffer vertexBuffers[] = {state->vertexBuffer, state->instances.dynamic.buffer, state->instances.dynamic.buffer};
+    VkDeviceSize offsets[] = {0, state->instances.dynamic.frameOffset, state->instances.dynamic.frameOffset + state->instances.colorOffset};
+
+    // pulled vertices come from the push constants, the pool holds the indices of every mesh
+    if (state->vertexPulling) {
+        encoderBindVertexBuffers(encoder, 1, 2, vertexBuffers + 1, offsets + 1);
+        encoderBindIndexBuffer(encoder, state->meshes.buffer, 0, VK_INDEX_TYPE_UINT32);
+    }
+    else
+    {
+        encoderBindVertexBuffers(encoder, 0, 3, vertexBuffers, offsets);
+        encoderBindIndexBuffer(encoder, state->indexBuffer, 0, VK_INDEX_TYPE_UINT16);
+    }
 
     // Set dynamic stages
     VkViewport viewport = { 
@@ -93,31 +135,351 @@ void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex, Sta
         .x = 0,
         .y = 0,
 
-        .width = (float) state->extent.width,
-        .height = (float) state->extent.height,
+        .width = (float) target->extent.width,
+        .height = (float) target->extent.height,
 
         .minDepth = 0,
         .maxDepth = 1,
     };
 
-    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+    encoderSetViewport(encoder, &viewport);
    
     VkRect2D scissor = {
         .offset = {0,0},
-        .extent = state->extent
+        .extent = target->extent
+    };
+
+    encoderSetScissor(encoder, &scissor);
+
+    // bindless set stays bound for the whole command buffer, rebinding set 0 does not disturb it
+    encoderBindDescriptorSet(encoder, 1, state->bindless.set, NULL);
+
+    // uniforms are the same for every draw of the scene, one block per target keeps set 0 bound across draws
+    uint32_t dynamicOffset;
+    DrawUniforms* uniforms = uniformRingAlloc(state, sizeof(DrawUniforms), &dynamicOffset);
+    assert_my(uniforms, "uniform ring exhausted, increase UNIFORM_RING_FRAME_SIZE", "");
+
+    glm_mat4_copy(state->viewTransform, uniforms->transform);
+    uniforms->time = state->time;
+
+    encoderBindDescriptorSet(encoder, 0, state->uniforms.set, &dynamicOffset);
+
+    // only draws which survived culling, in sort key order
+    for (uint32_t i = 0; i < state->drawQueue.count; i++)
+    {
+        Draw* draw = &state->draws[state->drawQueue.items[i]];
+
+        encoderBindPipeline(encoder, drawPipeline(state, draw));
+
+        DrawPushConstants pushConstants = {
+            .offset = {draw->offset[0], draw->offset[1], 0.0f, 0.0f},
+            // material switch is just different indices, no descriptor rebind
+            .textureIndex = draw->textureIndex,
+            .materialIndex = draw->materialIndex,
+            // meshes of any format draw with the same pipeline
+            .vertexAddress = draw->vertexAddress,
+            .vertexFormat = draw->vertexFormat,
+        };
+
+        encoderPushConstants(encoder, &pushConstants);
+
+        encoderDrawIndexed(encoder, draw->indexCount, draw->instanceCount, draw->firstIndex, draw->vertexOffset, draw->firstInstance);
+    }
+
+    // 2D quads go over the scene
+    if (state->hudQuads > 0) {
+        batchRecord(state, encoder, target->extent);
+    }
+}
+
+static void recordRenderPassTarget(VkCommandBuffer commandBuffer, State* state, RenderTarget* target, VkBool32 primary)
+{
+    VkClearValue clearValues[2] = {
+        {.color = {{0,0,0}}},
+        {.depthStencil = {1.0f, 0}},
     };
 
-    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+    VkRenderPassBeginInfo renderPassBeginInf = {
+        .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
 
+        .renderPass = state->renderPass,
+        .framebuffer = target->swapChainFrameBuffers[target->imageIndex],
+
+        .renderArea.offset = {0,0},
+        .renderArea.extent = target->extent,
+        // clear color and depth
+        .clearValueCount = state->useDepth ? 2 : 1,
+        .pClearValues = clearValues
+    };
+    vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInf, VK_SUBPASS_CONTENTS_INLINE);
 
-    // vkCmdDraw(commandBuffer, 3, 1, 0, 0);
-    vkCmdDrawIndexed(commandBuffer, 6, 1, 0, 0, 0);
+    recordDraws(commandBuffer, state, target);
 
     vkCmdEndRenderPass(commandBuffer);
 
+    if (primary && state->captureFrames) {
+        // render pass left the image in its final layout, its outgoing dependency already waits for the writes
+        captureRecordCopy(state, commandBuffer, target->swapchainImages[target->imageIndex], state->presentLayout,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, 0);
+    }
+
+    // incoming dependency of the render pass waits for the image available semaphore here
+    target->acquireStage = graphAccessStage(GRAPH_ACCESS_COLOR_ATTACHMENT_WRITE);
+}
+
+// graph resources of one target, lives until the graph is executed
+typedef struct ScenePass
+{
+    RenderTarget* target;
+    // swapchain or headless image
+    uint32_t output;
+    // image the scene is rendered into, the exported image or output
+    uint32_t color;
+    // GRAPH_INVALID_RESOURCE without depth testing
+    uint32_t depth;
+    // previous frame tonemapped on the compute queue, GRAPH_INVALID_RESOURCE without async compute or before the first one
+    uint32_t tonemapped;
+} ScenePass;
+
+static void recordScenePass(VkCommandBuffer commandBuffer, State* state, void* userData)
+{
+    ScenePass* scene = userData;
+
+    VkRenderingAttachmentInfo colorAttachment = {
+        .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+        .pNext = NULL,
+
+        .imageView = graphImageView(&state->graph, scene->color),
+        .imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+
+        .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+        .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+        .clearValue = {.color = {{0,0,0}}},
+    };
+
+    VkRenderingAttachmentInfo depthAttachment = {
+        .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+        .pNext = NULL,
+
+        .imageView = scene->depth != GRAPH_INVALID_RESOURCE ? graphImageView(&state->graph, scene->depth) : VK_NULL_HANDLE,
+        .imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+
+        // cleared on load and never written back
+        .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+        .storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+        .clearValue = {.depthStencil = {1.0f, 0}},
+    };
+
+    VkRenderingInfo renderingInf = {
+        .sType = VK_STRUCTURE_TYPE_RENDERING_INFO,
+        .pNext = NULL,
+        .flags = 0,
+
+        .renderArea.offset = {0,0},
+        .renderArea.extent = scene->target->extent,
+        .layerCount = 1,
+
+        .colorAttachmentCount = 1,
+        .pColorAttachments = &colorAttachment,
+        .pDepthAttachment = scene->depth != GRAPH_INVALID_RESOURCE ? &depthAttachment : NULL,
+        .pStencilAttachment = NULL,
+    };
+
+    vkCmdBeginRendering(commandBuffer, &renderingInf);
+    recordDraws(commandBuffer, state, scene->target);
+    vkCmdEndRendering(commandBuffer);
+}
+
+static void recordExportPass(VkCommandBuffer commandBuffer, State* state, void* userData)
+{
+    ScenePass* scene = userData;
+    frameExportRecordCopy(state, commandBuffer, graphImage(&state->graph, scene->output));
+}
+
+static void recordCapturePass(VkCommandBuffer commandBuffer, State* state, void* userData)
+{
+    ScenePass* scene = userData;
+    captureRecordGraphCopy(state, commandBuffer, graphImage(&state->graph, scene->output));
+}
+
+static void recordPostProcessCopyPass(VkCommandBuffer commandBuffer, State* state, void* userData)
+{
+    ScenePass* scene = userData;
+    postProcessRecordCopy(state, commandBuffer, scene->target, graphImage(&state->graph, scene->output));
+}
+
+// declares one scene pass per target, capture and export of the first target follow its scene pass
+static void buildFrameGraph(State* state, RenderGraph* graph, ScenePass* scenes, uint32_t* sceneCount)
+{
+    graphBegin(graph);
+    *sceneCount = 0;
+
+    // presentation or, headless, the next capture reads the images after the frame
+    GraphAccess finalAccess = state->presentLayout == VK_IMAGE_LAYOUT_PRESENT_SRC_KHR ? GRAPH_ACCESS_PRESENT : GRAPH_ACCESS_TRANSFER_READ;
+
+    for (uint32_t i = 0; i < state->targetCount; i++)
+    {
+        RenderTarget* target = &state->targets[i];
+        if (target->imageIndex == UINT32_MAX) {
+            continue;
+        }
+
+        ScenePass* scene = &scenes[(*sceneCount)++];
+        scene->target = target;
+        scene->output = graphImportImage(graph, "target", target->swapchainImages[target->imageIndex], target->imageViews[target->imageIndex],
+            VK_IMAGE_ASPECT_COLOR_BIT, GRAPH_ACCESS_NONE, finalAccess);
+        scene->color = scene->output;
+        scene->depth = GRAPH_INVALID_RESOURCE;
+        scene->tonemapped = GRAPH_INVALID_RESOURCE;
+
+        if (state->asyncCompute) {
+            // this frame is rendered in HDR for the compute queue, the target shows the frame before
+            PostProcessTarget* post = &state->postProcess.targets[i];
+            uint32_t frameIndex = state->postProcess.frameIndex;
+            post->current = frameIndex;
+
+            scene->color = graphImportImage(graph, "hdr", post->hdr[frameIndex].image, post->hdr[frameIndex].view,
+                VK_IMAGE_ASPECT_COLOR_BIT, GRAPH_ACCESS_NONE, GRAPH_ACCESS_SAMPLED_COMPUTE);
+
+            if (post->previous != UINT32_MAX) {
+                scene->tonemapped = graphImportImage(graph, "tonemapped", post->ldr[post->previous].image, post->ldr[post->previous].view,
+                    VK_IMAGE_ASPECT_COLOR_BIT, GRAPH_ACCESS_STORAGE_WRITE_COMPUTE, GRAPH_ACCESS_NONE);
+            }
+        }
+
+        VkBool32 exported = i == 0 && state->exportFrames;
+        if (exported) {
+            // the consumer only ever sees the exported image in GENERAL, the copy to the swapchain keeps it there
+            ExportImage* image = &state->frameExport.images[state->frameExport.current];
+            scene->color = graphImportImage(graph, "export", image->image, image->view, VK_IMAGE_ASPECT_COLOR_BIT,
+                GRAPH_ACCESS_NONE, GRAPH_ACCESS_TRANSFER_READ_GENERAL);
+        }
+
+        if (state->useDepth) {
+            // targets render one after another, all depth images share the same memory
+            scene->depth = graphCreateImage(graph, "depth", state->depthFormat, target->extent,
+                VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT, depthImageAspect(state->depthFormat));
+        }
+
+        uint32_t pass = graphAddPass(graph, "scene", recordScenePass, scene);
+        graphPassUse(graph, pass, scene->color, GRAPH_ACCESS_COLOR_ATTACHMENT_WRITE);
+        if (scene->depth != GRAPH_INVALID_RESOURCE) {
+            graphPassUse(graph, pass, scene->depth, GRAPH_ACCESS_DEPTH_ATTACHMENT_WRITE);
+        }
+
+        if (state->asyncCompute) {
+            // recorded after the scene, only this copy waits for the compute queue
+            pass = graphAddPass(graph, "tonemapped copy", recordPostProcessCopyPass, scene);
+            if (scene->tonemapped != GRAPH_INVALID_RESOURCE) {
+                graphPassUse(graph, pass, scene->tonemapped, GRAPH_ACCESS_TRANSFER_READ_GENERAL);
+            }
+            graphPassUse(graph, pass, scene->output, GRAPH_ACCESS_TRANSFER_WRITE);
+        }
+
+        if (exported) {
+            pass = graphAddPass(graph, "export", recordExportPass, scene);
+            graphPassUse(graph, pass, scene->color, GRAPH_ACCESS_TRANSFER_READ_GENERAL);
+            graphPassUse(graph, pass, scene->output, GRAPH_ACCESS_TRANSFER_WRITE);
+            // announced to the consumer even when nothing reads the swapchain image
+            graphPassSideEffects(graph, pass);
+        }
+
+        if (i == 0 && state->captureFrames) {
+            pass = graphAddPass(graph, "capture", recordCapturePass, scene);
+            graphPassUse(graph, pass, scene->output, GRAPH_ACCESS_TRANSFER_READ);
+            graphPassSideEffects(graph, pass);
+        }
+    }
+}
+
+void recordCommandBuffer(VkCommandBuffer commandBuffer, State* state)
+{
+    VkCommandBufferBeginInfo beginInf = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .pNext = NULL,
+        .flags = 0,
+
+        .pInheritanceInfo = NULL
+    };
+
+    assertVk( vkBeginCommandBuffer(commandBuffer, &beginInf),
+    "failed to begin recording command buffer", "began command buffer recording");
+
+    // nothing is bound on a freshly begun command buffer, the encoder follows it through every target
+    encoderBegin(&state->encoder, commandBuffer, state->pipelineLayout);
+    queueVisibleDraws(state);
+
+    // copies must land before any render pass begins
+    dynamicBufferRecordUpload(state, &state->instances.dynamic, commandBuffer);
+    if (state->hudQuads > 0) {
+        dynamicBufferRecordUpload(state, &state->batch.vertices, commandBuffer);
+    }
+
+    if (state->useDynamicRendering) {
+        ScenePass scenes[MAX_RENDER_TARGETS];
+        uint32_t sceneCount;
+
+        buildFrameGraph(state, &state->graph, scenes, &sceneCount);
+        graphCompile(state, &state->graph);
+        graphExecute(state, &state->graph, commandBuffer);
+
+        // image available semaphores wait for the first use the graph found, not a fixed stage
+        for (uint32_t i = 0; i < sceneCount; i++)
+        {
+            scenes[i].target->acquireStage = graphFirstStage(&state->graph, scenes[i].output);
+        }
+    }
+    else
+    {
+        for (uint32_t i = 0; i < state->targetCount; i++)
+        {
+            if (state->targets[i].imageIndex != UINT32_MAX) {
+                recordRenderPassTarget(commandBuffer, state, &state->targets[i], i == 0);
+            }
+        }
+    }
+
     assertVk(vkEndCommandBuffer(commandBuffer), "Failed to record command buffer", "recorded command buffer");
-    
+}
+
+void transitionImageLayout(VkCommandBuffer commandBuffer, VkImage image, VkImageAspectFlags aspect,
+    VkImageLayout oldLayout, VkImageLayout newLayout,
+    VkPipelineStageFlags2 srcStage, VkAccessFlags2 srcAccess,
+    VkPipelineStageFlags2 dstStage, VkAccessFlags2 dstAccess)
+{
+    VkImageMemoryBarrier2 barrier = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+        .pNext = NULL,
+
+        .srcStageMask = srcStage,
+        .srcAccessMask = srcAccess,
+        .dstStageMask = dstStage,
+        .dstAccessMask = dstAccess,
 
+        .oldLayout = oldLayout,
+        .newLayout = newLayout,
+
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+
+        .image = image,
+        .subresourceRange.aspectMask = aspect,
+        .subresourceRange.baseMipLevel = 0,
+        .subresourceRange.levelCount = 1,
+        .subresourceRange.baseArrayLayer = 0,
+        .subresourceRange.layerCount = 1,
+    };
+
+    VkDependencyInfo dependencyInf = {
+        .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+        .pNext = NULL,
+        .dependencyFlags = 0,
+
+        .imageMemoryBarrierCount = 1,
+        .pImageMemoryBarriers = &barrier,
+    };
+
+    vkCmdPipelineBarrier2(commandBuffer, &dependencyInf);
 }
 
 void createBuffer(State* state, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer* buffer, VkDeviceMemory* bufferMemory)
@@ -152,14 +514,29 @@ void createBuffer(State* state, VkDeviceSize size, VkBufferUsageFlags usage, VkM
 }
 
 
-void recreateSwapchain(State* state)
+void recreateRenderTarget(State* state, RenderTarget* target)
 {
 
     vkDeviceWaitIdle(state->device);
-    cleanUpSwapchain(state);
 
-    createSwapchain(state);
-    retrieveSwapchainImages(state);
-    createImageViews(state);
-    createFramebuffers(state);
+    // frames waiting for their presentation time refer to the swapchain
+    if (state->measureLatency) {
+        latencySwapchainRetired(state, target);
+    }
+
+    cleanUpSwapchain(state, target);
+
+    createRenderTarget(state, target);
+
+    // exported images follow the extent of the target they are copied to
+    if (state->exportFrames && target == &state->targets[0]) {
+        frameExportResize(state);
+    }
+
+    if (state->asyncCompute) {
+        postProcessResize(state, target);
+    }
+
+    // the target skipped or presented a frame of the old size
+    requestRedraw(state);
 }
\ No newline at end of file
@@ -2,21 +2,34 @@
 #define __UTILS_H__
 
 #include "init.h"
-#include <cglm/types.h>
 #include <vulkan/vulkan_core.h>
 
-// vertex.h
-typedef struct Vertex {
-    vec2 pos;
-    vec3 color;
-}Vertex;
-
-
 // whatever just fill the hole hole filler
 double clamp(int d, int min, int max);
-void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex, State* state);
+
+/**
+ * @brief records one pass per target whose imageIndex is set, all into the same command buffer
+ */
+void recordCommandBuffer(VkCommandBuffer commandBuffer, State* state);
 void createBuffer(State* state, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer* buffer, VkDeviceMemory* bufferMemory);
-void recreateSwapchain(State* state);
+
+/**
+ * @brief waits for the device and rebuilds swapchain (or headless images) of one target with its current size
+ */
+void recreateRenderTarget(State* state, RenderTarget* target);
 void copyBuffer(State* state, VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
 
+/**
+ * @brief copies size bytes between buffers on the graphics queue and waits for the copy
+ */
+void copyBufferRegion(State* state, VkBuffer srcBuffer, VkDeviceSize srcOffset, VkBuffer dstBuffer, VkDeviceSize dstOffset, VkDeviceSize size);
+
+/**
+ * @brief records single synchronization2 layout transition of first mip level and layer of image
+ */
+void transitionImageLayout(VkCommandBuffer commandBuffer, VkImage image, VkImageAspectFlags aspect,
+    VkImageLayout oldLayout, VkImageLayout newLayout,
+    VkPipelineStageFlags2 srcStage, VkAccessFlags2 srcAccess,
+    VkPipelineStageFlags2 dstStage, VkAccessFlags2 dstAccess);
+
 #endif // __UTILS_H__
\ No newline at end of file
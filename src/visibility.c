@@ -0,0 +1,467 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "visibility.h"
+
+#include "debug.h"
+#include "init.h"
+#include "job.h"
+#include "simd.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef uint32_t (*VisibilityKernel)(const Visibility* visibility, vec4 planes[6], uint32_t begin, uint32_t end, uint32_t* out);
+
+// box is outside when it lies completely behind one plane, SIMD kernels do the same operations in the same order
+static inline int boundsVisible(const Visibility* visibility, vec4 planes[6], uint32_t i)
+{
+    int visible = 1;
+
+    for (uint32_t p = 0; p < 6; p++)
+    {
+        float distance = visibility->centerX[i] * planes[p][0] + visibility->centerY[i] * planes[p][1];
+        distance = distance + visibility->centerZ[i] * planes[p][2];
+        distance = distance + planes[p][3];
+
+        // projection of the extent onto the plane normal
+        float radius = visibility->extentX[i] * fabsf(planes[p][0]) + visibility->extentY[i] * fabsf(planes[p][1]);
+        radius = radius + visibility->extentZ[i] * fabsf(planes[p][2]);
+
+        visible &= distance + radius >= 0.0f;
+    }
+
+    return visible;
+}
+
+uint32_t visibilityKernelCullScalar(const Visibility* visibility, vec4 planes[6], uint32_t begin, uint32_t end, uint32_t* out)
+{
+    uint32_t written = 0;
+
+    for (uint32_t i = begin; i < end; i++)
+    {
+        // always store, only advance on hit -> no mispredicted branch per object
+        out[written] = i;
+        written += (uint32_t) boundsVisible(visibility, planes, i);
+    }
+
+    return written;
+}
+
+#ifdef SIMD_X86
+
+static uint32_t visibilityKernelSse2(const Visibility* visibility, vec4 planes[6], uint32_t begin, uint32_t end, uint32_t* out)
+{
+    __m128 normal[6][3];
+    __m128 absNormal[6][3];
+    __m128 offset[6];
+
+    for (uint32_t p = 0; p < 6; p++)
+    {
+        for (uint32_t axis = 0; axis < 3; axis++)
+        {
+            normal[p][axis] = _mm_set1_ps(planes[p][axis]);
+            absNormal[p][axis] = _mm_set1_ps(fabsf(planes[p][axis]));
+        }
+        offset[p] = _mm_set1_ps(planes[p][3]);
+    }
+
+    const __m128 zero = _mm_setzero_ps();
+
+    uint32_t written = 0;
+    uint32_t i = begin;
+    for (; i + 4 <= end; i += 4)
+    {
+        __m128 cx = _mm_loadu_ps(visibility->centerX + i);
+        __m128 cy = _mm_loadu_ps(visibility->centerY + i);
+        __m128 cz = _mm_loadu_ps(visibility->centerZ + i);
+        __m128 ex = _mm_loadu_ps(visibility->extentX + i);
+        __m128 ey = _mm_loadu_ps(visibility->extentY + i);
+        __m128 ez = _mm_loadu_ps(visibility->extentZ + i);
+
+        __m128 visible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+        for (uint32_t p = 0; p < 6; p++)
+        {
+            __m128 distance = _mm_add_ps(_mm_mul_ps(cx, normal[p][0]), _mm_mul_ps(cy, normal[p][1]));
+            distance = _mm_add_ps(distance, _mm_mul_ps(cz, normal[p][2]));
+            distance = _mm_add_ps(distance, offset[p]);
+
+            __m128 radius = _mm_add_ps(_mm_mul_ps(ex, absNormal[p][0]), _mm_mul_ps(ey, absNormal[p][1]));
+            radius = _mm_add_ps(radius, _mm_mul_ps(ez, absNormal[p][2]));
+
+            visible = _mm_and_ps(visible, _mm_cmpge_ps(_mm_add_ps(distance, radius), zero));
+        }
+
+        uint32_t mask = (uint32_t) _mm_movemask_ps(visible);
+        for (uint32_t lane = 0; lane < 4; lane++)
+        {
+            out[written] = i + lane;
+            written += (mask >> lane) & 1;
+        }
+    }
+
+    return written + visibilityKernelCullScalar(visibility, planes, i, end, out + written);
+}
+
+__attribute__((target("avx")))
+static uint32_t visibilityKernelAvx(const Visibility* visibility, vec4 planes[6], uint32_t begin, uint32_t end, uint32_t* out)
+{
+    __m256 normal[6][3];
+    __m256 absNormal[6][3];
+    __m256 offset[6];
+
+    for (uint32_t p = 0; p < 6; p++)
+    {
+        for (uint32_t axis = 0; axis < 3; axis++)
+        {
+            normal[p][axis] = _mm256_set1_ps(planes[p][axis]);
+            absNormal[p][axis] = _mm256_set1_ps(fabsf(planes[p][axis]));
+        }
+        offset[p] = _mm256_set1_ps(planes[p][3]);
+    }
+
+    const __m256 zero = _mm256_setzero_ps();
+
+    uint32_t written = 0;
+    uint32_t i = begin;
+    for (; i + 8 <= end; i += 8)
+    {
+        __m256 cx = _mm256_loadu_ps(visibility->centerX + i);
+        __m256 cy = _mm256_loadu_ps(visibility->centerY + i);
+        __m256 cz = _mm256_loadu_ps(visibility->centerZ + i);
+        __m256 ex = _mm256_loadu_ps(visibility->extentX + i);
+        __m256 ey = _mm256_loadu_ps(visibility->extentY + i);
+        __m256 ez = _mm256_loadu_ps(visibility->extentZ + i);
+
+        __m256 visible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+        for (uint32_t p = 0; p < 6; p++)
+        {
+            __m256 distance = _mm256_add_ps(_mm256_mul_ps(cx, normal[p][0]), _mm256_mul_ps(cy, normal[p][1]));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(cz, normal[p][2]));
+            distance = _mm256_add_ps(distance, offset[p]);
+
+            __m256 radius = _mm256_add_ps(_mm256_mul_ps(ex, absNormal[p][0]), _mm256_mul_ps(ey, absNormal[p][1]));
+            radius = _mm256_add_ps(radius, _mm256_mul_ps(ez, absNormal[p][2]));
+
+            // ordered compare -> NaN bounds count as outside like the scalar >=
+            visible = _mm256_and_ps(visible, _mm256_cmp_ps(_mm256_add_ps(distance, radius), zero, _CMP_GE_OQ));
+        }
+
+        uint32_t mask = (uint32_t) _mm256_movemask_ps(visible);
+        for (uint32_t lane = 0; lane < 8; lane++)
+        {
+            out[written] = i + lane;
+            written += (mask >> lane) & 1;
+        }
+    }
+
+    return written + visibilityKernelCullScalar(visibility, planes, i, end, out + written);
+}
+
+#endif // SIMD_X86
+
+#ifdef SIMD_NEON
+
+static uint32_t visibilityKernelNeon(const Visibility* visibility, vec4 planes[6], uint32_t begin, uint32_t end, uint32_t* out)
+{
+    float32x4_t normal[6][3];
+    float32x4_t absNormal[6][3];
+    float32x4_t offset[6];
+
+    for (uint32_t p = 0; p < 6; p++)
+    {
+        for (uint32_t axis = 0; axis < 3; axis++)
+        {
+            normal[p][axis] = vdupq_n_f32(planes[p][axis]);
+            absNormal[p][axis] = vdupq_n_f32(fabsf(planes[p][axis]));
+        }
+        offset[p] = vdupq_n_f32(planes[p][3]);
+    }
+
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+
+    uint32_t written = 0;
+    uint32_t i = begin;
+    for (; i + 4 <= end; i += 4)
+    {
+        float32x4_t cx = vld1q_f32(visibility->centerX + i);
+        float32x4_t cy = vld1q_f32(visibility->centerY + i);
+        float32x4_t cz = vld1q_f32(visibility->centerZ + i);
+        float32x4_t ex = vld1q_f32(visibility->extentX + i);
+        float32x4_t ey = vld1q_f32(visibility->extentY + i);
+        float32x4_t ez = vld1q_f32(visibility->extentZ + i);
+
+        uint32x4_t visible = vdupq_n_u32(UINT32_MAX);
+
+        for (uint32_t p = 0; p < 6; p++)
+        {
+            float32x4_t distance = vaddq_f32(vmulq_f32(cx, normal[p][0]), vmulq_f32(cy, normal[p][1]));
+            distance = vaddq_f32(distance, vmulq_f32(cz, normal[p][2]));
+            distance = vaddq_f32(distance, offset[p]);
+
+            float32x4_t radius = vaddq_f32(vmulq_f32(ex, absNormal[p][0]), vmulq_f32(ey, absNormal[p][1]));
+            radius = vaddq_f32(radius, vmulq_f32(ez, absNormal[p][2]));
+
+            visible = vandq_u32(visible, vcgeq_f32(vaddq_f32(distance, radius), zero));
+        }
+
+        // no movemask on NEON, lanes are all ones or all zeros
+        out[written] = i;
+        written += vgetq_lane_u32(visible, 0) & 1;
+        out[written] = i + 1;
+        written += vgetq_lane_u32(visible, 1) & 1;
+        out[written] = i + 2;
+        written += vgetq_lane_u32(visible, 2) & 1;
+        out[written] = i + 3;
+        written += vgetq_lane_u32(visible, 3) & 1;
+    }
+
+    return written + visibilityKernelCullScalar(visibility, planes, i, end, out + written);
+}
+
+#endif // SIMD_NEON
+
+// only written by visibilityKernelSelect before any culling job runs, scalar until then
+static VisibilityKernel selectedKernel = visibilityKernelCullScalar;
+static SimdLevel selectedLevel = SIMD_LEVEL_SCALAR;
+
+void visibilityKernelSelect(void)
+{
+    SimdLevel level = simdDetect();
+    VisibilityKernel kernel = visibilityKernelCullScalar;
+
+#if defined(SIMD_X86)
+    if (level == SIMD_LEVEL_AVX) {
+        kernel = visibilityKernelAvx;
+    }
+    else if (level == SIMD_LEVEL_SSE2) {
+        kernel = visibilityKernelSse2;
+    }
+#elif defined(SIMD_NEON)
+    kernel = visibilityKernelNeon;
+#endif
+
+    selectedKernel = kernel;
+    selectedLevel = level;
+}
+
+uint32_t visibilityKernelCull(const Visibility* visibility, vec4 planes[6], uint32_t begin, uint32_t end, uint32_t* out)
+{
+    return selectedKernel(visibility, planes, begin, end, out);
+}
+
+const char* visibilityKernelName(void)
+{
+    return simdLevelName(selectedLevel);
+}
+
+void visibilityFrustumPlanes(mat4 viewProjection, vec4 planes[6])
+{
+    // cglm matrices are column major, row r of the matrix is m[0][r] .. m[3][r]
+    for (uint32_t axis = 0; axis < 4; axis++)
+    {
+        float x = viewProjection[axis][0];
+        float y = viewProjection[axis][1];
+        float z = viewProjection[axis][2];
+        float w = viewProjection[axis][3];
+
+        planes[0][axis] = w + x;
+        planes[1][axis] = w - x;
+        planes[2][axis] = w + y;
+        planes[3][axis] = w - y;
+        // Vulkan depth range starts at 0, not -w
+        planes[4][axis] = z;
+        planes[5][axis] = w - z;
+    }
+}
+
+// returns 0 on allocation failure
+static int allocateBounds(Visibility* visibility, uint32_t capacity)
+{
+    float* arrays = simdAllocArrays(&capacity, 6);
+    if (arrays == NULL) {
+        return 0;
+    }
+    uint32_t batches = (capacity + VISIBILITY_BATCH - 1) / VISIBILITY_BATCH;
+
+    visibility->block = arrays;
+    visibility->centerX = arrays;
+    visibility->centerY = arrays + capacity;
+    visibility->centerZ = arrays + capacity * 2;
+    visibility->extentX = arrays + capacity * 3;
+    visibility->extentY = arrays + capacity * 4;
+    visibility->extentZ = arrays + capacity * 5;
+
+    visibility->visible = malloc(sizeof(uint32_t) * capacity);
+    visibility->scratch = malloc(sizeof(uint32_t) * capacity);
+    visibility->batchVisible = malloc(sizeof(uint32_t) * batches);
+    visibility->batchOffset = malloc(sizeof(uint32_t) * batches);
+
+    visibility->count = 0;
+    visibility->visibleCount = 0;
+    visibility->capacity = capacity;
+
+    return visibility->visible != NULL && visibility->scratch != NULL &&
+        visibility->batchVisible != NULL && visibility->batchOffset != NULL;
+}
+
+static void freeBounds(Visibility* visibility)
+{
+    free(visibility->block);
+    free(visibility->visible);
+    free(visibility->scratch);
+    free(visibility->batchVisible);
+    free(visibility->batchOffset);
+
+    visibility->block = NULL;
+    visibility->visible = NULL;
+    visibility->scratch = NULL;
+    visibility->batchVisible = NULL;
+    visibility->batchOffset = NULL;
+}
+
+uint32_t visibilityAdd(Visibility* visibility, const vec3 center, const vec3 extent)
+{
+    if (visibility->count == visibility->capacity) {
+        return UINT32_MAX;
+    }
+
+    uint32_t i = visibility->count++;
+    visibilitySetBounds(visibility, i, center, extent);
+
+    return i;
+}
+
+void visibilitySetBounds(Visibility* visibility, uint32_t index, const vec3 center, const vec3 extent)
+{
+    visibility->centerX[index] = center[0];
+    visibility->centerY[index] = center[1];
+    visibility->centerZ[index] = center[2];
+    visibility->extentX[index] = extent[0];
+    visibility->extentY[index] = extent[1];
+    visibility->extentZ[index] = extent[2];
+}
+
+typedef struct VisibilityCullJob
+{
+    Visibility* visibility;
+    vec4 planes[6];
+} VisibilityCullJob;
+
+// batches never straddle, jobParallelFor only grows them in multiples of VISIBILITY_BATCH
+static void cullRange(void* data, uint32_t begin, uint32_t end)
+{
+    VisibilityCullJob* job = data;
+    Visibility* visibility = job->visibility;
+
+    visibility->batchVisible[begin / VISIBILITY_BATCH] = visibilityKernelCull(visibility, job->planes, begin, end, visibility->scratch + begin);
+}
+
+static void gatherRange(void* data, uint32_t begin, uint32_t end)
+{
+    Visibility* visibility = data;
+
+    for (uint32_t batch = begin; batch < end; batch++)
+    {
+        memcpy(visibility->visible + visibility->batchOffset[batch], visibility->scratch + (size_t) batch * VISIBILITY_BATCH,
+            sizeof(uint32_t) * visibility->batchVisible[batch]);
+    }
+}
+
+void visibilityCull(Visibility* visibility, mat4 viewProjection)
+{
+    VisibilityCullJob job = {
+        .visibility = visibility
+    };
+    visibilityFrustumPlanes(viewProjection, job.planes);
+
+    // single batch compacts straight into the result
+    if (visibility->count <= VISIBILITY_BATCH) {
+        visibility->visibleCount = visibilityKernelCull(visibility, job.planes, 0, visibility->count, visibility->visible);
+        return;
+    }
+
+    uint32_t batches = (visibility->count + VISIBILITY_BATCH - 1) / VISIBILITY_BATCH;
+    // grown batches leave the counts of the batches they swallowed untouched
+    memset(visibility->batchVisible, 0, sizeof(uint32_t) * batches);
+
+    jobParallelFor(visibility->count, VISIBILITY_BATCH, cullRange, &job);
+
+    uint32_t visibleCount = 0;
+    for (uint32_t batch = 0; batch < batches; batch++)
+    {
+        visibility->batchOffset[batch] = visibleCount;
+        visibleCount += visibility->batchVisible[batch];
+    }
+
+    // gathering is a copy per batch, a few batches per job amortize the scheduling
+    jobParallelFor(batches, 8, gatherRange, visibility);
+
+    visibility->visibleCount = visibleCount;
+}
+
+uint32_t visibilityKernelVerify(uint32_t count, uint32_t rounds)
+{
+    Visibility bounds = {0};
+    assert_my(allocateBounds(&bounds, count), "failed to allocate visibility verification data", "");
+
+    uint32_t* reference = malloc(sizeof(uint32_t) * bounds.capacity);
+    uint32_t* simd = malloc(sizeof(uint32_t) * bounds.capacity);
+    assert_my(reference != NULL && simd != NULL, "failed to allocate visibility verification data", "");
+
+    uint32_t seed = 0x9E3779B9u;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        vec3 center = {simdRandomRange(&seed, -2.0f, 2.0f), simdRandomRange(&seed, -2.0f, 2.0f), simdRandomRange(&seed, -1.0f, 2.0f)};
+        vec3 extent = {simdRandomRange(&seed, 0.0f, 0.3f), simdRandomRange(&seed, 0.0f, 0.3f), simdRandomRange(&seed, 0.0f, 0.3f)};
+        visibilityAdd(&bounds, center, extent);
+    }
+
+    uint32_t mismatches = 0;
+
+    for (uint32_t round = 0; round < rounds; round++)
+    {
+        mat4 viewProjection;
+        for (uint32_t column = 0; column < 4; column++)
+        {
+            for (uint32_t row = 0; row < 4; row++)
+            {
+                viewProjection[column][row] = simdRandomRange(&seed, -1.0f, 1.0f) + (column == row ? 1.0f : 0.0f);
+            }
+        }
+
+        vec4 planes[6];
+        visibilityFrustumPlanes(viewProjection, planes);
+
+        // odd begin exercises the scalar tail of the SIMD kernels
+        uint32_t begin = count > 1 ? 1 : 0;
+        uint32_t referenceCount = visibilityKernelCullScalar(&bounds, planes, begin, count, reference);
+        uint32_t simdCount = visibilityKernelCull(&bounds, planes, begin, count, simd);
+
+        mismatches += referenceCount != simdCount || memcmp(reference, simd, sizeof(uint32_t) * referenceCount) != 0;
+    }
+
+    free(reference);
+    free(simd);
+    freeBounds(&bounds);
+
+    return mismatches;
+}
+
+void createVisibility(State* state, uint32_t capacity)
+{
+    Visibility* visibility = &state->visibility;
+
+    visibilityKernelSelect();
+    LOG("culling kernel: %s", visibilityKernelName());
+
+    assert_my(allocateBounds(visibility, capacity > 0 ? capacity : 1), "failed to allocate visibility", "allocated visibility");
+}
+
+void destroyVisibility(State* state)
+{
+    freeBounds(&state->visibility);
+}
@@ -0,0 +1,107 @@
+#ifndef __VISIBILITY_H__
+#define __VISIBILITY_H__
+
+#include "common.h"
+
+#include <cglm/types.h>
+#include <stdint.h>
+
+// objects tested by one culling job, multiple of 8 so every batch starts on an aligned SIMD group
+#define VISIBILITY_BATCH 4096
+
+// axis aligned object bounds as structure of arrays, culled against the camera frustum on the CPU
+// object i is draw i of the scene
+typedef struct Visibility
+{
+    uint32_t count;
+    uint32_t capacity;
+
+    // one 32 byte aligned block, each array padded to multiple of 8 elements
+    void* block;
+    float* centerX;
+    float* centerY;
+    float* centerZ;
+    float* extentX;
+    float* extentY;
+    float* extentZ;
+
+    // indices of objects inside the frustum in ascending order, written by visibilityCull
+    uint32_t* visible;
+    uint32_t visibleCount;
+
+    // every batch compacts its survivors into its own slice of scratch, slices are then gathered into visible
+    uint32_t* scratch;
+    uint32_t* batchVisible;
+    uint32_t* batchOffset;
+} Visibility;
+
+/**
+ * @brief allocates structure of arrays bounds storage and the visible index list
+ * @details selects the SIMD kernel, make kernel_check verifies it against the scalar reference
+ * @param capacity max objects, rounded up to multiple of 8
+ */
+void createVisibility(State* state, uint32_t capacity);
+
+/**
+ * @brief appends object with axis aligned bounds
+ * @param extent half size along every axis
+ * @return index of object, UINT32_MAX when full
+ */
+uint32_t visibilityAdd(Visibility* visibility, const vec3 center, const vec3 extent);
+
+/**
+ * @brief replaces bounds of object
+ * Requires:
+    - index < visibility->count
+ */
+void visibilitySetBounds(Visibility* visibility, uint32_t index, const vec3 center, const vec3 extent);
+
+/**
+ * @brief extracts frustum planes (Vulkan clip space, 0 <= z <= w) from the matrix
+ * @details planes are not normalized, the culling test only needs their sign
+ */
+void visibilityFrustumPlanes(mat4 viewProjection, vec4 planes[6]);
+
+/**
+ * @brief tests all objects against the frustum on all job threads and compacts the survivors into visible
+ * @details object order is kept, so sorted draws stay sorted
+ */
+void visibilityCull(Visibility* visibility, mat4 viewProjection);
+
+/**
+ * @brief writes indices of objects in [begin, end) intersecting all planes into out
+ * @details uses widest SIMD kernel supported by the CPU (AVX, SSE2 or NEON)
+ * @param out room for end - begin indices
+ * @return number of indices written
+ */
+uint32_t visibilityKernelCull(const Visibility* visibility, vec4 planes[6], uint32_t begin, uint32_t end, uint32_t* out);
+
+/**
+ * @brief scalar reference of visibilityKernelCull, results are identical
+ */
+uint32_t visibilityKernelCullScalar(const Visibility* visibility, vec4 planes[6], uint32_t begin, uint32_t end, uint32_t* out);
+
+/**
+ * @brief picks the kernel visibilityKernelCull runs for the widest instruction set of the CPU
+ * @details the scalar kernel runs until then, called by createVisibility
+ * Requires:
+    - no culling running
+ */
+void visibilityKernelSelect(void);
+
+/**
+ * @brief culls random bounds with SIMD and scalar kernels and compares the visible lists
+ * Requires:
+    - visibilityKernelSelect called, the scalar kernel would only be compared with itself
+ * @return number of mismatching lists, 0 when kernels agree
+ */
+uint32_t visibilityKernelVerify(uint32_t count, uint32_t rounds);
+
+/**
+ * @brief name of kernel selected by visibilityKernelCull
+ */
+const char* visibilityKernelName(void);
+
+void destroyVisibility(State* state);
+
+#endif // __VISIBILITY_H__
@@ -0,0 +1,615 @@
+/**
+ * @file frame_consumer.c
+ * @brief reference consumer of frames exported with --export
+ *
+ * imports the exported images on the same device, copies every announced frame to host memory,
+ * checks that something was rendered and releases the image back to the renderer
+ *
+ * usage: frame_consumer socket [--frames count]
+ * exits with failure when any received frame is blank
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "debug.h"
+#include "export_protocol.h"
+#include "log.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <vulkan/vulkan_core.h>
+
+typedef struct Consumer
+{
+    VkInstance instance;
+    VkPhysicalDevice physicalDevice;
+    VkDevice device;
+    VkQueue queue;
+    uint32_t queueFamilyIndex;
+    VkBool32 syncFd;
+    PFN_vkImportSemaphoreFdKHR importSemaphoreFd;
+
+    VkCommandPool commandPool;
+    VkCommandBuffer commandBuffer;
+    VkFence fence;
+    VkSemaphore frameReady;
+
+    // images of the current configuration, recreated when the renderer resizes
+    uint32_t generation;
+    uint32_t imageCount;
+    VkImage images[EXPORT_MAX_IMAGES];
+    VkDeviceMemory memory[EXPORT_MAX_IMAGES];
+    VkExtent2D extent;
+
+    VkBuffer readback;
+    VkDeviceMemory readbackMemory;
+    uint32_t* pixels;
+} Consumer;
+
+// receives one message, returns number of fds that came with it or -1 when the renderer is gone
+static int receiveMessage(int socket, ExportMessage* message, int* fds)
+{
+    struct iovec iov = {
+        .iov_base = message,
+        .iov_len = sizeof(*message),
+    };
+
+    union {
+        struct cmsghdr header;
+        char buffer[CMSG_SPACE(sizeof(int) * EXPORT_MAX_IMAGES)];
+    } control;
+
+    struct msghdr msg = {
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+        .msg_control = control.buffer,
+        .msg_controllen = sizeof(control.buffer),
+    };
+
+    if (recvmsg(socket, &msg, MSG_CMSG_CLOEXEC) != (ssize_t) sizeof(*message)) {
+        return -1;
+    }
+
+    int fdCount = 0;
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg))
+    {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+            fdCount = (int) ((cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+            memcpy(fds, CMSG_DATA(cmsg), sizeof(int) * fdCount);
+        }
+    }
+
+    return fdCount;
+}
+
+static uint32_t findMemory(Consumer* consumer, uint32_t typeFilter, VkMemoryPropertyFlags properties)
+{
+    VkPhysicalDeviceMemoryProperties memProps;
+    vkGetPhysicalDeviceMemoryProperties(consumer->physicalDevice, &memProps);
+
+    for (uint32_t i = 0; i < memProps.memoryTypeCount; i++)
+    {
+        if ((typeFilter & (1u << i)) && (memProps.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+
+    assert_my(0, "no suitable memory type", "");
+    return 0;
+}
+
+static VkBool32 hasDeviceExtension(VkPhysicalDevice physicalDevice, const char* name)
+{
+    uint32_t count;
+    vkEnumerateDeviceExtensionProperties(physicalDevice, NULL, &count, NULL);
+    VkExtensionProperties* extensions = malloc(sizeof(VkExtensionProperties) * count);
+    vkEnumerateDeviceExtensionProperties(physicalDevice, NULL, &count, extensions);
+
+    VkBool32 found = VK_FALSE;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        found |= strcmp(extensions[i].extensionName, name) == 0;
+    }
+
+    free(extensions);
+    return found;
+}
+
+// imported memory is only meaningful on the physical device that exported it
+static void createDevice(Consumer* consumer, const ExportMessage* configure)
+{
+    VkApplicationInfo appInf = {
+        .sType = VK_STRUCTURE_TYPE_APPLICATION_INFO,
+        .pNext = NULL,
+        .pApplicationName = "frame consumer",
+        .applicationVersion = VK_MAKE_VERSION(1, 0, 0),
+        .pEngineName = "No Engine",
+        .engineVersion = VK_MAKE_VERSION(1, 0, 0),
+        .apiVersion = VK_API_VERSION_1_2,
+    };
+
+    VkInstanceCreateInfo instanceCrtInf = {
+        .sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .pApplicationInfo = &appInf,
+        .enabledLayerCount = 0,
+        .ppEnabledLayerNames = NULL,
+        .enabledExtensionCount = 0,
+        .ppEnabledExtensionNames = NULL,
+    };
+
+    assertVk(vkCreateInstance(&instanceCrtInf, NULL, &consumer->instance), "failed to create instance", "created instance");
+
+    uint32_t deviceCount;
+    vkEnumeratePhysicalDevices(consumer->instance, &deviceCount, NULL);
+    VkPhysicalDevice* devices = malloc(sizeof(VkPhysicalDevice) * deviceCount);
+    vkEnumeratePhysicalDevices(consumer->instance, &deviceCount, devices);
+
+    consumer->physicalDevice = VK_NULL_HANDLE;
+    for (uint32_t i = 0; i < deviceCount; i++)
+    {
+        VkPhysicalDeviceIDProperties idProps = {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES,
+            .pNext = NULL,
+        };
+
+        VkPhysicalDeviceProperties2 props = {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+            .pNext = &idProps,
+        };
+
+        vkGetPhysicalDeviceProperties2(devices[i], &props);
+
+        if (memcmp(idProps.deviceUUID, configure->deviceUUID, VK_UUID_SIZE) == 0 &&
+            memcmp(idProps.driverUUID, configure->driverUUID, VK_UUID_SIZE) == 0) {
+            consumer->physicalDevice = devices[i];
+            LOG("using %s", props.properties.deviceName);
+            break;
+        }
+    }
+    free(devices);
+
+    assert_my(consumer->physicalDevice != VK_NULL_HANDLE, "renderer device not found, memory can not be imported", "");
+    assert_my(hasDeviceExtension(consumer->physicalDevice, VK_KHR_EXTERNAL_MEMORY_FD_EXTENSION_NAME),
+        "device can not import memory fds", "device imports memory fds");
+
+    // any queue can copy, graphics and compute queues implicitly support transfers
+    uint32_t familyCount;
+    vkGetPhysicalDeviceQueueFamilyProperties(consumer->physicalDevice, &familyCount, NULL);
+    VkQueueFamilyProperties* families = malloc(sizeof(VkQueueFamilyProperties) * familyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(consumer->physicalDevice, &familyCount, families);
+
+    consumer->queueFamilyIndex = UINT32_MAX;
+    for (uint32_t i = 0; i < familyCount && consumer->queueFamilyIndex == UINT32_MAX; i++)
+    {
+        if (families[i].queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT)) {
+            consumer->queueFamilyIndex = i;
+        }
+    }
+    free(families);
+    assert_my(consumer->queueFamilyIndex != UINT32_MAX, "no queue family can copy", "");
+
+    const char* extensions[2] = {VK_KHR_EXTERNAL_MEMORY_FD_EXTENSION_NAME};
+    uint32_t extensionCount = 1;
+
+    consumer->syncFd = hasDeviceExtension(consumer->physicalDevice, VK_KHR_EXTERNAL_SEMAPHORE_FD_EXTENSION_NAME);
+    if (consumer->syncFd) {
+        extensions[extensionCount++] = VK_KHR_EXTERNAL_SEMAPHORE_FD_EXTENSION_NAME;
+    }
+
+    float priority = 1;
+    VkDeviceQueueCreateInfo queueCrtInf = {
+        .sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .queueFamilyIndex = consumer->queueFamilyIndex,
+        .queueCount = 1,
+        .pQueuePriorities = &priority,
+    };
+
+    VkDeviceCreateInfo deviceCrtInf = {
+        .sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .queueCreateInfoCount = 1,
+        .pQueueCreateInfos = &queueCrtInf,
+        .enabledExtensionCount = extensionCount,
+        .ppEnabledExtensionNames = extensions,
+        .enabledLayerCount = 0,
+        .ppEnabledLayerNames = NULL,
+        .pEnabledFeatures = NULL,
+    };
+
+    assertVk(vkCreateDevice(consumer->physicalDevice, &deviceCrtInf, NULL, &consumer->device), "failed to create device", "created device");
+    vkGetDeviceQueue(consumer->device, consumer->queueFamilyIndex, 0, &consumer->queue);
+
+    if (consumer->syncFd) {
+        consumer->importSemaphoreFd = (PFN_vkImportSemaphoreFdKHR) vkGetDeviceProcAddr(consumer->device, "vkImportSemaphoreFdKHR");
+        consumer->syncFd = consumer->importSemaphoreFd != NULL;
+    }
+
+    VkCommandPoolCreateInfo poolCrtInf = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+        .pNext = NULL,
+        .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+        .queueFamilyIndex = consumer->queueFamilyIndex,
+    };
+
+    assertVk(vkCreateCommandPool(consumer->device, &poolCrtInf, NULL, &consumer->commandPool), "failed to create command pool", "created command pool");
+
+    VkCommandBufferAllocateInfo allocInf = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .pNext = NULL,
+        .commandPool = consumer->commandPool,
+        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+        .commandBufferCount = 1,
+    };
+
+    assertVk(vkAllocateCommandBuffers(consumer->device, &allocInf, &consumer->commandBuffer), "failed to allocate command buffer", "allocated command buffer");
+
+    VkFenceCreateInfo fenceCrtInf = {
+        .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+    };
+
+    assertVk(vkCreateFence(consumer->device, &fenceCrtInf, NULL, &consumer->fence), "failed to create fence", "created fence");
+
+    // sync files are imported temporarily, the semaphore returns to its empty payload after each wait
+    VkSemaphoreCreateInfo semCrtInf = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+    };
+
+    assertVk(vkCreateSemaphore(consumer->device, &semCrtInf, NULL, &consumer->frameReady), "failed to create semaphore", "created semaphore");
+}
+
+static void destroyImages(Consumer* consumer)
+{
+    for (uint32_t i = 0; i < consumer->imageCount; i++)
+    {
+        vkDestroyImage(consumer->device, consumer->images[i], NULL);
+        vkFreeMemory(consumer->device, consumer->memory[i], NULL);
+    }
+
+    if (consumer->readback != VK_NULL_HANDLE) {
+        vkDestroyBuffer(consumer->device, consumer->readback, NULL);
+        vkFreeMemory(consumer->device, consumer->readbackMemory, NULL);
+    }
+
+    consumer->imageCount = 0;
+    consumer->readback = VK_NULL_HANDLE;
+}
+
+// images must match the exported ones exactly, the memory only carries their content
+static void importImages(Consumer* consumer, const ExportMessage* configure, const int* fds)
+{
+    assert_my(configure->version == EXPORT_PROTOCOL_VERSION, "renderer speaks a different protocol version", "");
+    assert_my(configure->imageCount <= EXPORT_MAX_IMAGES, "too many exported images", "");
+
+    // readback assumes 4 byte texels, which covers the swapchain formats the renderer picks
+    assert_my(configure->format == VK_FORMAT_B8G8R8A8_SRGB || configure->format == VK_FORMAT_B8G8R8A8_UNORM ||
+        configure->format == VK_FORMAT_R8G8B8A8_SRGB || configure->format == VK_FORMAT_R8G8B8A8_UNORM,
+        "exported format is not 4 bytes per texel", "");
+
+    vkDeviceWaitIdle(consumer->device);
+    destroyImages(consumer);
+
+    consumer->generation = configure->generation;
+    consumer->imageCount = configure->imageCount;
+    consumer->extent.width = configure->width;
+    consumer->extent.height = configure->height;
+
+    for (uint32_t i = 0; i < configure->imageCount; i++)
+    {
+        VkExternalMemoryImageCreateInfo externalInf = {
+            .sType = VK_STRUCTURE_TYPE_EXTERNAL_MEMORY_IMAGE_CREATE_INFO,
+            .pNext = NULL,
+            .handleTypes = VK_EXTERNAL_MEMORY_HANDLE_TYPE_OPAQUE_FD_BIT,
+        };
+
+        VkImageCreateInfo imageCrtInf = {
+            .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+            .pNext = &externalInf,
+            .flags = 0,
+            .imageType = VK_IMAGE_TYPE_2D,
+            .format = (VkFormat) configure->format,
+            .extent = {configure->width, configure->height, 1},
+            .mipLevels = 1,
+            .arrayLayers = 1,
+            .samples = VK_SAMPLE_COUNT_1_BIT,
+            .tiling = VK_IMAGE_TILING_OPTIMAL,
+            .usage = configure->usage,
+            .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+            .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        };
+
+        assertVk(vkCreateImage(consumer->device, &imageCrtInf, NULL, &consumer->images[i]), "failed to create imported image", "created imported image");
+
+        VkMemoryRequirements memReq;
+        vkGetImageMemoryRequirements(consumer->device, consumer->images[i], &memReq);
+        assert_my(memReq.size <= configure->memorySize[i], "exported memory is smaller than the image needs", "");
+
+        VkMemoryDedicatedAllocateInfo dedicatedInf = {
+            .sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO,
+            .pNext = NULL,
+            .image = consumer->images[i],
+            .buffer = VK_NULL_HANDLE,
+        };
+
+        // successful import takes ownership of the fd
+        VkImportMemoryFdInfoKHR importInf = {
+            .sType = VK_STRUCTURE_TYPE_IMPORT_MEMORY_FD_INFO_KHR,
+            .pNext = &dedicatedInf,
+            .handleType = VK_EXTERNAL_MEMORY_HANDLE_TYPE_OPAQUE_FD_BIT,
+            .fd = fds[i],
+        };
+
+        VkMemoryAllocateInfo allocInf = {
+            .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+            .pNext = &importInf,
+            .allocationSize = configure->memorySize[i],
+            .memoryTypeIndex = findMemory(consumer, memReq.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT),
+        };
+
+        assertVk(vkAllocateMemory(consumer->device, &allocInf, NULL, &consumer->memory[i]), "failed to import image memory", "imported image memory");
+        vkBindImageMemory(consumer->device, consumer->images[i], consumer->memory[i], 0);
+    }
+
+    VkBufferCreateInfo bufferCrtInf = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .size = (VkDeviceSize) configure->width * configure->height * 4,
+        .usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+    };
+
+    assertVk(vkCreateBuffer(consumer->device, &bufferCrtInf, NULL, &consumer->readback), "failed to create readback buffer", "created readback buffer");
+
+    VkMemoryRequirements memReq;
+    vkGetBufferMemoryRequirements(consumer->device, consumer->readback, &memReq);
+
+    VkMemoryAllocateInfo allocInf = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+        .pNext = NULL,
+        .allocationSize = memReq.size,
+        .memoryTypeIndex = findMemory(consumer, memReq.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT),
+    };
+
+    assertVk(vkAllocateMemory(consumer->device, &allocInf, NULL, &consumer->readbackMemory), "failed to allocate readback memory", "allocated readback memory");
+    vkBindBufferMemory(consumer->device, consumer->readback, consumer->readbackMemory, 0);
+    vkMapMemory(consumer->device, consumer->readbackMemory, 0, VK_WHOLE_SIZE, 0, (void**) &consumer->pixels);
+
+    LOG("imported %u images %ux%u, generation %u, synchronized by %s", configure->imageCount, configure->width, configure->height,
+        configure->generation, consumer->syncFd ? "sync file" : "fence");
+}
+
+// copies the frame to host memory, the image can be released once the fence signaled
+static void readFrame(Consumer* consumer, uint32_t imageIndex, int syncFd)
+{
+    VkBool32 waitSync = VK_FALSE;
+
+    if (syncFd >= 0 && consumer->syncFd) {
+        VkImportSemaphoreFdInfoKHR importInf = {
+            .sType = VK_STRUCTURE_TYPE_IMPORT_SEMAPHORE_FD_INFO_KHR,
+            .pNext = NULL,
+            .semaphore = consumer->frameReady,
+            .flags = VK_SEMAPHORE_IMPORT_TEMPORARY_BIT,
+            .handleType = VK_EXTERNAL_SEMAPHORE_HANDLE_TYPE_SYNC_FD_BIT,
+            .fd = syncFd,
+        };
+
+        assertVk(consumer->importSemaphoreFd(consumer->device, &importInf), "failed to import sync file", "imported sync file");
+        waitSync = VK_TRUE;
+    }
+    else if (syncFd >= 0) {
+        // device can not wait on it, the renderer's frame may still be running
+        LOG_WARN("sync file received but not importable, reading without waiting");
+        close(syncFd);
+    }
+
+    VkCommandBufferBeginInfo beginInf = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .pNext = NULL,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+        .pInheritanceInfo = NULL,
+    };
+
+    vkResetCommandBuffer(consumer->commandBuffer, 0);
+    assertVk(vkBeginCommandBuffer(consumer->commandBuffer, &beginInf), "failed to begin command buffer", "");
+
+    // acquire half of the renderer's release, layouts match on both sides
+    VkImageMemoryBarrier acquire = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .pNext = NULL,
+        .srcAccessMask = 0,
+        .dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
+        .oldLayout = VK_IMAGE_LAYOUT_GENERAL,
+        .newLayout = VK_IMAGE_LAYOUT_GENERAL,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_EXTERNAL,
+        .dstQueueFamilyIndex = consumer->queueFamilyIndex,
+        .image = consumer->images[imageIndex],
+        .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1},
+    };
+
+    vkCmdPipelineBarrier(consumer->commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+        0, NULL, 0, NULL, 1, &acquire);
+
+    VkBufferImageCopy region = {
+        .bufferOffset = 0,
+        .bufferRowLength = 0,
+        .bufferImageHeight = 0,
+        .imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1},
+        .imageOffset = {0, 0, 0},
+        .imageExtent = {consumer->extent.width, consumer->extent.height, 1},
+    };
+
+    vkCmdCopyImageToBuffer(consumer->commandBuffer, consumer->images[imageIndex], VK_IMAGE_LAYOUT_GENERAL, consumer->readback, 1, &region);
+
+    VkBufferMemoryBarrier toHost = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+        .pNext = NULL,
+        .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_HOST_READ_BIT,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .buffer = consumer->readback,
+        .offset = 0,
+        .size = VK_WHOLE_SIZE,
+    };
+
+    vkCmdPipelineBarrier(consumer->commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+        0, NULL, 1, &toHost, 0, NULL);
+
+    assertVk(vkEndCommandBuffer(consumer->commandBuffer), "failed to record copy", "");
+
+    VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+
+    VkSubmitInfo submitInf = {
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .pNext = NULL,
+        .waitSemaphoreCount = waitSync ? 1 : 0,
+        .pWaitSemaphores = &consumer->frameReady,
+        .pWaitDstStageMask = &waitStage,
+        .commandBufferCount = 1,
+        .pCommandBuffers = &consumer->commandBuffer,
+        .signalSemaphoreCount = 0,
+        .pSignalSemaphores = NULL,
+    };
+
+    assertVk(vkQueueSubmit(consumer->queue, 1, &submitInf, consumer->fence), "failed to submit copy", "");
+    vkWaitForFences(consumer->device, 1, &consumer->fence, VK_TRUE, UINT64_MAX);
+    vkResetFences(consumer->device, 1, &consumer->fence);
+}
+
+static void sendRelease(int socket, uint32_t generation, uint32_t imageIndex, uint64_t frame)
+{
+    ExportMessage release = {
+        .type = EXPORT_MESSAGE_RELEASE,
+        .version = EXPORT_PROTOCOL_VERSION,
+        .generation = generation,
+        .imageIndex = imageIndex,
+        .frame = frame,
+    };
+
+    send(socket, &release, sizeof(release), MSG_NOSIGNAL);
+}
+
+int main(int argc, char** argv)
+{
+    const char* socketPath = NULL;
+    // 0 -> until the renderer closes the connection
+    uint64_t frameLimit = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            frameLimit = strtoull(argv[++i], NULL, 10);
+        }
+        else if (socketPath == NULL && argv[i][0] != '-') {
+            socketPath = argv[i];
+        }
+        else
+        {
+            socketPath = NULL;
+            break;
+        }
+    }
+
+    if (socketPath == NULL) {
+        fprintf(stderr, "usage: %s socket [--frames count]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    logInit();
+
+    struct sockaddr_un address = {
+        .sun_family = AF_UNIX,
+    };
+    assert_my(strlen(socketPath) < sizeof(address.sun_path), "socket path too long", "");
+    snprintf(address.sun_path, sizeof(address.sun_path), "%s", socketPath);
+
+    int socketFd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+    assert_my(socketFd >= 0, "failed to create socket", "");
+    assert_my(connect(socketFd, (struct sockaddr*) &address, sizeof(address)) == 0, "failed to connect to renderer", "connected to renderer");
+
+    Consumer consumer = {0};
+    uint64_t received = 0;
+    uint64_t blank = 0;
+
+    ExportMessage message;
+    int fds[EXPORT_MAX_IMAGES];
+    int fdCount;
+
+    while ((frameLimit == 0 || received < frameLimit) && (fdCount = receiveMessage(socketFd, &message, fds)) >= 0)
+    {
+        if (message.type == EXPORT_MESSAGE_CONFIGURE) {
+            assert_my(fdCount == (int) message.imageCount, "configuration without memory fds", "");
+
+            if (consumer.device == VK_NULL_HANDLE) {
+                createDevice(&consumer, &message);
+            }
+            importImages(&consumer, &message, fds);
+            continue;
+        }
+
+        assert_my(message.type == EXPORT_MESSAGE_FRAME && consumer.imageCount > 0, "unexpected message", "");
+        int syncFd = fdCount > 0 ? fds[0] : -1;
+
+        // sent before the renderer's resize reached us, the image it names is gone
+        if (message.generation != consumer.generation || message.imageIndex >= consumer.imageCount) {
+            if (syncFd >= 0) {
+                close(syncFd);
+            }
+            continue;
+        }
+
+        readFrame(&consumer, message.imageIndex, syncFd);
+
+        // renderer may overwrite the image as soon as it knows the copy finished
+        sendRelease(socketFd, message.generation, message.imageIndex, message.frame);
+
+        // FNV-1a over the frame, identical frames give identical checksums
+        uint64_t texelCount = (uint64_t) consumer.extent.width * consumer.extent.height;
+        uint64_t lit = 0;
+        uint32_t checksum = 2166136261u;
+        for (uint64_t i = 0; i < texelCount; i++)
+        {
+            uint32_t texel = consumer.pixels[i];
+            lit += (texel & 0x00ffffffu) != 0;
+            checksum = (checksum ^ texel) * 16777619u;
+        }
+
+        blank += lit == 0;
+        received++;
+
+        printf("frame %llu image %u lit %.2f%% checksum %08x\n", (unsigned long long) message.frame, message.imageIndex,
+            100.0 * (double) lit / (double) texelCount, checksum);
+    }
+
+    close(socketFd);
+
+    if (consumer.device != VK_NULL_HANDLE) {
+        vkDeviceWaitIdle(consumer.device);
+        destroyImages(&consumer);
+        vkDestroySemaphore(consumer.device, consumer.frameReady, NULL);
+        vkDestroyFence(consumer.device, consumer.fence, NULL);
+        vkDestroyCommandPool(consumer.device, consumer.commandPool, NULL);
+        vkDestroyDevice(consumer.device, NULL);
+        vkDestroyInstance(consumer.instance, NULL);
+    }
+
+    printf("received %llu frames, %llu blank\n", (unsigned long long) received, (unsigned long long) blank);
+
+    logShutdown();
+
+    return blank == 0 && received > 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}